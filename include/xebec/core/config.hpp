@@ -4,14 +4,31 @@
 
 namespace xebec {
 
+// How connections are driven. IoUring is Linux only and falls back to Threads
+// when the kernel does not support it.
+enum class IoBackend { Threads, IoUring };
+
 // Configuration structure for server settings
 struct ServerConfig {
     int port = 8080;
     std::string host = "0.0.0.0";
-    size_t thread_pool_size = 4;
+    size_t thread_pool_size = 4;           // Handler threads of the io_uring backend
     size_t max_request_size = 1024 * 1024; // 1MB
+    int keep_alive_timeout_ms = 5000;      // Idle time before a keep-alive connection is closed
+    size_t max_keep_alive_requests = 1000; // Requests served on one connection before it is closed
     std::string ssl_cert_path;
     std::string ssl_key_path;
+    bool enable_ktls = true;               // Kernel TLS offload when built with XEBEC_ENABLE_TLS on Linux
+    int tls_handshake_timeout_ms = 10000;  // Time a client has to complete the TLS handshake
+    bool enable_http2 = true;              // h2c (prior knowledge or Upgrade) and h2 over TLS via ALPN
+    size_t http2_max_concurrent_streams = 100;
+    size_t http2_max_handlers = 8;         // Handlers running at once per HTTP/2 connection; other requests wait
+    size_t sse_history = 1024;             // Events per channel kept for Last-Event-ID replay
+    int sse_heartbeat_ms = 15000;          // Comment sent on idle event streams; 0 disables it
+    size_t sse_max_channels = 10000;       // Event channels with subscribers or history at once
+    double trace_sample_rate = 0;          // Fraction of requests traced (see Tracer); 0 disables tracing
+    IoBackend io_backend = IoBackend::Threads; // IoUring: one event loop thread for plain HTTP/1.1
+    bool log_requests = false;             // Print each request and its response size to stdout
     bool enable_cors = false;
     std::string cors_origin = "*";
     std::vector<std::string> allowed_methods = {"GET", "POST", "PUT", "DELETE", "PATCH"};
@@ -0,0 +1,53 @@
+#pragma once
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace xebec {
+
+// One encoding of an embedded file and its entity tag.
+struct EmbeddedVariant {
+    std::string_view data;
+    std::string_view etag;
+
+    bool present() const { return !etag.empty(); }
+};
+
+struct EmbeddedFile {
+    std::string_view path;           // "/css/site.css"
+    std::string_view content_type;
+    EmbeddedVariant identity;
+    EmbeddedVariant gzip;            // absent unless a smaller site.css.gz was packed
+    EmbeddedVariant br;
+};
+
+// Hash of a path under a seed, shared by tools/xebec_embed.cpp and lookups.
+inline uint32_t embedded_hash(std::string_view key, uint32_t seed) {
+    uint64_t hash = 0xcbf29ce484222325ull ^ (seed * 0x9E3779B97F4A7C15ull);
+    for (unsigned char c : key) hash = (hash ^ c) * 0x100000001b3ull;
+    hash ^= hash >> 31;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+// A directory packed into the binary by tools/xebec_embed.cpp. Paths are found
+// with a perfect hash (hash and displace): the path's bucket gives a seed under
+// which every path of the bucket lands in its own slot, so a lookup is two
+// hashes and one comparison.
+struct EmbeddedDirectory {
+    const EmbeddedFile* files;
+    size_t file_count;
+    const uint32_t* seeds;           // per bucket
+    size_t bucket_count;
+    const uint32_t* slots;           // file index, or file_count for an empty slot
+    size_t slot_count;
+
+    const EmbeddedFile* find(std::string_view path) const {
+        uint32_t seed = seeds[embedded_hash(path, 0) % bucket_count];
+        uint32_t index = slots[embedded_hash(path, seed) % slot_count];
+        if (index >= file_count || files[index].path != path) return nullptr;
+        return &files[index];
+    }
+};
+
+} // namespace xebec
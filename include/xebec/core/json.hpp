@@ -0,0 +1,770 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <type_traits>
+#include "error.hpp"
+#include "../utils/cpu_features.hpp"
+#include "../utils/url.hpp"
+
+namespace xebec {
+
+// Malformed or unexpected JSON in a request body. It is an HttpError, so an
+// uncaught one becomes a 400 response.
+class JsonError : public HttpError {
+public:
+    explicit JsonError(const std::string& message) : HttpError(400, "Invalid JSON: " + message) {}
+};
+
+namespace detail {
+
+inline int count_trailing_zeros(uint64_t bits) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// First byte in [p, end) that a JSON string cannot hold as is: '"', '\\' or a
+// control character.
+inline const char* find_json_escape(const char* p, const char* end) {
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+                                    _mm_cmpeq_epi8(_mm_max_epu8(block, control), control));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) return p + count_trailing_zeros(static_cast<uint64_t>(mask));
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\' || c < 0x20) return p;
+    }
+    return end;
+}
+
+// Character classes of one 64-byte block, one bit per byte.
+struct JsonBlock {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t structural = 0;  // { } [ ] : ,
+    uint64_t whitespace = 0;
+};
+
+inline void json_classify_scalar(const char* p, JsonBlock& block) {
+    block = JsonBlock();
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ULL << i;
+        switch (p[i]) {
+            case '"': block.quote |= bit; break;
+            case '\\': block.backslash |= bit; break;
+            case '{': case '}': case '[': case ']': case ':': case ',': block.structural |= bit; break;
+            case ' ': case '\t': case '\n': case '\r': block.whitespace |= bit; break;
+            default: break;
+        }
+    }
+}
+
+#ifdef XEBEC_X86
+
+// '[' and ']' are '{' and '}' without the 0x20 bit, so four compares find all six structurals.
+#if defined(__SSE2__) || defined(_M_X64)
+inline void json_classify_sse2(const char* p, JsonBlock& block) {
+    block = JsonBlock();
+    for (int i = 0; i < 4; i++) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+        __m128i folded = _mm_or_si128(bytes, _mm_set1_epi8(0x20));
+        __m128i structural = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(':')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(','))));
+        __m128i whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\r'))));
+        int shift = i * 16;
+        block.quote |= static_cast<uint64_t>(static_cast<uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'))))) << shift;
+        block.backslash |= static_cast<uint64_t>(static_cast<uint16_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\'))))) << shift;
+        block.structural |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(structural))) << shift;
+        block.whitespace |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(whitespace))) << shift;
+    }
+}
+#endif
+
+XEBEC_TARGET("avx2") inline void json_classify_avx2(const char* p, JsonBlock& block) {
+    block = JsonBlock();
+    for (int i = 0; i < 2; i++) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 32));
+        __m256i folded = _mm256_or_si256(bytes, _mm256_set1_epi8(0x20));
+        __m256i structural = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(','))));
+        __m256i whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\r'))));
+        int shift = i * 32;
+        block.quote |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"'))))) << shift;
+        block.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\'))))) << shift;
+        block.structural |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(structural))) << shift;
+        block.whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(whitespace))) << shift;
+    }
+}
+
+#endif // XEBEC_X86
+
+using JsonClassifier = void (*)(const char*, JsonBlock&);
+
+inline JsonClassifier json_classifier() {
+#ifdef XEBEC_X86
+    if (cpu_features().avx2) return json_classify_avx2;
+#if defined(__SSE2__) || defined(_M_X64)
+    return json_classify_sse2;
+#endif
+#endif
+    return json_classify_scalar;
+}
+
+// Bits of the characters escaped by a backslash. Backslashes are rare, so they
+// are walked one by one. `carry` holds a backslash left open at the block end.
+inline uint64_t json_escaped(uint64_t backslash, uint64_t& carry) {
+    uint64_t escaped = carry;
+    if (carry) backslash &= ~1ULL;
+    carry = 0;
+    while (backslash) {
+        int i = count_trailing_zeros(backslash);
+        if (i == 63) {
+            carry = 1;
+            break;
+        }
+        escaped |= 2ULL << i;
+        backslash &= ~(3ULL << i);
+    }
+    return escaped;
+}
+
+// Bit i is the XOR of bits 0..i: set from an opening quote up to its closing one.
+inline uint64_t prefix_xor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// Stage one, as in simdjson: classify 64 bytes at a time with SIMD and keep the
+// offsets of structural characters, opening quotes and the first byte of each
+// number or literal. Every JSON value then starts at an index entry.
+inline void json_build_index(std::string_view input, std::vector<uint32_t>& index,
+                             JsonClassifier classify = json_classifier()) {
+    index.clear();
+    uint64_t escape_carry = 0;
+    uint64_t in_string_carry = 0;
+    uint64_t scalar_carry = 0;
+    char tail[64];
+    for (size_t offset = 0; offset < input.size(); offset += 64) {
+        const char* p = input.data() + offset;
+        if (input.size() - offset < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, p, input.size() - offset);
+            p = tail;
+        }
+        JsonBlock block;
+        classify(p, block);
+
+        uint64_t quotes = block.quote & ~json_escaped(block.backslash, escape_carry);
+        uint64_t in_string = prefix_xor(quotes) ^ in_string_carry;
+        in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+        uint64_t scalar = ~(block.structural | block.whitespace | block.quote) & ~in_string;
+        uint64_t scalar_start = scalar & ~((scalar << 1) | scalar_carry);
+        scalar_carry = scalar >> 63;
+
+        uint64_t bits = (block.structural & ~in_string) | (quotes & in_string) | scalar_start;
+        while (bits) {
+            index.push_back(static_cast<uint32_t>(offset + count_trailing_zeros(bits)));
+            bits &= bits - 1;
+        }
+    }
+    if (in_string_carry) throw JsonError("unterminated string");
+}
+
+inline void append_utf8(std::string& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out += static_cast<char>(code_point);
+    } else if (code_point < 0x800) {
+        out += static_cast<char>(0xC0 | (code_point >> 6));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        out += static_cast<char>(0xE0 | (code_point >> 12));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code_point >> 18));
+        out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code_point & 0x3F));
+    }
+}
+
+} // namespace detail
+
+// Writes JSON straight into a string, usually a response body:
+//
+//     res.json().begin_object().field("id", 7).field("name", name).end_object();
+//
+// Commas are placed automatically, strings are escaped and numbers formatted
+// with std::to_chars.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    JsonWriter& begin_object() {
+        separator();
+        out_ += '{';
+        return *this;
+    }
+
+    JsonWriter& end_object() {
+        out_ += '}';
+        return *this;
+    }
+
+    JsonWriter& begin_array() {
+        separator();
+        out_ += '[';
+        return *this;
+    }
+
+    JsonWriter& end_array() {
+        out_ += ']';
+        return *this;
+    }
+
+    JsonWriter& key(std::string_view name) {
+        separator();
+        write_string(name);
+        out_ += ':';
+        return *this;
+    }
+
+    JsonWriter& value(std::string_view text) {
+        separator();
+        write_string(text);
+        return *this;
+    }
+
+    JsonWriter& value(const std::string& text) { return value(std::string_view(text)); }
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+
+    JsonWriter& value(bool flag) {
+        separator();
+        out_ += flag ? "true" : "false";
+        return *this;
+    }
+
+    JsonWriter& value(std::nullptr_t) {
+        separator();
+        out_ += "null";
+        return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                                                  !std::is_same<T, char>::value, int>::type = 0>
+    JsonWriter& value(T number) {
+        separator();
+        char buffer[24];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out_.append(buffer, result.ptr);
+        return *this;
+    }
+
+    // Shortest round-trip form; NaN and infinities have no JSON form and are written as null.
+    JsonWriter& value(double number) {
+        separator();
+        if (!std::isfinite(number)) {
+            out_ += "null";
+            return *this;
+        }
+        char buffer[32];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+        out_.append(buffer, result.ptr);
+#else
+        int length = std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+        out_.append(buffer, static_cast<size_t>(length));
+#endif
+        return *this;
+    }
+
+    JsonWriter& value(float number) { return value(static_cast<double>(number)); }
+
+    // An already serialized JSON value, copied as is.
+    JsonWriter& raw(std::string_view json) {
+        separator();
+        out_.append(json.data(), json.size());
+        return *this;
+    }
+
+    template <typename T>
+    JsonWriter& field(std::string_view name, const T& field_value) {
+        key(name);
+        return value(field_value);
+    }
+
+    JsonWriter& field(std::string_view name, const char* field_value) {
+        key(name);
+        return value(field_value);
+    }
+
+    static void escape(std::string_view text, std::string& out) {
+        static const char digits[] = "0123456789abcdef";
+        const char* p = text.data();
+        const char* end = p + text.size();
+        while (p < end) {
+            const char* special = detail::find_json_escape(p, end);
+            out.append(p, special);
+            if (special == end) break;
+            unsigned char c = static_cast<unsigned char>(*special);
+            switch (c) {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                default: {
+                    char unicode[6] = {'\\', 'u', '0', '0', digits[c >> 4], digits[c & 0xF]};
+                    out.append(unicode, sizeof(unicode));
+                }
+            }
+            p = special + 1;
+        }
+    }
+
+private:
+    std::string& out_;
+
+    // A value needs a comma unless it opens the container or follows its key.
+    void separator() {
+        if (out_.empty()) return;
+        char last = out_.back();
+        if (last != '{' && last != '[' && last != ':') out_ += ',';
+    }
+
+    void write_string(std::string_view text) {
+        out_ += '"';
+        escape(text, out_);
+        out_ += '"';
+    }
+};
+
+class JsonDocument;
+class JsonValue;
+
+enum class JsonType { Object, Array, String, Number, Bool, Null };
+
+struct JsonField;
+
+// A value inside a JsonDocument. Nothing is parsed until it is asked for, and
+// strings are views into the input unless they contain escapes.
+class JsonValue {
+public:
+    JsonValue() = default;
+
+    // False for the result of find() on a missing key.
+    explicit operator bool() const { return document_ != nullptr; }
+
+    JsonType type() const;
+    bool is_null() const { return type() == JsonType::Null; }
+
+    std::string_view get_string() const;
+    long long get_int() const;
+    double get_double() const;
+    bool get_bool() const;
+
+    // The member named `name`; throws JsonError when it is missing.
+    JsonValue operator[](std::string_view name) const;
+    // The member named `name`, or an empty JsonValue.
+    JsonValue find(std::string_view name) const;
+    // The element at `position` of an array; throws JsonError when out of range.
+    JsonValue operator[](size_t position) const;
+    size_t size() const;
+
+    // The value's JSON text as it appears in the input.
+    std::string_view raw() const;
+
+    class ArrayRange;
+    class ObjectRange;
+    ArrayRange array() const;
+    ObjectRange object() const;
+
+private:
+    friend class JsonDocument;
+    const JsonDocument* document_ = nullptr;
+    uint32_t entry_ = 0;
+
+    JsonValue(const JsonDocument* document, uint32_t entry) : document_(document), entry_(entry) {}
+    char first() const;
+    void expect(char c, const char* what) const;
+};
+
+struct JsonField {
+    std::string_view key;
+    JsonValue value;
+};
+
+// A parsed JSON text. Construction runs stage one (the SIMD structural index)
+// and matches brackets; values are decoded when accessed. The input must outlive
+// the document, and the document every value taken from it.
+class JsonDocument {
+public:
+    explicit JsonDocument(std::string_view input) : input_(input) {
+        detail::json_build_index(input_, index_);
+        if (index_.empty()) throw JsonError("empty document");
+        match_.assign(index_.size(), 0);
+        std::vector<uint32_t> open;
+        for (uint32_t i = 0; i < index_.size(); i++) {
+            char c = input_[index_[i]];
+            if (c == '{' || c == '[') {
+                open.push_back(i);
+            } else if (c == '}' || c == ']') {
+                if (open.empty() || input_[index_[open.back()]] != (c == '}' ? '{' : '[')) {
+                    throw JsonError("unbalanced '" + std::string(1, c) + "' at offset " + std::to_string(index_[i]));
+                }
+                match_[open.back()] = i;
+                open.pop_back();
+            }
+        }
+        if (!open.empty()) throw JsonError("unclosed container at offset " + std::to_string(index_[open.back()]));
+        if (skip(0) != index_.size()) {
+            throw JsonError("trailing content at offset " + std::to_string(index_[skip(0)]));
+        }
+    }
+
+    JsonDocument(const JsonDocument&) = delete;
+    JsonDocument& operator=(const JsonDocument&) = delete;
+
+    JsonValue root() const { return JsonValue(this, 0); }
+
+    JsonValue operator[](std::string_view name) const { return root()[name]; }
+
+private:
+    friend class JsonValue;
+    std::string_view input_;
+    std::vector<uint32_t> index_;
+    std::vector<uint32_t> match_;                // closing entry of each '{' and '['
+    mutable std::deque<std::string> unescaped_;  // strings that had escapes; deque keeps views stable
+
+    char at(uint32_t entry) const {
+        return entry < index_.size() ? input_[index_[entry]] : '\0';
+    }
+
+    // The entry after the value starting at `entry`.
+    uint32_t skip(uint32_t entry) const {
+        char c = at(entry);
+        return (c == '{' || c == '[') ? match_[entry] + 1 : entry + 1;
+    }
+
+    [[noreturn]] void fail(uint32_t entry, const std::string& message) const {
+        size_t offset = entry < index_.size() ? index_[entry] : input_.size();
+        throw JsonError(message + " at offset " + std::to_string(offset));
+    }
+
+    std::string_view string_at(uint32_t entry) const {
+        if (at(entry) != '"') fail(entry, "expected a string");
+        const char* start = input_.data() + index_[entry] + 1;
+        const char* end = input_.data() + input_.size();
+        const char* p = detail::find_any(start, end, '"', '\\', '"', '"');
+        if (p < end && *p == '"') return std::string_view(start, static_cast<size_t>(p - start));
+
+        std::string& out = unescaped_.emplace_back(start, p);
+        while (p < end && *p == '\\') {
+            if (end - p < 2) break;
+            char c = p[1];
+            p += 2;
+            switch (c) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code_point = 0;
+                    if (!read_hex4(p, end, code_point)) fail(entry, "bad \\u escape");
+                    p += 4;
+                    if (code_point >= 0xD800 && code_point < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                        uint32_t low = 0;
+                        if (read_hex4(p + 2, end, low) && low >= 0xDC00 && low < 0xE000) {
+                            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                            p += 6;
+                        }
+                    }
+                    detail::append_utf8(out, code_point);
+                    break;
+                }
+                default:
+                    fail(entry, "bad escape");
+            }
+            const char* next = detail::find_any(p, end, '"', '\\', '"', '"');
+            out.append(p, next);
+            p = next;
+        }
+        if (p >= end) fail(entry, "unterminated string");
+        return out;
+    }
+
+    static bool read_hex4(const char* p, const char* end, uint32_t& value) {
+        if (end - p < 4) return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            int digit = detail::hex_value(p[i]);
+            if (digit < 0) return false;
+            value = (value << 4) | static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    // The text of a number or literal: up to the next structural or whitespace.
+    std::string_view scalar_at(uint32_t entry) const {
+        size_t start = index_[entry];
+        size_t end = entry + 1 < index_.size() ? index_[entry + 1] : input_.size();
+        size_t length = 0;
+        while (start + length < end) {
+            char c = input_[start + length];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') break;
+            length++;
+        }
+        return input_.substr(start, length);
+    }
+};
+
+inline char JsonValue::first() const {
+    return document_->at(entry_);
+}
+
+inline void JsonValue::expect(char c, const char* what) const {
+    if (first() != c) document_->fail(entry_, std::string("expected ") + what);
+}
+
+inline JsonType JsonValue::type() const {
+    switch (first()) {
+        case '{': return JsonType::Object;
+        case '[': return JsonType::Array;
+        case '"': return JsonType::String;
+        case 't': case 'f': return JsonType::Bool;
+        case 'n': return JsonType::Null;
+        default: break;
+    }
+    char c = first();
+    if (c == '-' || (c >= '0' && c <= '9')) return JsonType::Number;
+    document_->fail(entry_, "unexpected character");
+}
+
+inline std::string_view JsonValue::get_string() const {
+    return document_->string_at(entry_);
+}
+
+inline long long JsonValue::get_int() const {
+    std::string_view text = document_->scalar_at(entry_);
+    long long result = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (error != std::errc() || end != text.data() + text.size()) document_->fail(entry_, "expected an integer");
+    return result;
+}
+
+inline double JsonValue::get_double() const {
+    std::string_view text = document_->scalar_at(entry_);
+    if (text.empty() || !(text[0] == '-' || (text[0] >= '0' && text[0] <= '9'))) {
+        document_->fail(entry_, "expected a number");
+    }
+    double result = 0;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (error != std::errc() || end != text.data() + text.size()) document_->fail(entry_, "expected a number");
+#else
+    std::string copy(text);
+    char* end = nullptr;
+    result = std::strtod(copy.c_str(), &end);
+    if (end != copy.c_str() + copy.size()) document_->fail(entry_, "expected a number");
+#endif
+    return result;
+}
+
+inline bool JsonValue::get_bool() const {
+    std::string_view text = document_->scalar_at(entry_);
+    if (text == "true") return true;
+    if (text != "false") document_->fail(entry_, "expected true or false");
+    return false;
+}
+
+inline std::string_view JsonValue::raw() const {
+    const std::string_view& input = document_->input_;
+    size_t start = document_->index_[entry_];
+    switch (first()) {
+        case '{':
+        case '[':
+            return input.substr(start, document_->index_[document_->match_[entry_]] + 1 - start);
+        case '"': {
+            // A closing quote is the first '"' not preceded by an odd run of backslashes.
+            size_t end = start + 1;
+            while (true) {
+                end = input.find('"', end);
+                size_t backslashes = 0;
+                while (input[end - 1 - backslashes] == '\\') backslashes++;
+                if (backslashes % 2 == 0) break;
+                end++;
+            }
+            return input.substr(start, end + 1 - start);
+        }
+        default:
+            return document_->scalar_at(entry_);
+    }
+}
+
+class JsonValue::ArrayRange {
+public:
+    class iterator {
+    public:
+        iterator(const JsonDocument* document, uint32_t entry) : document_(document), entry_(entry) {}
+        JsonValue operator*() const { return JsonValue(document_, entry_); }
+        iterator& operator++() {
+            uint32_t next = document_->skip(entry_);
+            char c = document_->at(next);
+            if (c == ',') {
+                entry_ = next + 1;
+            } else if (c == ']') {
+                entry_ = next;
+            } else {
+                document_->fail(next, "expected ',' or ']'");
+            }
+            return *this;
+        }
+        bool operator!=(const iterator& other) const { return entry_ != other.entry_; }
+        bool operator==(const iterator& other) const { return entry_ == other.entry_; }
+
+    private:
+        const JsonDocument* document_;
+        uint32_t entry_;
+    };
+
+    ArrayRange(const JsonDocument* document, uint32_t open) : document_(document), open_(open) {}
+    iterator begin() const {
+        uint32_t close = document_->match_[open_];
+        return iterator(document_, open_ + 1 == close ? close : open_ + 1);
+    }
+    iterator end() const { return iterator(document_, document_->match_[open_]); }
+
+private:
+    const JsonDocument* document_;
+    uint32_t open_;
+};
+
+class JsonValue::ObjectRange {
+public:
+    class iterator {
+    public:
+        iterator(const JsonDocument* document, uint32_t entry) : document_(document), entry_(entry) {}
+        JsonField operator*() const {
+            if (document_->at(entry_ + 1) != ':') document_->fail(entry_ + 1, "expected ':'");
+            return JsonField{document_->string_at(entry_), JsonValue(document_, entry_ + 2)};
+        }
+        iterator& operator++() {
+            uint32_t next = document_->skip(entry_ + 2);
+            char c = document_->at(next);
+            if (c == ',') {
+                entry_ = next + 1;
+            } else if (c == '}') {
+                entry_ = next;
+            } else {
+                document_->fail(next, "expected ',' or '}'");
+            }
+            return *this;
+        }
+        bool operator!=(const iterator& other) const { return entry_ != other.entry_; }
+        bool operator==(const iterator& other) const { return entry_ == other.entry_; }
+
+    private:
+        const JsonDocument* document_;
+        uint32_t entry_;
+    };
+
+    ObjectRange(const JsonDocument* document, uint32_t open) : document_(document), open_(open) {}
+    iterator begin() const {
+        uint32_t close = document_->match_[open_];
+        return iterator(document_, open_ + 1 == close ? close : open_ + 1);
+    }
+    iterator end() const { return iterator(document_, document_->match_[open_]); }
+
+private:
+    const JsonDocument* document_;
+    uint32_t open_;
+};
+
+inline JsonValue::ArrayRange JsonValue::array() const {
+    expect('[', "an array");
+    return ArrayRange(document_, entry_);
+}
+
+inline JsonValue::ObjectRange JsonValue::object() const {
+    expect('{', "an object");
+    return ObjectRange(document_, entry_);
+}
+
+inline JsonValue JsonValue::find(std::string_view name) const {
+    for (const JsonField& field : object()) {
+        if (field.key == name) return field.value;
+    }
+    return JsonValue();
+}
+
+inline JsonValue JsonValue::operator[](std::string_view name) const {
+    JsonValue value = find(name);
+    if (!value) throw JsonError("missing field \"" + std::string(name) + "\"");
+    return value;
+}
+
+inline JsonValue JsonValue::operator[](size_t position) const {
+    size_t i = 0;
+    for (JsonValue value : array()) {
+        if (i++ == position) return value;
+    }
+    throw JsonError("index " + std::to_string(position) + " out of range");
+}
+
+inline size_t JsonValue::size() const {
+    size_t count = 0;
+    if (first() == '{') {
+        for (auto it = object().begin(), end = object().end(); it != end; ++it) count++;
+    } else {
+        for (auto it = array().begin(), end = array().end(); it != end; ++it) count++;
+    }
+    return count;
+}
+
+} // namespace xebec
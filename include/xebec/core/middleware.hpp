@@ -9,25 +9,33 @@ namespace xebec {
 class MiddlewareContext {
 public:
     using NextFunction = std::function<void()>;
-    
-    MiddlewareContext(Request& req, Response& res) : req_(req), res_(res) {}
-    
+
+    // The handler runs once the last middleware calls next(). A middleware that
+    // does not call next() short-circuits the chain and the handler is skipped.
+    MiddlewareContext(Request& req, Response& res, NextFunction handler = nullptr)
+        : req_(req), res_(res), handler_(std::move(handler)) {}
+
     void next() {
         if (current_middleware_ < middlewares_.size()) {
             auto middleware = middlewares_[current_middleware_++];
             middleware(req_, res_, [this]() { next(); });
+        } else if (handler_ && !handled_) {
+            handled_ = true;
+            handler_();
         }
     }
-    
+
     void add(std::function<void(Request&, Response&, NextFunction)> middleware) {
         middlewares_.push_back(middleware);
     }
-    
+
 private:
     Request& req_;
     Response& res_;
+    NextFunction handler_;
+    bool handled_ = false;
     size_t current_middleware_ = 0;
     std::vector<std::function<void(Request&, Response&, NextFunction)>> middlewares_;
 };
 
-} // namespace xebec 
\ No newline at end of file
+} // namespace xebec
\ No newline at end of file
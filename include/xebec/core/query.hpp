@@ -0,0 +1,215 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <charconv>
+#include <cstdint>
+#include "../utils/url.hpp"
+
+namespace xebec {
+
+// Query string parameters. The raw string is kept as received and parsed on
+// first access: keys and values are percent-decoded ('+' is a space) into one
+// buffer that is reused when the object is, repeated keys keep every value, and
+// a key without '=' has an empty value. Not safe for concurrent first access.
+class QueryParams {
+public:
+    using value_type = std::pair<std::string_view, std::string_view>;
+
+    QueryParams() = default;
+
+    explicit QueryParams(std::string_view raw) {
+        assign(raw);
+    }
+
+    void assign(std::string_view raw) {
+        raw_.assign(raw.data(), raw.size());
+        parsed_ = false;
+    }
+
+    const std::string& raw() const { return raw_; }
+
+    bool has(std::string_view name) const {
+        return find(name) != nullptr;
+    }
+
+    // The first value of `name`, or `default_value` when it is absent.
+    std::string get(std::string_view name, const std::string& default_value = "") const {
+        const Entry* entry = find(name);
+        return entry ? std::string(value(*entry)) : default_value;
+    }
+
+    std::string operator[](std::string_view name) const {
+        return get(name);
+    }
+
+    // Every value of `name` in order, e.g. {"a", "b"} for "?tag=a&tag=b". The views
+    // stay valid until the parameters are assigned again.
+    std::vector<std::string_view> get_all(std::string_view name) const {
+        parse();
+        std::vector<std::string_view> values;
+        for (const Entry& entry : entries_) {
+            if (key(entry) == name) values.push_back(value(entry));
+        }
+        return values;
+    }
+
+    // The first value of `name` as an integer; `default_value` when it is absent
+    // or not entirely a number.
+    long long get_int(std::string_view name, long long default_value = 0) const {
+        const Entry* entry = find(name);
+        if (!entry) return default_value;
+        std::string_view text = value(*entry);
+        long long result = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+        return error == std::errc() && end == text.data() + text.size() ? result : default_value;
+    }
+
+    // true/1/yes/on and false/0/no/off, case-insensitively. A bare key ("?debug")
+    // is true; anything else gives `default_value`.
+    bool get_bool(std::string_view name, bool default_value = false) const {
+        const Entry* entry = find(name);
+        if (!entry) return default_value;
+        std::string_view text = value(*entry);
+        if (text.empty()) return true;
+        if (text.size() > 5) return default_value;
+        char lower[5];
+        for (size_t i = 0; i < text.size(); i++) {
+            char c = text[i];
+            lower[i] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+        std::string_view word(lower, text.size());
+        if (word == "true" || word == "1" || word == "yes" || word == "on") return true;
+        if (word == "false" || word == "0" || word == "no" || word == "off") return false;
+        return default_value;
+    }
+
+    size_t size() const {
+        parse();
+        return entries_.size();
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // Iterates (key, value) pairs in the order they appear.
+    class const_iterator {
+    public:
+        const_iterator(const QueryParams* params, size_t index) : params_(params), index_(index) {}
+        value_type operator*() const {
+            const Entry& entry = params_->entries_[index_];
+            return {params_->key(entry), params_->value(entry)};
+        }
+        const_iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+
+    private:
+        const QueryParams* params_;
+        size_t index_;
+    };
+
+    const_iterator begin() const {
+        parse();
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        parse();
+        return const_iterator(this, entries_.size());
+    }
+
+private:
+    // Offsets into decoded_, so copies of the object stay valid.
+    struct Entry {
+        uint32_t key;
+        uint32_t key_length;
+        uint32_t value;
+        uint32_t value_length;
+    };
+
+    std::string raw_;
+    mutable bool parsed_ = true;
+    mutable std::string decoded_;
+    mutable std::vector<Entry> entries_;
+
+    std::string_view key(const Entry& entry) const {
+        return std::string_view(decoded_.data() + entry.key, entry.key_length);
+    }
+
+    std::string_view value(const Entry& entry) const {
+        return std::string_view(decoded_.data() + entry.value, entry.value_length);
+    }
+
+    const Entry* find(std::string_view name) const {
+        parse();
+        for (const Entry& entry : entries_) {
+            if (key(entry) == name) return &entry;
+        }
+        return nullptr;
+    }
+
+    // One pass over the raw string: plain runs are copied in bulk up to the next
+    // separator or escape, found with detail::find_any.
+    void parse() const {
+        if (parsed_) return;
+        parsed_ = true;
+        entries_.clear();
+        decoded_.resize(raw_.size());
+        const char* p = raw_.data();
+        const char* end = p + raw_.size();
+        char* out = &decoded_[0];
+        char* base = out;
+        Entry entry{0, 0, 0, 0};
+        bool in_value = false;
+
+        auto finish = [&]() {
+            uint32_t position = static_cast<uint32_t>(out - base);
+            if (in_value) {
+                entry.value_length = position - entry.value;
+            } else {
+                entry.key_length = position - entry.key;
+                entry.value = position;
+                entry.value_length = 0;
+            }
+            if (entry.key_length > 0 || entry.value_length > 0) entries_.push_back(entry);
+            entry = Entry{position, 0, position, 0};
+            in_value = false;
+        };
+
+        while (true) {
+            const char* special = detail::find_any(p, end, '&', '=', '%', '+');
+            std::memcpy(out, p, static_cast<size_t>(special - p));
+            out += special - p;
+            if (special == end) break;
+            p = special + 1;
+            switch (*special) {
+                case '&':
+                    finish();
+                    break;
+                case '=':
+                    if (in_value) {
+                        *out++ = '=';
+                    } else {
+                        uint32_t position = static_cast<uint32_t>(out - base);
+                        entry.key_length = position - entry.key;
+                        entry.value = position;
+                        in_value = true;
+                    }
+                    break;
+                case '+':
+                    *out++ = ' ';
+                    break;
+                default:
+                    p = special + detail::decode_escape(special, end, out++);
+            }
+        }
+        finish();
+        decoded_.resize(static_cast<size_t>(out - base));
+    }
+};
+
+} // namespace xebec
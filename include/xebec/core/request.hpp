@@ -1,18 +1,26 @@
 #pragma once
 #include <string>
 #include <map>
+#include <functional>
+#include "query.hpp"
+#include "json.hpp"
+#include "../utils/url.hpp"
 
 namespace xebec {
 
 class Request {
 public:
-    std::map<std::string, std::string> query;      // Query parameters
+    QueryParams query;                             // Query parameters, parsed on first access
     std::map<std::string, std::string> params;     // Route parameters
     std::string body;                              // Request body
     std::map<std::string, std::string> headers;    // Request headers
     std::string method;                            // HTTP method
     std::string path;                              // Request path
     std::string version;                           // HTTP version
+    std::string remote_addr;                       // Peer IP address, e.g. "203.0.113.7"
+    // Set instead of `body` on routes that stream the body (server.upload): returns
+    // up to `size` bytes of it, 0 once it has all been read.
+    std::function<size_t(char* out, size_t size)> body_reader;
 
     bool has_header(const std::string& key) const {
         return headers.find(key) != headers.end();
@@ -23,9 +31,42 @@ public:
         return it != headers.end() ? it->second : default_value;
     }
 
+    // The path with percent-escapes decoded, e.g. "/files/a b" for "/files/a%20b".
+    // Routing matches the raw `path`.
+    const std::string& decoded_path() const {
+        if (decoded_path_source_ != path) {
+            decoded_path_source_ = path;
+            decoded_path_ = percent_decode(path);
+        }
+        return decoded_path_;
+    }
+
+    // Indexes the body as JSON; values are decoded as they are read. The document
+    // refers into `body`, which must not change while it is in use. Throws
+    // JsonError (a 400) when the body is not valid JSON.
+    JsonDocument json() const {
+        return JsonDocument(body);
+    }
+
     bool is_secure() const {
         return get_header("X-Forwarded-Proto") == "https" || get_header("X-Forwarded-Ssl") == "on";
     }
+
+private:
+    mutable std::string decoded_path_source_;
+    mutable std::string decoded_path_;
 };
 
+// Splits a request target into the path and the raw query string, which is
+// only parsed if the handler looks at it.
+inline void parse_request_target(const std::string& target, Request& req) {
+    size_t query_pos = target.find('?');
+    req.path.assign(target, 0, query_pos);
+    if (query_pos == std::string::npos) {
+        req.query.assign(std::string_view());
+    } else {
+        req.query.assign(std::string_view(target).substr(query_pos + 1));
+    }
+}
+
 } // namespace xebec 
\ No newline at end of file
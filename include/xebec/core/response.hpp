@@ -1,15 +1,39 @@
 #pragma once
 #include <string>
 #include <fstream>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include "json.hpp"
+#include "embedded.hpp"
 
 namespace xebec {
 
+// Writes the next piece of a streamed body. Returns false once the client is gone.
+using BodyWriter = std::function<bool(const char* data, size_t length)>;
+
 class Response {
 public:
     std::string status;    // HTTP status line
     std::string body;      // Response body
     std::string headers;   // Response headers
     std::string public_dir;  // Public directory path
+    std::string file_path;   // When set, the body is streamed from this file instead of `body`
+    uint64_t file_offset = 0;
+    uint64_t file_length = 0;
+    // When set, the body is produced while the response is sent (see stream()).
+    std::function<bool(const BodyWriter& write)> body_stream;
+    int64_t stream_length = -1;  // -1: unknown, sent chunked
+    // When set, the body is this constant data, sent without being copied (see view()).
+    std::string_view body_view;
+    // Set when the public directory is embedded in the binary; html() reads from it.
+    const EmbeddedDirectory* embedded = nullptr;
+    // Set by http_server::sse() routes: the connection then subscribes to this channel.
+    std::string event_channel;
+    // Set when next() returns before a coroutine handler has run (see
+    // http_server::get_async()): middleware code after next() must not treat
+    // the response as final.
+    bool async_pending = false;
 
     explicit Response(const std::string& public_dir = "") : status("200 OK\r\n"), public_dir(public_dir) {}
 
@@ -31,6 +55,11 @@ public:
 
     Response& html(const std::string& path) {
         header("Content-Type", "text/html");
+        if (embedded) {
+            const EmbeddedFile* found = embedded->find(!path.empty() && path[0] == '/' ? path : "/" + path);
+            if (found) return view(found->identity.data);
+            return status_code(404) << "File Not Found";
+        }
         std::fstream file(public_dir + "/" + path, std::ios::in | std::ios::binary);
         if(file.is_open()) {
             body = std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
@@ -41,11 +70,65 @@ public:
         return *this;
     }
 
+    // Sends `length` bytes of the file starting at `offset` as the body, without
+    // loading it into memory.
+    Response& file(const std::string& path, uint64_t offset, uint64_t length) {
+        file_path = path;
+        file_offset = offset;
+        file_length = length;
+        body.clear();
+        return *this;
+    }
+
+    // Sends a body produced as the response goes out, e.g. relayed from another
+    // server: `producer` passes each piece to `write` and returns false if it
+    // could not finish, which closes the connection. Without a `length` the body
+    // is sent with chunked encoding.
+    Response& stream(std::function<bool(const BodyWriter& write)> producer, int64_t length = -1) {
+        body_stream = std::move(producer);
+        stream_length = length;
+        body.clear();
+        return *this;
+    }
+
+    // Sends `data`, which must outlive the response (e.g. an embedded file), as
+    // the body without copying it.
+    Response& view(std::string_view data) {
+        body_view = data;
+        body.clear();
+        return *this;
+    }
+
+    // Runs a streamed body (or copies a viewed one) into `body`, for senders that
+    // need all of it up front.
+    bool buffer_stream() {
+        if (body_view.data()) {
+            body.assign(body_view.data(), body_view.size());
+            body_view = std::string_view();
+        }
+        if (!body_stream) return true;
+        std::function<bool(const BodyWriter&)> producer = std::move(body_stream);
+        body_stream = nullptr;
+        body.clear();
+        return producer([this](const char* data, size_t length) {
+            body.append(data, length);
+            return true;
+        });
+    }
+
     Response& json(const std::string& data) {
         header("Content-Type", "application/json");
         body = data;
         return *this;
     }
+
+    // Starts a JSON body and returns a writer that serializes into it:
+    // res.json().begin_object().field("id", 7).end_object();
+    JsonWriter json() {
+        header("Content-Type", "application/json");
+        body.clear();
+        return JsonWriter(body);
+    }
 };
 
 } // namespace xebec 
\ No newline at end of file
@@ -0,0 +1,310 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <chrono>
+#include <regex>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include "../core/request.hpp"
+#include "../core/response.hpp"
+#include "../core/middleware.hpp"
+#include "../utils/etag.hpp"
+
+namespace xebec {
+
+// Per-route caching rule. The cache key is built from the method, the path and
+// only the query parameters and request headers listed here.
+struct CacheRule {
+    std::chrono::milliseconds ttl{0};
+    std::vector<std::string> vary_query;
+    std::vector<std::string> vary_headers;
+};
+
+// In-memory response cache used as middleware:
+//
+//     xebec::ResponseCache cache(32 * 1024 * 1024);
+//     cache.route("GET", "/api/stats", std::chrono::seconds(5));
+//     server.use(cache.middleware());
+//
+// Entries live in a sharded LRU bounded by a memory budget. Concurrent misses
+// on the same key are coalesced so the handler runs once, and every cached
+// response carries an ETag so If-None-Match is answered with 304 directly.
+class ResponseCache {
+public:
+    explicit ResponseCache(size_t memory_budget = 64 * 1024 * 1024, size_t shard_count = 16)
+        : state_(std::make_shared<State>(memory_budget, shard_count)) {}
+
+    ResponseCache& route(const std::string& method, const std::string& path,
+                         std::chrono::milliseconds ttl,
+                         std::vector<std::string> vary_query = {},
+                         std::vector<std::string> vary_headers = {}) {
+        CacheRule rule{ttl, std::move(vary_query), std::move(vary_headers)};
+        if (path.find(':') == std::string::npos) {
+            state_->exact_rules[method + " " + path] = rule;
+        } else {
+            std::string pattern = std::regex_replace(path, std::regex("/:\\w+/?"), "/([^/]+)/?");
+            state_->pattern_rules.push_back({method, std::regex(pattern), rule});
+        }
+        return *this;
+    }
+
+    void clear() {
+        for (auto& shard : state_->shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.lru.clear();
+            shard.index.clear();
+            shard.bytes = 0;
+        }
+    }
+
+    std::function<void(Request&, Response&, MiddlewareContext::NextFunction)> middleware() const {
+        std::shared_ptr<State> state = state_;
+        return [state](Request& req, Response& res, MiddlewareContext::NextFunction next) {
+            state->handle(req, res, next);
+        };
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string status;
+        std::string headers;
+        std::string body;
+        std::string etag;
+        Clock::time_point expires;
+        size_t bytes;
+    };
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<std::pair<std::string, EntryPtr>> lru;
+        std::unordered_map<std::string, std::list<std::pair<std::string, EntryPtr>>::iterator> index;
+        std::unordered_map<std::string, std::shared_future<EntryPtr>> inflight;
+        size_t bytes = 0;
+    };
+
+    struct PatternRule {
+        std::string method;
+        std::regex pattern;
+        CacheRule rule;
+    };
+
+    struct State {
+        State(size_t memory_budget, size_t shard_count)
+            : shards(shard_count ? shard_count : 1),
+              shard_budget(memory_budget / (shard_count ? shard_count : 1)) {}
+
+        std::vector<Shard> shards;
+        size_t shard_budget;
+        std::map<std::string, CacheRule> exact_rules;
+        std::vector<PatternRule> pattern_rules;
+
+        const CacheRule* find_rule(const Request& req) const {
+            auto it = exact_rules.find(req.method + " " + req.path);
+            if (it != exact_rules.end()) return &it->second;
+            for (const auto& pattern_rule : pattern_rules) {
+                if (pattern_rule.method == req.method && std::regex_match(req.path, pattern_rule.pattern)) {
+                    return &pattern_rule.rule;
+                }
+            }
+            return nullptr;
+        }
+
+        static std::string make_key(const Request& req, const CacheRule& rule) {
+            std::string key = req.method + " " + req.path;
+            for (const auto& name : rule.vary_query) {
+                key += '\n';
+                for (std::string_view value : req.query.get_all(name)) {
+                    key += name + "=";
+                    key.append(value.data(), value.size());
+                    key += '&';
+                }
+            }
+            for (const auto& name : rule.vary_headers) {
+                key += '\n' + req.get_header(name);
+            }
+            return key;
+        }
+
+        void handle(Request& req, Response& res, const MiddlewareContext::NextFunction& next) {
+            const CacheRule* rule = find_rule(req);
+            if (!rule) {
+                next();
+                return;
+            }
+
+            std::string key = make_key(req, *rule);
+            Shard& shard = shards[std::hash<std::string>{}(key) % shards.size()];
+
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            if (EntryPtr entry = lookup(shard, key)) {
+                lock.unlock();
+                serve(req, res, *entry);
+                return;
+            }
+
+            auto pending = shard.inflight.find(key);
+            if (pending != shard.inflight.end()) {
+                std::shared_future<EntryPtr> result = pending->second;
+                lock.unlock();
+                if (EntryPtr entry = result.get()) {
+                    serve(req, res, *entry);
+                } else {
+                    next();
+                }
+                return;
+            }
+
+            std::promise<EntryPtr> promise;
+            shard.inflight.emplace(key, promise.get_future().share());
+            lock.unlock();
+
+            EntryPtr entry;
+            try {
+                next();
+                // A coroutine handler has not written the response yet.
+                if (!res.async_pending) entry = store(shard, key, *rule, res);
+            } catch (...) {
+                finish(shard, key, promise, nullptr);
+                throw;
+            }
+            finish(shard, key, promise, entry);
+
+            if (entry && etag_matches(req.get_header("If-None-Match"), entry->etag)) {
+                serve(req, res, *entry);
+            }
+        }
+
+        EntryPtr lookup(Shard& shard, const std::string& key) {
+            auto it = shard.index.find(key);
+            if (it == shard.index.end()) return nullptr;
+            if (it->second->second->expires <= Clock::now()) {
+                shard.bytes -= it->second->second->bytes;
+                shard.lru.erase(it->second);
+                shard.index.erase(it);
+                return nullptr;
+            }
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return it->second->second;
+        }
+
+        EntryPtr store(Shard& shard, const std::string& key, const CacheRule& rule, Response& res) {
+            // Only in-memory bodies are cached. Embedded files are already served
+            // from memory, and files and streams are not read into it.
+            if (res.status.compare(0, 3, "200") != 0 || res.body_view.data() || !res.file_path.empty() ||
+                res.body_stream) {
+                return nullptr;
+            }
+
+            // A handler's own ETag is kept, and answers If-None-Match as ours would.
+            std::string etag = header_value(res.headers, "etag");
+            if (etag.empty()) {
+                etag = make_etag(res.body);
+                res.header("ETag", etag);
+            }
+
+            auto entry = std::make_shared<Entry>();
+            entry->status = res.status;
+            entry->headers = res.headers;
+            entry->body = res.body;
+            entry->etag = etag;
+            entry->expires = Clock::now() + rule.ttl;
+            entry->bytes = key.size() * 2 + entry->status.size() + entry->headers.size() +
+                           entry->body.size() + entry->etag.size() + sizeof(Entry);
+            if (entry->bytes > shard_budget) return entry;
+
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto existing = shard.index.find(key);
+            if (existing != shard.index.end()) {
+                shard.bytes -= existing->second->second->bytes;
+                shard.lru.erase(existing->second);
+                shard.index.erase(existing);
+            }
+            shard.lru.emplace_front(key, entry);
+            shard.index[key] = shard.lru.begin();
+            shard.bytes += entry->bytes;
+            while (shard.bytes > shard_budget && !shard.lru.empty()) {
+                auto& victim = shard.lru.back();
+                shard.bytes -= victim.second->bytes;
+                shard.index.erase(victim.first);
+                shard.lru.pop_back();
+            }
+            return entry;
+        }
+
+        // The value of the header called `name`, in lower case, or "".
+        static std::string header_value(const std::string& headers, const std::string& name) {
+            size_t line = 0;
+            while (line < headers.size()) {
+                size_t end = headers.find("\r\n", line);
+                if (end == std::string::npos) end = headers.size();
+                size_t colon = headers.find(':', line);
+                if (colon < end && colon - line == name.size() &&
+                    std::equal(name.begin(), name.end(), headers.begin() + line, [](char a, char b) {
+                        return a == std::tolower(static_cast<unsigned char>(b));
+                    })) {
+                    size_t value = headers.find_first_not_of(' ', colon + 1);
+                    return value < end ? headers.substr(value, end - value) : std::string();
+                }
+                line = end + 2;
+            }
+            return std::string();
+        }
+
+        // The lines of `headers` a 304 repeats from the 200 it stands for (RFC 9110 15.4.5).
+        static std::string not_modified_headers(const std::string& headers) {
+            static const char* const kept[] = {"etag", "cache-control", "vary", "expires", "content-location"};
+            std::string lines;
+            size_t line = 0;
+            while (line < headers.size()) {
+                size_t end = headers.find("\r\n", line);
+                if (end == std::string::npos) end = headers.size();
+                size_t colon = headers.find(':', line);
+                if (colon < end) {
+                    std::string name = headers.substr(line, colon - line);
+                    std::transform(name.begin(), name.end(), name.begin(),
+                                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                    if (std::find(std::begin(kept), std::end(kept), name) != std::end(kept)) {
+                        lines.append(headers, line, end - line).append("\r\n");
+                    }
+                }
+                line = end + 2;
+            }
+            return lines;
+        }
+
+        static void finish(Shard& shard, const std::string& key,
+                           std::promise<EntryPtr>& promise, EntryPtr entry) {
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.inflight.erase(key);
+            }
+            promise.set_value(std::move(entry));
+        }
+
+        static void serve(const Request& req, Response& res, const Entry& entry) {
+            if (etag_matches(req.get_header("If-None-Match"), entry.etag)) {
+                res.status_code(304);
+                res.headers = not_modified_headers(entry.headers);
+                res.body.clear();
+                return;
+            }
+            res.status = entry.status;
+            res.headers = entry.headers;
+            res.body = entry.body;
+        }
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace xebec
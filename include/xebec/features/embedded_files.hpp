@@ -0,0 +1,82 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "../core/embedded.hpp"
+
+namespace xebec {
+
+// Whether an Accept-Encoding value allows `coding` (q=0 refuses it).
+inline bool accepts_encoding(std::string_view header, std::string_view coding) {
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string_view::npos) end = header.size();
+        std::string_view item = header.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t begin = item.find_first_not_of(" \t");
+        if (begin == std::string_view::npos) continue;
+        item.remove_prefix(begin);
+        size_t name_end = item.find_first_of(" \t;");
+        std::string_view name = item.substr(0, name_end);
+        bool matches = name.size() == coding.size() || name == "*";
+        for (size_t i = 0; matches && name != "*" && i < name.size(); i++) {
+            char c = name[i] >= 'A' && name[i] <= 'Z' ? static_cast<char>(name[i] + 32) : name[i];
+            matches = c == coding[i];
+        }
+        if (!matches) continue;
+
+        size_t q = item.find("q=", name_end == std::string_view::npos ? item.size() : name_end);
+        if (q == std::string_view::npos) return true;
+        std::string_view value = item.substr(q + 2);
+        return value.substr(0, value.find_first_of(" \t;")).find_first_not_of("0.") != std::string_view::npos;
+    }
+    return false;
+}
+
+namespace detail {
+
+// Builds the seeds and slots of an EmbeddedDirectory for distinct `paths`.
+inline void build_embedded_index(const std::vector<std::string_view>& paths,
+                                 std::vector<uint32_t>& seeds, std::vector<uint32_t>& slots) {
+    size_t count = paths.size();
+    size_t bucket_count = count / 3 + 1;
+    size_t slot_count = count + count / 4 + 1;
+    seeds.assign(bucket_count, 0);
+    slots.assign(slot_count, static_cast<uint32_t>(count));
+
+    std::vector<std::vector<uint32_t>> buckets(bucket_count);
+    for (size_t i = 0; i < count; i++) {
+        buckets[embedded_hash(paths[i], 0) % bucket_count].push_back(static_cast<uint32_t>(i));
+    }
+    std::vector<size_t> order(bucket_count);
+    for (size_t i = 0; i < bucket_count; i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&buckets](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    // Largest buckets first, while most slots are free.
+    std::vector<size_t> taken;
+    for (size_t bucket : order) {
+        if (buckets[bucket].empty()) break;
+        for (uint32_t seed = 1;; seed++) {
+            taken.clear();
+            for (uint32_t index : buckets[bucket]) {
+                size_t slot = embedded_hash(paths[index], seed) % slot_count;
+                if (slots[slot] != count || std::find(taken.begin(), taken.end(), slot) != taken.end()) break;
+                taken.push_back(slot);
+            }
+            if (taken.size() == buckets[bucket].size()) {
+                for (size_t i = 0; i < taken.size(); i++) slots[taken[i]] = buckets[bucket][i];
+                seeds[bucket] = seed;
+                break;
+            }
+        }
+    }
+}
+
+} // namespace detail
+
+} // namespace xebec
@@ -0,0 +1,365 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+// HPACK header compression for HTTP/2 (RFC 7541).
+namespace xebec {
+namespace hpack {
+
+struct HeaderField {
+    std::string name;
+    std::string value;
+};
+
+// Entries 1..61 of the static table, shared by every connection.
+inline const std::vector<HeaderField>& static_table() {
+    static const std::vector<HeaderField> table = {
+        {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"},
+        {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"},
+        {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"},
+        {":status", "404"}, {":status", "500"}, {"accept-charset", ""}, {"accept-encoding", "gzip, deflate"},
+        {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""},
+        {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+        {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+        {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""},
+        {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""},
+        {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+        {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""},
+        {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""},
+        {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""},
+        {"retry-after", ""}, {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""},
+        {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+        {"www-authenticate", ""},
+    };
+    return table;
+}
+
+// The HPACK Huffman code is canonical, so the code lengths from RFC 7541
+// Appendix B are enough to rebuild every code. Symbol 256 is EOS.
+class Huffman {
+public:
+    static const Huffman& instance() {
+        static const Huffman huffman;
+        return huffman;
+    }
+
+    size_t encoded_length(const std::string& input) const {
+        uint64_t bits = 0;
+        for (unsigned char c : input) bits += lengths_[c];
+        return static_cast<size_t>((bits + 7) / 8);
+    }
+
+    void encode(const std::string& input, std::string& out) const {
+        uint64_t accumulator = 0;
+        int pending = 0;
+        for (unsigned char c : input) {
+            accumulator = (accumulator << lengths_[c]) | codes_[c];
+            pending += lengths_[c];
+            while (pending >= 8) {
+                pending -= 8;
+                out += static_cast<char>((accumulator >> pending) & 0xFF);
+            }
+        }
+        if (pending > 0) {
+            // Pad with the most significant bits of EOS (all ones).
+            out += static_cast<char>(((accumulator << (8 - pending)) | (0xFF >> pending)) & 0xFF);
+        }
+    }
+
+    bool decode(const uint8_t* data, size_t length, std::string& out) const {
+        uint32_t code = 0;
+        int bits = 0;
+        for (size_t i = 0; i < length; i++) {
+            for (int bit = 7; bit >= 0; bit--) {
+                code = (code << 1) | ((data[i] >> bit) & 1);
+                bits++;
+                if (bits > 30) return false;
+                int64_t index = static_cast<int64_t>(code) - first_code_[bits];
+                if (index >= 0 && index < count_[bits]) {
+                    uint16_t symbol = sorted_[first_index_[bits] + index];
+                    if (symbol == 256) return false;
+                    out += static_cast<char>(symbol);
+                    code = 0;
+                    bits = 0;
+                }
+            }
+        }
+        // Padding must be shorter than a byte and consist of EOS bits.
+        return bits < 8 && code == (1u << bits) - 1;
+    }
+
+private:
+    uint8_t lengths_[257];
+    uint32_t codes_[257];
+    uint32_t first_code_[32] = {0};
+    int count_[32] = {0};
+    int first_index_[32] = {0};
+    uint16_t sorted_[257];
+
+    Huffman() {
+        static const uint8_t lengths[257] = {
+            13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+            28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+            6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+            5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+            13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+            7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+            15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+            6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+            20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+            24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+            22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+            21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+            26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+            19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+            20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+            26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+            30,
+        };
+
+        for (int symbol = 0; symbol < 257; symbol++) {
+            lengths_[symbol] = lengths[symbol];
+            count_[lengths[symbol]]++;
+        }
+
+        // Canonical assignment: shorter codes first, ties broken by symbol value.
+        int index = 0;
+        uint32_t code = 0;
+        for (int bits = 1; bits <= 30; bits++) {
+            code <<= 1;
+            first_code_[bits] = code;
+            first_index_[bits] = index;
+            for (int symbol = 0; symbol < 257; symbol++) {
+                if (lengths[symbol] == bits) {
+                    codes_[symbol] = code++;
+                    sorted_[index++] = static_cast<uint16_t>(symbol);
+                }
+            }
+        }
+    }
+};
+
+inline void encode_integer(uint64_t value, int prefix_bits, uint8_t first_byte_flags, std::string& out) {
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out += static_cast<char>(first_byte_flags | value);
+        return;
+    }
+    out += static_cast<char>(first_byte_flags | max_prefix);
+    value -= max_prefix;
+    while (value >= 128) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline bool decode_integer(const uint8_t*& pos, const uint8_t* end, int prefix_bits, uint64_t& value) {
+    if (pos >= end) return false;
+    uint64_t max_prefix = (1u << prefix_bits) - 1;
+    value = *pos++ & max_prefix;
+    if (value < max_prefix) return true;
+    int shift = 0;
+    while (pos < end) {
+        uint8_t byte = *pos++;
+        value += static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+        shift += 7;
+        if (shift > 56) return false;
+    }
+    return false;
+}
+
+class DynamicTable {
+public:
+    const HeaderField* get(size_t index) const {
+        return index < entries_.size() ? &entries_[index] : nullptr;
+    }
+
+    size_t count() const { return entries_.size(); }
+    size_t max_size() const { return max_size_; }
+
+    void add(const std::string& name, const std::string& value) {
+        size_t entry_size = name.size() + value.size() + 32;
+        if (entry_size > max_size_) {
+            entries_.clear();
+            size_ = 0;
+            return;
+        }
+        while (size_ + entry_size > max_size_) evict();
+        entries_.push_front({name, value});
+        size_ += entry_size;
+    }
+
+    void set_max_size(size_t max_size) {
+        max_size_ = max_size;
+        while (size_ > max_size_) evict();
+    }
+
+private:
+    std::deque<HeaderField> entries_;
+    size_t size_ = 0;
+    size_t max_size_ = 4096;
+
+    void evict() {
+        size_ -= entries_.back().name.size() + entries_.back().value.size() + 32;
+        entries_.pop_back();
+    }
+};
+
+class Decoder {
+public:
+    // Upper bound for table size updates, i.e. our SETTINGS_HEADER_TABLE_SIZE.
+    void set_max_table_size(size_t size) {
+        max_table_size_ = size;
+        if (table_.max_size() > size) table_.set_max_size(size);
+    }
+
+    // Decodes one complete header block. Returns false on a compression error,
+    // after which the connection must be closed.
+    bool decode(const uint8_t* data, size_t length, std::vector<HeaderField>& headers,
+                size_t max_header_list_size = 1024 * 1024) {
+        const uint8_t* pos = data;
+        const uint8_t* end = data + length;
+        size_t list_size = 0;
+        bool header_seen = false;
+        while (pos < end) {
+            uint8_t byte = *pos;
+            uint64_t index;
+            HeaderField field;
+            if (byte & 0x80) {
+                if (!decode_integer(pos, end, 7, index) || !lookup(index, field)) return false;
+            } else if ((byte & 0xE0) == 0x20) {
+                // Size updates are only allowed at the start of a block.
+                if (header_seen || !decode_integer(pos, end, 5, index) || index > max_table_size_) return false;
+                table_.set_max_size(static_cast<size_t>(index));
+                continue;
+            } else {
+                bool incremental = (byte & 0xC0) == 0x40;
+                if (!decode_integer(pos, end, incremental ? 6 : 4, index)) return false;
+                if (index == 0) {
+                    if (!decode_string(pos, end, field.name)) return false;
+                } else {
+                    HeaderField indexed;
+                    if (!lookup(index, indexed)) return false;
+                    field.name = indexed.name;
+                }
+                if (!decode_string(pos, end, field.value)) return false;
+                if (incremental) table_.add(field.name, field.value);
+            }
+            header_seen = true;
+            list_size += field.name.size() + field.value.size() + 32;
+            if (list_size > max_header_list_size) return false;
+            headers.push_back(std::move(field));
+        }
+        return true;
+    }
+
+private:
+    DynamicTable table_;
+    size_t max_table_size_ = 4096;
+
+    bool lookup(uint64_t index, HeaderField& field) const {
+        const auto& fixed = static_table();
+        if (index == 0) return false;
+        if (index <= fixed.size()) {
+            field = fixed[index - 1];
+            return true;
+        }
+        const HeaderField* entry = table_.get(static_cast<size_t>(index - fixed.size() - 1));
+        if (!entry) return false;
+        field = *entry;
+        return true;
+    }
+
+    static bool decode_string(const uint8_t*& pos, const uint8_t* end, std::string& out) {
+        if (pos >= end) return false;
+        bool huffman = (*pos & 0x80) != 0;
+        uint64_t length;
+        if (!decode_integer(pos, end, 7, length) || length > static_cast<uint64_t>(end - pos)) return false;
+        if (huffman) {
+            if (!Huffman::instance().decode(pos, static_cast<size_t>(length), out)) return false;
+        } else {
+            out.assign(reinterpret_cast<const char*>(pos), static_cast<size_t>(length));
+        }
+        pos += length;
+        return true;
+    }
+};
+
+class Encoder {
+public:
+    // Applies the peer's SETTINGS_HEADER_TABLE_SIZE; the change is announced at
+    // the start of the next header block.
+    void set_max_table_size(size_t size) {
+        size_t capped = size < 4096 ? size : 4096;
+        if (capped != table_.max_size()) {
+            table_.set_max_size(capped);
+            pending_size_update_ = true;
+        }
+    }
+
+    void encode(const std::vector<HeaderField>& headers, std::string& out) {
+        if (pending_size_update_) {
+            encode_integer(table_.max_size(), 5, 0x20, out);
+            pending_size_update_ = false;
+        }
+        for (const auto& field : headers) {
+            size_t name_index = 0;
+            size_t exact_index = find(field, name_index);
+            if (exact_index) {
+                encode_integer(exact_index, 7, 0x80, out);
+                continue;
+            }
+            // Values that change on every response would only churn the table.
+            bool index = field.name != "content-length" && field.name != "date" &&
+                         field.name != "etag" && field.name != "last-modified" &&
+                         field.name != "content-range" && field.name != "set-cookie" &&
+                         field.value.size() < 256;
+            encode_integer(name_index, index ? 6 : 4, index ? 0x40 : 0x00, out);
+            if (name_index == 0) encode_string(field.name, out);
+            encode_string(field.value, out);
+            if (index) table_.add(field.name, field.value);
+        }
+    }
+
+private:
+    DynamicTable table_;
+    bool pending_size_update_ = false;
+
+    // Returns the index of an exact match, and sets `name_index` to the first
+    // entry with a matching name.
+    size_t find(const HeaderField& field, size_t& name_index) const {
+        const auto& fixed = static_table();
+        for (size_t i = 0; i < fixed.size(); i++) {
+            if (fixed[i].name != field.name) continue;
+            if (fixed[i].value == field.value) return i + 1;
+            if (!name_index) name_index = i + 1;
+        }
+        for (size_t i = 0; i < table_.count(); i++) {
+            const HeaderField* entry = table_.get(i);
+            if (entry->name != field.name) continue;
+            if (entry->value == field.value) return fixed.size() + i + 1;
+            if (!name_index) name_index = fixed.size() + i + 1;
+        }
+        return 0;
+    }
+
+    static void encode_string(const std::string& value, std::string& out) {
+        const Huffman& huffman = Huffman::instance();
+        size_t huffman_length = huffman.encoded_length(value);
+        if (huffman_length < value.size()) {
+            encode_integer(huffman_length, 7, 0x80, out);
+            huffman.encode(value, out);
+        } else {
+            encode_integer(value.size(), 7, 0x00, out);
+            out += value;
+        }
+    }
+};
+
+} // namespace hpack
+} // namespace xebec
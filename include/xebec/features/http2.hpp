@@ -0,0 +1,825 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+
+#include "hpack.hpp"
+#include "../core/config.hpp"
+#include "../core/request.hpp"
+#include "../core/response.hpp"
+#include "../server/connection.hpp"
+
+// HTTP/2 (RFC 9113) over an established connection, for prior-knowledge h2c,
+// the HTTP/1.1 Upgrade path and TLS with ALPN "h2".
+namespace xebec {
+
+enum class H2FrameType : uint8_t {
+    DATA = 0x0,
+    HEADERS = 0x1,
+    PRIORITY = 0x2,
+    RST_STREAM = 0x3,
+    SETTINGS = 0x4,
+    PUSH_PROMISE = 0x5,
+    PING = 0x6,
+    GOAWAY = 0x7,
+    WINDOW_UPDATE = 0x8,
+    CONTINUATION = 0x9
+};
+
+enum class H2Error : uint32_t {
+    NONE = 0x0,
+    PROTOCOL = 0x1,
+    INTERNAL = 0x2,
+    FLOW_CONTROL = 0x3,
+    STREAM_CLOSED = 0x5,
+    FRAME_SIZE = 0x6,
+    REFUSED_STREAM = 0x7,
+    CANCEL = 0x8,
+    COMPRESSION = 0x9
+};
+
+static const char h2_client_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+class Http2Session {
+public:
+    // Runs a request through middleware and routes, on a worker thread.
+    using Dispatcher = std::function<Response(Request&)>;
+    // Runs a job on a worker thread.
+    using Executor = std::function<void(std::function<void()>)>;
+
+    Http2Session(Connection& connection, const ServerConfig& config, Dispatcher dispatcher, Executor run_on_worker,
+                 std::function<bool()> stopping)
+        : connection_(connection), config_(config), dispatcher_(std::move(dispatcher)),
+          run_on_worker_(std::move(run_on_worker)), stopping_(std::move(stopping)) {
+        decoder_.set_max_table_size(4096);
+    }
+
+    ~Http2Session() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        workers_cv_.wait(lock, [this] { return workers_ == 0; });
+        lock.unlock();
+        for (SOCKET socket : wake_) {
+            if (socket != INVALID_SOCKET) SOCKET_CLOSE(socket);
+        }
+    }
+
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+
+    // Serves the connection until it closes. `buffered` holds bytes already read,
+    // starting with the client connection preface.
+    void run(std::string buffered = "") {
+        input_ = std::move(buffered);
+        if (!create_socket_pair(wake_)) return;
+        send_settings();
+        serve();
+    }
+
+    // h2c upgrade: answers 101 and serves the upgrading request as stream 1.
+    void run_upgraded(Request request, const std::string& settings_header, std::string buffered) {
+        input_ = std::move(buffered);
+        if (!create_socket_pair(wake_)) return;
+        std::string settings;
+        if (!decode_base64url(settings_header, settings) || settings.size() % 6 != 0) return;
+
+        static const char switching[] =
+            "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+        if (!connection_.send_all(switching, sizeof(switching) - 1)) return;
+        send_settings();
+        if (!apply_settings(reinterpret_cast<const uint8_t*>(settings.data()), settings.size())) return;
+
+        auto stream = std::make_shared<Stream>(1, peer_initial_window_);
+        stream->request = std::move(request);
+        stream->request.version = "HTTP/2.0";
+        stream->remote_closed = true;
+        streams_[1] = stream;
+        last_stream_id_ = 1;
+        dispatch(stream);
+        serve();
+    }
+
+private:
+    struct Stream {
+        Stream(uint32_t id, int64_t send_window) : id(id), send_window(send_window) {}
+
+        uint32_t id;
+        Request request;
+        bool remote_closed = false;   // END_STREAM received
+        int64_t send_window;
+        int64_t receive_window = initial_window;
+
+        // Filled in by the worker thread.
+        Response response;
+
+        // Sending state, owned by the I/O thread.
+        bool headers_sent = false;
+        bool has_body = false;
+        std::string body;
+        size_t body_offset = 0;
+        std::ifstream file;
+        uint64_t file_remaining = 0;
+
+        uint64_t remaining() const { return file.is_open() ? file_remaining : body.size() - body_offset; }
+    };
+
+    static constexpr uint32_t max_frame_size = 16384;  // what we accept; the default
+    static constexpr int64_t initial_window = 1 << 20;  // advertised per stream
+    static constexpr int64_t max_window = 0x7FFFFFFF;
+    static constexpr size_t write_batch = 256 * 1024;
+
+    Connection& connection_;
+    const ServerConfig& config_;
+    Dispatcher dispatcher_;
+    Executor run_on_worker_;
+    std::function<bool()> stopping_;
+    SOCKET wake_[2] = {INVALID_SOCKET, INVALID_SOCKET};
+
+    hpack::Decoder decoder_;
+    hpack::Encoder encoder_;
+    std::string input_;
+    size_t input_pos_ = 0;
+    std::string output_;
+    bool preface_received_ = false;
+
+    std::map<uint32_t, std::shared_ptr<Stream>> streams_;
+    size_t handlers_running_ = 0;
+    std::deque<std::shared_ptr<Stream>> waiting_;  // requests for when a handler finishes
+    std::deque<std::shared_ptr<Stream>> sending_;  // responses in progress, served round-robin
+    uint32_t last_stream_id_ = 0;
+    int64_t connection_send_window_ = 65535;
+    int64_t connection_receive_window_ = 65535;
+    int64_t peer_initial_window_ = 65535;
+    uint32_t peer_max_frame_size_ = 16384;
+
+    // A header block split over CONTINUATION frames.
+    uint32_t continuation_stream_ = 0;
+    bool continuation_end_stream_ = false;
+    std::string header_block_;
+
+    bool goaway_sent_ = false;
+    bool goaway_received_ = false;
+    bool failed_ = false;
+
+    // Shared with worker threads.
+    std::mutex mutex_;
+    std::condition_variable workers_cv_;
+    size_t workers_ = 0;
+    std::vector<std::shared_ptr<Stream>> completed_;
+
+    void serve() {
+        auto last_activity = std::chrono::steady_clock::now();
+        char chunk[16384];
+        if (!input_.empty()) process_input();
+        while (!failed_) {
+            collect_completed();
+            write_frames();
+            if (failed_) break;
+
+            if (!goaway_sent_ && stopping_()) {
+                send_goaway(H2Error::NONE);
+            }
+            if ((goaway_sent_ || goaway_received_) && streams_.empty() && output_.empty()) break;
+            if (streams_.empty() && std::chrono::steady_clock::now() - last_activity >
+                                        std::chrono::milliseconds(config_.keep_alive_timeout_ms)) {
+                send_goaway(H2Error::NONE);
+                write_frames();
+                break;
+            }
+
+            bool readable = connection_.has_buffered_data();
+            if (!readable) {
+                pollfd fds[2] = {};
+                fds[0].fd = connection_.socket();
+                fds[0].events = POLLIN;
+                fds[1].fd = wake_[0];
+                fds[1].events = POLLIN;
+                int timeout = can_send() ? 0 : 100;
+                if (SOCKET_POLL(fds, 2, timeout) < 0) break;
+                if (fds[1].revents & POLLIN) {
+                    char drain[64];
+                    ::recv(wake_[0], drain, sizeof(drain), 0);
+                }
+                readable = (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) != 0;
+            }
+            if (!readable) continue;
+
+            int received = connection_.recv(chunk, sizeof(chunk));
+            if (received <= 0) break;
+            last_activity = std::chrono::steady_clock::now();
+            input_.append(chunk, received);
+            process_input();
+        }
+        if (!failed_) write_frames();
+    }
+
+    // Parses every complete frame in the input buffer.
+    void process_input() {
+        if (!preface_received_) {
+            size_t preface_length = sizeof(h2_client_preface) - 1;
+            size_t available = std::min(input_.size(), preface_length);
+            if (input_.compare(0, available, h2_client_preface, available) != 0) {
+                failed_ = true;
+                return;
+            }
+            if (input_.size() < preface_length) return;
+            input_pos_ = preface_length;
+            preface_received_ = true;
+        }
+
+        while (!failed_ && input_.size() - input_pos_ >= 9) {
+            const uint8_t* header = reinterpret_cast<const uint8_t*>(input_.data()) + input_pos_;
+            uint32_t length = (header[0] << 16) | (header[1] << 8) | header[2];
+            if (length > max_frame_size) {
+                connection_error(H2Error::FRAME_SIZE);
+                return;
+            }
+            if (input_.size() - input_pos_ < 9 + length) break;
+            H2FrameType type = static_cast<H2FrameType>(header[3]);
+            uint8_t flags = header[4];
+            uint32_t stream_id = read_u32(header + 5) & 0x7FFFFFFF;
+            handle_frame(type, flags, stream_id, header + 9, length);
+            input_pos_ += 9 + length;
+        }
+        input_.erase(0, input_pos_);
+        input_pos_ = 0;
+    }
+
+    void handle_frame(H2FrameType type, uint8_t flags, uint32_t stream_id, const uint8_t* payload, uint32_t length) {
+        if (continuation_stream_ != 0 &&
+            (type != H2FrameType::CONTINUATION || stream_id != continuation_stream_)) {
+            connection_error(H2Error::PROTOCOL);
+            return;
+        }
+
+        switch (type) {
+            case H2FrameType::DATA:
+                handle_data(flags, stream_id, payload, length);
+                break;
+            case H2FrameType::HEADERS:
+                handle_headers(flags, stream_id, payload, length);
+                break;
+            case H2FrameType::CONTINUATION:
+                if (stream_id == 0 || stream_id != continuation_stream_) {
+                    connection_error(H2Error::PROTOCOL);
+                    return;
+                }
+                header_block_.append(reinterpret_cast<const char*>(payload), length);
+                if (flags & 0x4) end_header_block();
+                break;
+            case H2FrameType::PRIORITY:
+                if (stream_id == 0) connection_error(H2Error::PROTOCOL);
+                else if (length != 5) reset_stream(stream_id, H2Error::FRAME_SIZE);
+                break;
+            case H2FrameType::RST_STREAM:
+                if (stream_id == 0 || stream_id > last_stream_id_) connection_error(H2Error::PROTOCOL);
+                else if (length != 4) connection_error(H2Error::FRAME_SIZE);
+                else close_stream(stream_id);
+                break;
+            case H2FrameType::SETTINGS:
+                if (stream_id != 0) {
+                    connection_error(H2Error::PROTOCOL);
+                } else if (flags & 0x1) {
+                    if (length != 0) connection_error(H2Error::FRAME_SIZE);
+                } else if (length % 6 != 0) {
+                    connection_error(H2Error::FRAME_SIZE);
+                } else if (apply_settings(payload, length)) {
+                    write_frame_header(0, H2FrameType::SETTINGS, 0x1, 0);
+                }
+                break;
+            case H2FrameType::PUSH_PROMISE:
+                connection_error(H2Error::PROTOCOL);
+                break;
+            case H2FrameType::PING:
+                if (stream_id != 0) connection_error(H2Error::PROTOCOL);
+                else if (length != 8) connection_error(H2Error::FRAME_SIZE);
+                else if (!(flags & 0x1)) {
+                    write_frame_header(8, H2FrameType::PING, 0x1, 0);
+                    output_.append(reinterpret_cast<const char*>(payload), 8);
+                }
+                break;
+            case H2FrameType::GOAWAY:
+                if (stream_id != 0) connection_error(H2Error::PROTOCOL);
+                else goaway_received_ = true;
+                break;
+            case H2FrameType::WINDOW_UPDATE:
+                handle_window_update(stream_id, payload, length);
+                break;
+            default:
+                break;  // unknown frame types are ignored
+        }
+    }
+
+    void handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t* payload, uint32_t length) {
+        if (stream_id == 0 || (stream_id & 1) == 0) {
+            connection_error(H2Error::PROTOCOL);
+            return;
+        }
+        size_t skip = 0, padding = 0;
+        if (flags & 0x8) {
+            if (length < 1) return connection_error(H2Error::FRAME_SIZE);
+            padding = payload[0];
+            skip = 1;
+        }
+        if (flags & 0x20) skip += 5;  // priority fields, which we ignore
+        if (skip + padding > length) return connection_error(H2Error::PROTOCOL);
+
+        header_block_.assign(reinterpret_cast<const char*>(payload) + skip, length - skip - padding);
+        continuation_stream_ = stream_id;
+        continuation_end_stream_ = (flags & 0x1) != 0;
+        if (flags & 0x4) end_header_block();
+    }
+
+    void end_header_block() {
+        uint32_t stream_id = continuation_stream_;
+        bool end_stream = continuation_end_stream_;
+        continuation_stream_ = 0;
+
+        // The block is decoded even when the stream is refused, to keep the HPACK state in sync.
+        std::vector<hpack::HeaderField> fields;
+        if (!decoder_.decode(reinterpret_cast<const uint8_t*>(header_block_.data()), header_block_.size(),
+                             fields, config_.max_request_size)) {
+            connection_error(H2Error::COMPRESSION);
+            return;
+        }
+        header_block_.clear();
+
+        auto existing = streams_.find(stream_id);
+        if (existing != streams_.end()) {
+            // Trailers: accepted only to end the request body.
+            if (existing->second->remote_closed || !end_stream) {
+                reset_stream(stream_id, H2Error::PROTOCOL);
+                return;
+            }
+            existing->second->remote_closed = true;
+            dispatch(existing->second);
+            return;
+        }
+        if (stream_id <= last_stream_id_) {
+            connection_error(H2Error::PROTOCOL);
+            return;
+        }
+        last_stream_id_ = stream_id;
+        if (goaway_sent_) return;
+        if (streams_.size() >= config_.http2_max_concurrent_streams) {
+            reset_stream(stream_id, H2Error::REFUSED_STREAM);
+            return;
+        }
+
+        auto stream = std::make_shared<Stream>(stream_id, peer_initial_window_);
+        if (!build_request(fields, stream->request)) {
+            reset_stream(stream_id, H2Error::PROTOCOL);
+            return;
+        }
+        stream->request.remote_addr = connection_.remote_addr();
+        streams_[stream_id] = stream;
+        if (end_stream) {
+            stream->remote_closed = true;
+            dispatch(stream);
+        }
+    }
+
+    void handle_data(uint8_t flags, uint32_t stream_id, const uint8_t* payload, uint32_t length) {
+        if (stream_id == 0) return connection_error(H2Error::PROTOCOL);
+
+        // Flow control counts the whole frame, padding included. Received data is
+        // credited back straight away; max_request_size bounds what a stream can buffer.
+        connection_receive_window_ -= length;
+        if (connection_receive_window_ < 0) return connection_error(H2Error::FLOW_CONTROL);
+        if (length > 0) {
+            send_window_update(0, length);
+            connection_receive_window_ += length;
+        }
+
+        auto it = streams_.find(stream_id);
+        if (it == streams_.end() || it->second->remote_closed) {
+            if (stream_id > last_stream_id_) return connection_error(H2Error::PROTOCOL);
+            reset_stream(stream_id, H2Error::STREAM_CLOSED);
+            return;
+        }
+        Stream& stream = *it->second;
+        size_t padding = 0, skip = 0;
+        if (flags & 0x8) {
+            if (length < 1) return connection_error(H2Error::FRAME_SIZE);
+            padding = payload[0];
+            skip = 1;
+        }
+        if (skip + padding > length) return connection_error(H2Error::PROTOCOL);
+
+        stream.receive_window -= length;
+        if (stream.receive_window < 0) {
+            reset_stream(stream_id, H2Error::FLOW_CONTROL);
+            return;
+        }
+        if (stream.request.body.size() + length > config_.max_request_size) {
+            stream.remote_closed = true;
+            Response too_large;
+            too_large.status_code(413).json("{\"error\": \"Payload too large\"}");
+            start_response(it->second, std::move(too_large));
+            return;
+        }
+        stream.request.body.append(reinterpret_cast<const char*>(payload) + skip, length - skip - padding);
+        if (!(flags & 0x1) && length > 0) {
+            send_window_update(stream_id, length);
+            stream.receive_window += length;
+        }
+        if (flags & 0x1) {
+            stream.remote_closed = true;
+            dispatch(it->second);
+        }
+    }
+
+    void handle_window_update(uint32_t stream_id, const uint8_t* payload, uint32_t length) {
+        if (length != 4) return connection_error(H2Error::FRAME_SIZE);
+        int64_t increment = read_u32(payload) & 0x7FFFFFFF;
+        if (stream_id == 0) {
+            if (increment == 0) return connection_error(H2Error::PROTOCOL);
+            connection_send_window_ += increment;
+            if (connection_send_window_ > max_window) connection_error(H2Error::FLOW_CONTROL);
+            return;
+        }
+        auto it = streams_.find(stream_id);
+        if (it == streams_.end()) return;
+        if (increment == 0) return reset_stream(stream_id, H2Error::PROTOCOL);
+        it->second->send_window += increment;
+        if (it->second->send_window > max_window) reset_stream(stream_id, H2Error::FLOW_CONTROL);
+    }
+
+    bool apply_settings(const uint8_t* payload, size_t length) {
+        for (size_t i = 0; i + 6 <= length; i += 6) {
+            uint16_t id = static_cast<uint16_t>((payload[i] << 8) | payload[i + 1]);
+            uint32_t value = read_u32(payload + i + 2);
+            switch (id) {
+                case 0x1:  // HEADER_TABLE_SIZE
+                    encoder_.set_max_table_size(value);
+                    break;
+                case 0x2:  // ENABLE_PUSH
+                    if (value > 1) {
+                        connection_error(H2Error::PROTOCOL);
+                        return false;
+                    }
+                    break;
+                case 0x4: {  // INITIAL_WINDOW_SIZE, which applies to open streams too
+                    if (value > max_window) {
+                        connection_error(H2Error::FLOW_CONTROL);
+                        return false;
+                    }
+                    int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+                    peer_initial_window_ = value;
+                    for (auto& [id, stream] : streams_) {
+                        stream->send_window += delta;
+                    }
+                    break;
+                }
+                case 0x5:  // MAX_FRAME_SIZE
+                    if (value < 16384 || value > 16777215) {
+                        connection_error(H2Error::PROTOCOL);
+                        return false;
+                    }
+                    peer_max_frame_size_ = value;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    // Builds a Request from the decoded header list. Header names are given the
+    // usual HTTP/1.1 capitalization so handlers see the same keys on both protocols.
+    bool build_request(const std::vector<hpack::HeaderField>& fields, Request& req) {
+        std::string target;
+        bool regular_seen = false;
+        for (const auto& field : fields) {
+            if (!field.name.empty() && field.name[0] == ':') {
+                if (regular_seen) return false;
+                if (field.name == ":method") req.method = field.value;
+                else if (field.name == ":path") target = field.value;
+                else if (field.name == ":authority") req.headers["Host"] = field.value;
+                else if (field.name != ":scheme") return false;
+                continue;
+            }
+            regular_seen = true;
+            for (char c : field.name) {
+                if (std::isupper(static_cast<unsigned char>(c))) return false;
+            }
+            if (field.name == "connection" || field.name == "upgrade" || field.name == "keep-alive" ||
+                field.name == "transfer-encoding") {
+                return false;
+            }
+            std::string name = canonical_header_name(field.name);
+            auto existing = req.headers.find(name);
+            if (existing == req.headers.end()) {
+                req.headers[name] = field.value;
+            } else {
+                existing->second += (field.name == "cookie" ? "; " : ", ") + field.value;
+            }
+        }
+        if (req.method.empty() || target.empty()) return false;
+        req.version = "HTTP/2.0";
+        parse_request_target(target, req);
+        return true;
+    }
+
+    static std::string canonical_header_name(const std::string& name) {
+        std::string result = name;
+        bool upper = true;
+        for (char& c : result) {
+            if (upper) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            upper = c == '-';
+        }
+        return result;
+    }
+
+    // At most http2_max_handlers requests of the session run at once; the rest
+    // wait their turn, so one client cannot occupy the server's workers.
+    void dispatch(const std::shared_ptr<Stream>& stream) {
+        if (handlers_running_ >= std::max<size_t>(config_.http2_max_handlers, 1)) {
+            waiting_.push_back(stream);
+            return;
+        }
+        handlers_running_++;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            workers_++;
+        }
+        run_on_worker_([this, stream]() {
+            Response response = dispatcher_(stream->request);
+            // DATA frames are sent from the session thread, which must not wait on a producer.
+            if (!response.buffer_stream()) {
+                response = Response();
+                response.status_code(502).json("{\"error\": \"Incomplete response body\"}");
+            }
+            // Everything happens under the lock: once workers_ drops to zero the
+            // session may be destroyed, wake sockets included.
+            std::lock_guard<std::mutex> lock(mutex_);
+            stream->response = std::move(response);
+            completed_.push_back(stream);
+            ::send(wake_[1], "w", 1, 0);
+            workers_--;
+            workers_cv_.notify_all();
+        });
+    }
+
+    void collect_completed() {
+        std::vector<std::shared_ptr<Stream>> completed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            completed.swap(completed_);
+        }
+        for (auto& stream : completed) {
+            handlers_running_--;
+            if (streams_.count(stream->id)) {
+                start_response(stream, std::move(stream->response));
+            }
+        }
+        while (!waiting_.empty() && handlers_running_ < std::max<size_t>(config_.http2_max_handlers, 1)) {
+            std::shared_ptr<Stream> next = std::move(waiting_.front());
+            waiting_.pop_front();
+            // Skips streams the client reset while they waited.
+            if (streams_.count(next->id)) dispatch(next);
+        }
+    }
+
+    void start_response(const std::shared_ptr<Stream>& stream, Response response) {
+        bool bodyless = response.status.compare(0, 3, "304") == 0 || response.status.compare(0, 3, "204") == 0 ||
+                        stream->request.method == "HEAD";
+        bool has_file = !response.file_path.empty();
+        uint64_t length = has_file ? response.file_length : response.body.size();
+
+        std::vector<hpack::HeaderField> fields;
+        fields.push_back({":status", response.status.substr(0, 3)});
+        size_t line = 0;
+        while (line < response.headers.size()) {
+            size_t end = response.headers.find("\r\n", line);
+            if (end == std::string::npos) end = response.headers.size();
+            size_t colon = response.headers.find(':', line);
+            if (colon != std::string::npos && colon < end) {
+                std::string name = response.headers.substr(line, colon - line);
+                std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+                size_t value = response.headers.find_first_not_of(" \t", colon + 1);
+                if (value == std::string::npos || value > end) value = end;
+                if (name != "connection" && name != "keep-alive" && name != "transfer-encoding" &&
+                    name != "upgrade" && name != "content-length") {
+                    fields.push_back({name, response.headers.substr(value, end - value)});
+                }
+            }
+            line = end + 2;
+        }
+        if (!bodyless || stream->request.method == "HEAD") {
+            fields.push_back({"content-length", std::to_string(length)});
+        }
+        fields.push_back({"x-powered-by", "Xebec-Server/0.1.0"});
+        fields.push_back({"programming-language", "C++"});
+
+        std::string block;
+        encoder_.encode(fields, block);
+        stream->has_body = !bodyless && length > 0;
+        if (stream->has_body && has_file) {
+            stream->file.open(response.file_path, std::ios::in | std::ios::binary);
+            stream->file.seekg(static_cast<std::streamoff>(response.file_offset));
+            stream->file_remaining = length;
+        } else if (stream->has_body) {
+            stream->body = std::move(response.body);
+        }
+
+        // HEADERS go out immediately, in stream order, because the encoder state
+        // must match the order the peer decodes blocks in.
+        size_t offset = 0;
+        bool first = true;
+        do {
+            size_t chunk = std::min<size_t>(block.size() - offset, peer_max_frame_size_);
+            bool last = offset + chunk == block.size();
+            uint8_t flags = (last ? 0x4 : 0) | (first && !stream->has_body ? 0x1 : 0);
+            write_frame_header(static_cast<uint32_t>(chunk), first ? H2FrameType::HEADERS : H2FrameType::CONTINUATION,
+                               flags, stream->id);
+            output_.append(block, offset, chunk);
+            offset += chunk;
+            first = false;
+        } while (offset < block.size());
+        stream->headers_sent = true;
+
+        if (stream->has_body) {
+            sending_.push_back(stream);
+        } else {
+            finish_stream(stream->id);
+        }
+    }
+
+    bool can_send() const {
+        if (!output_.empty()) return true;
+        if (connection_send_window_ <= 0) return false;
+        for (const auto& stream : sending_) {
+            if (stream->send_window > 0) return true;
+        }
+        return false;
+    }
+
+    // Writes pending frames, one DATA frame per stream per round so that a large
+    // file cannot starve the small responses multiplexed next to it.
+    void write_frames() {
+        while (!sending_.empty() && output_.size() < write_batch && connection_send_window_ > 0) {
+            bool progressed = false;
+            size_t count = sending_.size();
+            for (size_t i = 0; i < count && output_.size() < write_batch && connection_send_window_ > 0; i++) {
+                std::shared_ptr<Stream> stream = sending_.front();
+                sending_.pop_front();
+                if (stream->send_window <= 0) {
+                    sending_.push_back(stream);
+                    continue;
+                }
+                int64_t allowed = std::min<int64_t>({connection_send_window_, stream->send_window,
+                                                     static_cast<int64_t>(peer_max_frame_size_)});
+                uint64_t chunk = std::min<uint64_t>(stream->remaining(), static_cast<uint64_t>(allowed));
+                bool last = chunk == stream->remaining();
+                write_frame_header(static_cast<uint32_t>(chunk), H2FrameType::DATA, last ? 0x1 : 0, stream->id);
+                if (stream->file.is_open()) {
+                    size_t offset = output_.size();
+                    output_.resize(offset + chunk);
+                    stream->file.read(&output_[offset], static_cast<std::streamsize>(chunk));
+                    if (static_cast<uint64_t>(stream->file.gcount()) != chunk) {
+                        failed_ = true;  // the file shrank; the frame cannot be completed
+                        return;
+                    }
+                    stream->file_remaining -= chunk;
+                } else {
+                    output_.append(stream->body, stream->body_offset, chunk);
+                    stream->body_offset += chunk;
+                }
+                stream->send_window -= chunk;
+                connection_send_window_ -= chunk;
+                progressed = true;
+                if (last) {
+                    finish_stream(stream->id);
+                } else {
+                    sending_.push_back(stream);
+                }
+            }
+            if (!progressed) break;
+        }
+        flush();
+    }
+
+    void flush() {
+        if (output_.empty()) return;
+        if (!connection_.send_all(output_.data(), output_.size())) failed_ = true;
+        output_.clear();
+    }
+
+    // Our side of the stream is done. A stream whose request is still arriving is
+    // kept until END_STREAM, which then does not dispatch a second time.
+    void finish_stream(uint32_t stream_id) {
+        auto it = streams_.find(stream_id);
+        if (it == streams_.end()) return;
+        if (!it->second->remote_closed) {
+            reset_stream(stream_id, H2Error::NONE);
+            return;
+        }
+        streams_.erase(it);
+    }
+
+    void close_stream(uint32_t stream_id) {
+        streams_.erase(stream_id);
+        sending_.erase(std::remove_if(sending_.begin(), sending_.end(),
+                                      [stream_id](const std::shared_ptr<Stream>& s) { return s->id == stream_id; }),
+                       sending_.end());
+    }
+
+    void reset_stream(uint32_t stream_id, H2Error error) {
+        write_frame_header(4, H2FrameType::RST_STREAM, 0, stream_id);
+        write_u32(static_cast<uint32_t>(error));
+        close_stream(stream_id);
+    }
+
+    void send_goaway(H2Error error) {
+        write_frame_header(8, H2FrameType::GOAWAY, 0, 0);
+        write_u32(last_stream_id_);
+        write_u32(static_cast<uint32_t>(error));
+        goaway_sent_ = true;
+    }
+
+    void connection_error(H2Error error) {
+        send_goaway(error);
+        flush();
+        failed_ = true;
+    }
+
+    void send_settings() {
+        // MAX_CONCURRENT_STREAMS, INITIAL_WINDOW_SIZE and ENABLE_PUSH = 0, then a
+        // connection window update to match the per-stream window.
+        write_frame_header(18, H2FrameType::SETTINGS, 0, 0);
+        write_setting(0x3, static_cast<uint32_t>(config_.http2_max_concurrent_streams));
+        write_setting(0x4, static_cast<uint32_t>(initial_window));
+        write_setting(0x2, 0);
+        send_window_update(0, static_cast<uint32_t>(initial_window - connection_receive_window_));
+        connection_receive_window_ = initial_window;
+        flush();
+    }
+
+    void send_window_update(uint32_t stream_id, uint32_t increment) {
+        write_frame_header(4, H2FrameType::WINDOW_UPDATE, 0, stream_id);
+        write_u32(increment);
+    }
+
+    void write_setting(uint16_t id, uint32_t value) {
+        output_ += static_cast<char>(id >> 8);
+        output_ += static_cast<char>(id & 0xFF);
+        write_u32(value);
+    }
+
+    void write_frame_header(uint32_t length, H2FrameType type, uint8_t flags, uint32_t stream_id) {
+        output_ += static_cast<char>((length >> 16) & 0xFF);
+        output_ += static_cast<char>((length >> 8) & 0xFF);
+        output_ += static_cast<char>(length & 0xFF);
+        output_ += static_cast<char>(type);
+        output_ += static_cast<char>(flags);
+        write_u32(stream_id);
+    }
+
+    void write_u32(uint32_t value) {
+        output_ += static_cast<char>((value >> 24) & 0xFF);
+        output_ += static_cast<char>((value >> 16) & 0xFF);
+        output_ += static_cast<char>((value >> 8) & 0xFF);
+        output_ += static_cast<char>(value & 0xFF);
+    }
+
+    static uint32_t read_u32(const uint8_t* data) {
+        return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    }
+
+    // HTTP2-Settings carries the SETTINGS payload in unpadded base64url.
+    static bool decode_base64url(const std::string& input, std::string& out) {
+        uint32_t bits = 0;
+        int count = 0;
+        for (char c : input) {
+            int value;
+            if (c >= 'A' && c <= 'Z') value = c - 'A';
+            else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+            else if (c >= '0' && c <= '9') value = c - '0' + 52;
+            else if (c == '-') value = 62;
+            else if (c == '_') value = 63;
+            else if (c == '=') break;
+            else return false;
+            bits = (bits << 6) | value;
+            count += 6;
+            if (count >= 8) {
+                count -= 8;
+                out += static_cast<char>((bits >> count) & 0xFF);
+            }
+        }
+        return true;
+    }
+
+};
+
+} // namespace xebec
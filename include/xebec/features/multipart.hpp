@@ -0,0 +1,498 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+#include "../core/error.hpp"
+#include "../core/request.hpp"
+#include "../utils/cpu_features.hpp"
+
+namespace xebec {
+
+namespace detail {
+
+inline const char* find_delimiter_scalar(const char* p, const char* end, std::string_view delimiter) {
+    while (end - p >= static_cast<ptrdiff_t>(delimiter.size())) {
+        p = static_cast<const char*>(std::memchr(p, delimiter[0], static_cast<size_t>(end - p)));
+        if (p == nullptr || end - p < static_cast<ptrdiff_t>(delimiter.size())) break;
+        if (std::memcmp(p, delimiter.data(), delimiter.size()) == 0) return p;
+        ++p;
+    }
+    return end;
+}
+
+// Candidates are positions where both the first and the last byte of the
+// delimiter match, checked a whole register at a time; only those are compared
+// in full. File data rarely produces a candidate, so this runs at memory speed.
+#if defined(__SSE2__) || defined(_M_X64)
+inline const char* find_delimiter_sse2(const char* p, const char* end, std::string_view delimiter) {
+    const size_t last = delimiter.size() - 1;
+    const __m128i first_byte = _mm_set1_epi8(delimiter[0]);
+    const __m128i last_byte = _mm_set1_epi8(delimiter[last]);
+    while (end - p >= static_cast<ptrdiff_t>(last + 16)) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + last));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first_byte), _mm_cmpeq_epi8(tail, last_byte))));
+        while (mask != 0) {
+            int i = count_trailing_zeros(mask);
+            if (std::memcmp(p + i + 1, delimiter.data() + 1, last - 1) == 0) return p + i;
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+    return find_delimiter_scalar(p, end, delimiter);
+}
+#endif
+
+#ifdef XEBEC_X86
+XEBEC_TARGET("avx2") inline const char* find_delimiter_avx2(const char* p, const char* end, std::string_view delimiter) {
+    const size_t last = delimiter.size() - 1;
+    const __m256i first_byte = _mm256_set1_epi8(delimiter[0]);
+    const __m256i last_byte = _mm256_set1_epi8(delimiter[last]);
+    while (end - p >= static_cast<ptrdiff_t>(last + 32)) {
+        __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + last));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(head, first_byte), _mm256_cmpeq_epi8(tail, last_byte))));
+        while (mask != 0) {
+            int i = count_trailing_zeros(mask);
+            if (std::memcmp(p + i + 1, delimiter.data() + 1, last - 1) == 0) return p + i;
+            mask &= mask - 1;
+        }
+        p += 32;
+    }
+    return find_delimiter_scalar(p, end, delimiter);
+}
+#endif
+
+// First occurrence of `delimiter` (at least 3 bytes) in [p, end), or `end`.
+inline const char* find_delimiter(const char* p, const char* end, std::string_view delimiter) {
+#ifdef XEBEC_X86
+    static const bool avx2 = cpu_features().avx2;
+    if (avx2) return find_delimiter_avx2(p, end, delimiter);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+    return find_delimiter_sse2(p, end, delimiter);
+#else
+    return find_delimiter_scalar(p, end, delimiter);
+#endif
+}
+
+// Length of the longest suffix of [p, end) that is a proper prefix of
+// `delimiter`: bytes that may be the start of a delimiter split across reads.
+inline size_t partial_delimiter(const char* p, const char* end, std::string_view delimiter) {
+    size_t longest = std::min(static_cast<size_t>(end - p), delimiter.size() - 1);
+    for (size_t length = longest; length > 0; length--) {
+        if (std::memcmp(end - length, delimiter.data(), length) == 0) return length;
+    }
+    return 0;
+}
+
+} // namespace detail
+
+// The headers of one part of a multipart/form-data body.
+struct MultipartPart {
+    std::string name;          // Content-Disposition name
+    std::string filename;      // Content-Disposition filename
+    std::string content_type;  // Content-Type, empty when not given
+    bool is_file = false;      // A filename parameter was present, even if empty
+};
+
+// Incremental multipart/form-data parser (RFC 7578). Bytes are fed as they
+// arrive and part data is passed on as soon as it is known not to be part of a
+// boundary, so memory use does not depend on the size of the parts. Only a
+// possible partial boundary or part headers are held between calls.
+class MultipartParser {
+public:
+    std::function<void(const MultipartPart&)> on_part;
+    std::function<void(const char*, size_t)> on_data;
+    std::function<void()> on_part_end;
+
+    size_t max_header_size = 16 * 1024;
+
+    explicit MultipartParser(const std::string& boundary) : delimiter_("\r\n--" + boundary) {
+        if (boundary.empty() || boundary.size() > 70) throw HttpError(400, "Invalid multipart boundary");
+        // The first boundary may start the body, so the body is parsed as if
+        // preceded by a line break.
+        pending_ = "\r\n";
+    }
+
+    void feed(const char* data, size_t length) {
+        if (pending_.empty()) {
+            size_t used = process(data, data + length);
+            pending_.assign(data + used, length - used);
+        } else {
+            pending_.append(data, length);
+            size_t used = process(pending_.data(), pending_.data() + pending_.size());
+            pending_.erase(0, used);
+        }
+    }
+
+    // Throws unless the closing boundary has been seen.
+    void finish() const {
+        if (state_ != State::Done) throw HttpError(400, "Truncated multipart body");
+    }
+
+    bool done() const { return state_ == State::Done; }
+
+    // The boundary parameter of a multipart/form-data Content-Type, or "" when
+    // the type is something else.
+    static std::string boundary_of(const std::string& content_type) {
+        std::string lower = content_type;
+        for (char& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (lower.compare(0, 19, "multipart/form-data") != 0) return "";
+        size_t position = lower.find("boundary=");
+        if (position == std::string::npos) return "";
+        std::string boundary = content_type.substr(position + 9);
+        if (!boundary.empty() && boundary[0] == '"') {
+            size_t close = boundary.find('"', 1);
+            return close == std::string::npos ? "" : boundary.substr(1, close - 1);
+        }
+        return boundary.substr(0, boundary.find_first_of("; \t"));
+    }
+
+private:
+    enum class State { Preamble, AfterBoundary, Headers, Data, Done };
+
+    std::string delimiter_;
+    std::string pending_;
+    State state_ = State::Preamble;
+    MultipartPart part_;
+
+    // Consumes what it can of [begin, end) and returns how much; the rest is
+    // held until more bytes arrive.
+    size_t process(const char* begin, const char* end) {
+        const char* p = begin;
+        while (p < end) {
+            switch (state_) {
+                case State::Preamble:
+                case State::Data: {
+                    const char* found = detail::find_delimiter(p, end, delimiter_);
+                    const char* data_end = found != end ? found : end - detail::partial_delimiter(p, end, delimiter_);
+                    if (state_ == State::Data && data_end > p && on_data) {
+                        on_data(p, static_cast<size_t>(data_end - p));
+                    }
+                    if (found == end) return static_cast<size_t>(data_end - begin);
+                    if (state_ == State::Data && on_part_end) on_part_end();
+                    state_ = State::AfterBoundary;
+                    p = found + delimiter_.size();
+                    break;
+                }
+                case State::AfterBoundary: {
+                    // "--" closes the body; otherwise optional whitespace and a line break.
+                    const char* q = p;
+                    while (q < end && (*q == ' ' || *q == '\t')) ++q;
+                    if (static_cast<size_t>(q - p) > max_header_size) {
+                        throw HttpError(400, "Malformed multipart boundary");
+                    }
+                    if (end - q < 2) return static_cast<size_t>(p - begin);
+                    if (q == p && q[0] == '-' && q[1] == '-') {
+                        state_ = State::Done;
+                        return static_cast<size_t>(end - begin);
+                    }
+                    if (q[0] != '\r' || q[1] != '\n') throw HttpError(400, "Malformed multipart boundary");
+                    state_ = State::Headers;
+                    p = q + 2;
+                    break;
+                }
+                case State::Headers: {
+                    std::string_view rest(p, static_cast<size_t>(end - p));
+                    size_t headers_end = rest.substr(0, 2) == "\r\n" ? 0 : rest.find("\r\n\r\n");
+                    if (headers_end == std::string_view::npos) {
+                        if (rest.size() > max_header_size) throw HttpError(431, "Multipart headers too large");
+                        return static_cast<size_t>(p - begin);
+                    }
+                    parse_headers(rest.substr(0, headers_end));
+                    p += headers_end + (headers_end == 0 ? 2 : 4);
+                    state_ = State::Data;
+                    if (on_part) on_part(part_);
+                    break;
+                }
+                case State::Done:
+                    return static_cast<size_t>(end - begin);
+            }
+        }
+        return static_cast<size_t>(p - begin);
+    }
+
+    void parse_headers(std::string_view headers) {
+        part_ = MultipartPart();
+        bool has_disposition = false;
+        while (!headers.empty()) {
+            size_t line_end = headers.find("\r\n");
+            std::string_view line = headers.substr(0, line_end);
+            headers = line_end == std::string_view::npos ? std::string_view() : headers.substr(line_end + 2);
+            size_t colon = line.find(':');
+            if (colon == std::string_view::npos) continue;
+            std::string name(line.substr(0, colon));
+            for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            std::string_view value = trim(line.substr(colon + 1));
+            if (name == "content-type") {
+                part_.content_type = std::string(value);
+            } else if (name == "content-disposition") {
+                has_disposition = true;
+                parse_disposition(value);
+            }
+        }
+        if (!has_disposition) throw HttpError(400, "Multipart part without Content-Disposition");
+    }
+
+    // form-data; name="field"; filename="a.txt"
+    void parse_disposition(std::string_view value) {
+        size_t position = value.find(';');
+        while (position != std::string_view::npos) {
+            value = trim(value.substr(position + 1));
+            size_t equals = value.find('=');
+            if (equals == std::string_view::npos) break;
+            std::string key(trim(value.substr(0, equals)));
+            for (char& c : key) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            value = trim(value.substr(equals + 1));
+            std::string parameter;
+            if (!value.empty() && value[0] == '"') {
+                size_t i = 1;
+                for (; i < value.size() && value[i] != '"'; i++) {
+                    if (value[i] == '\\' && i + 1 < value.size()) i++;
+                    parameter += value[i];
+                }
+                value = value.substr(std::min(i + 1, value.size()));
+            } else {
+                size_t end = value.find(';');
+                parameter = std::string(trim(value.substr(0, end)));
+                value = end == std::string_view::npos ? std::string_view() : value.substr(end);
+            }
+            if (key == "name") {
+                part_.name = parameter;
+            } else if (key == "filename") {
+                part_.filename = parameter;
+                part_.is_file = true;
+            }
+            position = value.find(';');
+        }
+    }
+
+    static std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+        return text;
+    }
+};
+
+// Where the bytes of an uploaded file go. write() is called as the body
+// arrives and close() after the last byte of the part.
+class UploadSink {
+public:
+    virtual ~UploadSink() = default;
+    virtual void write(const char* data, size_t length) = 0;
+    virtual void close() {}
+};
+
+// A file part of an upload. With the default sink it is in a temporary file
+// that is removed with the form unless it is moved with save_as().
+struct UploadedFile {
+    std::string name;
+    std::string filename;
+    std::string content_type;
+    std::string path;   // Temporary file; empty when the part went to a custom sink
+    uint64_t size = 0;
+    bool temporary = false;
+
+    bool save_as(const std::string& destination) {
+        if (path.empty()) return false;
+        std::remove(destination.c_str());
+        if (std::rename(path.c_str(), destination.c_str()) != 0) return false;
+        path = destination;
+        temporary = false;
+        return true;
+    }
+};
+
+struct UploadOptions {
+    std::string temp_dir;              // Defaults to TMPDIR (TEMP on Windows) or /tmp
+    uint64_t max_size = 0;             // Whole body; 0 for no limit
+    uint64_t max_file_size = 0;        // Each file part; 0 for no limit
+    size_t max_field_size = 64 * 1024; // Each part without a filename, kept in memory
+    size_t max_parts = 1000;
+    // Returns the sink for a file part. When unset or it returns nullptr the
+    // file goes to a temporary file.
+    std::function<std::unique_ptr<UploadSink>(const Request&, const MultipartPart&)> open_sink;
+};
+
+// The parsed form: fields in memory, files as UploadedFile.
+class MultipartForm {
+public:
+    std::vector<std::pair<std::string, std::string>> fields;
+    std::vector<UploadedFile> files;
+
+    MultipartForm() = default;
+    MultipartForm(const MultipartForm&) = delete;
+    MultipartForm& operator=(const MultipartForm&) = delete;
+    MultipartForm(MultipartForm&&) = default;
+    MultipartForm& operator=(MultipartForm&&) = default;
+
+    ~MultipartForm() {
+        for (const UploadedFile& file : files) {
+            if (file.temporary) std::remove(file.path.c_str());
+        }
+    }
+
+    bool has(const std::string& name) const {
+        for (const auto& field : fields) {
+            if (field.first == name) return true;
+        }
+        return false;
+    }
+
+    std::string get(const std::string& name, const std::string& default_value = "") const {
+        for (const auto& field : fields) {
+            if (field.first == name) return field.second;
+        }
+        return default_value;
+    }
+
+    UploadedFile* file(const std::string& name) {
+        for (UploadedFile& file : files) {
+            if (file.name == name) return &file;
+        }
+        return nullptr;
+    }
+};
+
+namespace detail {
+
+// Writes a part to a new file in `dir` through stdio's buffer.
+class TempFileSink : public UploadSink {
+public:
+    TempFileSink(const std::string& dir, std::string& path) {
+        static std::atomic<uint64_t> counter{0};
+        uint64_t unique = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#ifdef _WIN32
+        for (int attempt = 0; attempt < 16 && !file_; attempt++) {
+            path = dir + "\\xebec-upload-" + std::to_string(unique) + "-" + std::to_string(counter++);
+            // "x" fails if the file exists, so a name is never shared.
+            file_ = std::fopen(path.c_str(), "wbx");
+        }
+#else
+        path = dir + "/xebec-upload-XXXXXX";
+        int fd = mkstemp(&path[0]);
+        if (fd >= 0) {
+            file_ = fdopen(fd, "wb");
+            if (!file_) ::close(fd);
+        }
+        (void)unique;
+#endif
+        if (!file_) throw HttpError(500, "Cannot create upload file in " + dir);
+    }
+
+    ~TempFileSink() override {
+        if (file_) std::fclose(file_);
+    }
+
+    void write(const char* data, size_t length) override {
+        if (std::fwrite(data, 1, length, file_) != length) throw HttpError(500, "Cannot write upload file");
+    }
+
+    void close() override {
+        int result = std::fclose(file_);
+        file_ = nullptr;
+        if (result != 0) throw HttpError(500, "Cannot write upload file");
+    }
+
+private:
+    std::FILE* file_ = nullptr;
+};
+
+inline std::string default_temp_dir() {
+#ifdef _WIN32
+    const char* dir = std::getenv("TEMP");
+    return dir ? dir : ".";
+#else
+    const char* dir = std::getenv("TMPDIR");
+    return dir && *dir ? dir : "/tmp";
+#endif
+}
+
+} // namespace detail
+
+// Parses a multipart/form-data request body. A streamed body (upload routes)
+// is read from req.body_reader in fixed-size chunks; otherwise req.body is used.
+inline MultipartForm read_multipart(Request& req, const UploadOptions& options) {
+    std::string boundary = MultipartParser::boundary_of(req.get_header("Content-Type"));
+    if (boundary.empty()) throw HttpError(415, "Expected multipart/form-data");
+    uint64_t content_length = std::strtoull(req.get_header("Content-Length", "0").c_str(), nullptr, 10);
+    if (options.max_size && content_length > options.max_size) throw HttpError(413, "Payload too large");
+
+    MultipartForm form;
+    MultipartParser parser(boundary);
+    MultipartPart current;
+    std::unique_ptr<UploadSink> sink;
+    std::string field;
+    uint64_t part_size = 0;
+    size_t parts = 0;
+
+    parser.on_part = [&](const MultipartPart& part) {
+        if (++parts > options.max_parts) throw HttpError(413, "Too many multipart parts");
+        current = part;
+        part_size = 0;
+        field.clear();
+        if (!part.is_file) return;
+        UploadedFile file;
+        file.name = part.name;
+        file.filename = part.filename;
+        file.content_type = part.content_type;
+        if (options.open_sink) sink = options.open_sink(req, part);
+        if (!sink) {
+            sink = std::make_unique<detail::TempFileSink>(
+                options.temp_dir.empty() ? detail::default_temp_dir() : options.temp_dir, file.path);
+            file.temporary = true;
+        }
+        form.files.push_back(std::move(file));
+    };
+    parser.on_data = [&](const char* data, size_t length) {
+        part_size += length;
+        if (current.is_file) {
+            if (options.max_file_size && part_size > options.max_file_size) throw HttpError(413, "Uploaded file too large");
+            sink->write(data, length);
+        } else {
+            if (part_size > options.max_field_size) throw HttpError(413, "Form field too large");
+            field.append(data, length);
+        }
+    };
+    parser.on_part_end = [&]() {
+        if (current.is_file) {
+            form.files.back().size = part_size;
+            std::unique_ptr<UploadSink> finished = std::move(sink);
+            finished->close();
+        } else {
+            form.fields.emplace_back(current.name, std::move(field));
+            field = std::string();
+        }
+    };
+
+    if (req.body_reader) {
+        const size_t chunk_size = 64 * 1024;
+        std::unique_ptr<char[]> chunk(new char[chunk_size]);
+        size_t received;
+        while ((received = req.body_reader(chunk.get(), chunk_size)) > 0) {
+            parser.feed(chunk.get(), received);
+        }
+    } else {
+        parser.feed(req.body.data(), req.body.size());
+    }
+    parser.finish();
+    return form;
+}
+
+} // namespace xebec
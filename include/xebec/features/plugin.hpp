@@ -1,18 +1,82 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
 
 namespace xebec {
 
-// Forward declaration
+// Forward declarations
 class http_server;
+class Request;
+class Response;
+struct WebSocketFrame;
 
+// A client connection as seen by plugin hooks.
+struct ConnectionInfo {
+    uint64_t id;                    // the socket; unique while the connection is open
+    std::string_view remote_addr;
+    bool secure;
+};
+
+// Hooks are called on the thread serving the connection, so they must be
+// thread-safe. Only the hooks a plugin overrides are ever called.
 class Plugin {
 public:
     virtual ~Plugin() = default;
     virtual void init(http_server* server) = 0;
     virtual std::string name() const = 0;
     virtual std::string version() const = 0;
+
+    virtual void on_connection(const ConnectionInfo&) {}
+    // `raw` is the request head as received; empty for HTTP/2.
+    virtual void on_request_parsed(Request&, std::string_view /*raw*/) {}
+    // Before the response is sent; headers may still be changed.
+    virtual void on_response(const Request&, Response&) {}
+    // Frames received on a WebSocket, `req` being the upgrade request.
+    virtual void on_ws_frame(const Request&, const WebSocketFrame&) {}
+    virtual void on_close(const ConnectionInfo&) {}
+};
+
+// One flat list per hook, holding only the plugins that override it, so a
+// hook without plugins costs a test for an empty vector.
+struct PluginHooks {
+    std::vector<Plugin*> connection;
+    std::vector<Plugin*> request_parsed;
+    std::vector<Plugin*> response;
+    std::vector<Plugin*> ws_frame;
+    std::vector<Plugin*> close;
+
+    // Overrides are found from the static type `T`; a plugin handed over as a
+    // plain Plugin is called for every hook.
+    template <typename T>
+    void add(Plugin* plugin) {
+        constexpr bool unknown = std::is_same_v<T, Plugin>;
+        if (unknown || !std::is_same_v<decltype(&T::on_connection), decltype(&Plugin::on_connection)>) {
+            connection.push_back(plugin);
+        }
+        if (unknown || !std::is_same_v<decltype(&T::on_request_parsed), decltype(&Plugin::on_request_parsed)>) {
+            request_parsed.push_back(plugin);
+        }
+        if (unknown || !std::is_same_v<decltype(&T::on_response), decltype(&Plugin::on_response)>) {
+            response.push_back(plugin);
+        }
+        if (unknown || !std::is_same_v<decltype(&T::on_ws_frame), decltype(&Plugin::on_ws_frame)>) {
+            ws_frame.push_back(plugin);
+        }
+        if (unknown || !std::is_same_v<decltype(&T::on_close), decltype(&Plugin::on_close)>) {
+            close.push_back(plugin);
+        }
+    }
+
+    void remove(Plugin* plugin) {
+        for (std::vector<Plugin*>* hook : {&connection, &request_parsed, &response, &ws_frame, &close}) {
+            hook->erase(std::remove(hook->begin(), hook->end(), plugin), hook->end());
+        }
+    }
 };
 
-} // namespace xebec 
\ No newline at end of file
+} // namespace xebec
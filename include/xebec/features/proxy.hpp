@@ -0,0 +1,638 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <condition_variable>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#ifndef _WIN32
+#include <netdb.h>
+#include <netinet/tcp.h>
+#endif
+#include "plugin.hpp"
+#include "../core/error.hpp"
+#include "../core/request.hpp"
+#include "../core/response.hpp"
+#include "../server/connection.hpp"
+#include "../server/http_server.hpp"
+
+namespace xebec {
+
+struct ProxyOptions {
+    enum class Balance { PowerOfTwoChoices, LeastConnections };
+    Balance balance = Balance::PowerOfTwoChoices;
+    size_t max_idle_connections = 32;  // Kept-alive connections pooled per upstream
+    int idle_timeout_ms = 30000;       // Pooled connections unused for longer are closed
+    int connect_timeout_ms = 2000;
+    int read_timeout_ms = 30000;       // Per read from an upstream; 504 when the head is late
+    std::string health_path = "/health"; // Polled with GET; empty disables active checks
+    int health_interval_ms = 2000;
+    int failure_threshold = 5;         // Consecutive failures that open an upstream's circuit
+    int open_circuit_ms = 5000;        // How long an open circuit rejects before one trial request
+};
+
+// One upstream server: a pool of keep-alive connections, an in-flight count
+// for balancing, and the health and circuit breaker state.
+class ProxyUpstream {
+public:
+    const std::string host;
+    const int port;
+    std::atomic<int> in_flight{0};
+
+    ProxyUpstream(std::string host_name, int port_number, const ProxyOptions& options)
+        : host(std::move(host_name)), port(port_number), options_(options) {}
+
+    // Accepts "host:port" or "http://host:port".
+    static std::unique_ptr<ProxyUpstream> parse(std::string address, const ProxyOptions& options) {
+        if (address.compare(0, 7, "http://") == 0) address.erase(0, 7);
+        while (!address.empty() && address.back() == '/') address.pop_back();
+        size_t colon = address.rfind(':');
+        int port = 80;
+        if (colon != std::string::npos) {
+            port = std::atoi(address.c_str() + colon + 1);
+            address.erase(colon);
+        }
+        return std::make_unique<ProxyUpstream>(address, port, options);
+    }
+
+    // Healthy and not rejecting because of an open circuit.
+    bool available(int64_t now) const {
+        return healthy_.load(std::memory_order_relaxed) && now >= open_until_.load(std::memory_order_relaxed);
+    }
+
+    // Called for the upstream picked for a request. While the circuit is open only
+    // one caller gets through once it has cooled down (half-open); claiming the
+    // trial pushes the deadline out so the others keep being rejected.
+    bool admit(int64_t now) {
+        if (failures_.load(std::memory_order_relaxed) < options_.failure_threshold) return true;
+        int64_t until = open_until_.load();
+        return now >= until && open_until_.compare_exchange_strong(until, now + ms(options_.open_circuit_ms));
+    }
+
+    void record_success() {
+        failures_.store(0, std::memory_order_relaxed);
+        open_until_.store(0, std::memory_order_relaxed);
+    }
+
+    void record_failure() {
+        if (failures_.fetch_add(1) + 1 >= options_.failure_threshold) {
+            open_until_.store(now_ns() + ms(options_.open_circuit_ms));
+        }
+    }
+
+    bool circuit_open() const { return failures_.load() >= options_.failure_threshold; }
+    bool healthy() const { return healthy_.load(); }
+    void set_healthy(bool healthy) { healthy_.store(healthy); }
+
+    // A pooled connection (most recently used first) or a new one. `reused`
+    // tells whether the upstream may have closed it in the meantime. Pooled
+    // connections with something to read have been closed already, as nothing
+    // is expected on them, and are dropped.
+    std::unique_ptr<Connection> acquire(bool& reused) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            int64_t now = now_ns();
+            while (!idle_.empty()) {
+                Idle entry = std::move(idle_.back());
+                idle_.pop_back();
+                pollfd readable{};
+                readable.fd = entry.connection->socket();
+                readable.events = POLLIN;
+                if (now - entry.since < ms(options_.idle_timeout_ms) && SOCKET_POLL(&readable, 1, 0) == 0) {
+                    reused = true;
+                    return std::move(entry.connection);
+                }
+            }
+        }
+        reused = false;
+        return connect(options_.connect_timeout_ms, options_.read_timeout_ms);
+    }
+
+    void release(std::unique_ptr<Connection> connection) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (idle_.size() < options_.max_idle_connections) {
+            idle_.push_back(Idle{std::move(connection), now_ns()});
+        }
+    }
+
+    size_t idle_connections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return idle_.size();
+    }
+
+    // A new connection with a connect timeout and a read timeout, or nullptr.
+    std::unique_ptr<Connection> connect(int connect_timeout_ms, int read_timeout_ms) const {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) return nullptr;
+        std::unique_ptr<Connection> result;
+        for (addrinfo* address = addresses; address && !result; address = address->ai_next) {
+            SOCKET sock = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (sock == INVALID_SOCKET) continue;
+            auto connection = std::make_unique<Connection>(sock);
+            if (connect_with_timeout(sock, address, connect_timeout_ms)) {
+                int one = 1;
+                setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&one), sizeof(one));
+                set_read_timeout(sock, read_timeout_ms);
+                result = std::move(connection);
+            }
+        }
+        freeaddrinfo(addresses);
+        return result;
+    }
+
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t ms(int milliseconds) { return static_cast<int64_t>(milliseconds) * 1000000; }
+
+    static void set_read_timeout(SOCKET sock, int timeout_ms) {
+#ifdef _WIN32
+        DWORD timeout = static_cast<DWORD>(timeout_ms);
+#else
+        timeval timeout{timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+#endif
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+    }
+
+private:
+    struct Idle {
+        std::unique_ptr<Connection> connection;
+        int64_t since;
+    };
+
+    const ProxyOptions& options_;
+    std::mutex mutex_;
+    std::vector<Idle> idle_;
+    std::atomic<bool> healthy_{true};
+    std::atomic<int> failures_{0};
+    std::atomic<int64_t> open_until_{0};
+
+    static bool connect_with_timeout(SOCKET sock, addrinfo* address, int timeout_ms) {
+#ifdef _WIN32
+        u_long non_blocking = 1;
+        ioctlsocket(sock, FIONBIO, &non_blocking);
+#else
+        int flags = fcntl(sock, F_GETFL, 0);
+        fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+#endif
+        bool connected = ::connect(sock, address->ai_addr, static_cast<int>(address->ai_addrlen)) == 0;
+        if (!connected) {
+            pollfd writable{};
+            writable.fd = sock;
+            writable.events = POLLOUT;
+            int error = 0;
+            socklen_t length = sizeof(error);
+            connected = SOCKET_POLL(&writable, 1, timeout_ms) == 1 &&
+                        getsockopt(sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) == 0 &&
+                        error == 0;
+        }
+#ifdef _WIN32
+        non_blocking = 0;
+        ioctlsocket(sock, FIONBIO, &non_blocking);
+#else
+        fcntl(sock, F_SETFL, flags);
+#endif
+        return connected;
+    }
+};
+
+// Response head from an upstream, and how its body is framed.
+struct ProxyResponseHead {
+    int status = 0;
+    std::string status_line;                         // "200 OK\r\n"
+    std::vector<std::pair<std::string, std::string>> headers;
+    int64_t content_length = -1;
+    bool chunked = false;
+    bool keep_alive = true;
+};
+
+// Forwards requests under a path prefix to a group of upstream servers:
+//
+//     auto proxy = std::make_unique<xebec::ProxyPlugin>();
+//     proxy->route("/api", {"127.0.0.1:9001", "127.0.0.1:9002"});
+//     server.register_plugin(std::move(proxy));
+//
+// Connections to each upstream are kept alive and pooled. Request and response
+// bodies are relayed in fixed-size chunks as they arrive, never buffered whole.
+class ProxyPlugin : public Plugin {
+public:
+    explicit ProxyPlugin(ProxyOptions options = ProxyOptions()) : options_(std::move(options)) {}
+
+    ~ProxyPlugin() override {
+        {
+            std::lock_guard<std::mutex> lock(health_mutex_);
+            stopping_ = true;
+        }
+        health_cv_.notify_all();
+        if (health_thread_.joinable()) health_thread_.join();
+    }
+
+    // Requests for `prefix` and everything below it go to `upstreams`.
+    ProxyPlugin& route(const std::string& prefix, const std::vector<std::string>& upstreams) {
+        auto group = std::make_unique<Route>();
+        group->prefix = prefix;
+        for (const std::string& address : upstreams) group->upstreams.push_back(ProxyUpstream::parse(address, options_));
+        routes_.push_back(std::move(group));
+        return *this;
+    }
+
+    void init(http_server* server) override {
+        static const char* const methods[] = {"GET", "HEAD", "POST", "PUT", "DELETE", "PATCH", "OPTIONS"};
+        for (const auto& route : routes_) {
+            Route* target = route.get();
+            std::string pattern = route->prefix == "/" ? "/.*" : regex_escape(route->prefix) + "(/.*)?";
+            for (const char* method : methods) {
+                server->stream_body(method, pattern, [this, target](Request& req, Response& res) {
+                    forward(*target, req, res);
+                });
+            }
+        }
+        if (!options_.health_path.empty() && !routes_.empty()) {
+            health_thread_ = std::thread(&ProxyPlugin::check_health, this);
+        }
+    }
+
+    std::string name() const override { return "proxy"; }
+    std::string version() const override { return "1.0.0"; }
+
+    // The upstreams of the route for `prefix`, for monitoring.
+    std::vector<ProxyUpstream*> upstreams(const std::string& prefix) const {
+        std::vector<ProxyUpstream*> result;
+        for (const auto& route : routes_) {
+            if (route->prefix != prefix) continue;
+            for (const auto& upstream : route->upstreams) result.push_back(upstream.get());
+        }
+        return result;
+    }
+
+private:
+    struct Route {
+        std::string prefix;
+        std::vector<std::unique_ptr<ProxyUpstream>> upstreams;
+        std::atomic<size_t> next{0};
+    };
+
+    // An upstream connection relaying a response body. It goes back to the pool
+    // only once the whole body has been read.
+    struct Exchange {
+        ProxyUpstream* upstream;
+        std::unique_ptr<Connection> connection;
+        std::string buffer;  // Bytes read past the head
+        ~Exchange() { upstream->in_flight--; }
+    };
+
+    ProxyOptions options_;
+    std::vector<std::unique_ptr<Route>> routes_;
+    std::thread health_thread_;
+    std::mutex health_mutex_;
+    std::condition_variable health_cv_;
+    bool stopping_ = false;
+
+    static constexpr size_t chunk_size = 64 * 1024;
+    static constexpr size_t max_head_size = 64 * 1024;
+
+    // Power of two choices: the less busy of two random available upstreams,
+    // which stays close to least-connections without scanning every upstream.
+    ProxyUpstream* pick(Route& route, const std::vector<ProxyUpstream*>& tried) {
+        static thread_local std::minstd_rand random(std::random_device{}());
+        int64_t now = ProxyUpstream::now_ns();
+        std::vector<ProxyUpstream*> candidates;
+        candidates.reserve(route.upstreams.size());
+        for (const auto& upstream : route.upstreams) {
+            if (upstream->available(now) && std::find(tried.begin(), tried.end(), upstream.get()) == tried.end()) {
+                candidates.push_back(upstream.get());
+            }
+        }
+        // Circuits are tried in order of preference; a half-open one admits a single trial.
+        while (!candidates.empty()) {
+            size_t choice;
+            if (options_.balance == ProxyOptions::Balance::LeastConnections) {
+                size_t start = route.next++ % candidates.size();
+                choice = start;
+                for (size_t i = 1; i < candidates.size(); i++) {
+                    size_t index = (start + i) % candidates.size();
+                    if (candidates[index]->in_flight < candidates[choice]->in_flight) choice = index;
+                }
+            } else {
+                choice = random() % candidates.size();
+                if (candidates.size() > 1) {
+                    size_t other = (choice + 1 + random() % (candidates.size() - 1)) % candidates.size();
+                    if (candidates[other]->in_flight < candidates[choice]->in_flight) choice = other;
+                }
+            }
+            if (candidates[choice]->admit(now)) return candidates[choice];
+            candidates.erase(candidates.begin() + static_cast<ptrdiff_t>(choice));
+        }
+        return nullptr;
+    }
+
+    void forward(Route& route, Request& req, Response& res) {
+        uint64_t body_length = req.body_reader ? content_length(req) : req.body.size();
+        std::string head = request_head(req, body_length);
+        ProxyResponseHead response;
+        std::shared_ptr<Exchange> exchange;
+        std::vector<ProxyUpstream*> tried;
+        bool sent = false;
+        bool timed_out = false;
+        // An upstream that could not be reached never saw the request, so another one is tried.
+        while (!exchange && !sent) {
+            ProxyUpstream* upstream = pick(route, tried);
+            if (!upstream) {
+                if (tried.empty()) throw HttpError(503, "No upstream available");
+                break;
+            }
+            tried.push_back(upstream);
+            exchange = send_request(*upstream, req, head, body_length, response, sent, timed_out);
+        }
+        if (!exchange) throw HttpError(timed_out ? 504 : 502, timed_out ? "Upstream timed out" : "Bad gateway");
+        ProxyUpstream* upstream = exchange->upstream;
+        if (response.status >= 500) {
+            upstream->record_failure();
+        } else {
+            upstream->record_success();
+        }
+
+        res.status = response.status_line;
+        for (const auto& header : response.headers) {
+            if (!hop_by_hop(header.first) && !equals_lower(header.first, "content-length")) {
+                res.header(header.first, header.second);
+            }
+        }
+        bool bodyless = req.method == "HEAD" || response.status == 204 || response.status == 304 ||
+                        response.status < 200;
+        if (bodyless) {
+            if (response.keep_alive) upstream->release(std::move(exchange->connection));
+            return;
+        }
+        int64_t length = response.chunked ? -1 : response.content_length;
+        bool keep_alive = response.keep_alive && (response.chunked || response.content_length >= 0);
+        res.stream([exchange, response, keep_alive](const BodyWriter& write) {
+            bool complete = response.chunked ? relay_chunked(*exchange, write)
+                                             : relay(*exchange, response.content_length, write);
+            if (complete && keep_alive) exchange->upstream->release(std::move(exchange->connection));
+            return complete;
+        }, length);
+    }
+
+    // Sends the request and reads the response head, or returns nullptr. A pooled
+    // connection the upstream has closed fails before any response byte; that is
+    // retried once on a new connection if the body can be sent again. `sent` tells
+    // whether the request cannot be sent elsewhere: the upstream may have received
+    // it, or part of a streamed body has been read and is gone. Only a failed new
+    // connection or a timeout counts against the upstream; a pooled connection
+    // can have been closed by it while idle.
+    std::shared_ptr<Exchange> send_request(ProxyUpstream& upstream, Request& req, const std::string& head,
+                                           uint64_t body_length, ProxyResponseHead& response,
+                                           bool& sent, bool& timed_out) {
+        upstream.in_flight++;
+        auto exchange = std::make_shared<Exchange>();
+        exchange->upstream = &upstream;
+        bool body_read = false;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            bool reused = false;
+            exchange->connection = upstream.acquire(reused);
+            if (!exchange->connection) {
+                upstream.record_failure();
+                return nullptr;
+            }
+            exchange->buffer.clear();
+            bool written = exchange->connection->send_all(head.data(), head.size());
+            sent = sent || (written && !reused);
+            written = written && send_body(*exchange->connection, req, body_length, body_read);
+            sent = sent || body_read;
+            if (written && read_head(*exchange, response, timed_out)) return exchange;
+            exchange->connection.reset();
+            if (!reused || timed_out) {
+                upstream.record_failure();
+                break;
+            }
+            if (body_read) break;
+        }
+        return nullptr;
+    }
+
+    static uint64_t content_length(const Request& req) {
+        for (const auto& header : req.headers) {
+            if (equals_lower(header.first, "content-length")) return std::strtoull(header.second.c_str(), nullptr, 10);
+        }
+        return 0;
+    }
+
+    static std::string request_head(const Request& req, uint64_t body_length) {
+        std::string head = req.method + " " + req.path;
+        if (!req.query.raw().empty()) head += "?" + req.query.raw();
+        head += " HTTP/1.1\r\n";
+        for (const auto& header : req.headers) {
+            if (hop_by_hop(header.first) || equals_lower(header.first, "content-length") ||
+                equals_lower(header.first, "expect")) {
+                continue;
+            }
+            head += header.first + ": " + header.second + "\r\n";
+        }
+        if (!req.has_header("X-Forwarded-Proto")) head += "X-Forwarded-Proto: http\r\n";
+        if (body_length > 0 || req.method == "POST" || req.method == "PUT" || req.method == "PATCH") {
+            head += "Content-Length: " + std::to_string(body_length) + "\r\n";
+        }
+        head += "\r\n";
+        return head;
+    }
+
+    // A streamed request body is relayed chunk by chunk as it is read from the client.
+    static bool send_body(Connection& upstream, Request& req, uint64_t length, bool& body_read) {
+        if (!req.body_reader) return upstream.send_all(req.body.data(), req.body.size());
+        if (length == 0) return true;
+        std::unique_ptr<char[]> chunk(new char[chunk_size]);
+        size_t received;
+        while ((received = req.body_reader(chunk.get(), chunk_size)) > 0) {
+            body_read = true;
+            if (!upstream.send_all(chunk.get(), received)) return false;
+        }
+        return true;
+    }
+
+    static bool read_head(Exchange& exchange, ProxyResponseHead& response, bool& timed_out) {
+        char chunk[16 * 1024];
+        size_t head_end;
+        while ((head_end = exchange.buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (exchange.buffer.size() > max_head_size) return false;
+            int received = exchange.connection->recv(chunk, sizeof(chunk));
+            if (received <= 0) {
+                timed_out = received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+                return false;
+            }
+            exchange.buffer.append(chunk, static_cast<size_t>(received));
+        }
+        std::string head = exchange.buffer.substr(0, head_end);
+        exchange.buffer.erase(0, head_end + 4);
+
+        size_t line_end = head.find("\r\n");
+        std::string status_line = head.substr(0, line_end);
+        size_t space = status_line.find(' ');
+        if (space == std::string::npos || status_line.compare(0, 5, "HTTP/") != 0) return false;
+        response.status = std::atoi(status_line.c_str() + space + 1);
+        response.status_line = status_line.substr(space + 1) + "\r\n";
+        response.keep_alive = status_line.compare(0, 8, "HTTP/1.0") != 0;
+        while (line_end != std::string::npos) {
+            size_t start = line_end + 2;
+            line_end = head.find("\r\n", start);
+            std::string line = head.substr(start, line_end == std::string::npos ? std::string::npos : line_end - start);
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon);
+            size_t value_start = line.find_first_not_of(" \t", colon + 1);
+            std::string value = value_start == std::string::npos ? "" : line.substr(value_start);
+            if (equals_lower(name, "content-length")) {
+                response.content_length = std::strtoll(value.c_str(), nullptr, 10);
+            } else if (equals_lower(name, "transfer-encoding")) {
+                response.chunked = contains_lower(value, "chunked");
+            } else if (equals_lower(name, "connection")) {
+                if (contains_lower(value, "close")) response.keep_alive = false;
+                if (contains_lower(value, "keep-alive")) response.keep_alive = true;
+            }
+            response.headers.emplace_back(std::move(name), std::move(value));
+        }
+        // 1xx responses other than 101 are informational; the real one follows.
+        if (response.status >= 100 && response.status < 200 && response.status != 101) {
+            response = ProxyResponseHead();
+            return read_head(exchange, response, timed_out);
+        }
+        return true;
+    }
+
+    // Relays `length` bytes, or everything until the upstream closes when it is -1.
+    static bool relay(Exchange& exchange, int64_t length, const BodyWriter& write) {
+        uint64_t remaining = length < 0 ? UINT64_MAX : static_cast<uint64_t>(length);
+        size_t buffered = static_cast<size_t>(std::min<uint64_t>(exchange.buffer.size(), remaining));
+        if (buffered > 0 && !write(exchange.buffer.data(), buffered)) return false;
+        remaining -= buffered;
+        exchange.buffer.erase(0, buffered);
+        std::unique_ptr<char[]> chunk(new char[chunk_size]);
+        while (remaining > 0) {
+            int received = exchange.connection->recv(chunk.get(), static_cast<size_t>(std::min<uint64_t>(chunk_size, remaining)));
+            if (received <= 0) return length < 0 && received == 0;
+            remaining -= static_cast<uint64_t>(received);
+            if (!write(chunk.get(), static_cast<size_t>(received))) return false;
+        }
+        return true;
+    }
+
+    // Decodes the upstream's chunked framing; the server re-frames what is written.
+    static bool relay_chunked(Exchange& exchange, const BodyWriter& write) {
+        while (true) {
+            std::string line;
+            uint64_t size;
+            if (!read_line(exchange, line) || !chunk_size_of(line, size)) return false;
+            if (size == 0) {
+                // Trailers, then the blank line that ends the body.
+                do {
+                    if (!read_line(exchange, line)) return false;
+                } while (!line.empty());
+                return true;
+            }
+            if (!relay(exchange, static_cast<int64_t>(size), write) || !read_line(exchange, line)) return false;
+        }
+    }
+
+    // The hex size that starts a chunk line, before any ";" extensions. Fails on
+    // anything else, and on sizes past what relay() takes.
+    static bool chunk_size_of(const std::string& line, uint64_t& size) {
+        if (line.empty() || !std::isxdigit(static_cast<unsigned char>(line[0]))) return false;
+        char* end;
+        errno = 0;
+        size = std::strtoull(line.c_str(), &end, 16);
+        if (errno == ERANGE || size > static_cast<uint64_t>(INT64_MAX)) return false;
+        while (*end == ' ' || *end == '\t') ++end;
+        return *end == '\0' || *end == ';';
+    }
+
+    static bool read_line(Exchange& exchange, std::string& line) {
+        char chunk[4096];
+        size_t end;
+        while ((end = exchange.buffer.find("\r\n")) == std::string::npos) {
+            if (exchange.buffer.size() > max_head_size) return false;
+            int received = exchange.connection->recv(chunk, sizeof(chunk));
+            if (received <= 0) return false;
+            exchange.buffer.append(chunk, static_cast<size_t>(received));
+        }
+        line = exchange.buffer.substr(0, end);
+        exchange.buffer.erase(0, end + 2);
+        return true;
+    }
+
+    // Active health checks: a GET of health_path on a separate connection. Any
+    // 2xx or 3xx marks the upstream healthy.
+    void check_health() {
+        std::unique_lock<std::mutex> lock(health_mutex_);
+        while (!stopping_) {
+            lock.unlock();
+            for (const auto& route : routes_) {
+                for (const auto& upstream : route->upstreams) {
+                    upstream->set_healthy(probe(*upstream));
+                }
+            }
+            lock.lock();
+            health_cv_.wait_for(lock, std::chrono::milliseconds(options_.health_interval_ms),
+                                [this] { return stopping_; });
+        }
+    }
+
+    bool probe(ProxyUpstream& upstream) const {
+        int timeout = std::min(options_.connect_timeout_ms, options_.health_interval_ms);
+        std::unique_ptr<Connection> connection = upstream.connect(timeout, timeout);
+        if (!connection) return false;
+        std::string request = "GET " + options_.health_path + " HTTP/1.1\r\nHost: " + upstream.host +
+                              "\r\nConnection: close\r\n\r\n";
+        if (!connection->send_all(request.data(), request.size())) return false;
+        char status[16];
+        if (!connection->recv_all(status, 12)) return false;
+        return std::strncmp(status, "HTTP/1.", 7) == 0 && (status[9] == '2' || status[9] == '3');
+    }
+
+    static bool equals_lower(const std::string& name, const char* lower) {
+        size_t length = std::strlen(lower);
+        if (name.size() != length) return false;
+        for (size_t i = 0; i < length; i++) {
+            if (std::tolower(static_cast<unsigned char>(name[i])) != lower[i]) return false;
+        }
+        return true;
+    }
+
+    // `text` as a regular expression that matches only itself. ":" is escaped so
+    // that the route is not read as having :params.
+    static std::string regex_escape(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c != '\0' && std::strchr("\\^$.|?*+()[]{}:", c)) escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    static bool contains_lower(std::string value, const char* lower) {
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        return value.find(lower) != std::string::npos;
+    }
+
+    // Headers that describe one connection and are not forwarded (RFC 9110 7.6.1).
+    static bool hop_by_hop(const std::string& name) {
+        return equals_lower(name, "connection") || equals_lower(name, "keep-alive") ||
+               equals_lower(name, "transfer-encoding") || equals_lower(name, "te") ||
+               equals_lower(name, "trailer") || equals_lower(name, "upgrade") ||
+               equals_lower(name, "proxy-connection") || equals_lower(name, "proxy-authorization");
+    }
+};
+
+} // namespace xebec
@@ -0,0 +1,226 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <regex>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include "../core/request.hpp"
+#include "../core/response.hpp"
+#include "../core/middleware.hpp"
+
+namespace xebec {
+
+struct RateLimitOptions {
+    double rate = 10;                // tokens added per second
+    double burst = 20;               // bucket size: requests allowed at once
+    size_t max_clients = 1 << 20;    // clients tracked before idle ones are evicted
+    std::string key_header;          // client key; empty, or absent from a request, means the peer address
+};
+
+// Token-bucket rate limiting used as middleware:
+//
+//     xebec::RateLimitOptions options;
+//     options.rate = 5;
+//     options.burst = 10;
+//     xebec::RateLimiter limiter(options);
+//     limiter.route("POST", "/login");   // without routes every request counts
+//     server.use(limiter.middleware());
+//
+// Each client gets one bucket per route. A bucket is a single atomic word, the
+// time at which it would be full again, so a request refills and takes a token
+// with one compare-and-swap and no lock. Buckets live in a table of
+// cache-line-sized sets of four; a new client takes the idlest bucket of its set,
+// which evicts clients that have not been seen for the longest time. Clients are
+// told apart by a 64-bit hash of their key, and a client that is evicted while
+// sending starts over with a full bucket, so limits are approximate under
+// heavy churn.
+class RateLimiter {
+public:
+    explicit RateLimiter(RateLimitOptions options = RateLimitOptions())
+        : state_(std::make_shared<State>(std::move(options))) {}
+
+    // Counts requests to `path` (which may contain :params) separately from
+    // other routes.
+    RateLimiter& route(const std::string& method, const std::string& path) {
+        size_t id = state_->route_count++;
+        if (path.find(':') == std::string::npos) {
+            state_->exact_routes[method + " " + path] = id;
+        } else {
+            std::string pattern = std::regex_replace(path, std::regex("/:\\w+/?"), "/([^/]+)/?");
+            state_->pattern_routes.push_back({method, std::regex(pattern), id});
+        }
+        return *this;
+    }
+
+    // Takes a token from `key`'s bucket. When none is left, returns false and
+    // sets `retry_after` to the time until the next one.
+    bool allow(std::string_view key, std::chrono::nanoseconds& retry_after) {
+        return state_->allow(hash_key(key, 0), now(), retry_after);
+    }
+
+    bool allow(std::string_view key) {
+        std::chrono::nanoseconds retry_after;
+        return allow(key, retry_after);
+    }
+
+    // With an explicit clock reading, for tests.
+    bool allow_at(std::string_view key, std::chrono::nanoseconds time, std::chrono::nanoseconds& retry_after) {
+        return state_->allow(hash_key(key, 0), static_cast<uint64_t>(time.count()), retry_after);
+    }
+
+    size_t capacity() const {
+        return state_->sets.size() * ways;
+    }
+
+    std::function<void(Request&, Response&, MiddlewareContext::NextFunction)> middleware() const {
+        std::shared_ptr<State> state = state_;
+        return [state](Request& req, Response& res, MiddlewareContext::NextFunction next) {
+            state->handle(req, res, next);
+        };
+    }
+
+private:
+    static constexpr size_t ways = 4;
+
+    struct alignas(64) Set {
+        std::atomic<uint64_t> keys[ways];
+        std::atomic<uint64_t> full_at[ways];   // ns; 0 for an unused bucket
+    };
+
+    struct PatternRoute {
+        std::string method;
+        std::regex pattern;
+        size_t id;
+    };
+
+    struct State {
+        explicit State(RateLimitOptions limit_options) : options(std::move(limit_options)) {
+            if (!(options.rate > 0)) options.rate = 1;
+            if (options.burst < 1) options.burst = 1;
+            interval = static_cast<uint64_t>(std::llround(1e9 / options.rate));
+            if (interval == 0) interval = 1;
+            window = static_cast<uint64_t>(std::llround(options.burst * static_cast<double>(interval)));
+            size_t set_count = 1;
+            while (set_count * ways < options.max_clients) set_count <<= 1;
+            sets = std::vector<Set>(set_count);
+            for (Set& set : sets) {
+                for (size_t i = 0; i < ways; i++) {
+                    set.keys[i].store(0, std::memory_order_relaxed);
+                    set.full_at[i].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        RateLimitOptions options;
+        uint64_t interval;   // ns per token
+        uint64_t window;     // ns worth of tokens a full bucket holds
+        std::vector<Set> sets;
+        std::map<std::string, size_t> exact_routes;
+        std::vector<PatternRoute> pattern_routes;
+        size_t route_count = 0;
+
+        // The route's id plus one, 0 when it is not limited.
+        size_t find_route(const Request& req) const {
+            if (route_count == 0) return 1;
+            auto it = exact_routes.find(req.method + " " + req.path);
+            if (it != exact_routes.end()) return it->second + 1;
+            for (const auto& pattern_route : pattern_routes) {
+                if (pattern_route.method == req.method && std::regex_match(req.path, pattern_route.pattern)) {
+                    return pattern_route.id + 1;
+                }
+            }
+            return 0;
+        }
+
+        void handle(Request& req, Response& res, const MiddlewareContext::NextFunction& next) {
+            size_t route = find_route(req);
+            if (route == 0) {
+                next();
+                return;
+            }
+            std::chrono::nanoseconds retry_after;
+            if (allow(client_hash(req, route), RateLimiter::now(), retry_after)) {
+                next();
+                return;
+            }
+            auto seconds = (retry_after.count() + 999999999) / 1000000000;
+            res.status_code(429);
+            res.header("Retry-After", std::to_string(seconds > 0 ? seconds : 1));
+            res.json().begin_object().field("error", "Too Many Requests").end_object();
+        }
+
+        // Requests without the key header are told apart by address, in buckets
+        // no header value can share.
+        uint64_t client_hash(const Request& req, size_t route) const {
+            if (!options.key_header.empty()) {
+                auto it = req.headers.find(options.key_header);
+                if (it != req.headers.end()) return hash_key(it->second, route);
+            }
+            uint64_t hash = hash_key(req.remote_addr, route);
+            return options.key_header.empty() ? hash : (hash ^ 0x8000000000000000ull) | 1;
+        }
+
+        // A bucket is full at time `full_at`; each request moves that one interval
+        // later, and is refused when it would land more than a full bucket ahead.
+        bool allow(uint64_t hash, uint64_t now, std::chrono::nanoseconds& retry_after) {
+            std::atomic<uint64_t>& bucket = find_bucket(hash);
+            uint64_t full_at = bucket.load(std::memory_order_relaxed);
+            for (;;) {
+                uint64_t next_full = (full_at > now ? full_at : now) + interval;
+                if (next_full - now > window) {
+                    retry_after = std::chrono::nanoseconds(next_full - now - window);
+                    return false;
+                }
+                if (bucket.compare_exchange_weak(full_at, next_full, std::memory_order_relaxed)) return true;
+            }
+        }
+
+        std::atomic<uint64_t>& find_bucket(uint64_t hash) {
+            Set& set = sets[(hash >> 32) & (sets.size() - 1)];
+            for (size_t i = 0; i < ways; i++) {
+                if (set.keys[i].load(std::memory_order_relaxed) == hash) return set.full_at[i];
+            }
+            // The bucket that has been full the longest belongs to the idlest client.
+            size_t victim = 0;
+            uint64_t oldest = set.full_at[0].load(std::memory_order_relaxed);
+            for (size_t i = 1; i < ways; i++) {
+                uint64_t full_at = set.full_at[i].load(std::memory_order_relaxed);
+                if (full_at < oldest) {
+                    oldest = full_at;
+                    victim = i;
+                }
+            }
+            uint64_t old_key = set.keys[victim].load(std::memory_order_relaxed);
+            if (set.keys[victim].compare_exchange_strong(old_key, hash, std::memory_order_relaxed)) {
+                set.full_at[victim].store(0, std::memory_order_relaxed);
+            }
+            // Lost the race to another new client: share its bucket this once.
+            return set.full_at[victim];
+        }
+    };
+
+    // 0 marks an unused bucket, so no key hashes to it.
+    static uint64_t hash_key(std::string_view key, uint64_t route) {
+        uint64_t hash = 0xcbf29ce484222325ull ^ (route * 0x9E3779B97F4A7C15ull);
+        for (unsigned char c : key) hash = (hash ^ c) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+        hash *= 0xbf58476d1ce4e5b9ull;
+        hash ^= hash >> 32;
+        return hash ? hash : 1;
+    }
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace xebec
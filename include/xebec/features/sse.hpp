@@ -0,0 +1,410 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include "../server/connection.hpp"
+
+namespace xebec {
+
+struct SseOptions {
+    size_t history = 1024;        // events per channel kept for Last-Event-ID replay
+    int heartbeat_ms = 15000;     // comment sent to idle subscribers; 0 disables it
+    size_t max_channels = 10000;  // channels with subscribers or history at once
+};
+
+// One event in the text/event-stream format, framed as an HTTP/1.1 chunk so it
+// can be written to every subscriber as it is. Each line of `data`, ended by
+// CR, LF or CRLF as the client splits it, becomes a data field. Line breaks
+// are dropped from `event`, where they would start fields of their own.
+inline std::string encode_sse_event(uint64_t id, std::string_view event, std::string_view data) {
+    std::string payload = "id: " + std::to_string(id) + "\n";
+    if (!event.empty()) {
+        payload += "event: ";
+        for (char c : event) {
+            if (c != '\r' && c != '\n') payload += c;
+        }
+        payload += "\n";
+    }
+    size_t pos = 0;
+    do {
+        size_t end = data.find_first_of("\r\n", pos);
+        if (end == std::string_view::npos) end = data.size();
+        payload += "data: ";
+        payload.append(data.data() + pos, end - pos);
+        payload += "\n";
+        pos = end + (data.compare(end, 2, "\r\n") == 0 ? 2 : 1);
+    } while (pos <= data.size());
+    payload += "\n";
+
+    char size[20];
+    int size_length = std::snprintf(size, sizeof(size), "%zx\r\n", payload.size());
+    std::string chunk(size, static_cast<size_t>(size_length));
+    chunk += payload;
+    chunk += "\r\n";
+    return chunk;
+}
+
+// Server-Sent Events fan-out. Publishing encodes an event once, into a buffer
+// shared by every subscriber of the channel, and keeps it in a bounded ring of
+// recent events for clients that reconnect with Last-Event-ID. Subscribers are
+// non-blocking sockets driven by one thread with poll(): each one only holds a
+// cursor into its channel's ring, so an idle subscriber costs a socket and a
+// few words, and a subscriber that falls behind by more than the ring is
+// disconnected instead of buffering without bound. Event ids count up from 1
+// per channel. A channel gets its ring when something is first published to
+// it; one that never was is forgotten when its last subscriber leaves, so
+// clients subscribing to made-up channel names cost nothing once they are gone.
+class SseHub {
+public:
+    explicit SseHub(SseOptions options = SseOptions()) : options_(options) {
+        if (options_.history == 0) options_.history = 1;
+        if (!create_socket_pair(wake_)) {
+            throw std::runtime_error("SseHub: cannot create wake-up sockets");
+        }
+        set_socket_blocking(wake_[0], false);
+        set_socket_blocking(wake_[1], false);
+        thread_ = std::thread(&SseHub::run, this);
+    }
+
+    ~SseHub() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake();
+        thread_.join();
+        SOCKET_CLOSE(wake_[0]);
+        SOCKET_CLOSE(wake_[1]);
+    }
+
+    SseHub(const SseHub&) = delete;
+    SseHub& operator=(const SseHub&) = delete;
+
+    // Called with each connection the hub closes, before it is closed.
+    std::function<void(Connection&)> on_close;
+
+    // Sends `data` to the subscribers of `channel`. Returns the event's id, or 0
+    // when `channel` is new and max_channels are in use.
+    uint64_t publish(const std::string& channel, std::string_view data, std::string_view event = {}) {
+        Channel* found = find_channel(channel, true);
+        if (!found) return 0;
+        Channel& target = *found;
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(target.mutex);
+            if (target.ring.empty()) target.ring.resize(options_.history);
+            id = target.next_id++;
+            target.ring[id % target.ring.size()] =
+                std::make_shared<const std::string>(encode_sse_event(id, event, data));
+        }
+        if (!target.dirty.exchange(true, std::memory_order_acq_rel)) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                dirty_.push_back(&target);
+            }
+            wake();
+        }
+        return id;
+    }
+
+    // Takes over a connection whose response head has been sent. Events after
+    // `last_event_id` still in the ring are replayed first; without one, the
+    // subscriber starts with the next event published. The connection is closed
+    // instead when `channel` is new and max_channels are in use.
+    void subscribe(std::unique_ptr<Connection> connection, const std::string& channel,
+                   std::string_view last_event_id = {}) {
+        Channel* found = find_channel(channel, false);
+        if (!found) {
+            if (on_close) on_close(*connection);
+            connection->close();
+            return;
+        }
+        Channel& target = *found;
+        auto subscriber = std::make_unique<Subscriber>();
+        subscriber->channel = &target;
+        {
+            std::lock_guard<std::mutex> lock(target.mutex);
+            subscriber->next_id = target.next_id;
+            uint64_t last = 0;
+            if (parse_id(last_event_id, last) && last < target.next_id) {
+                uint64_t oldest = target.next_id > target.ring.size() ? target.next_id - target.ring.size() : 1;
+                subscriber->next_id = last + 1 > oldest ? last + 1 : oldest;
+            }
+        }
+        connection->set_blocking(false);
+        subscriber->connection = std::move(connection);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            incoming_.push_back(std::move(subscriber));
+        }
+        wake();
+    }
+
+    // Subscribers currently connected, across channels.
+    size_t subscribers() const {
+        return subscriber_count_.load(std::memory_order_relaxed);
+    }
+
+    // Channels with subscribers or history.
+    size_t channels() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return channels_.size();
+    }
+
+    // Closes every subscriber, and returns once they are closed.
+    void close_all() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t generation = ++close_requests_;
+        wake();
+        closed_cv_.wait(lock, [this, generation] { return closed_generation_ >= generation || stopping_; });
+    }
+
+private:
+    struct Subscriber;
+
+    struct Channel {
+        explicit Channel(const std::string& name) : name(name) {}
+
+        const std::string name;
+        std::mutex mutex;                                   // guards ring and next_id
+        std::vector<std::shared_ptr<const std::string>> ring;  // event `id` at id % size; empty until published
+        uint64_t next_id = 1;
+        std::atomic<bool> dirty{false};                      // queued for the hub thread
+        std::vector<Subscriber*> subscribers;                // hub thread only
+        size_t subscribed = 0;                               // guarded by the hub's mutex_, incoming included
+        bool published = false;                              // guarded by the hub's mutex_; kept from then on
+    };
+
+    struct Subscriber {
+        std::unique_ptr<Connection> connection;
+        Channel* channel = nullptr;
+        size_t channel_index = 0;
+        size_t index = 0;                                    // in subscribers_ and polls_
+        uint64_t next_id = 0;                                // next event to send
+        std::shared_ptr<const std::string> sending;          // chunk being written
+        size_t offset = 0;
+        bool blocked = false;                                // waiting for POLLOUT
+    };
+
+    SseOptions options_;
+    SOCKET wake_[2];
+    std::thread thread_;
+    mutable std::mutex mutex_;
+    std::condition_variable closed_cv_;
+    bool stopping_ = false;
+    uint64_t close_requests_ = 0;
+    uint64_t closed_generation_ = 0;
+    std::map<std::string, std::unique_ptr<Channel>> channels_;
+    std::vector<std::unique_ptr<Subscriber>> incoming_;
+    std::vector<Channel*> dirty_;
+    std::atomic<size_t> subscriber_count_{0};
+
+    // Hub thread only. polls_[0] is the wake-up socket; polls_[i + 1] is
+    // subscribers_[i].
+    std::vector<std::unique_ptr<Subscriber>> subscribers_;
+    std::vector<pollfd> polls_;
+
+    static bool parse_id(std::string_view text, uint64_t& id) {
+        if (text.empty() || text.size() > 19) return false;
+        id = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9') return false;
+            id = id * 10 + static_cast<uint64_t>(c - '0');
+        }
+        return true;
+    }
+
+    // Counts a subscriber in, or marks the channel published, so that it is not
+    // forgotten while in use. Null when a new channel would exceed max_channels.
+    Channel* find_channel(const std::string& name, bool publishing) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = channels_.find(name);
+        if (it == channels_.end()) {
+            if (channels_.size() >= options_.max_channels) return nullptr;
+            it = channels_.emplace(name, std::make_unique<Channel>(name)).first;
+        }
+        if (publishing) it->second->published = true;
+        else it->second->subscribed++;
+        return it->second.get();
+    }
+
+    // Counts a subscriber out, forgetting the channel if nothing was published to it.
+    void release_channel(Channel& channel) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--channel.subscribed == 0 && !channel.published) channels_.erase(channel.name);
+    }
+
+    void wake() {
+        char byte = 1;
+        ::send(wake_[1], &byte, 1, 0);
+    }
+
+    void run() {
+        static const auto heartbeat = std::make_shared<const std::string>("3\r\n:\n\n\r\n");
+        polls_.push_back(pollfd{wake_[0], POLLIN, 0});
+        auto next_heartbeat = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.heartbeat_ms);
+        std::vector<std::unique_ptr<Subscriber>> incoming;
+        std::vector<Channel*> dirty;
+        for (;;) {
+            int timeout = -1;
+            if (options_.heartbeat_ms > 0) {
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    next_heartbeat - std::chrono::steady_clock::now()).count();
+                timeout = wait > 0 ? static_cast<int>(wait) : 0;
+            }
+            int ready = SOCKET_POLL(polls_.data(), static_cast<unsigned long>(polls_.size()), timeout);
+
+            if (polls_[0].revents) {
+                char drain[256];
+                while (::recv(wake_[0], drain, sizeof(drain), 0) > 0) {}
+            }
+            uint64_t close_requests;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) break;
+                incoming.swap(incoming_);
+                dirty.swap(dirty_);
+                close_requests = close_requests_;
+            }
+
+            if (close_requests != closed_generation_) {
+                while (!subscribers_.empty()) drop(*subscribers_.back());
+                for (std::unique_ptr<Subscriber>& subscriber : incoming) release_channel(*subscriber->channel);
+                incoming.clear();
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    closed_generation_ = close_requests;
+                }
+                closed_cv_.notify_all();
+            }
+
+            // Sockets first, while `index` still matches polls_.
+            for (size_t i = subscribers_.size(); ready > 0 && i-- > 0;) {
+                Subscriber& subscriber = *subscribers_[i];
+                short revents = polls_[i + 1].revents;
+                if (!revents) continue;
+                bool alive = true;
+                if (revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                    alive = false;
+                } else if (revents & POLLIN) {
+                    // Nothing is expected from the client; reading finds out whether it left.
+                    char discard[512];
+                    alive = subscriber.connection->recv_some(discard, sizeof(discard)) >= 0;
+                }
+                if (alive && (revents & POLLOUT)) {
+                    subscriber.blocked = false;
+                    alive = flush(subscriber);
+                }
+                if (!alive) drop(subscriber);
+            }
+
+            for (std::unique_ptr<Subscriber>& subscriber : incoming) {
+                Subscriber& added = *subscriber;
+                added.index = subscribers_.size();
+                added.channel_index = added.channel->subscribers.size();
+                added.channel->subscribers.push_back(&added);
+                polls_.push_back(pollfd{added.connection->socket(), POLLIN, 0});
+                subscribers_.push_back(std::move(subscriber));
+                subscriber_count_.fetch_add(1, std::memory_order_relaxed);
+                if (!flush(added)) drop(added);
+            }
+            incoming.clear();
+
+            for (Channel* channel : dirty) {
+                channel->dirty.store(false, std::memory_order_release);
+                for (size_t i = channel->subscribers.size(); i-- > 0;) {
+                    Subscriber& subscriber = *channel->subscribers[i];
+                    if (!subscriber.blocked && !flush(subscriber)) drop(subscriber);
+                }
+            }
+            dirty.clear();
+
+            if (options_.heartbeat_ms > 0 && std::chrono::steady_clock::now() >= next_heartbeat) {
+                for (size_t i = subscribers_.size(); i-- > 0;) {
+                    Subscriber& subscriber = *subscribers_[i];
+                    if (subscriber.sending || subscriber.blocked) continue;
+                    subscriber.sending = heartbeat;
+                    if (!flush(subscriber)) drop(subscriber);
+                }
+                next_heartbeat = std::chrono::steady_clock::now() + std::chrono::milliseconds(options_.heartbeat_ms);
+            }
+        }
+
+        while (!subscribers_.empty()) drop(*subscribers_.back());
+        closed_cv_.notify_all();
+    }
+
+    // Writes until the subscriber is caught up or its socket is full. Returns
+    // false when it has to be dropped.
+    bool flush(Subscriber& subscriber) {
+        for (;;) {
+            if (!subscriber.sending && !next_event(subscriber, subscriber.sending)) {
+                return subscriber.next_id != 0;
+            }
+            const std::string& chunk = *subscriber.sending;
+            int sent = subscriber.connection->send_some(chunk.data() + subscriber.offset,
+                                                        chunk.size() - subscriber.offset);
+            if (sent < 0) return false;
+            subscriber.offset += static_cast<size_t>(sent);
+            if (subscriber.offset < chunk.size()) {
+                subscriber.blocked = true;
+                polls_[subscriber.index + 1].events = POLLIN | POLLOUT;
+                return true;
+            }
+            subscriber.sending.reset();
+            subscriber.offset = 0;
+            polls_[subscriber.index + 1].events = POLLIN;
+        }
+    }
+
+    // The subscriber's next event, if one has been published. A subscriber whose
+    // next event has already left the ring gets next_id 0, to be dropped.
+    bool next_event(Subscriber& subscriber, std::shared_ptr<const std::string>& chunk) {
+        Channel& channel = *subscriber.channel;
+        std::lock_guard<std::mutex> lock(channel.mutex);
+        if (subscriber.next_id >= channel.next_id) return false;
+        if (channel.next_id - subscriber.next_id > channel.ring.size()) {
+            subscriber.next_id = 0;
+            return false;
+        }
+        chunk = channel.ring[subscriber.next_id % channel.ring.size()];
+        subscriber.next_id++;
+        return true;
+    }
+
+    void drop(Subscriber& subscriber) {
+        std::vector<Subscriber*>& peers = subscriber.channel->subscribers;
+        peers[subscriber.channel_index] = peers.back();
+        peers[subscriber.channel_index]->channel_index = subscriber.channel_index;
+        peers.pop_back();
+
+        if (on_close) on_close(*subscriber.connection);
+        subscriber.connection->close();
+        subscriber_count_.fetch_sub(1, std::memory_order_relaxed);
+
+        // Swap with the last subscriber, which keeps polls_ in step.
+        size_t index = subscriber.index;
+        std::unique_ptr<Subscriber> removed = std::move(subscribers_[index]);
+        if (index + 1 < subscribers_.size()) {
+            subscribers_[index] = std::move(subscribers_.back());
+            subscribers_[index]->index = index;
+            polls_[index + 1] = polls_.back();
+        }
+        subscribers_.pop_back();
+        polls_.pop_back();
+        release_channel(*removed->channel);
+    }
+};
+
+} // namespace xebec
@@ -0,0 +1,175 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "../utils/etag.hpp"
+
+namespace xebec {
+
+struct FileInfo {
+    uint64_t size = 0;
+    time_t mtime = 0;
+};
+
+// A byte range with inclusive bounds, as in "bytes=first-last".
+struct ByteRange {
+    uint64_t first;
+    uint64_t last;
+    uint64_t length() const { return last - first + 1; }
+};
+
+inline std::string mime_type(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    std::string file_extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+
+    if (file_extension == "html") return "text/html";
+    if (file_extension == "css") return "text/css";
+    if (file_extension == "js") return "application/javascript";
+    if (file_extension == "json") return "application/json";
+    if (file_extension == "jpg" || file_extension == "jpeg") return "image/jpeg";
+    if (file_extension == "png") return "image/png";
+    if (file_extension == "gif") return "image/gif";
+    if (file_extension == "svg") return "image/svg+xml";
+    if (file_extension == "txt") return "text/plain";
+    if (file_extension == "mp4") return "video/mp4";
+    if (file_extension == "webm") return "video/webm";
+    if (file_extension == "mp3") return "audio/mpeg";
+    if (file_extension == "wasm") return "application/wasm";
+    return "application/octet-stream";
+}
+
+// Returns false when the path does not name a regular file.
+inline bool stat_file(const std::string& path, FileInfo& info) {
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0 || !(st.st_mode & _S_IFREG)) return false;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+#endif
+    info.size = static_cast<uint64_t>(st.st_size);
+    info.mtime = st.st_mtime;
+    return true;
+}
+
+// Validator built from size and modification time, so no file content is read.
+inline std::string file_etag(const FileInfo& info) {
+    std::string size_hex = to_hex(info.size);
+    std::string mtime_hex = to_hex(static_cast<uint64_t>(info.mtime));
+    size_hex.erase(0, std::min(size_hex.find_first_not_of('0'), size_hex.size() - 1));
+    mtime_hex.erase(0, std::min(mtime_hex.find_first_not_of('0'), mtime_hex.size() - 1));
+    return "\"" + mtime_hex + "-" + size_hex + "\"";
+}
+
+// IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT".
+inline std::string http_date(time_t t) {
+    std::tm tm{};
+#ifdef _WIN32
+    gmtime_s(&tm, &t);
+#else
+    gmtime_r(&t, &tm);
+#endif
+    static const char* days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                  days[tm.tm_wday], tm.tm_mday, months[tm.tm_mon], tm.tm_year + 1900,
+                  tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return buffer;
+}
+
+// Parses an IMF-fixdate. Returns -1 when the value is not a valid date.
+inline time_t parse_http_date(const std::string& value) {
+    static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char month[4] = {0};
+    int day, year, hour, minute, second;
+    if (std::sscanf(value.c_str(), "%*3s, %2d %3s %4d %2d:%2d:%2d GMT",
+                    &day, month, &year, &hour, &minute, &second) != 6) {
+        return -1;
+    }
+    const char* found = std::strstr(months, month);
+    if (!found || month[0] == 0 || (found - months) % 3 != 0) return -1;
+    int mon = static_cast<int>(found - months) / 3 + 1;
+
+    // Days since the epoch for a proleptic Gregorian date (Howard Hinnant's days_from_civil).
+    int y = year - (mon <= 2);
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (mon + (mon > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long days = static_cast<long long>(era) * 146097 + doe - 719468;
+    return static_cast<time_t>(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+enum class RangeResult { None, Satisfiable, Unsatisfiable };
+
+// Parses a Range header against a representation of the given size. Malformed
+// headers yield None so the full representation is served, as RFC 9110 allows.
+// Ranges come back sorted, with those that overlap or touch merged, so the
+// ranges never add up to more than the representation, however many overlap.
+inline RangeResult parse_ranges(const std::string& header, uint64_t size,
+                                std::vector<ByteRange>& ranges, size_t max_ranges = 16) {
+    ranges.clear();
+    if (header.compare(0, 6, "bytes=") != 0) return RangeResult::None;
+
+    size_t pos = 6;
+    size_t specs = 0;
+    while (pos <= header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) end = header.size();
+        std::string spec = header.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t begin = spec.find_first_not_of(" \t");
+        if (begin == std::string::npos) continue;
+        spec = spec.substr(begin, spec.find_last_not_of(" \t") - begin + 1);
+
+        size_t dash = spec.find('-');
+        if (dash == std::string::npos) return RangeResult::None;
+        std::string first_str = spec.substr(0, dash);
+        std::string last_str = spec.substr(dash + 1);
+        if (first_str.find_first_not_of("0123456789") != std::string::npos ||
+            last_str.find_first_not_of("0123456789") != std::string::npos ||
+            (first_str.empty() && last_str.empty()) ||
+            first_str.size() > 19 || last_str.size() > 19) {
+            return RangeResult::None;
+        }
+        if (++specs > max_ranges) return RangeResult::None;
+
+        if (first_str.empty()) {
+            uint64_t suffix = std::stoull(last_str);
+            if (suffix == 0 || size == 0) continue;
+            ranges.push_back({suffix >= size ? 0 : size - suffix, size - 1});
+            continue;
+        }
+
+        uint64_t first = std::stoull(first_str);
+        uint64_t last = last_str.empty() ? size - 1 : std::stoull(last_str);
+        if (!last_str.empty() && last < first) return RangeResult::None;
+        if (first >= size) continue;
+        if (last >= size) last = size - 1;
+        ranges.push_back({first, last});
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const ByteRange& a, const ByteRange& b) { return a.first < b.first; });
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].first <= ranges[merged].last + 1) {
+            ranges[merged].last = std::max(ranges[merged].last, ranges[i].last);
+        } else {
+            ranges[++merged] = ranges[i];
+        }
+    }
+    if (!ranges.empty()) ranges.resize(merged + 1);
+
+    return ranges.empty() ? RangeResult::Unsatisfiable : RangeResult::Satisfiable;
+}
+
+} // namespace xebec
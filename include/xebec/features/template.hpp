@@ -15,8 +15,8 @@ public:
         template_dir_ = dir;
     }
     
-    std::string render(const std::string& template_name, 
-                      const std::map<std::string, std::string>& vars) {
+    virtual std::string render(const std::string& template_name,
+                               const std::map<std::string, std::string>& vars) {
         std::string template_content = load_template(template_name);
         return render_template(template_content, vars);
     }
@@ -55,4 +55,29 @@ protected:
     }
 };
 
+// Serves templates compiled to C++ by tools/xebec_templates.cpp, and reads any
+// other template from the template directory as SimpleTemplateEngine does:
+//
+//     auto engine = std::make_unique<xebec::CompiledTemplateEngine>();
+//     templates::register_templates(*engine);
+//     server.set_template_engine(std::move(engine));
+class CompiledTemplateEngine : public SimpleTemplateEngine {
+public:
+    using RenderFunction = std::string (*)(const std::map<std::string, std::string>& vars);
+
+    void add(const std::string& template_name, RenderFunction render) {
+        compiled_[template_name] = render;
+    }
+
+    std::string render(const std::string& template_name,
+                       const std::map<std::string, std::string>& vars) override {
+        auto it = compiled_.find(template_name);
+        if (it != compiled_.end()) return it->second(vars);
+        return SimpleTemplateEngine::render(template_name, vars);
+    }
+
+private:
+    std::map<std::string, RenderFunction> compiled_;
+};
+
 } // namespace xebec 
\ No newline at end of file
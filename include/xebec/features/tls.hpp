@@ -0,0 +1,157 @@
+#pragma once
+
+// TLS support is compiled in with -DXEBEC_ENABLE_TLS and linking -lssl -lcrypto.
+#ifdef XEBEC_ENABLE_TLS
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <chrono>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <poll.h>
+#include <fcntl.h>
+#endif
+
+namespace xebec {
+
+class TlsContext {
+public:
+    TlsContext(const std::string& cert_path, const std::string& key_path, bool enable_ktls = true) {
+        ctx_ = SSL_CTX_new(TLS_server_method());
+        if (!ctx_) {
+            throw std::runtime_error("SSL_CTX_new failed: " + last_error());
+        }
+        SSL_CTX_set_min_proto_version(ctx_, TLS1_2_VERSION);
+
+        if (SSL_CTX_use_certificate_chain_file(ctx_, cert_path.c_str()) != 1 ||
+            SSL_CTX_use_PrivateKey_file(ctx_, key_path.c_str(), SSL_FILETYPE_PEM) != 1 ||
+            SSL_CTX_check_private_key(ctx_) != 1) {
+            std::string error = last_error();
+            SSL_CTX_free(ctx_);
+            throw std::runtime_error("Failed to load TLS certificate or key: " + error);
+        }
+
+        // Resumption: TLS 1.3 and 1.2 session tickets (keys are generated per context)
+        // plus a server-side session cache for TLS 1.2 clients that use session IDs.
+        SSL_CTX_clear_options(ctx_, SSL_OP_NO_TICKET);
+        static const unsigned char session_id_context[] = "xebec";
+        SSL_CTX_set_session_id_context(ctx_, session_id_context, sizeof(session_id_context) - 1);
+        SSL_CTX_set_session_cache_mode(ctx_, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx_, 20480);
+
+#ifdef SSL_OP_ENABLE_KTLS
+        // Record encryption moves into the kernel when the cipher and kernel allow it,
+        // which keeps sendfile() usable for static files.
+        if (enable_ktls) {
+            SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+        }
+#else
+        (void)enable_ktls;
+#endif
+    }
+
+    // Offers HTTP/2 through ALPN, preferring it over HTTP/1.1 when the client supports both.
+    void enable_http2(bool enabled) {
+        http2_ = enabled;
+        SSL_CTX_set_alpn_select_cb(ctx_, &TlsContext::select_alpn, this);
+    }
+
+    ~TlsContext() {
+        SSL_CTX_free(ctx_);
+    }
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    // Runs the server handshake on a connected, blocking socket. Returns nullptr on
+    // failure, or if the handshake takes longer than `timeout_ms` (-1: without limit).
+    SSL* accept(int socket, int timeout_ms = -1) const {
+        SSL* ssl = SSL_new(ctx_);
+        if (!ssl) return nullptr;
+        SSL_set_fd(ssl, socket);
+        bool ok = timeout_ms < 0 ? SSL_accept(ssl) > 0 : accept_within(ssl, socket, timeout_ms);
+        if (!ok) {
+            SSL_free(ssl);
+            return nullptr;
+        }
+        return ssl;
+    }
+
+    SSL_CTX* native_handle() const { return ctx_; }
+
+    static std::string last_error() {
+        unsigned long code = ERR_get_error();
+        if (code == 0) return "unknown error";
+        char buffer[256];
+        ERR_error_string_n(code, buffer, sizeof(buffer));
+        return buffer;
+    }
+
+private:
+    SSL_CTX* ctx_ = nullptr;
+    bool http2_ = false;
+
+    // The handshake on a non-blocking socket, waiting for each step until the
+    // deadline, so a client that stalls mid-handshake cannot hold the thread.
+    static bool accept_within(SSL* ssl, int socket, int timeout_ms) {
+        set_blocking(socket, false);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        bool ok = false;
+        while (true) {
+            int result = SSL_accept(ssl);
+            if (result > 0) {
+                ok = true;
+                break;
+            }
+            int error = SSL_get_error(ssl, result);
+            if (error != SSL_ERROR_WANT_READ && error != SSL_ERROR_WANT_WRITE) break;
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline -
+                                                                              std::chrono::steady_clock::now());
+            if (left.count() <= 0) break;
+            pollfd pfd{};
+            pfd.fd = socket;
+            pfd.events = error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT;
+#ifdef _WIN32
+            if (WSAPoll(&pfd, 1, static_cast<int>(left.count())) <= 0) break;
+#else
+            if (poll(&pfd, 1, static_cast<int>(left.count())) <= 0) break;
+#endif
+        }
+        set_blocking(socket, true);
+        return ok;
+    }
+
+    static void set_blocking(int socket, bool blocking) {
+#ifdef _WIN32
+        u_long mode = blocking ? 0 : 1;
+        ioctlsocket(socket, FIONBIO, &mode);
+#else
+        int flags = fcntl(socket, F_GETFL, 0);
+        fcntl(socket, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+    }
+
+    static int select_alpn(SSL*, const unsigned char** out, unsigned char* out_length,
+                           const unsigned char* in, unsigned int in_length, void* arg) {
+        static const unsigned char with_h2[] = "\x02h2\x08http/1.1";
+        static const unsigned char http1_only[] = "\x08http/1.1";
+        bool http2 = static_cast<TlsContext*>(arg)->http2_;
+        const unsigned char* offered = http2 ? with_h2 : http1_only;
+        unsigned int offered_length = http2 ? sizeof(with_h2) - 1 : sizeof(http1_only) - 1;
+        unsigned char* selected = nullptr;
+        if (SSL_select_next_proto(&selected, out_length, offered, offered_length, in, in_length) !=
+            OPENSSL_NPN_NEGOTIATED) {
+            return SSL_TLSEXT_ERR_NOACK;
+        }
+        *out = selected;
+        return SSL_TLSEXT_ERR_OK;
+    }
+};
+
+} // namespace xebec
+
+#endif // XEBEC_ENABLE_TLS
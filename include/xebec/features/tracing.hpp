@@ -0,0 +1,337 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include "../core/json.hpp"
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#endif
+
+namespace xebec {
+
+// One finished span. The name is copied, so spans may be named at run time.
+struct TraceEvent {
+    enum class Kind : uint8_t { Request, Phase, User };
+
+    uint64_t trace;           // request the span belongs to
+    uint64_t start;           // ns on the steady clock
+    uint64_t duration;        // ns
+    Kind kind;
+    char name[55];
+};
+
+// The spans of one thread: a ring written only by that thread, read by dumps
+// without stopping it. Entries the writer may have overwritten during a dump,
+// or be overwriting next, are left out of it.
+class TraceBuffer {
+public:
+    TraceBuffer(size_t capacity, uint32_t id) : events_(new TraceEvent[capacity]), capacity_(capacity), id_(id) {}
+
+    uint32_t id() const { return id_; }
+
+    void record(const TraceEvent& event) {
+        uint64_t written = written_.load(std::memory_order_relaxed);
+        events_[written % capacity_] = event;
+        written_.store(written + 1, std::memory_order_release);
+    }
+
+    void collect(std::vector<TraceEvent>& out) const {
+        uint64_t end = written_.load(std::memory_order_acquire);
+        uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+        size_t first = out.size();
+        for (uint64_t i = begin; i < end; i++) out.push_back(events_[i % capacity_]);
+        // Keeps the copies above from being read after written_ below.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // The writer may already be storing entry `after`, over entry `after - capacity_`.
+        uint64_t after = written_.load(std::memory_order_relaxed);
+        if (after + 1 > capacity_ && after + 1 - capacity_ > begin) {
+            uint64_t overwritten = std::min(after + 1 - capacity_ - begin, end - begin);
+            out.erase(out.begin() + static_cast<std::ptrdiff_t>(first),
+                      out.begin() + static_cast<std::ptrdiff_t>(first + overwritten));
+        }
+    }
+
+private:
+    std::unique_ptr<TraceEvent[]> events_;
+    size_t capacity_;
+    uint32_t id_;
+    std::atomic<uint64_t> written_{0};
+};
+
+// Sampled request tracing:
+//
+//     xebec::Tracer::global().set_sample_rate(0.01);    // or ServerConfig::trace_sample_rate
+//     ...
+//     std::string json = xebec::Tracer::global().chrome_trace();   // chrome://tracing, ui.perfetto.dev
+//
+// A sampled request records a span for itself and for each phase the server
+// goes through (read_request, parse_request, middleware, handle_route, handler,
+// send_response), plus any TraceSpan opened by its handler. Whether a request
+// is sampled is decided once, when it starts; on requests that are not, spans
+// cost a test of a thread-local. Each thread records into a buffer of its own,
+// reused by later threads once it exits, holding the latest `buffer_capacity`
+// spans of that thread.
+class Tracer {
+public:
+    // Never destroyed, so threads still running at exit can record.
+    static Tracer& global() {
+        static Tracer* tracer = new Tracer();
+        return *tracer;
+    }
+
+    // Fraction of requests traced; 0 turns tracing off.
+    void set_sample_rate(double rate) {
+        double clamped = rate < 0 ? 0 : rate > 1 ? 1 : rate;
+        threshold_.store(clamped <= 0 ? 0 : static_cast<uint64_t>(clamped * 4294967296.0),
+                         std::memory_order_relaxed);
+    }
+
+    // Spans kept per thread, for buffers created afterwards.
+    void set_buffer_capacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity > 0 ? capacity : 1;
+    }
+
+    // Leaves the spans recorded so far out of later dumps.
+    void clear() {
+        cleared_at_.store(now(), std::memory_order_relaxed);
+    }
+
+    // The recorded spans in the Chrome trace-event format.
+    std::string chrome_trace() {
+        std::string out;
+        JsonWriter json(out);
+        json.begin_object().key("traceEvents").begin_array();
+        std::vector<TraceEvent> events;
+        uint64_t cleared_at = cleared_at_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& buffer : buffers_) {
+            events.clear();
+            buffer->collect(events);
+            for (const TraceEvent& event : events) {
+                if (event.start < cleared_at) continue;
+                static const char* const categories[] = {"request", "phase", "user"};
+                json.begin_object()
+                    .field("name", std::string_view(event.name, strnlen(event.name, sizeof event.name)))
+                    .field("cat", categories[static_cast<int>(event.kind)])
+                    .field("ph", "X")
+                    .field("ts", static_cast<double>(event.start - epoch_) / 1000.0)   // us
+                    .field("dur", static_cast<double>(event.duration) / 1000.0)
+                    .field("pid", 1)
+                    .field("tid", buffer->id())
+                    .key("args").begin_object().field("request", event.trace).end_object()
+                    .end_object();
+            }
+        }
+        json.end_array().field("displayTimeUnit", "ms").end_object();
+        return out;
+    }
+
+    bool write_chrome_trace(const std::string& path) {
+        std::string trace = chrome_trace();
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << trace;
+        return static_cast<bool>(file);
+    }
+
+#ifndef _WIN32
+    // Writes the trace to `path` each time the process receives `signal`
+    // (SIGUSR2, say). The handler only wakes a thread that does the writing.
+    // Returns false if it cannot be set up, or already was.
+    bool dump_on_signal(int signal, const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (signal_fd() >= 0) return false;
+        int fds[2];
+        if (pipe(fds) != 0) return false;
+        signal_fd() = fds[1];
+        std::thread([this, fd = fds[0], path]() {
+            char byte;
+            while (read(fd, &byte, 1) == 1) write_chrome_trace(path);
+            close(fd);
+        }).detach();
+        struct sigaction action {};
+        action.sa_handler = [](int) {
+            int saved_errno = errno;
+            char byte = 1;
+            ssize_t ignored = write(signal_fd(), &byte, 1);
+            (void)ignored;
+            errno = saved_errno;
+        };
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        if (sigaction(signal, &action, nullptr) == 0) return true;
+        // The writing thread ends once the pipe is closed.
+        close(signal_fd());
+        signal_fd() = -1;
+        return false;
+    }
+#endif
+
+    // Decides whether the request starting on this thread is traced. Returns its
+    // id, or 0.
+    uint64_t sample() {
+        uint64_t threshold = threshold_.load(std::memory_order_relaxed);
+        if (threshold == 0) return 0;
+        thread_local uint64_t state = (0x9E3779B97F4A7C15ull ^
+                                       std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if ((state & 0xFFFFFFFFull) >= threshold) return 0;
+        return next_trace_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record(const TraceEvent& event) {
+        thread_local ThreadBuffer local;
+        if (!local.buffer) local.buffer = acquire();
+        local.buffer->record(event);
+    }
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // The request traced on this thread, 0 when none.
+    static uint64_t& current() {
+        thread_local uint64_t trace = 0;
+        return trace;
+    }
+
+private:
+    // Gives the thread's buffer back when the thread exits.
+    struct ThreadBuffer {
+        TraceBuffer* buffer = nullptr;
+        ~ThreadBuffer() {
+            if (buffer) Tracer::global().release(buffer);
+        }
+    };
+
+    Tracer() : epoch_(now()) {}
+
+    TraceBuffer* acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!free_.empty()) {
+            TraceBuffer* buffer = free_.back();
+            free_.pop_back();
+            return buffer;
+        }
+        buffers_.push_back(std::make_unique<TraceBuffer>(capacity_, static_cast<uint32_t>(buffers_.size() + 1)));
+        return buffers_.back().get();
+    }
+
+    void release(TraceBuffer* buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(buffer);
+    }
+
+#ifndef _WIN32
+    static int& signal_fd() {
+        static int fd = -1;
+        return fd;
+    }
+#endif
+
+    std::atomic<uint64_t> threshold_{0};        // sampled when a 32-bit random number is below
+    std::atomic<uint64_t> next_trace_{1};
+    std::atomic<uint64_t> cleared_at_{0};
+    uint64_t epoch_;
+    std::mutex mutex_;                          // guards buffers_, free_ and capacity_
+    std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+    std::vector<TraceBuffer*> free_;
+    size_t capacity_ = 8192;
+};
+
+// A span on the current thread, recorded when it ends if the thread is serving
+// a sampled request. Handlers use it for their own spans:
+//
+//     xebec::TraceSpan span("load user");
+//     auto user = db.find(id);
+class TraceSpan {
+public:
+    explicit TraceSpan(std::string_view name, TraceEvent::Kind kind = TraceEvent::Kind::User)
+        : trace_(Tracer::current()) {
+        if (!trace_) return;
+        start(name, kind);
+    }
+
+    ~TraceSpan() {
+        end();
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // Drops the span without recording it.
+    void discard() {
+        trace_ = 0;
+    }
+
+    // Ends the span before the end of its scope.
+    void end() {
+        if (!trace_) return;
+        event_.duration = Tracer::now() - event_.start;
+        Tracer::global().record(event_);
+        trace_ = 0;
+    }
+
+protected:
+    TraceSpan() : trace_(0) {}
+
+    void start(std::string_view name, TraceEvent::Kind kind) {
+        event_.trace = trace_;
+        event_.kind = kind;
+        size_t length = std::min(name.size(), sizeof(event_.name) - 1);
+        std::memcpy(event_.name, name.data(), length);
+        event_.name[length] = '\0';
+        event_.start = Tracer::now();
+    }
+
+    uint64_t trace_;
+    TraceEvent event_;
+};
+
+// Samples the request starting on this thread and, when it is traced, makes it
+// the thread's current request until the end of the scope, recording a span
+// for all of it.
+class RequestTrace : public TraceSpan {
+public:
+    RequestTrace() : previous_(Tracer::current()) {
+        trace_ = Tracer::global().sample();
+        Tracer::current() = trace_;
+        if (trace_) start("request", TraceEvent::Kind::Request);
+    }
+
+    ~RequestTrace() {
+        end();
+        Tracer::current() = previous_;
+    }
+
+    // Names the request span ("GET /users/7") once the request is parsed.
+    void describe(std::string_view method, std::string_view path) {
+        if (!trace_) return;
+        std::string name;
+        name.reserve(method.size() + 1 + path.size());
+        name.append(method).append(" ").append(path);
+        size_t length = std::min(name.size(), sizeof(event_.name) - 1);
+        std::memcpy(event_.name, name.data(), length);
+        event_.name[length] = '\0';
+    }
+
+private:
+    uint64_t previous_;
+};
+
+} // namespace xebec
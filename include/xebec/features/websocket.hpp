@@ -1,6 +1,9 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include "../utils/sha1.hpp"
+#include "../utils/base64.hpp"
 
 namespace xebec {
 
@@ -23,4 +26,15 @@ struct WebSocketFrame {
     std::vector<uint8_t> payload;
 };
 
+// Sec-WebSocket-Accept for a handshake key: base64(SHA-1(key + GUID)), written
+// into `out` without touching the heap.
+inline void websocket_accept_key(const char* key, size_t length, char out[28]) {
+    static const char magic[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+    class SHA1 sha1;
+    sha1.update(key, length);
+    sha1.update(magic, sizeof(magic) - 1);
+    Sha1Digest digest = sha1.digest();
+    base64_encode(digest.data(), digest.size(), out);
+}
+
 } // namespace xebec
\ No newline at end of file
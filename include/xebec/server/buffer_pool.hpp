@@ -0,0 +1,265 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace xebec {
+
+// Blocks for connection buffers in three size classes, 4, 16 and 64 KB, kept
+// for reuse instead of going back to the allocator. Each thread keeps a few
+// free blocks per class for itself, taken and given back without locking;
+// the rest go to a depot shared by all threads, and past the depot's limit
+// they are freed. Larger buffers come from the allocator directly.
+class BufferPool {
+public:
+    static constexpr size_t class_count = 3;
+    static constexpr size_t class_sizes[class_count] = {4 * 1024, 16 * 1024, 64 * 1024};
+    static constexpr size_t thread_cache_blocks = 8;    // per class
+
+    struct Stats {
+        size_t in_use;          // pooled blocks handed out and not given back
+        size_t cached;          // free blocks in the depot; thread caches are not counted
+        size_t allocated;       // pooled blocks taken from the allocator so far
+    };
+
+    // Never destroyed, so threads still running at exit can give blocks back.
+    static BufferPool& global() {
+        static BufferPool* pool = new BufferPool();
+        return *pool;
+    }
+
+    // Index of the smallest class holding `size` bytes, class_count when none does.
+    static size_t size_class(size_t size) {
+        size_t index = 0;
+        while (index < class_count && class_sizes[index] < size) index++;
+        return index;
+    }
+
+    // A block of at least `size` bytes; how large it is goes in `capacity`.
+    char* acquire(size_t size, size_t& capacity) {
+        size_t index = size_class(size);
+        if (index == class_count) {
+            capacity = size;
+            return new char[size];
+        }
+        capacity = class_sizes[index];
+        in_use_.fetch_add(1, std::memory_order_relaxed);
+        ThreadCache& cache = thread_cache();
+        if (cache.counts[index] > 0) return cache.blocks[index][--cache.counts[index]];
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!depot_[index].empty()) {
+                char* block = depot_[index].back();
+                depot_[index].pop_back();
+                cached_bytes_ -= capacity;
+                return block;
+            }
+        }
+        allocated_.fetch_add(1, std::memory_order_relaxed);
+        return new char[capacity];
+    }
+
+    void release(char* block, size_t capacity) {
+        size_t index = size_class(capacity);
+        if (index == class_count || class_sizes[index] != capacity) {
+            delete[] block;
+            return;
+        }
+        in_use_.fetch_sub(1, std::memory_order_relaxed);
+        ThreadCache& cache = thread_cache();
+        if (cache.counts[index] < thread_cache_blocks) {
+            cache.blocks[index][cache.counts[index]++] = block;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        deposit(index, block);
+    }
+
+    // Moves the calling thread's free blocks to the depot. For a thread about
+    // to block for a while, whose blocks other threads could use meanwhile.
+    void flush_thread_cache() {
+        flush(thread_cache());
+    }
+
+    // Bytes of free blocks the depot keeps; 32 MB unless set.
+    void set_max_cached_bytes(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_cached_bytes_ = bytes;
+        for (size_t index = class_count; index-- > 0 && cached_bytes_ > max_cached_bytes_;) {
+            while (!depot_[index].empty() && cached_bytes_ > max_cached_bytes_) {
+                delete[] depot_[index].back();
+                depot_[index].pop_back();
+                cached_bytes_ -= class_sizes[index];
+            }
+        }
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t cached = 0;
+        for (const auto& blocks : depot_) cached += blocks.size();
+        return {in_use_.load(std::memory_order_relaxed), cached, allocated_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    struct ThreadCache {
+        char* blocks[class_count][thread_cache_blocks];
+        size_t counts[class_count] = {};
+        // A thread's blocks outlive it in the depot.
+        ~ThreadCache() {
+            BufferPool::global().flush(*this);
+        }
+    };
+
+    BufferPool() = default;
+
+    static ThreadCache& thread_cache() {
+        thread_local ThreadCache cache;
+        return cache;
+    }
+
+    void flush(ThreadCache& cache) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t index = 0; index < class_count; index++) {
+            while (cache.counts[index] > 0) deposit(index, cache.blocks[index][--cache.counts[index]]);
+        }
+    }
+
+    // Requires mutex_.
+    void deposit(size_t index, char* block) {
+        if (cached_bytes_ + class_sizes[index] > max_cached_bytes_) {
+            delete[] block;
+            return;
+        }
+        depot_[index].push_back(block);
+        cached_bytes_ += class_sizes[index];
+    }
+
+    std::atomic<size_t> in_use_{0};
+    std::atomic<size_t> allocated_{0};
+    std::mutex mutex_;                          // guards depot_ and the byte counts
+    std::vector<char*> depot_[class_count];
+    size_t cached_bytes_ = 0;
+    size_t max_cached_bytes_ = 32 * 1024 * 1024;
+};
+
+// A growable byte buffer on pooled blocks, for what is read from or written
+// to a connection. Bytes are consumed from the front without moving the rest;
+// release() gives the block back, which a connection does when it goes idle.
+class IoBuffer {
+public:
+    IoBuffer() = default;
+
+    IoBuffer(IoBuffer&& other) noexcept
+        : block_(other.block_), capacity_(other.capacity_), begin_(other.begin_), end_(other.end_) {
+        other.block_ = nullptr;
+        other.capacity_ = other.begin_ = other.end_ = 0;
+    }
+
+    IoBuffer& operator=(IoBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            std::swap(block_, other.block_);
+            std::swap(capacity_, other.capacity_);
+            std::swap(begin_, other.begin_);
+            std::swap(end_, other.end_);
+        }
+        return *this;
+    }
+
+    IoBuffer(const IoBuffer&) = delete;
+    IoBuffer& operator=(const IoBuffer&) = delete;
+
+    ~IoBuffer() {
+        release();
+    }
+
+    const char* data() const { return block_ + begin_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    size_t capacity() const { return capacity_; }
+    char operator[](size_t index) const { return block_[begin_ + index]; }
+
+    std::string_view view() const { return std::string_view(data(), size()); }
+    operator std::string_view() const { return view(); }
+
+    size_t find(std::string_view bytes, size_t from = 0) const {
+        return view().find(bytes, from);
+    }
+
+    // Space for at least `length` more bytes at the end, to be filled and then
+    // added with commit(). room() tells how much there is.
+    char* prepare(size_t length) {
+        if (capacity_ - end_ < length) make_room(length);
+        return block_ + end_;
+    }
+
+    size_t room() const { return capacity_ - end_; }
+
+    void commit(size_t length) {
+        end_ += length;
+    }
+
+    void append(const char* bytes, size_t length) {
+        if (length == 0) return;
+        std::memcpy(prepare(length), bytes, length);
+        end_ += length;
+    }
+
+    IoBuffer& operator+=(std::string_view bytes) {
+        append(bytes.data(), bytes.size());
+        return *this;
+    }
+
+    IoBuffer& operator+=(char byte) {
+        *prepare(1) = byte;
+        end_++;
+        return *this;
+    }
+
+    // Drops `length` bytes from the front.
+    void consume(size_t length) {
+        begin_ += length;
+        if (begin_ == end_) begin_ = end_ = 0;
+    }
+
+    void clear() {
+        begin_ = end_ = 0;
+    }
+
+    // Drops the bytes and gives the block back to the pool.
+    void release() {
+        if (block_) BufferPool::global().release(block_, capacity_);
+        block_ = nullptr;
+        capacity_ = begin_ = end_ = 0;
+    }
+
+private:
+    void make_room(size_t length) {
+        size_t used = size();
+        if (capacity_ - used >= length) {
+            std::memmove(block_, block_ + begin_, used);
+        } else {
+            size_t capacity;
+            char* block = BufferPool::global().acquire(std::max(used + length, capacity_ * 2), capacity);
+            if (used > 0) std::memcpy(block, block_ + begin_, used);
+            if (block_) BufferPool::global().release(block_, capacity_);
+            block_ = block;
+            capacity_ = capacity;
+        }
+        begin_ = 0;
+        end_ = used;
+    }
+
+    char* block_ = nullptr;
+    size_t capacity_ = 0;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+};
+
+} // namespace xebec
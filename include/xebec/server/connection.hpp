@@ -0,0 +1,427 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <fstream>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <WS2spi.h>
+#define SOCKET_CLOSE(sock) closesocket(sock)
+#define SOCKET_SHUTDOWN(sock) shutdown(sock, SD_BOTH)
+#define SOCKET_POLL WSAPoll
+#else
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define SOCKADDR sockaddr
+#define WSAGetLastError() errno
+#define SOCKET_CLOSE(sock) ::close(sock)
+#define SOCKET_SHUTDOWN(sock) shutdown(sock, SHUT_RDWR)
+#define SOCKET_POLL poll
+extern char** environ;
+#endif
+
+#include "../features/tls.hpp"
+
+namespace xebec {
+
+inline void set_socket_blocking(SOCKET socket, bool blocking) {
+#ifdef _WIN32
+    u_long mode = blocking ? 0 : 1;
+    ioctlsocket(socket, FIONBIO, &mode);
+#else
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif
+}
+
+// Small responses and the head of a larger one are written whole, so Nagle's
+// algorithm would only hold them back until the client's delayed ACK.
+inline void set_socket_nodelay(SOCKET socket) {
+    int enabled = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enabled), sizeof(enabled));
+}
+
+// Carries a connection's bytes somewhere other than a socket, such as to an
+// in-process peer (LoopbackTransport).
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    // Blocks until there are bytes to return; 0 once the peer has finished sending.
+    virtual int recv(char* buffer, size_t length) = 0;
+
+    // Returns the number of bytes taken, -1 once the peer is gone.
+    virtual int send(const char* data, size_t length) = 0;
+
+    // Waits up to `timeout_ms` (-1: without limit) until recv() would return
+    // at once. False on timeout.
+    virtual bool wait_readable(int timeout_ms) = 0;
+
+    // Called again when the connection is destroyed.
+    virtual void close() = 0;
+};
+
+// A client connection. Once a TLS session is attached, reads and writes go
+// through it; otherwise they hit the socket directly, or the transport for a
+// connection made with one.
+class Connection {
+public:
+    explicit Connection(SOCKET socket, std::string remote_addr = std::string())
+        : socket_(socket), remote_addr_(std::move(remote_addr)) {}
+
+    // A connection without a socket, whose bytes go through `transport`.
+    explicit Connection(std::unique_ptr<Transport> transport, std::string remote_addr = std::string())
+        : socket_(INVALID_SOCKET), remote_addr_(std::move(remote_addr)), transport_(std::move(transport)) {}
+
+    ~Connection() {
+        close();
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    SOCKET socket() const { return socket_; }
+
+    // The transport of a connection made with one, otherwise null.
+    Transport* transport() const { return transport_.get(); }
+
+    // The peer's IP address as recorded at accept time.
+    const std::string& remote_addr() const { return remote_addr_; }
+
+    int recv(char* buffer, size_t length) {
+        int chunk = static_cast<int>(length < (1u << 30) ? length : (1u << 30));
+        if (transport_) return transport_->recv(buffer, static_cast<size_t>(chunk));
+#ifdef XEBEC_ENABLE_TLS
+        if (ssl_) return SSL_read(ssl_, buffer, chunk);
+#endif
+        return ::recv(socket_, buffer, chunk, 0);
+    }
+
+    // Reads exactly `length` bytes. Returns false if the peer closes first.
+    bool recv_all(char* buffer, size_t length) {
+        while (length > 0) {
+            int received = recv(buffer, length);
+            if (received <= 0) return false;
+            buffer += received;
+            length -= received;
+        }
+        return true;
+    }
+
+    bool send_all(const char* data, size_t length) {
+        while (length > 0) {
+            int chunk = static_cast<int>(length < (1u << 30) ? length : (1u << 30));
+#ifdef XEBEC_ENABLE_TLS
+            int sent = transport_ ? transport_->send(data, static_cast<size_t>(chunk))
+                       : ssl_ ? SSL_write(ssl_, data, chunk) : ::send(socket_, data, chunk, 0);
+#else
+            int sent = transport_ ? transport_->send(data, static_cast<size_t>(chunk))
+                                  : ::send(socket_, data, chunk, 0);
+#endif
+            if (sent <= 0) return false;
+            data += sent;
+            length -= sent;
+        }
+        return true;
+    }
+
+    // For a connection switched to non-blocking mode: sends what fits in the socket
+    // buffer. Returns the number of bytes sent, 0 when none fit, -1 once the peer is gone.
+    int send_some(const char* data, size_t length) {
+        int chunk = static_cast<int>(length < (1u << 30) ? length : (1u << 30));
+        if (transport_) return transport_->send(data, static_cast<size_t>(chunk));
+#ifdef XEBEC_ENABLE_TLS
+        if (ssl_) {
+            int sent = SSL_write(ssl_, data, chunk);
+            if (sent > 0) return sent;
+            int error = SSL_get_error(ssl_, sent);
+            return error == SSL_ERROR_WANT_WRITE || error == SSL_ERROR_WANT_READ ? 0 : -1;
+        }
+#endif
+        int sent = ::send(socket_, data, chunk, 0);
+        if (sent >= 0) return sent;
+        return would_block() ? 0 : -1;
+    }
+
+    // The reading counterpart of send_some(): 0 when nothing is available, -1 once
+    // the peer has closed.
+    int recv_some(char* buffer, size_t length) {
+        int chunk = static_cast<int>(length < (1u << 30) ? length : (1u << 30));
+        if (transport_) {
+            if (!transport_->wait_readable(0)) return 0;
+            int received = transport_->recv(buffer, static_cast<size_t>(chunk));
+            return received > 0 ? received : -1;
+        }
+#ifdef XEBEC_ENABLE_TLS
+        if (ssl_) {
+            int received = SSL_read(ssl_, buffer, chunk);
+            if (received > 0) return received;
+            int error = SSL_get_error(ssl_, received);
+            return error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE ? 0 : -1;
+        }
+#endif
+        int received = ::recv(socket_, buffer, chunk, 0);
+        if (received > 0) return received;
+        return received < 0 && would_block() ? 0 : -1;
+    }
+
+    // Non-blocking TLS writes may then return after part of the data, and are
+    // retried from wherever the rest is.
+    void set_blocking(bool blocking) {
+        if (transport_) return;
+        set_socket_blocking(socket_, blocking);
+#ifdef XEBEC_ENABLE_TLS
+        if (ssl_ && !blocking) SSL_set_mode(ssl_, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#endif
+    }
+
+    // Sends `head` followed by `body` with one writev() where possible, so a small
+    // response leaves in one segment without the body being copied.
+    bool send_all(const char* head, size_t head_length, const char* body, size_t body_length) {
+#ifndef _WIN32
+        if (!secure() && !transport_) {
+            iovec parts[2] = {{const_cast<char*>(head), head_length}, {const_cast<char*>(body), body_length}};
+            iovec* part = parts;
+            int count = 2;
+            while (count > 0) {
+                ssize_t sent = ::writev(socket_, part, count);
+                if (sent <= 0) return false;
+                while (count > 0 && static_cast<size_t>(sent) >= part->iov_len) {
+                    sent -= static_cast<ssize_t>(part->iov_len);
+                    part++;
+                    count--;
+                }
+                if (count > 0) {
+                    part->iov_base = static_cast<char*>(part->iov_base) + sent;
+                    part->iov_len -= static_cast<size_t>(sent);
+                }
+            }
+            return true;
+        }
+#endif
+        return send_all(head, head_length) && send_all(body, body_length);
+    }
+
+    // Sends `head`, then a byte range of a file. Uses sendfile() on Linux,
+    // including over TLS when the kernel took over record encryption (kTLS); the
+    // head is then corked with MSG_MORE so it leaves with the start of the file.
+    // Elsewhere the head goes out in one writev() with the first block read.
+    bool send_file(const std::string& path, uint64_t offset, uint64_t length, const char* head = nullptr,
+                   size_t head_length = 0) {
+#ifdef __linux__
+#ifdef XEBEC_ENABLE_TLS
+        bool zero_copy = !transport_ && (!ssl_ || ktls_send());
+#else
+        bool zero_copy = !transport_;
+#endif
+        if (zero_copy) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+            if (!send_head_more(head, head_length, length > 0)) {
+                ::close(fd);
+                return false;
+            }
+            off_t file_offset = static_cast<off_t>(offset);
+            while (length > 0) {
+                size_t chunk = length < (1u << 30) ? length : (1u << 30);
+#ifdef XEBEC_ENABLE_TLS
+                ssize_t sent = ssl_ ? SSL_sendfile(ssl_, fd, file_offset, chunk, 0)
+                                    : sendfile(socket_, fd, &file_offset, chunk);
+                if (ssl_ && sent > 0) file_offset += sent;
+#else
+                ssize_t sent = sendfile(socket_, fd, &file_offset, chunk);
+#endif
+                if (sent <= 0) break;
+                length -= sent;
+            }
+            ::close(fd);
+            return length == 0;
+        }
+#endif
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) return false;
+        file.seekg(static_cast<std::streamoff>(offset));
+        char buffer[64 * 1024];
+        if (length == 0 && head_length > 0) return send_all(head, head_length);
+        while (length > 0 && file) {
+            file.read(buffer, length < sizeof(buffer) ? length : sizeof(buffer));
+            std::streamsize got = file.gcount();
+            if (got <= 0) return false;
+            bool sent = head_length > 0 ? send_all(head, head_length, buffer, static_cast<size_t>(got))
+                                        : send_all(buffer, static_cast<size_t>(got));
+            if (!sent) return false;
+            head_length = 0;
+            length -= got;
+        }
+        return length == 0;
+    }
+
+    // Decrypted bytes already buffered by TLS, which a poll() on the socket would miss.
+    bool has_buffered_data() const {
+#ifdef XEBEC_ENABLE_TLS
+        return ssl_ && SSL_pending(ssl_) > 0;
+#else
+        return false;
+#endif
+    }
+
+    bool secure() const {
+#ifdef XEBEC_ENABLE_TLS
+        return ssl_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    // Protocol chosen through ALPN during the TLS handshake, e.g. "h2".
+    std::string alpn_protocol() const {
+#ifdef XEBEC_ENABLE_TLS
+        if (ssl_) {
+            const unsigned char* protocol = nullptr;
+            unsigned int length = 0;
+            SSL_get0_alpn_selected(ssl_, &protocol, &length);
+            if (protocol) return std::string(reinterpret_cast<const char*>(protocol), length);
+        }
+#endif
+        return "";
+    }
+
+#ifdef XEBEC_ENABLE_TLS
+    void attach_tls(SSL* ssl) {
+        ssl_ = ssl;
+    }
+
+    SSL* tls() const { return ssl_; }
+
+    bool ktls_send() const {
+        return ssl_ && BIO_get_ktls_send(SSL_get_wbio(ssl_));
+    }
+#endif
+
+    void close() {
+#ifdef XEBEC_ENABLE_TLS
+        if (ssl_) {
+            SSL_shutdown(ssl_);
+            SSL_free(ssl_);
+            ssl_ = nullptr;
+        }
+#endif
+        if (socket_ != INVALID_SOCKET) {
+            SOCKET_CLOSE(socket_);
+            socket_ = INVALID_SOCKET;
+        }
+        if (transport_) transport_->close();
+    }
+
+private:
+#ifdef __linux__
+    // Sends a response head that is followed by a sendfile(). With MSG_MORE the
+    // kernel holds it until the file data arrives instead of pushing it alone.
+    bool send_head_more(const char* head, size_t length, bool more) {
+#ifdef XEBEC_ENABLE_TLS
+        if (ssl_) return send_all(head, length);
+#endif
+        while (length > 0) {
+            ssize_t sent = ::send(socket_, head, length, more ? MSG_MORE : 0);
+            if (sent <= 0) return false;
+            head += sent;
+            length -= static_cast<size_t>(sent);
+        }
+        return true;
+    }
+#endif
+
+    static bool would_block() {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+    }
+
+    SOCKET socket_;
+    std::string remote_addr_;
+    std::unique_ptr<Transport> transport_;
+#ifdef XEBEC_ENABLE_TLS
+    SSL* ssl_ = nullptr;
+#endif
+};
+
+// The IP address in `address` as text, with IPv4-mapped IPv6 addresses shown
+// as plain IPv4. Empty for other address families.
+inline std::string format_address(const sockaddr* address) {
+    char text[INET6_ADDRSTRLEN] = "";
+    if (address->sa_family == AF_INET) {
+        const auto* ipv4 = reinterpret_cast<const sockaddr_in*>(address);
+        inet_ntop(AF_INET, const_cast<in_addr*>(&ipv4->sin_addr), text, sizeof(text));
+    } else if (address->sa_family == AF_INET6) {
+        const auto* ipv6 = reinterpret_cast<const sockaddr_in6*>(address);
+        inet_ntop(AF_INET6, const_cast<in6_addr*>(&ipv6->sin6_addr), text, sizeof(text));
+        if (std::strncmp(text, "::ffff:", 7) == 0 && std::strchr(text + 7, '.')) return text + 7;
+    }
+    return text;
+}
+
+// The peer address of a connected socket, for sockets accepted without one.
+inline std::string peer_address(SOCKET socket) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getpeername(socket, reinterpret_cast<SOCKADDR*>(&address), &length) != 0) return std::string();
+    return format_address(reinterpret_cast<const sockaddr*>(&address));
+}
+
+// A connected pair of sockets, used to wake up a thread blocked in poll().
+inline bool create_socket_pair(SOCKET pair[2]) {
+#ifdef _WIN32
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET) return false;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int addr_length = sizeof(addr);
+    pair[0] = pair[1] = INVALID_SOCKET;
+    if (bind(listener, reinterpret_cast<SOCKADDR*>(&addr), sizeof(addr)) == 0 &&
+        getsockname(listener, reinterpret_cast<SOCKADDR*>(&addr), &addr_length) == 0 &&
+        listen(listener, 1) == 0) {
+        pair[1] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (pair[1] != INVALID_SOCKET &&
+            connect(pair[1], reinterpret_cast<SOCKADDR*>(&addr), sizeof(addr)) == 0) {
+            pair[0] = accept(listener, NULL, NULL);
+        }
+    }
+    SOCKET_CLOSE(listener);
+    if (pair[0] == INVALID_SOCKET) {
+        if (pair[1] != INVALID_SOCKET) SOCKET_CLOSE(pair[1]);
+        pair[1] = INVALID_SOCKET;
+        return false;
+    }
+    return true;
+#else
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) return false;
+    pair[0] = fds[0];
+    pair[1] = fds[1];
+    return true;
+#endif
+}
+
+} // namespace xebec
@@ -0,0 +1,274 @@
+#pragma once
+#include "../core/task.hpp"
+
+#ifdef XEBEC_HAS_COROUTINES
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+#include "connection.hpp"
+
+namespace xebec {
+
+// Runs coroutine handlers. One thread polls sockets and timers and resumes the
+// coroutines waiting on them; file reads, which poll() cannot wait for, go to a
+// helper thread and resume on the loop when done. A suspended handler costs its
+// coroutine frame, not a thread.
+class EventLoop {
+public:
+    EventLoop() {
+        if (!create_socket_pair(wake_)) {
+            throw std::runtime_error("EventLoop: cannot create wake-up sockets");
+        }
+        thread_ = std::thread(&EventLoop::run, this);
+        file_thread_ = std::thread(&EventLoop::run_file_reads, this);
+    }
+
+    ~EventLoop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        file_cv_.notify_all();
+        wake();
+        thread_.join();
+        file_thread_.join();
+        SOCKET_CLOSE(wake_[0]);
+        SOCKET_CLOSE(wake_[1]);
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // The loop running on the calling thread, or nullptr outside of one.
+    static EventLoop* current() {
+        return current_slot();
+    }
+
+    static EventLoop& require_current() {
+        EventLoop* loop = current();
+        if (!loop) throw std::logic_error("xebec awaitables must be used inside a coroutine handler");
+        return *loop;
+    }
+
+    // Runs `callback` on the loop thread. Safe to call from any thread.
+    void post(std::function<void()> callback) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            posted_.push_back(std::move(callback));
+        }
+        wake();
+    }
+
+    // Starts `work` on the loop; `done` runs on the loop thread when it finishes.
+    void spawn(task<void> work, std::function<void(std::exception_ptr)> done) {
+        auto shared = std::make_shared<task<void>>(std::move(work));
+        post([shared, done = std::move(done)]() mutable {
+            detail::run_detached(std::move(*shared), std::move(done));
+        });
+    }
+
+    struct SleepAwaiter {
+        EventLoop& loop;
+        std::chrono::steady_clock::time_point deadline;
+
+        bool await_ready() const noexcept { return std::chrono::steady_clock::now() >= deadline; }
+        void await_suspend(std::coroutine_handle<> handle) { loop.timers_.emplace(deadline, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    struct SocketAwaiter {
+        EventLoop& loop;
+        SOCKET socket;
+        short events;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { loop.waiters_.push_back({socket, events, handle}); }
+        void await_resume() const noexcept {}
+    };
+
+    struct FileReadAwaiter {
+        EventLoop& loop;
+        std::string path;
+        std::string data;
+        bool ok = false;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            {
+                std::lock_guard<std::mutex> lock(loop.mutex_);
+                loop.file_reads_.push_back({this, handle});
+            }
+            loop.file_cv_.notify_one();
+        }
+        std::string await_resume() {
+            if (!ok) throw std::runtime_error("Cannot read file: " + path);
+            return std::move(data);
+        }
+    };
+
+    SleepAwaiter sleep_until(std::chrono::steady_clock::time_point deadline) { return {*this, deadline}; }
+    SocketAwaiter readable(SOCKET socket) { return {*this, socket, POLLIN}; }
+    SocketAwaiter writable(SOCKET socket) { return {*this, socket, POLLOUT}; }
+    FileReadAwaiter read_file(const std::string& path) { return {*this, path, std::string(), false}; }
+
+private:
+    struct Waiter {
+        SOCKET socket;
+        short events;
+        std::coroutine_handle<> handle;
+    };
+
+    struct FileRead {
+        FileReadAwaiter* awaiter;
+        std::coroutine_handle<> handle;
+    };
+
+    std::thread thread_;
+    std::thread file_thread_;
+    SOCKET wake_[2] = {INVALID_SOCKET, INVALID_SOCKET};
+    std::mutex mutex_;
+    std::condition_variable file_cv_;
+    bool stopping_ = false;
+    std::vector<std::function<void()>> posted_;
+    std::deque<FileRead> file_reads_;
+
+    // Loop thread only.
+    std::multimap<std::chrono::steady_clock::time_point, std::coroutine_handle<>> timers_;
+    std::vector<Waiter> waiters_;
+
+    static EventLoop*& current_slot() {
+        static thread_local EventLoop* loop = nullptr;
+        return loop;
+    }
+
+    void wake() {
+        ::send(wake_[1], "w", 1, 0);
+    }
+
+    void run() {
+        current_slot() = this;
+        std::vector<pollfd> fds;
+        std::vector<std::coroutine_handle<>> ready;
+        while (true) {
+            std::vector<std::function<void()>> posted;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) break;
+                posted.swap(posted_);
+            }
+            for (auto& callback : posted) callback();
+
+            int timeout = 1000;
+            if (!timers_.empty()) {
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    timers_.begin()->first - std::chrono::steady_clock::now()).count() + 1;
+                timeout = wait < 0 ? 0 : (wait < timeout ? static_cast<int>(wait) : timeout);
+            }
+
+            fds.assign(1, pollfd{});
+            fds[0].fd = wake_[0];
+            fds[0].events = POLLIN;
+            for (const auto& waiter : waiters_) {
+                pollfd entry{};
+                entry.fd = waiter.socket;
+                entry.events = waiter.events;
+                fds.push_back(entry);
+            }
+            if (SOCKET_POLL(fds.data(), static_cast<unsigned long>(fds.size()), timeout) < 0) continue;
+            if (fds[0].revents & POLLIN) {
+                char drain[256];
+                ::recv(wake_[0], drain, sizeof(drain), 0);
+            }
+
+            // Resumed coroutines may register new waits, so ready handles are collected first.
+            ready.clear();
+            size_t kept = 0;
+            for (size_t i = 0; i < waiters_.size(); i++) {
+                if (fds[i + 1].revents) {
+                    ready.push_back(waiters_[i].handle);
+                } else {
+                    waiters_[kept++] = waiters_[i];
+                }
+            }
+            waiters_.resize(kept);
+            auto now = std::chrono::steady_clock::now();
+            while (!timers_.empty() && timers_.begin()->first <= now) {
+                ready.push_back(timers_.begin()->second);
+                timers_.erase(timers_.begin());
+            }
+            for (auto handle : ready) handle.resume();
+        }
+        current_slot() = nullptr;
+    }
+
+    void run_file_reads() {
+        while (true) {
+            FileRead read;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                file_cv_.wait(lock, [this] { return stopping_ || !file_reads_.empty(); });
+                if (stopping_) return;
+                read = file_reads_.front();
+                file_reads_.pop_front();
+            }
+            std::ifstream file(read.awaiter->path, std::ios::in | std::ios::binary);
+            if (file) {
+                read.awaiter->data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                read.awaiter->ok = !file.bad();
+            }
+            std::coroutine_handle<> handle = read.handle;
+            post([handle]() { handle.resume(); });
+        }
+    }
+};
+
+// Awaitables for coroutine handlers. They suspend onto the loop that runs the handler.
+
+inline EventLoop::SleepAwaiter sleep_for(std::chrono::milliseconds duration) {
+    return EventLoop::require_current().sleep_until(std::chrono::steady_clock::now() + duration);
+}
+
+inline EventLoop::FileReadAwaiter async_read_file(const std::string& path) {
+    return EventLoop::require_current().read_file(path);
+}
+
+// Reads what is available once the socket is readable. Returns recv()'s result.
+inline task<int> async_read(SOCKET socket, char* buffer, size_t length) {
+    co_await EventLoop::require_current().readable(socket);
+    co_return static_cast<int>(::recv(socket, buffer, static_cast<int>(length), 0));
+}
+
+// Writes all of `data`, waiting for the socket to drain as needed.
+inline task<bool> async_write(SOCKET socket, const char* data, size_t length) {
+#ifdef MSG_DONTWAIT
+    const int flags = MSG_DONTWAIT;
+#else
+    const int flags = 0;
+#endif
+    while (length > 0) {
+        co_await EventLoop::require_current().writable(socket);
+        int chunk = static_cast<int>(length < (1u << 30) ? length : (1u << 30));
+        int sent = static_cast<int>(::send(socket, data, chunk, flags));
+        if (sent < 0 && (WSAGetLastError() == EAGAIN || WSAGetLastError() == EWOULDBLOCK)) continue;
+        if (sent <= 0) co_return false;
+        data += sent;
+        length -= sent;
+    }
+    co_return true;
+}
+
+} // namespace xebec
+
+#endif // XEBEC_HAS_COROUTINES
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <functional>
 #include <thread>
 #include <regex>
@@ -9,32 +10,41 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <deque>
 #include <memory>
 #include <stdexcept>
 #include <future>
+#include <algorithm>
+#include <cctype>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
 
-#ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <WS2spi.h>
-#define SOCKET_CLOSE(sock) closesocket(sock)
-#else
-#include <unistd.h>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#define SOCKET int
-#define INVALID_SOCKET -1
-#define SOCKET_CLOSE(sock) close(sock)
-#endif
-
+#include "connection.hpp"
+#include "buffer_pool.hpp"
+#include "loopback.hpp"
+#include "event_loop.hpp"
+#include "io_uring.hpp"
 #include "../core/config.hpp"
 #include "../core/error.hpp"
 #include "../core/request.hpp"
 #include "../core/response.hpp"
 #include "../core/middleware.hpp"
+#include "../core/task.hpp"
 #include "../features/plugin.hpp"
 #include "../features/websocket.hpp"
 #include "../features/template.hpp"
+#include "../features/static_files.hpp"
+#include "../features/embedded_files.hpp"
+#include "../features/http2.hpp"
+#include "../features/multipart.hpp"
+#include "../features/sse.hpp"
+#include "../features/tracing.hpp"
 #include "../utils/base64.hpp"
 #include "../utils/sha1.hpp"
 #include "../utils/string_utils.hpp"
@@ -43,6 +53,12 @@ namespace xebec {
 
 class http_server {
 public:
+#ifdef XEBEC_HAS_COROUTINES
+    using AsyncHandler = std::function<task<void>(Request&, Response&)>;
+#else
+    struct AsyncHandler {};  // coroutine handlers need C++20
+#endif
+
     explicit http_server(const ServerConfig& config = ServerConfig())
         : config_(config), template_engine_(std::make_unique<SimpleTemplateEngine>()) {
 #ifdef _WIN32
@@ -51,10 +67,20 @@ public:
         if (iResult != 0) {
             std::cerr << "WSAStartup failed: " << iResult << std::endl;
         }
+#else
+        signal(SIGPIPE, SIG_IGN);
 #endif
+        if (config_.trace_sample_rate > 0) Tracer::global().set_sample_rate(config_.trace_sample_rate);
     }
 
     ~http_server() noexcept {
+        stop(std::chrono::milliseconds(0));
+        // stop() gives up on connections after a second; their threads still use this server.
+        {
+            std::unique_lock<std::mutex> lock(connections_mutex_);
+            connections_cv_.wait(lock, [this] { return connection_threads_ == 0; });
+        }
+        stop_workers();
 #ifdef _WIN32
         WSACleanup();
 #endif
@@ -65,43 +91,226 @@ public:
         publicDirPath = sanitized_path;
     }
 
+    // Serves static files, and Response::html(), from a directory packed into the
+    // binary by tools/xebec_embed.cpp instead of the filesystem.
+    void publicDir(const EmbeddedDirectory& files) {
+        embedded_public_ = &files;
+    }
+
     void start() {
-        SOCKET listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (listen_socket == INVALID_SOCKET) {
-            std::cerr << "Error at socket(): " << WSAGetLastError() << std::endl;
+        if (!config_.ssl_cert_path.empty()) {
+#ifdef XEBEC_ENABLE_TLS
+            try {
+                tls_ = std::make_unique<TlsContext>(config_.ssl_cert_path, config_.ssl_key_path, config_.enable_ktls);
+                tls_->enable_http2(config_.enable_http2);
+            } catch (const std::exception& e) {
+                std::cerr << "TLS setup failed: " << e.what() << std::endl;
+                return;
+            }
+#else
+            std::cerr << "ssl_cert_path is set but Xebec was built without XEBEC_ENABLE_TLS" << std::endl;
             return;
+#endif
         }
 
-        sockaddr_in service;
-        service.sin_family = AF_INET;
-        service.sin_addr.s_addr = INADDR_ANY;
-        service.sin_port = htons(config_.port);
+        SOCKET listen_socket = inherited_listen_socket();
+        if (listen_socket == INVALID_SOCKET) {
+            listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (listen_socket == INVALID_SOCKET) {
+                std::cerr << "Error at socket(): " << WSAGetLastError() << std::endl;
+                return;
+            }
+
+            int reuse = 1;
+            setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
 
-        if (bind(listen_socket, reinterpret_cast<SOCKADDR*>(&service), sizeof(service)) == SOCKET_ERROR) {
-            std::cerr << "bind() failed." << std::endl;
-            SOCKET_CLOSE(listen_socket);
-            return;
+            sockaddr_in service;
+            service.sin_family = AF_INET;
+            service.sin_addr.s_addr = INADDR_ANY;
+            service.sin_port = htons(config_.port);
+
+            if (bind(listen_socket, reinterpret_cast<SOCKADDR*>(&service), sizeof(service)) == SOCKET_ERROR) {
+                std::cerr << "bind() failed." << std::endl;
+                SOCKET_CLOSE(listen_socket);
+                return;
+            }
+
+            if (listen(listen_socket, SOMAXCONN) == SOCKET_ERROR) {
+                std::cerr << "Error listening on socket." << std::endl;
+                SOCKET_CLOSE(listen_socket);
+                return;
+            }
         }
 
-        if (listen(listen_socket, SOMAXCONN) == SOCKET_ERROR) {
-            std::cerr << "Error listening on socket." << std::endl;
-            SOCKET_CLOSE(listen_socket);
-            return;
+        // Non-blocking so that a peer process sharing the socket during a hot
+        // upgrade can win the race for a connection without stalling this loop.
+        set_blocking(listen_socket, false);
+        set_cloexec(listen_socket);
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            listen_socket_ = listen_socket;
+            listening_ = true;
         }
 
+#ifdef XEBEC_HAS_IO_URING
+        std::unique_ptr<IoUring> ring = create_ring();
+#else
+        if (config_.io_backend == IoBackend::IoUring) {
+            std::cerr << "io_uring is not available in this build, using threads" << std::endl;
+        }
+#endif
+
         std::cout << "Server is listening on port " << config_.port << std::endl;
+        notify_ready();
 
-        while (true) {
-            SOCKET client_socket = accept(listen_socket, NULL, NULL);
+#ifdef XEBEC_HAS_IO_URING
+        if (ring) serve_io_uring(*ring, listen_socket);
+#endif
+        while (!stopping_) {
+            pollfd listen_poll{};
+            listen_poll.fd = listen_socket;
+            listen_poll.events = POLLIN;
+            if (SOCKET_POLL(&listen_poll, 1, 100) <= 0) {
+                continue;
+            }
+
+            sockaddr_storage client_address{};
+            socklen_t address_length = sizeof(client_address);
+            SOCKET client_socket = accept(listen_socket, reinterpret_cast<SOCKADDR*>(&client_address), &address_length);
             if (client_socket == INVALID_SOCKET) {
-                std::cerr << "accept failed: " << WSAGetLastError() << std::endl;
-                SOCKET_CLOSE(listen_socket);
-                return;
+                if (!would_block()) {
+                    std::cerr << "accept failed: " << WSAGetLastError() << std::endl;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                continue;
+            }
+            set_blocking(client_socket, true);
+            set_cloexec(client_socket);
+            set_socket_nodelay(client_socket);
+
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex_);
+                connections_[client_socket] = ConnectionState::Fresh;
+            }
+            spawn_connection_thread([this, client_socket,
+                                     remote_addr = format_address(reinterpret_cast<const sockaddr*>(&client_address))] {
+                handle_client(client_socket, remote_addr);
+            });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            listening_ = false;
+            listen_socket_ = INVALID_SOCKET;
+        }
+        connections_cv_.notify_all();
+        SOCKET_CLOSE(listen_socket);
+    }
+
+    // Graceful shutdown: stops accepting, lets in-flight requests finish and closes
+    // idle keep-alive connections and event streams. Whatever is still open after
+    // `drain_timeout` is shut down. Returns once start() has returned and all connections are closed.
+    void stop(std::chrono::milliseconds drain_timeout = std::chrono::seconds(10)) {
+        std::unique_lock<std::mutex> lock(connections_mutex_);
+        stopping_ = true;
+        connections_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return !listening_; });
+
+        for (auto& [socket, state] : connections_) {
+            if (state == ConnectionState::Idle) {
+                SOCKET_SHUTDOWN(socket);
+                state = ConnectionState::Closing;
+            }
+        }
+
+        if (!connections_cv_.wait_for(lock, drain_timeout, [this] { return connections_.empty(); })) {
+            for (auto& [socket, state] : connections_) {
+                SOCKET_SHUTDOWN(socket);
+                state = ConnectionState::Closing;
+            }
+            connections_cv_.wait_for(lock, std::chrono::seconds(1), [this] { return connections_.empty(); });
+        }
+        lock.unlock();
+        if (events_) events_->close_all();
+    }
+
+#ifndef _WIN32
+    // Hot upgrade: starts `argv` (argv[0] is the path of the new binary) with the
+    // listening socket inherited through XEBEC_LISTEN_FD, waits until the new process
+    // is accepting, then drains this server with stop(). Both processes accept on the
+    // same socket during the hand-off, so no connection is refused. Returns the pid of
+    // the replacement, or -1 if it did not come up, in which case this server keeps running.
+    pid_t upgrade(const std::vector<std::string>& argv,
+                  std::chrono::milliseconds ready_timeout = std::chrono::seconds(10),
+                  std::chrono::milliseconds drain_timeout = std::chrono::seconds(10)) {
+        SOCKET listen_socket;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            if (!listening_ || argv.empty()) return -1;
+            listen_socket = listen_socket_;
+        }
+
+        int ready_pipe[2];
+        if (pipe(ready_pipe) != 0) return -1;
+        set_cloexec(ready_pipe[0]);
+
+        // Everything exec needs is built before fork(), since only async-signal-safe
+        // calls are allowed in the child of a multi-threaded process.
+        std::vector<std::string> env_strings;
+        for (char** env = environ; *env; ++env) {
+            if (std::strncmp(*env, "XEBEC_LISTEN_FD=", 16) != 0 && std::strncmp(*env, "XEBEC_READY_FD=", 15) != 0) {
+                env_strings.push_back(*env);
             }
+        }
+        env_strings.push_back("XEBEC_LISTEN_FD=" + std::to_string(listen_socket));
+        env_strings.push_back("XEBEC_READY_FD=" + std::to_string(ready_pipe[1]));
+        std::vector<char*> envp;
+        for (auto& env : env_strings) envp.push_back(&env[0]);
+        envp.push_back(nullptr);
+        std::vector<std::string> args_copy = argv;
+        std::vector<char*> args;
+        for (auto& arg : args_copy) args.push_back(&arg[0]);
+        args.push_back(nullptr);
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            fcntl(listen_socket, F_SETFD, fcntl(listen_socket, F_GETFD) & ~FD_CLOEXEC);
+            execve(args[0], args.data(), envp.data());
+            _exit(127);
+        }
+        close(ready_pipe[1]);
+        if (pid < 0) {
+            close(ready_pipe[0]);
+            return -1;
+        }
+
+        pollfd ready_poll{};
+        ready_poll.fd = ready_pipe[0];
+        ready_poll.events = POLLIN;
+        char byte = 0;
+        bool ready = poll(&ready_poll, 1, static_cast<int>(ready_timeout.count())) > 0 &&
+                     read(ready_pipe[0], &byte, 1) == 1;
+        close(ready_pipe[0]);
+        if (!ready) {
+            kill(pid, SIGTERM);
+            waitpid(pid, nullptr, 0);
+            return -1;
+        }
 
-            std::thread t(&http_server::handle_client, this, client_socket);
-            t.detach();
+        stop(drain_timeout);
+        return pid;
+    }
+#endif
+
+    // Serves a connection that did not come from the listening socket, such as
+    // the server end of a LoopbackClient, on the calling thread until it is
+    // closed. The server does not have to be started. Such connections speak
+    // HTTP/1.1 and WebSocket; stop() leaves them alone.
+    void serve(std::unique_ptr<Connection> connection) {
+        if (!hooks_.connection.empty()) {
+            ConnectionInfo info = connection_info(*connection);
+            for (Plugin* plugin : hooks_.connection) plugin->on_connection(info);
         }
+        serve_connection(std::move(connection), IoBuffer(), 0);
     }
 
     void get(const std::string& path, std::function<void(Request&, Response&)> callback) {
@@ -124,6 +333,56 @@ public:
         assignHandler("PATCH", path, callback);
     }
 
+#ifdef XEBEC_HAS_COROUTINES
+    // Coroutine handlers: while one awaits (sleep_for, async_read, async_write,
+    // async_read_file) the connection is parked on the event loop and holds no
+    // thread. Middleware runs first as usual, but code after next() runs before
+    // the handler has finished, with res.async_pending set; ResponseCache does
+    // not store such responses.
+    void get_async(const std::string& path, AsyncHandler callback) {
+        assignAsyncHandler("GET", path, callback);
+    }
+
+    void post_async(const std::string& path, AsyncHandler callback) {
+        assignAsyncHandler("POST", path, callback);
+    }
+
+    void put_async(const std::string& path, AsyncHandler callback) {
+        assignAsyncHandler("PUT", path, callback);
+    }
+
+    void delete_async(const std::string& path, AsyncHandler callback) {
+        assignAsyncHandler("DELETE", path, callback);
+    }
+
+    void patch_async(const std::string& path, AsyncHandler callback) {
+        assignAsyncHandler("PATCH", path, callback);
+    }
+#endif
+
+    // A route whose handler reads the body itself, through req.body_reader, as it
+    // arrives instead of after it has been buffered. max_request_size does not
+    // apply. Used by upload() and the proxy plugin.
+    void stream_body(const std::string& method, const std::string& path,
+                     std::function<void(Request&, Response&)> callback) {
+        std::string pattern = std::regex_replace(path, std::regex("/:\\w+/?"), "/([^/]+)/?");
+        streaming_routes_[method].emplace_back(pattern);
+        assignHandler(method, path, callback);
+    }
+
+    // multipart/form-data uploads, parsed while the body is received: fields are
+    // kept in memory and files streamed to temporary files (or options.open_sink)
+    // in fixed-size chunks, so memory use does not depend on the upload size.
+    // Middleware runs before the body is read. max_request_size does not apply
+    // to these routes; options.max_size does.
+    void upload(const std::string& path, std::function<void(Request&, MultipartForm&, Response&)> callback,
+                UploadOptions options = UploadOptions()) {
+        stream_body("POST", path, [callback, options](Request& req, Response& res) {
+            MultipartForm form = read_multipart(req, options);
+            callback(req, form, res);
+        });
+    }
+
     void use(std::function<void(Request&, Response&, MiddlewareContext::NextFunction)> middleware) {
         middlewares_.push_back(middleware);
     }
@@ -132,9 +391,16 @@ public:
         error_handler_ = handler;
     }
 
-    void register_plugin(std::unique_ptr<Plugin> plugin) {
+    // Plugins are registered before start(). A plugin's hooks are looked up from
+    // its type here, so pass it as the derived type (std::make_unique<MyPlugin>()).
+    template <typename T>
+    void register_plugin(std::unique_ptr<T> plugin) {
+        static_assert(std::is_base_of_v<Plugin, T>, "register_plugin needs a Plugin");
         plugin->init(this);
-        plugins_[plugin->name()] = std::move(plugin);
+        std::unique_ptr<Plugin>& slot = plugins_[plugin->name()];
+        if (slot) hooks_.remove(slot.get());
+        hooks_.add<T>(plugin.get());
+        slot = std::move(plugin);
     }
 
     void ws(const std::string& path,
@@ -142,6 +408,41 @@ public:
         ws_handlers_[path] = handler;
     }
 
+    // Server-Sent Events: GET requests to `path` (which may contain :params) get a
+    // text/event-stream that stays open and receives what events().publish()
+    // sends to the request's channel, by default the request path. `channel` may
+    // throw HttpError to refuse a request. Middleware runs as for other routes.
+    // Over HTTP/2 these routes answer 505.
+    void sse(const std::string& path, std::function<std::string(Request&)> channel = nullptr) {
+        std::string pattern = std::regex_replace(path, std::regex("/:\\w+/?"), "/([^/]+)/?");
+        sse_routes_.emplace_back(pattern);
+        events();
+        assignHandler("GET", path, [channel](Request& req, Response& res) {
+            res.event_channel = channel ? channel(req) : req.path;
+            if (res.event_channel.empty()) throw HttpError(404, "No such event channel");
+            res.header("Content-Type", "text/event-stream");
+            res.header("Cache-Control", "no-cache");
+        });
+    }
+
+    // Publishes to the subscribers of sse() routes:
+    //     server.events().publish("/news", "{\"title\": \"...\"}", "article");
+    SseHub& events() {
+        std::call_once(events_once_, [this] {
+            SseOptions options;
+            options.history = config_.sse_history;
+            options.heartbeat_ms = config_.sse_heartbeat_ms;
+            options.max_channels = config_.sse_max_channels;
+            events_ = std::make_unique<SseHub>(options);
+            events_->on_close = [this](Connection& connection) {
+                if (hooks_.close.empty()) return;
+                ConnectionInfo info = connection_info(connection);
+                for (Plugin* plugin : hooks_.close) plugin->on_close(info);
+            };
+        });
+        return *events_;
+    }
+
     void set_template_dir(const std::string& dir) {
         template_engine_->set_template_dir(dir);
     }
@@ -162,46 +463,320 @@ private:
     ServerConfig config_;
     std::map<std::string, std::map<std::string, std::pair<std::string, std::function<void(Request&, Response&)>>>> routes;
     std::string publicDirPath;
+    const EmbeddedDirectory* embedded_public_ = nullptr;
     std::vector<std::function<void(Request&, Response&, MiddlewareContext::NextFunction)>> middlewares_;
     std::function<void(const HttpError&, Request&, Response&)> error_handler_;
     std::map<std::string, std::unique_ptr<Plugin>> plugins_;
+    PluginHooks hooks_;
     std::map<std::string, std::function<void(WebSocketFrame&,
                           std::function<void(const WebSocketFrame&)>)>> ws_handlers_;
     std::unique_ptr<TemplateEngine> template_engine_;
+#ifdef XEBEC_ENABLE_TLS
+    std::unique_ptr<TlsContext> tls_;
+#endif
+    std::map<std::string, std::map<std::string, AsyncHandler>> async_routes_;
+    std::map<std::string, std::vector<std::regex>> streaming_routes_;  // Bodies read via Request::body_reader
+    std::vector<std::regex> sse_routes_;
+    std::once_flag events_once_;
+    std::unique_ptr<SseHub> events_;
+#ifdef XEBEC_HAS_COROUTINES
+    std::once_flag loop_once_;
+    std::unique_ptr<EventLoop> loop_;
+#endif
+    // Threads that finish async requests and run HTTP/2 handlers; an idle one
+    // waits a while for the next.
+    std::mutex workers_mutex_;
+    std::condition_variable workers_cv_;
+    std::deque<std::function<void()>> worker_jobs_;
+    size_t workers_idle_ = 0;
+    size_t workers_live_ = 0;
+    bool workers_stopping_ = false;
+
+    // Fresh: accepted, no request yet. Idle: between keep-alive requests.
+    // Closing: shut down by stop().
+    enum class ConnectionState { Fresh, Idle, Busy, Closing };
+    std::mutex connections_mutex_;
+    std::condition_variable connections_cv_;
+    std::map<SOCKET, ConnectionState> connections_;
+    size_t connection_threads_ = 0;  // Running spawn_connection_thread() threads
+    std::atomic<bool> stopping_{false};
+    bool listening_ = false;
+    SOCKET listen_socket_ = INVALID_SOCKET;
 
     void assignHandler(const std::string& method, const std::string& path, std::function<void(Request&, Response&)> callback) {
         std::string newPath = std::regex_replace(path, std::regex("/:\\w+/?"), "/([^/]+)/?");
         routes[method][newPath] = std::pair<std::string, std::function<void(Request&, Response&)>>(path, callback);
     }
 
-    void handle_client(SOCKET client_socket) {
+#ifdef XEBEC_HAS_COROUTINES
+    void assignAsyncHandler(const std::string& method, const std::string& path, AsyncHandler callback) {
+        std::string newPath = std::regex_replace(path, std::regex("/:\\w+/?"), "/([^/]+)/?");
+        async_routes_[method][newPath] = callback;
+        // Where the connection cannot be handed to the loop (HTTP/2 streams), the
+        // calling thread waits for the coroutine instead.
+        assignHandler(method, path, [this, callback](Request& req, Response& res) {
+            std::promise<void> finished;
+            event_loop().spawn(callback(req, res), [&finished](std::exception_ptr error) {
+                if (error) finished.set_exception(error);
+                else finished.set_value();
+            });
+            finished.get_future().get();
+        });
+    }
+
+    EventLoop& event_loop() {
+        std::call_once(loop_once_, [this] { loop_ = std::make_unique<EventLoop>(); });
+        return *loop_;
+    }
+
+    // A request whose coroutine handler is running on the event loop.
+    struct AsyncExchange {
+        std::unique_ptr<Connection> connection;
+        IoBuffer buffer;
+        size_t requests_served;
+        bool keep_alive;
         Request req;
-        try {
-            auto request = read_request(client_socket);
-            std::cout << "Raw request:\n" << request << std::endl;
-            
-            Response res(publicDirPath);
-            parse_request(request, req);
-            
-            std::cout << "Parsed request - Method: " << req.method 
-                      << ", Path: " << req.path << std::endl;
-            
-            if (req.get_header("Upgrade") == "websocket") {
-                handle_websocket(req, client_socket);
-                return;
+        Response res;
+    };
+
+    void start_async(std::shared_ptr<AsyncExchange> exchange, const AsyncHandler& handler) {
+        event_loop().spawn(handler(exchange->req, exchange->res), [this, exchange](std::exception_ptr error) {
+            if (error) {
+                Response error_response(publicDirPath);
+                try {
+                    std::rethrow_exception(error);
+                } catch (const HttpError& e) {
+                    if (error_handler_) {
+                        error_handler_(e, exchange->req, error_response);
+                    } else {
+                        default_error_handler(e, error_response);
+                    }
+                } catch (const std::exception& e) {
+                    default_error_handler(HttpError(500, e.what()), error_response);
+                }
+                exchange->res = error_response;
+            }
+            // Sending and the rest of the keep-alive loop leave the event loop thread.
+            run_on_worker([this, exchange] { finish_async(exchange); });
+        });
+    }
+
+    void finish_async(std::shared_ptr<AsyncExchange> exchange) {
+        if (!exchange->keep_alive || stopping_) {
+            exchange->res.header("Connection", "close");
+            exchange->keep_alive = false;
+        }
+        responding(exchange->req, exchange->res);
+        if (!send_response(*exchange->connection, exchange->req.method, exchange->res)) {
+            exchange->keep_alive = false;
+        }
+        if (exchange->keep_alive) {
+            serve_connection(std::move(exchange->connection), std::move(exchange->buffer), exchange->requests_served);
+        } else {
+            close_connection(*exchange->connection);
+        }
+    }
+#endif
+
+    // Runs `job` on an idle worker, or on a new one if all are busy, so that a
+    // connection alternating between the loop and a thread, or a stream of
+    // HTTP/2 requests, does not start a thread per request.
+    void run_on_worker(std::function<void()> job) {
+        std::lock_guard<std::mutex> lock(workers_mutex_);
+        worker_jobs_.push_back(std::move(job));
+        if (workers_idle_ >= worker_jobs_.size()) {
+            workers_cv_.notify_one();
+            return;
+        }
+        workers_live_++;
+        std::thread(&http_server::worker, this).detach();
+    }
+
+    void worker() {
+        std::unique_lock<std::mutex> lock(workers_mutex_);
+        while (true) {
+            workers_idle_++;
+            bool has_job = workers_cv_.wait_for(lock, std::chrono::seconds(10), [this] {
+                return !worker_jobs_.empty() || workers_stopping_;
+            }) && !worker_jobs_.empty();
+            workers_idle_--;
+            if (!has_job) break;
+            std::function<void()> job = std::move(worker_jobs_.front());
+            worker_jobs_.pop_front();
+            lock.unlock();
+            job();
+            lock.lock();
+        }
+        workers_live_--;
+        workers_cv_.notify_all();
+    }
+
+    // Wakes idle workers and waits for every worker to end.
+    void stop_workers() {
+        std::unique_lock<std::mutex> lock(workers_mutex_);
+        workers_stopping_ = true;
+        workers_cv_.notify_all();
+        workers_cv_.wait(lock, [this] { return workers_live_ == 0; });
+    }
+
+    // Runs `serve` on a thread of its own, counted so that the destructor can wait for it.
+    template <typename Serve>
+    void spawn_connection_thread(Serve serve) {
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connection_threads_++;
+        }
+        std::thread([this, serve = std::move(serve)]() mutable {
+            serve();
+            // Notified under the lock, so the destructor cannot return before this thread is done with it.
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connection_threads_--;
+            connections_cv_.notify_all();
+        }).detach();
+    }
+
+    void handle_client(SOCKET client_socket, std::string remote_addr) {
+        auto connection = std::make_unique<Connection>(client_socket, std::move(remote_addr));
+        bool handshake_ok = true;
+#ifdef XEBEC_ENABLE_TLS
+        if (tls_) {
+            SSL* ssl = tls_->accept(static_cast<int>(client_socket), config_.tls_handshake_timeout_ms);
+            handshake_ok = ssl != nullptr;
+            connection->attach_tls(ssl);
+        }
+#endif
+        if (!hooks_.connection.empty()) {
+            ConnectionInfo info = connection_info(*connection);
+            for (Plugin* plugin : hooks_.connection) plugin->on_connection(info);
+        }
+
+        if (handshake_ok && connection->alpn_protocol() == "h2") {
+            mark_busy(client_socket);
+            http2_session(*connection).run();
+            handshake_ok = false;
+        }
+        if (handshake_ok) {
+            serve_connection(std::move(connection), IoBuffer(), 0);
+        } else {
+            close_connection(*connection);
+        }
+    }
+
+    // The keep-alive loop. An async handler takes the connection over, in which
+    // case this returns and the loop continues on a worker once it is done.
+    void serve_connection(std::unique_ptr<Connection> connection, IoBuffer buffer, size_t requests_served) {
+        bool keep_alive = true;
+        while (keep_alive) {
+            if (buffer.empty()) {
+                // Nothing pipelined: the connection holds no buffer while it waits.
+                buffer.release();
+                if (!wait_for_request(*connection)) break;
+            }
+            keep_alive = serve_request(connection, buffer, ++requests_served);
+            if (!connection) return;
+        }
+        close_connection(*connection);
+    }
+
+    void close_connection(Connection& connection) {
+        if (!hooks_.close.empty()) {
+            ConnectionInfo info = connection_info(connection);
+            for (Plugin* plugin : hooks_.close) plugin->on_close(info);
+        }
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connections_.erase(connection.socket());
+        }
+        connections_cv_.notify_all();
+        connection.close();
+    }
+
+    // Waits for the next request on a connection. Idle keep-alive connections can
+    // be shut down by stop() while they wait here.
+    bool wait_for_request(Connection& connection) {
+        if (Transport* transport = connection.transport()) {
+            return transport->wait_readable(config_.keep_alive_timeout_ms);
+        }
+        SOCKET client_socket = connection.socket();
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            auto& state = connections_[client_socket];
+            if (state == ConnectionState::Busy) state = ConnectionState::Idle;
+            if (stopping_ && state != ConnectionState::Fresh) return false;
+        }
+
+        int ready = 1;
+        if (!connection.has_buffered_data()) {
+            pollfd client_poll{};
+            client_poll.fd = client_socket;
+            client_poll.events = POLLIN;
+            ready = SOCKET_POLL(&client_poll, 1, 0);
+            if (ready == 0) {
+                // Idle: the free buffers this thread holds are of use to other connections meanwhile.
+                BufferPool::global().flush_thread_cache();
+                ready = SOCKET_POLL(&client_poll, 1, config_.keep_alive_timeout_ms);
             }
+        }
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto& state = connections_[client_socket];
+        if (ready <= 0 || state == ConnectionState::Closing) return false;
+        state = ConnectionState::Busy;
+        return true;
+    }
+
+    void mark_busy(SOCKET client_socket) {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections_[client_socket] = ConnectionState::Busy;
+    }
+
+    // Requests on an HTTP/2 connection go through the same middleware and routes.
+    Http2Session http2_session(Connection& connection) {
+        return Http2Session(connection, config_,
+                            [this](Request& req) {
+                                RequestTrace trace;
+                                trace.describe(req.method, req.path);
+                                request_parsed(req, std::string_view());
+                                Response res = dispatch(req);
+                                if (!res.event_channel.empty()) {
+                                    res = Response(publicDirPath);
+                                    default_error_handler(HttpError(505, "Server-Sent Events need HTTP/1.1"), res);
+                                }
+                                responding(req, res);
+                                return res;
+                            },
+                            [this](std::function<void()> job) { run_on_worker(std::move(job)); },
+                            [this]() { return stopping_.load(); });
+    }
+
+    static ConnectionInfo connection_info(const Connection& connection) {
+        return ConnectionInfo{static_cast<uint64_t>(connection.socket()), connection.remote_addr(), connection.secure()};
+    }
+
+    void request_parsed(Request& req, std::string_view raw) {
+        for (Plugin* plugin : hooks_.request_parsed) plugin->on_request_parsed(req, raw);
+    }
+
+    void responding(const Request& req, Response& res) {
+        for (Plugin* plugin : hooks_.response) plugin->on_response(req, res);
+    }
 
-            MiddlewareContext ctx(req, res);
+    // Runs middleware and the matching route, turning errors into error responses.
+    // When `async_handler` is given and the route is a coroutine handler, it is
+    // returned there instead of being run.
+    Response dispatch(Request& req, const AsyncHandler** async_handler = nullptr) {
+        Response res(publicDirPath);
+        res.embedded = embedded_public_;
+        try {
+            MiddlewareContext ctx(req, res, [this, &req, &res, async_handler]() {
+                handle_route(req, res, async_handler);
+            });
             for (const auto& middleware : middlewares_) {
                 ctx.add(middleware);
             }
+            TraceSpan span("middleware", TraceEvent::Kind::Phase);
             ctx.next();
-            
-            handle_route(req, res);
-            
-            std::cout << "Response body length: " << res.body.length() << std::endl;
-            
-            send_response(client_socket, res);
+            return res;
         }
         catch (const HttpError& e) {
             std::cerr << "HTTP Error: " << e.what() << std::endl;
@@ -211,47 +786,171 @@ private:
             } else {
                 default_error_handler(e, error_response);
             }
-            send_response(client_socket, error_response);
+            return error_response;
         }
         catch (const std::exception& e) {
             std::cerr << "Exception: " << e.what() << std::endl;
             Response error_response(publicDirPath);
             default_error_handler(HttpError(500, e.what()), error_response);
-            send_response(client_socket, error_response);
+            return error_response;
         }
-        
-        SOCKET_CLOSE(client_socket);
     }
-    
+
+    // Serves one request from the connection and returns whether it stays open.
+    // Resets `connection` when an async handler has taken it over.
+    bool serve_request(std::unique_ptr<Connection>& connection_ptr, IoBuffer& buffer, size_t requests_served) {
+        Connection& connection = *connection_ptr;
+        Request req;
+        bool keep_alive = false;
+        RequestTrace trace;
+        try {
+            std::string request;
+            bool streamed = false;
+            TraceSpan read_span("read_request", TraceEvent::Kind::Phase);
+            if (!read_request(connection, buffer, request, streamed)) {
+                // Closed by the client: there was no request to trace.
+                read_span.discard();
+                trace.discard();
+                return false;
+            }
+            read_span.end();
+            if (config_.log_requests) std::cout << "Raw request:\n" << request << std::endl;
+
+            TraceSpan parse_span("parse_request", TraceEvent::Kind::Phase);
+            parse_request(request, req);
+            parse_span.end();
+            trace.describe(req.method, req.path);
+            req.remote_addr = connection.remote_addr();
+            request_parsed(req, request);
+
+            if (config_.log_requests) {
+                std::cout << "Parsed request - Method: " << req.method << ", Path: " << req.path << std::endl;
+            }
+
+            if (req.get_header("Upgrade") == "websocket") {
+                handle_websocket(req, connection);
+                return false;
+            }
+
+            if (config_.enable_http2 && !connection.transport()) {
+                // Prior knowledge: the request line was the start of the connection preface.
+                if (req.method == "PRI" && req.path == "*" && req.version == "HTTP/2.0") {
+                    request.append(buffer.data(), buffer.size());
+                    http2_session(connection).run(std::move(request));
+                    return false;
+                }
+                if (!connection.secure() && req.get_header("Upgrade") == "h2c" && req.has_header("HTTP2-Settings")) {
+                    http2_session(connection).run_upgraded(req, req.get_header("HTTP2-Settings"),
+                                                           std::string(buffer.view()));
+                    return false;
+                }
+            }
+
+            keep_alive = wants_keep_alive(req) && requests_served < config_.max_keep_alive_requests && !stopping_;
+            uint64_t body_remaining = 0;
+            if (streamed) {
+                body_remaining = parse_content_length(request, request.size() - 4);
+                req.body_reader = body_reader(connection, buffer, body_remaining,
+                                              req.get_header("Expect") == "100-continue");
+            }
+            const AsyncHandler* async_handler = nullptr;
+            Response res = dispatch(req, &async_handler);
+            // The rest of an unread body cannot be told apart from the next request.
+            if (body_remaining > 0) keep_alive = false;
+#ifdef XEBEC_HAS_COROUTINES
+            if (async_handler) {
+                auto exchange = std::make_shared<AsyncExchange>(AsyncExchange{
+                    std::move(connection_ptr), std::move(buffer), requests_served, keep_alive,
+                    std::move(req), std::move(res)});
+                start_async(exchange, *async_handler);
+                return false;
+            }
+#endif
+
+            if (!res.event_channel.empty() && res.status[0] == '2' && connection.transport()) {
+                // The hub waits on sockets.
+                res = Response(publicDirPath);
+                default_error_handler(HttpError(501, "Server-Sent Events need a socket"), res);
+            }
+            if (!res.event_channel.empty() && res.status[0] == '2') {
+                responding(req, res);
+                subscribe_events(connection_ptr, req, res);
+                return false;
+            }
+
+            if (config_.log_requests) std::cout << "Response body length: " << res.body.length() << std::endl;
+
+            if (!keep_alive || stopping_) {
+                res.header("Connection", "close");
+                keep_alive = false;
+            }
+            responding(req, res);
+            TraceSpan send_span("send_response", TraceEvent::Kind::Phase);
+            if (!send_response(connection, req.method, res)) keep_alive = false;
+        }
+        catch (const HttpError& e) {
+            std::cerr << "HTTP Error: " << e.what() << std::endl;
+            Response error_response(publicDirPath);
+            if (error_handler_) {
+                error_handler_(e, req, error_response);
+            } else {
+                default_error_handler(e, error_response);
+            }
+            if (!keep_alive || stopping_) {
+                error_response.header("Connection", "close");
+                keep_alive = false;
+            }
+            responding(req, error_response);
+            send_response(connection, req.method, error_response);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Exception: " << e.what() << std::endl;
+            Response error_response(publicDirPath);
+            default_error_handler(HttpError(500, e.what()), error_response);
+            error_response.header("Connection", "close");
+            responding(req, error_response);
+            send_response(connection, req.method, error_response);
+            keep_alive = false;
+        }
+        return keep_alive;
+    }
+
+    // Sends the head of an event stream and gives the connection to the hub,
+    // which keeps it open. A connection it cannot be sent on is closed as usual.
+    void subscribe_events(std::unique_ptr<Connection>& connection_ptr, const Request& req, Response& res) {
+        std::string head;
+        append_response(req.method, res, head);
+        if (!connection_ptr->send_all(head.data(), head.size())) return;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connections_.erase(connection_ptr->socket());
+        }
+        connections_cv_.notify_all();
+        events().subscribe(std::move(connection_ptr), res.event_channel, req.get_header("Last-Event-ID"));
+    }
+
+    static bool wants_keep_alive(const Request& req) {
+        std::string connection = req.get_header("Connection");
+        std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+        if (connection.find("close") != std::string::npos) return false;
+        if (req.version == "HTTP/1.0") return connection.find("keep-alive") != std::string::npos;
+        return true;
+    }
+
     void default_error_handler(const HttpError& e, Response& res) {
-        res.status_code(e.status_code())
-           .header("Content-Type", "application/json")
-           .json("{\"error\": \"" + std::string(e.what()) + "\"}");
+        res.status_code(e.status_code());
+        res.json().begin_object().field("error", e.what()).end_object();
     }
     
     void parse_request(const std::string& request_str, Request& req) {
+        RequestLine request_line = split_request_line(request_str);
+        req.method.assign(request_line.method);
+        req.version.assign(request_line.version);
+        parse_request_target(std::string(request_line.target), req);
+
         std::istringstream request_stream(request_str);
         std::string line;
-
-        if (std::getline(request_stream, line)) {
-            std::istringstream line_stream(line);
-            line_stream >> req.method >> req.path >> req.version;
-            
-            size_t query_pos = req.path.find('?');
-            if (query_pos != std::string::npos) {
-                std::string query_string = req.path.substr(query_pos + 1);
-                req.path = req.path.substr(0, query_pos);
-                
-                std::istringstream query_stream(query_string);
-                std::string param;
-                while (std::getline(query_stream, param, '&')) {
-                    size_t eq_pos = param.find('=');
-                    if (eq_pos != std::string::npos) {
-                        req.query[param.substr(0, eq_pos)] = param.substr(eq_pos + 1);
-                    }
-                }
-            }
-        }
+        std::getline(request_stream, line);
 
         while (std::getline(request_stream, line) && line != "\r") {
             size_t colon_pos = line.find(':');
@@ -264,15 +963,92 @@ private:
             }
         }
 
-        if (req.has_header("Content-Length")) {
-            size_t content_length = std::stoi(req.get_header("Content-Length"));
-            std::vector<char> body_buffer(content_length);
-            request_stream.read(body_buffer.data(), content_length);
-            req.body = std::string(body_buffer.data(), content_length);
+        // The body is whatever read_request() put after the head: nothing for a
+        // streamed body, which is read later through Request::body_reader.
+        size_t head_end = request_str.find("\r\n\r\n");
+        if (head_end != std::string::npos && head_end + 4 < request_str.size()) {
+            req.body.assign(request_str, head_end + 4, std::string::npos);
+        }
+    }
+
+    // Reads a streamed request body: first what is left in `buffer`, then from the
+    // connection, never past `remaining`. A client that sent "Expect: 100-continue"
+    // is told to go ahead on the first read, after middleware has accepted the request.
+    static std::function<size_t(char*, size_t)> body_reader(Connection& connection, IoBuffer& buffer,
+                                                            uint64_t& remaining, bool expect_continue) {
+        return [&connection, &buffer, &remaining, expect_continue](char* out, size_t size) mutable -> size_t {
+            if (remaining == 0) return 0;
+            size = static_cast<size_t>(std::min<uint64_t>(size, remaining));
+            size_t received;
+            if (!buffer.empty()) {
+                received = std::min(size, buffer.size());
+                std::memcpy(out, buffer.data(), received);
+                buffer.consume(received);
+            } else {
+                if (expect_continue) {
+                    static const char go_ahead[] = "HTTP/1.1 100 Continue\r\n\r\n";
+                    connection.send_all(go_ahead, sizeof(go_ahead) - 1);
+                    expect_continue = false;
+                }
+                int got = connection.recv(out, size);
+                if (got <= 0) throw HttpError(400, "Connection closed before the end of the body");
+                received = static_cast<size_t>(got);
+            }
+            remaining -= received;
+            return received;
+        };
+    }
+
+    bool streams_body(const std::string& method, const std::string& path) const {
+        auto routes = streaming_routes_.find(method);
+        if (routes == streaming_routes_.end()) return false;
+        for (const std::regex& route : routes->second) {
+            if (std::regex_match(path, route)) return true;
+        }
+        return false;
+    }
+
+    struct RequestLine {
+        std::string_view method;
+        std::string_view target;
+        std::string_view version;
+    };
+
+    // Splits the request line at the start of `head`: a method token, a target
+    // and an HTTP version, separated by single spaces. Anything else is refused
+    // rather than read leniently, so that whether a body is streamed is never
+    // decided on a different reading of the line than the one that is routed.
+    static RequestLine split_request_line(std::string_view head) {
+        std::string_view line = head.substr(0, head.find("\r\n"));
+        size_t method_end = line.find(' ');
+        size_t target_end = method_end == std::string::npos ? method_end : line.find(' ', method_end + 1);
+        if (target_end == std::string::npos) throw HttpError(400, "Malformed request line");
+        RequestLine parts{line.substr(0, method_end), line.substr(method_end + 1, target_end - method_end - 1),
+                          line.substr(target_end + 1)};
+        static const char separators[] = "()<>@,;:\\\"/[]?={} ";
+        const std::string_view& version = parts.version;
+        bool valid = !parts.method.empty() && !parts.target.empty() && version.size() == 8 &&
+                     version.compare(0, 5, "HTTP/") == 0 && version[5] >= '0' && version[5] <= '9' &&
+                     version[6] == '.' && version[7] >= '0' && version[7] <= '9';
+        for (char c : parts.method) {
+            valid = valid && c > 0x20 && c < 0x7f && !std::strchr(separators, c);
         }
+        for (unsigned char c : parts.target) {
+            valid = valid && c > 0x20 && c != 0x7f;
+        }
+        if (!valid) throw HttpError(400, "Malformed request line");
+        return parts;
+    }
+
+    // streams_body() for a request head that has not been parsed yet.
+    bool head_streams_body(std::string_view head) const {
+        RequestLine line = split_request_line(head);
+        if (streaming_routes_.empty()) return false;
+        return streams_body(std::string(line.method), std::string(line.target.substr(0, line.target.find('?'))));
     }
 
-    void handle_route(Request& req, Response& res) {
+    void handle_route(Request& req, Response& res, const AsyncHandler** async_handler = nullptr) {
+        TraceSpan span("handle_route", TraceEvent::Kind::Phase);
         std::string method = req.method;
         std::string path = req.path;
 
@@ -301,74 +1077,1165 @@ private:
                     originalPath = match.suffix();
                 }
 
+                if (async_handler) {
+                    auto async_route = async_routes_[method].find(route_path);
+                    if (async_route != async_routes_[method].end()) {
+                        *async_handler = &async_route->second;
+                        res.async_pending = true;
+                        return;
+                    }
+                }
+                TraceSpan handler_span("handler", TraceEvent::Kind::Phase);
                 routes[method][route_path].second(req, res);
                 return;
             }
         }
 
-        serve_static_file(path, res);
+        TraceSpan static_span("static_file", TraceEvent::Kind::Phase);
+        serve_static_file(req, res);
     }
 
-    void serve_static_file(const std::string& path, Response& response) {
-        std::string content_type;
-        std::string file_extension = path.substr(path.find_last_of('.') + 1);
-        
-        if (file_extension == "html") content_type = "text/html";
-        else if (file_extension == "css") content_type = "text/css";
-        else if (file_extension == "js") content_type = "application/javascript";
-        else if (file_extension == "json") content_type = "application/json";
-        else if (file_extension == "jpg" || file_extension == "jpeg") content_type = "image/jpeg";
-        else if (file_extension == "png") content_type = "image/png";
-        else if (file_extension == "gif") content_type = "image/gif";
-        else content_type = "application/octet-stream";
-
-        std::fstream file(publicDirPath + "/" + path, std::ios::in | std::ios::binary);
-        if (file) {
-            response << std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-            file.close();
-            response.header("Content-Type", content_type);
+    void serve_static_file(const Request& req, Response& response) {
+        if (embedded_public_) {
+            serve_embedded_file(req, response);
+            return;
         }
-    }
-
-    std::string read_request(SOCKET client_socket) {
-        std::string request;
-        char buffer[1024];
-        int bytes_received;
-        do {
-            bytes_received = recv(client_socket, buffer, 1024, 0);
-            if (bytes_received > 0) {
-                request.append(buffer, bytes_received);
+        const std::string& path = req.path;
+        for (const auto& segment : split_(path, '/')) {
+            if (segment == "..") {
+                throw HttpError(404, "File not found: " + path);
             }
-        } while (bytes_received == 1024);
-        return request;
-    }
+        }
 
-    void send_response(SOCKET client_socket, Response response) {
-        response.header("Content-Length", std::to_string(response.body.size()));
-        response.header("X-Powered-By", "Xebec-Server/0.1.0");
-        response.header("Programming-Language", "C++");
-        response.headers += "\r\n";
-        std::string res = "HTTP/1.1 " + response.status + response.headers + response.body;
-        send(client_socket, res.c_str(), res.size(), 0);
-    }
+        std::string file_path = publicDirPath + "/" + path;
+        FileInfo info;
+        if (!stat_file(file_path, info)) {
+            throw HttpError(404, "File not found: " + path);
+        }
 
-    std::string generate_websocket_accept(const std::string& key) {
-        const std::string magic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
-    
-        // Compute SHA-1 hash
-        SHA1 sha1;
-        sha1.update(key + magic);
-        std::vector<uint8_t> hash_bytes = sha1.final_bytes();
-    
-        // Encode the hash in base64
-        return base64_encode(hash_bytes.data(), hash_bytes.size());
-    }
-    
+        std::string content_type = mime_type(path);
+        std::string etag = file_etag(info);
+        std::string last_modified = http_date(info.mtime);
+        response.header("ETag", etag)
+                .header("Last-Modified", last_modified)
+                .header("Accept-Ranges", "bytes");
 
-    void handle_websocket(const Request& req, SOCKET client_socket) {
-        std::string key = req.get_header("Sec-WebSocket-Key");
-        if (key.empty()) {
-            throw HttpError(400, "Invalid WebSocket request");
+        if (req.has_header("If-None-Match")) {
+            if (etag_matches(req.get_header("If-None-Match"), etag)) {
+                response.status_code(304);
+                return;
+            }
+        } else if (req.has_header("If-Modified-Since")) {
+            time_t since = parse_http_date(req.get_header("If-Modified-Since"));
+            if (since != -1 && info.mtime <= since) {
+                response.status_code(304);
+                return;
+            }
+        }
+
+        std::vector<ByteRange> ranges;
+        RangeResult range_result = RangeResult::None;
+        if (req.method == "GET" && req.has_header("Range") && if_range_matches(req, etag, last_modified)) {
+            range_result = parse_ranges(req.get_header("Range"), info.size, ranges);
+        }
+
+        if (range_result == RangeResult::Unsatisfiable) {
+            response.status_code(416)
+                    .header("Content-Range", "bytes */" + std::to_string(info.size));
+            return;
+        }
+
+        if (range_result == RangeResult::None) {
+            response.header("Content-Type", content_type);
+            response.file(file_path, 0, info.size);
+            return;
+        }
+
+        response.status_code(206);
+        if (ranges.size() == 1) {
+            response.header("Content-Type", content_type)
+                    .header("Content-Range", content_range(ranges[0], info.size));
+            response.file(file_path, ranges[0].first, ranges[0].length());
+            return;
+        }
+
+        // The parts are read from the file as they are sent, a chunk at a time.
+        stream_ranges(response, etag, content_type, info.size, std::move(ranges),
+                      [file_path](uint64_t offset, uint64_t length, const BodyWriter& write) {
+            std::ifstream file(file_path, std::ios::in | std::ios::binary);
+            file.seekg(static_cast<std::streamoff>(offset));
+            std::unique_ptr<char[]> chunk(new char[range_chunk_size]);
+            while (length > 0 && file) {
+                size_t size = static_cast<size_t>(std::min<uint64_t>(length, range_chunk_size));
+                if (!file.read(chunk.get(), static_cast<std::streamsize>(size)) || !write(chunk.get(), size)) break;
+                length -= size;
+            }
+            return length == 0;
+        });
+    }
+
+    // Serves a file of the embedded public directory, in the best encoding the
+    // client accepts. Ranges are served from the unencoded file.
+    void serve_embedded_file(const Request& req, Response& response) {
+        const EmbeddedFile* file = embedded_public_->find(req.path);
+        if (!file) {
+            throw HttpError(404, "File not found: " + req.path);
+        }
+
+        bool negotiated = file->gzip.present() || file->br.present();
+        bool ranged = req.method == "GET" && req.has_header("Range");
+        const EmbeddedVariant* variant = &file->identity;
+        const char* encoding = nullptr;
+        if (negotiated && !ranged) {
+            std::string accept = req.get_header("Accept-Encoding");
+            if (file->br.present() && accepts_encoding(accept, "br")) {
+                variant = &file->br;
+                encoding = "br";
+            } else if (file->gzip.present() && accepts_encoding(accept, "gzip")) {
+                variant = &file->gzip;
+                encoding = "gzip";
+            }
+        }
+
+        std::string etag(variant->etag);
+        response.header("ETag", etag).header("Accept-Ranges", "bytes");
+        if (negotiated) response.header("Vary", "Accept-Encoding");
+        if (req.has_header("If-None-Match") && etag_matches(req.get_header("If-None-Match"), etag)) {
+            response.status_code(304);
+            return;
+        }
+
+        std::string content_type(file->content_type);
+        std::string_view data = variant->data;
+        std::vector<ByteRange> ranges;
+        RangeResult range_result = RangeResult::None;
+        if (ranged && if_range_matches(req, etag, std::string())) {
+            range_result = parse_ranges(req.get_header("Range"), data.size(), ranges);
+        }
+
+        if (range_result == RangeResult::Unsatisfiable) {
+            response.status_code(416)
+                    .header("Content-Range", "bytes */" + std::to_string(data.size()));
+            return;
+        }
+        if (range_result == RangeResult::None) {
+            response.header("Content-Type", content_type);
+            if (encoding) response.header("Content-Encoding", encoding);
+            response.view(data);
+            return;
+        }
+
+        response.status_code(206);
+        if (ranges.size() == 1) {
+            response.header("Content-Type", content_type)
+                    .header("Content-Range", content_range(ranges[0], data.size()));
+            response.view(data.substr(ranges[0].first, ranges[0].length()));
+            return;
+        }
+        stream_ranges(response, etag, content_type, data.size(), std::move(ranges),
+                      [data](uint64_t offset, uint64_t length, const BodyWriter& write) {
+            return write(data.data() + offset, static_cast<size_t>(length));
+        });
+    }
+
+    static constexpr size_t range_chunk_size = 64 * 1024;
+
+    // Sends `ranges` as a multipart/byteranges body with a Content-Length. The
+    // parts are not held in memory: `read` passes `length` bytes from `offset`
+    // to `write` while the response goes out, and returns false if it cannot.
+    static void stream_ranges(Response& response, const std::string& etag, const std::string& content_type,
+                              uint64_t size, std::vector<ByteRange> ranges,
+                              std::function<bool(uint64_t offset, uint64_t length, const BodyWriter& write)> read) {
+        std::string boundary = "xebec-" + to_hex(fnv1a_64(etag.data(), etag.size()));
+        std::vector<std::string> part_heads;
+        uint64_t length = 0;
+        for (const auto& range : ranges) {
+            part_heads.push_back("\r\n--" + boundary + "\r\nContent-Type: " + content_type +
+                                 "\r\nContent-Range: " + content_range(range, size) + "\r\n\r\n");
+            length += part_heads.back().size() + range.length();
+        }
+        std::string tail = "\r\n--" + boundary + "--\r\n";
+        length += tail.size();
+        response.header("Content-Type", "multipart/byteranges; boundary=" + boundary);
+        response.stream([part_heads, ranges, tail, read](const BodyWriter& write) {
+            for (size_t i = 0; i < ranges.size(); i++) {
+                if (!write(part_heads[i].data(), part_heads[i].size()) ||
+                    !read(ranges[i].first, ranges[i].length(), write)) {
+                    return false;
+                }
+            }
+            return write(tail.data(), tail.size());
+        }, static_cast<int64_t>(length));
+    }
+
+    static bool if_range_matches(const Request& req, const std::string& etag, const std::string& last_modified) {
+        if (!req.has_header("If-Range")) return true;
+        std::string condition = req.get_header("If-Range");
+        if (condition.compare(0, 2, "W/") == 0) return false;
+        if (!condition.empty() && condition[0] == '"') return condition == etag;
+        return condition == last_modified;
+    }
+
+    static std::string content_range(const ByteRange& range, uint64_t size) {
+        return "bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) +
+               "/" + std::to_string(size);
+    }
+
+    // Reads one complete request (head plus Content-Length body) from the connection.
+    // Bytes past the end of the request stay in `buffer` for the next pipelined request.
+    // `streamed` is set when only the head was read, the body being left for
+    // Request::body_reader.
+    bool read_request(Connection& connection, IoBuffer& buffer, std::string& request, bool& streamed) {
+        size_t scanned = 0;
+        size_t head_end;
+        while ((head_end = buffer.find("\r\n\r\n", scanned)) == std::string::npos) {
+            if (buffer.size() > config_.max_request_size) {
+                throw HttpError(431, "Request header fields too large");
+            }
+            scanned = buffer.size() < 3 ? 0 : buffer.size() - 3;
+            if (!receive(connection, buffer)) {
+                return false;
+            }
+        }
+
+        size_t total = head_end + 4;
+        streamed = head_streams_body(buffer.view().substr(0, head_end + 2));
+        size_t content_length = parse_content_length(buffer.view(), head_end);
+        if (!streamed) {
+            total += content_length;
+            if (total > config_.max_request_size) {
+                throw HttpError(413, "Payload too large");
+            }
+        }
+        while (buffer.size() < total) {
+            if (!receive(connection, buffer)) {
+                return false;
+            }
+        }
+
+        request.assign(buffer.data(), total);
+        buffer.consume(total);
+        return true;
+    }
+
+    // Receives straight into the free space at the end of `buffer`.
+    static bool receive(Connection& connection, IoBuffer& buffer) {
+        char* space = buffer.prepare(4096);
+        int bytes_received = connection.recv(space, std::min<size_t>(buffer.room(), 1 << 30));
+        if (bytes_received <= 0) {
+            return false;
+        }
+        buffer.commit(static_cast<size_t>(bytes_received));
+        return true;
+    }
+
+    // Length of the first complete request in `buffer`, or 0 while more bytes are
+    // needed. Just the head when the body is `streamed`.
+    size_t complete_request_length(std::string_view buffer, bool& streamed) const {
+        size_t head_end = buffer.find("\r\n\r\n");
+        if (head_end == std::string::npos) {
+            if (buffer.size() > config_.max_request_size) {
+                throw HttpError(431, "Request header fields too large");
+            }
+            return 0;
+        }
+        // Serving a streamed body is handed off to a connection thread.
+        streamed = head_streams_body(buffer.substr(0, head_end + 2));
+        size_t content_length = parse_content_length(buffer, head_end);
+        if (streamed) return head_end + 4;
+        size_t total = head_end + 4 + content_length;
+        if (total > config_.max_request_size) {
+            throw HttpError(413, "Payload too large");
+        }
+        return buffer.size() >= total ? total : 0;
+    }
+
+    // The length of the body from the Content-Length header, 0 without one.
+    // Heads whose body could be framed more than one way are refused, and the
+    // connection closed, rather than guessed at: Transfer-Encoding is not
+    // supported, and Content-Length must be one number, repeated only with the
+    // same value.
+    static size_t parse_content_length(std::string_view head, size_t head_end) {
+        size_t length = 0;
+        bool found = false;
+        size_t line = head.find("\r\n");
+        while (line != std::string::npos && line < head_end) {
+            line += 2;
+            size_t line_end = std::min(head.find("\r\n", line), head_end);
+            std::string_view field = head.substr(line, line_end - line);
+            line = line_end;
+            if (!field.empty() && (field[0] == ' ' || field[0] == '\t')) {
+                throw HttpError(400, "Folded header line");
+            }
+            size_t colon = field.find(':');
+            if (colon == std::string::npos) continue;
+            if (colon > 0 && (field[colon - 1] == ' ' || field[colon - 1] == '\t')) {
+                throw HttpError(400, "Whitespace before a header colon");
+            }
+            std::string_view name = field.substr(0, colon);
+            if (header_name_is(name, "transfer-encoding")) {
+                throw HttpError(501, "Transfer-Encoding is not supported");
+            }
+            if (!header_name_is(name, "content-length")) continue;
+
+            std::string_view value = field.substr(colon + 1);
+            value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+            value = value.substr(0, value.find_last_not_of(" \t") + 1);
+            if (value.empty() || value.size() > 18 || value.find_first_not_of("0123456789") != std::string::npos) {
+                throw HttpError(400, "Invalid Content-Length");
+            }
+            size_t value_length = 0;
+            for (char digit : value) value_length = value_length * 10 + static_cast<size_t>(digit - '0');
+            if (found && value_length != length) {
+                throw HttpError(400, "Conflicting Content-Length");
+            }
+            length = value_length;
+            found = true;
+        }
+        return length;
+    }
+
+    // Compares a header name, in any case, with `name`, given in lower case.
+    static bool header_name_is(std::string_view field_name, std::string_view name) {
+        if (field_name.size() != name.size()) return false;
+        for (size_t i = 0; i < name.size(); i++) {
+            if (std::tolower(static_cast<unsigned char>(field_name[i])) != name[i]) return false;
+        }
+        return true;
+    }
+
+    // Returns false when the connection cannot be reused: the client is gone or a
+    // streamed body ended early.
+    bool send_response(Connection& connection, const std::string& method, Response response) {
+        IoBuffer res;
+        append_response(method, response, res);
+        if (bodyless(method, response)) return connection.send_all(res.data(), res.size());
+        if (response.body_stream) return send_stream(connection, response, res);
+        if (response.body_view.data()) {
+            return connection.send_all(res.data(), res.size(), response.body_view.data(), response.body_view.size());
+        }
+        if (has_file_body(method, response)) {
+            return connection.send_file(response.file_path, response.file_offset, response.file_length, res.data(),
+                                        res.size());
+        }
+        return connection.send_all(res.data(), res.size());
+    }
+
+    // Pieces of a streamed body are collected with the head into sends of at
+    // least stream_flush_size bytes, so small pieces do not each wait on an ACK.
+    static constexpr size_t stream_flush_size = 16 * 1024;
+
+    static bool send_stream(Connection& connection, Response& response, IoBuffer& out) {
+        bool chunked = response.stream_length < 0;
+        uint64_t remaining = chunked ? 0 : static_cast<uint64_t>(response.stream_length);
+        bool ok = response.body_stream([&](const char* data, size_t length) {
+            if (chunked) {
+                if (length == 0) return true;
+                char size[20];
+                int size_length = std::snprintf(size, sizeof(size), "%zx\r\n", length);
+                out.append(size, static_cast<size_t>(size_length));
+            } else {
+                if (length > remaining) return false;
+                remaining -= length;
+            }
+            if (out.size() + length >= stream_flush_size) {
+                if (!connection.send_all(out.data(), out.size()) || !connection.send_all(data, length)) return false;
+                out.clear();
+            } else {
+                out.append(data, length);
+            }
+            if (chunked) out += "\r\n";
+            return true;
+        });
+        if (chunked) out += "0\r\n\r\n";
+        return ok && remaining == 0 && connection.send_all(out.data(), out.size());
+    }
+
+    // 1xx and 304 responses have no body, nor a length for one.
+    static bool lengthless(const Response& response) {
+        return response.status.compare(0, 3, "304") == 0 || response.status[0] == '1';
+    }
+
+    // Whether the response is sent without a body: those that have none, and the
+    // answer to a HEAD request, which describes the body without sending it.
+    static bool bodyless(const std::string& method, const Response& response) {
+        return method == "HEAD" || lengthless(response);
+    }
+
+    // Whether the body still has to be streamed from a file after append_response().
+    static bool has_file_body(const std::string& method, const Response& response) {
+        return !response.file_path.empty() && !bodyless(method, response);
+    }
+
+    // Appends the status line, headers and in-memory body to `out`, a std::string
+    // or an IoBuffer. `method` is the request's.
+    template <typename Buffer>
+    static void append_response(const std::string& method, Response& response, Buffer& out) {
+        if (!lengthless(response)) {
+            if ((response.body_stream && response.stream_length < 0) || !response.event_channel.empty()) {
+                response.header("Transfer-Encoding", "chunked");
+            } else {
+                uint64_t length = response.body_stream ? static_cast<uint64_t>(response.stream_length)
+                                  : response.body_view.data() ? response.body_view.size()
+                                  : response.file_path.empty() ? response.body.size() : response.file_length;
+                response.header("Content-Length", std::to_string(length));
+            }
+        }
+        response.header("X-Powered-By", "Xebec-Server/0.1.0");
+        response.header("Programming-Language", "C++");
+        out += "HTTP/1.1 ";
+        out += response.status;
+        out += response.headers;
+        out += "\r\n";
+        if (!bodyless(method, response)) out += response.body;
+    }
+
+#ifdef XEBEC_HAS_IO_URING
+    // io_uring backend. One thread drives every plain HTTP/1.1 connection through
+    // the ring: multishot accept and recv, receive buffers the kernel picks from a
+    // provided buffer ring, sockets in the registered file table, and static files
+    // sent as linked read -> send chains. Handlers run on config_.thread_pool_size
+    // handler threads, one request per connection at a time, and their responses
+    // come back to the ring through an eventfd. Requests that need a connection of
+    // their own (WebSocket, HTTP/2, coroutine handlers) and responses with a
+    // streamed body are handed to a thread running the blocking path.
+
+    static constexpr unsigned ring_entries = 1024;
+    static constexpr unsigned ring_buffers = 256;
+    static constexpr unsigned ring_buffer_size = 16 * 1024;
+    static constexpr size_t ring_file_chunk = 64 * 1024;
+
+    enum class RingOp : uint32_t { Ignore, Accept, AcceptRetry, Recv, Send, Wake };
+    enum class RingAction { KeepAlive, Close, HandOff };
+
+    // A request going to a handler thread, and its response coming back.
+    struct RingExchange {
+        int fd = -1;
+        std::string request;
+        bool streamed = false;
+        size_t requests_served = 0;     // counting this one
+        std::string remote_addr;
+
+        RingAction action = RingAction::Close;
+        std::string method;
+        Response res;
+    };
+
+    struct RingConnection {
+        int fd = -1;
+        bool fixed = false;             // registered in the file table, at slot `fd`
+        ConnectionState state = ConnectionState::Fresh;
+        bool recv_armed = false;
+        bool sending = false;
+        bool peer_closed = false;
+        bool close_after_send = false;
+        bool closing = false;           // shut down; released once the recv has ended
+        bool handing_off = false;       // recv cancelled; goes to a thread once it has ended
+        bool handling = false;          // a request is with a handler thread; kept until it is back
+        std::unique_ptr<RingExchange> exchange;  // back from the handler, response not queued yet
+        size_t requests_served = 0;
+        std::string remote_addr;
+        IoBuffer in;                    // received, not yet served
+        IoBuffer out;                   // response bytes being sent
+        size_t sent = 0;
+        int file = -1;                  // static file still to be sent after `out`
+        uint64_t file_offset = 0;
+        uint64_t file_remaining = 0;
+        std::chrono::steady_clock::time_point last_active;
+    };
+
+    struct RingLoop {
+        RingLoop(IoUring& loop_ring, SOCKET socket) : ring(loop_ring), listen_socket(socket) {}
+
+        IoUring& ring;
+        SOCKET listen_socket;
+        bool accepting = true;
+        std::unordered_map<int, std::unique_ptr<RingConnection>> connections;
+        __kernel_timespec accept_delay{};
+
+        // Shared with the handler threads.
+        std::mutex mutex;
+        std::condition_variable jobs_cv;
+        std::deque<std::unique_ptr<RingExchange>> jobs;
+        std::vector<std::unique_ptr<RingExchange>> results;
+        bool stopping = false;
+        std::vector<std::thread> handlers;
+        int wake_fd = -1;               // eventfd, written when results were empty
+        uint64_t wake_count = 0;        // the ring's read of wake_fd lands here
+    };
+
+    static uint64_t ring_tag(RingOp op, int fd) {
+        return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    std::unique_ptr<IoUring> create_ring() {
+        if (config_.io_backend != IoBackend::IoUring) return nullptr;
+#ifdef XEBEC_ENABLE_TLS
+        if (tls_) {
+            std::cerr << "The io_uring backend does not do TLS, using threads" << std::endl;
+            return nullptr;
+        }
+#endif
+        unsigned slots = 65536;
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < slots) {
+            slots = static_cast<unsigned>(limit.rlim_cur);
+        }
+        auto ring = std::make_unique<IoUring>();
+        std::string error;
+        if (!ring->init(ring_entries, error)) {
+        } else if (!ring->register_file_slots(slots)) {
+            error = std::string("registered files: ") + std::strerror(errno);
+        } else if (!ring->register_buffer_ring(0, ring_buffers, ring_buffer_size)) {
+            error = std::string("provided buffers: ") + std::strerror(errno);
+        }
+        if (!error.empty()) {
+            std::cerr << "io_uring unavailable (" << error << "), using threads" << std::endl;
+            return nullptr;
+        }
+        return ring;
+    }
+
+    void serve_io_uring(IoUring& ring, SOCKET listen_socket) {
+        RingLoop loop{ring, listen_socket};
+        loop.wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (loop.wake_fd < 0) {
+            std::cerr << "io_uring unavailable (eventfd: " << std::strerror(errno) << "), using threads" << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < std::max<size_t>(config_.thread_pool_size, 1); i++) {
+            loop.handlers.emplace_back(&http_server::ring_handler_thread, this, std::ref(loop));
+        }
+        ring_wait_for_results(loop);
+        ring_accept(loop);
+        auto last_sweep = std::chrono::steady_clock::now();
+        while (loop.accepting || !loop.connections.empty()) {
+            ring.submit(1, 100);
+            ring.for_each_completion([this, &loop](const io_uring_cqe& cqe) { ring_complete(loop, cqe); });
+
+            if (stopping_ && loop.accepting) {
+                loop.accepting = false;
+                io_uring_sqe* sqe = ring.sqe();
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->addr = ring_tag(RingOp::Accept, listen_socket);
+                sqe->user_data = ring_tag(RingOp::Ignore, -1);
+                {
+                    std::lock_guard<std::mutex> lock(connections_mutex_);
+                    listening_ = false;
+                }
+                connections_cv_.notify_all();
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - last_sweep >= std::chrono::seconds(1)) {
+                last_sweep = now;
+                ring_close_idle(loop, now);
+            }
+        }
+        // Flushes the closes queued for the last connections.
+        ring.submit(0, 0);
+
+        // No request is left with the handlers: connections wait for theirs.
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            loop.stopping = true;
+        }
+        loop.jobs_cv.notify_all();
+        for (std::thread& handler : loop.handlers) handler.join();
+        // The read still queued on the eventfd ends with the ring.
+        ::close(loop.wake_fd);
+    }
+
+    void ring_handler_thread(RingLoop& loop) {
+        std::unique_lock<std::mutex> lock(loop.mutex);
+        while (true) {
+            loop.jobs_cv.wait(lock, [&loop] { return !loop.jobs.empty() || loop.stopping; });
+            if (loop.jobs.empty()) return;
+            std::unique_ptr<RingExchange> exchange = std::move(loop.jobs.front());
+            loop.jobs.pop_front();
+            lock.unlock();
+            ring_respond(*exchange);
+            lock.lock();
+            bool wake = loop.results.empty();
+            loop.results.push_back(std::move(exchange));
+            if (wake) {
+                uint64_t one = 1;
+                ssize_t written = ::write(loop.wake_fd, &one, sizeof(one));
+                (void)written;
+            }
+        }
+    }
+
+    void ring_wait_for_results(RingLoop& loop) {
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = loop.wake_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&loop.wake_count);
+        sqe->len = sizeof(loop.wake_count);
+        sqe->user_data = ring_tag(RingOp::Wake, -1);
+    }
+
+    // Responses back from the handler threads.
+    void ring_collect(RingLoop& loop) {
+        std::vector<std::unique_ptr<RingExchange>> results;
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            results.swap(loop.results);
+        }
+        ring_wait_for_results(loop);
+        for (std::unique_ptr<RingExchange>& exchange : results) {
+            RingConnection& c = *loop.connections.at(exchange->fd);
+            c.handling = false;
+            c.exchange = std::move(exchange);
+            if (c.closing) {
+                if (!c.recv_armed) ring_release(loop, c);
+            } else if (!c.sending) {
+                ring_process(loop, c);
+            }
+        }
+    }
+
+    void ring_complete(RingLoop& loop, const io_uring_cqe& cqe) {
+        RingOp op = static_cast<RingOp>(cqe.user_data >> 32);
+        int fd = static_cast<int>(cqe.user_data & 0xFFFFFFFF);
+        if (op == RingOp::Accept) {
+            ring_accepted(loop, cqe);
+            return;
+        }
+        if (op == RingOp::AcceptRetry) {
+            if (loop.accepting) ring_accept(loop);
+            return;
+        }
+        if (op == RingOp::Wake) {
+            ring_collect(loop);
+            return;
+        }
+        auto it = loop.connections.find(fd);
+        if (it == loop.connections.end() || op == RingOp::Ignore) return;
+        if (op == RingOp::Recv) {
+            ring_received(loop, *it->second, cqe);
+        } else {
+            ring_sent(loop, *it->second, cqe);
+        }
+    }
+
+    void ring_accept(RingLoop& loop) {
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = loop.listen_socket;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = ring_tag(RingOp::Accept, loop.listen_socket);
+    }
+
+    // An accept that fails for want of descriptors or memory would fail again at
+    // once, so it is retried after a timeout instead.
+    void ring_accept_later(RingLoop& loop) {
+        loop.accept_delay.tv_sec = 0;
+        loop.accept_delay.tv_nsec = 10 * 1000000LL;
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&loop.accept_delay);
+        sqe->len = 1;
+        sqe->user_data = ring_tag(RingOp::AcceptRetry, -1);
+    }
+
+    void ring_accepted(RingLoop& loop, const io_uring_cqe& cqe) {
+        bool rearm = !(cqe.flags & IORING_CQE_F_MORE) && loop.accepting;
+        if (cqe.res < 0) {
+            if (cqe.res != -ECANCELED && cqe.res != -EAGAIN && cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+                std::cerr << "accept failed: " << -cqe.res << std::endl;
+                if (rearm) ring_accept_later(loop);
+            } else if (rearm) {
+                ring_accept(loop);
+            }
+            return;
+        }
+        if (rearm) ring_accept(loop);
+
+        int fd = cqe.res;
+        if (!loop.accepting) {
+            ::close(fd);
+            return;
+        }
+        set_socket_nodelay(fd);
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connections_[fd] = ConnectionState::Fresh;
+        }
+        auto connection = std::make_unique<RingConnection>();
+        RingConnection& c = *connection;
+        c.fd = fd;
+        c.fixed = static_cast<unsigned>(fd) < loop.ring.file_slots();
+        c.remote_addr = peer_address(fd);
+        if (!hooks_.connection.empty()) {
+            ConnectionInfo info{static_cast<uint64_t>(fd), c.remote_addr, false};
+            for (Plugin* plugin : hooks_.connection) plugin->on_connection(info);
+        }
+        c.last_active = std::chrono::steady_clock::now();
+        loop.connections[fd] = std::move(connection);
+
+        if (c.fixed) {
+            // Slot `fd` of the file table, linked so the recv below already uses it.
+            io_uring_sqe* sqe = loop.ring.sqe();
+            sqe->opcode = IORING_OP_FILES_UPDATE;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&c.fd);
+            sqe->len = 1;
+            sqe->off = static_cast<uint64_t>(fd);
+            sqe->flags = IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS;
+            sqe->user_data = ring_tag(RingOp::Ignore, fd);
+        }
+        ring_receive(loop, c);
+    }
+
+    void ring_receive(RingLoop& loop, RingConnection& c) {
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = c.fd;
+        sqe->flags = IOSQE_BUFFER_SELECT | (c.fixed ? IOSQE_FIXED_FILE : 0);
+        sqe->buf_group = 0;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->user_data = ring_tag(RingOp::Recv, c.fd);
+        c.recv_armed = true;
+    }
+
+    void ring_received(RingLoop& loop, RingConnection& c, const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE)) c.recv_armed = false;
+        if (cqe.res > 0) {
+            uint16_t id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            c.in.append(loop.ring.buffer(id), static_cast<size_t>(cqe.res));
+            loop.ring.recycle_buffer(id);
+            c.last_active = std::chrono::steady_clock::now();
+        } else if (cqe.res != -ENOBUFS) {
+            c.peer_closed = true;
+        }
+
+        if (c.recv_armed) {
+            if (!c.sending && !c.closing && !c.handing_off) ring_process(loop, c);
+            return;
+        }
+        // The multishot recv has ended.
+        if (c.handing_off) {
+            ring_hand_off(loop, c);
+        } else if (c.closing) {
+            ring_release(loop, c);
+        } else {
+            // Re-armed when the provided buffers ran out.
+            if (!c.peer_closed) ring_receive(loop, c);
+            if (!c.sending) ring_process(loop, c);
+        }
+    }
+
+    // Serves the complete requests in `c.in`, one at a time: each goes to a
+    // handler thread, and responses queued meanwhile are sent. A file body ends
+    // the batch.
+    void ring_process(RingLoop& loop, RingConnection& c) {
+        if (!c.in.empty()) ring_set_state(c, ConnectionState::Busy);
+        while (c.file < 0 && !c.close_after_send && !c.handling) {
+            if (c.exchange) {
+                RingExchange& exchange = *c.exchange;
+                if (exchange.action != RingAction::HandOff) {
+                    if (exchange.res.body_stream && !c.out.empty()) break;
+                    c.in.consume(exchange.request.size());
+                    c.requests_served++;
+                }
+                // A streamed body is sent by the connection thread, instead of being collected here.
+                if (exchange.action == RingAction::HandOff || exchange.res.body_stream) {
+                    // Responses already queued go out first.
+                    if (c.out.empty()) {
+                        ring_start_hand_off(loop, c);
+                        return;
+                    }
+                    break;
+                }
+                append_response(exchange.method, exchange.res, c.out);
+                // Sends go out of `out`, so a viewed body is copied in behind the head.
+                if (exchange.res.body_view.data() && !bodyless(exchange.method, exchange.res)) {
+                    c.out += exchange.res.body_view;
+                }
+                if (exchange.action == RingAction::Close) c.close_after_send = true;
+                if (has_file_body(exchange.method, exchange.res) && exchange.res.file_length > 0) {
+                    c.file = ::open(exchange.res.file_path.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (c.file < 0) {
+                        // The head promising the body is queued, so the connection cannot continue.
+                        c.close_after_send = true;
+                    } else {
+                        c.file_offset = exchange.res.file_offset;
+                        c.file_remaining = exchange.res.file_length;
+                    }
+                }
+                c.exchange.reset();
+                continue;
+            }
+
+            size_t length = 0;
+            bool streamed = false;
+            try {
+                length = complete_request_length(c.in.view(), streamed);
+            } catch (const HttpError& e) {
+                std::cerr << "HTTP Error: " << e.what() << std::endl;
+                Request req;
+                Response res(publicDirPath);
+                if (error_handler_) {
+                    error_handler_(e, req, res);
+                } else {
+                    default_error_handler(e, res);
+                }
+                res.header("Connection", "close");
+                responding(req, res);
+                append_response(req.method, res, c.out);
+                c.close_after_send = true;
+                break;
+            }
+            if (length == 0) break;
+
+            auto exchange = std::make_unique<RingExchange>();
+            exchange->fd = c.fd;
+            exchange->request.assign(c.in.data(), length);
+            exchange->streamed = streamed;
+            exchange->requests_served = c.requests_served + 1;
+            exchange->remote_addr = c.remote_addr;
+            c.handling = true;
+            {
+                std::lock_guard<std::mutex> lock(loop.mutex);
+                loop.jobs.push_back(std::move(exchange));
+            }
+            loop.jobs_cv.notify_one();
+        }
+
+        // Connections without unserved bytes hold no receive buffer.
+        if (c.in.empty()) c.in.release();
+        if (!c.out.empty()) {
+            ring_send(loop, c);
+        } else if (c.handling) {
+            // ring_collect() continues once the handler is done.
+        } else if (c.close_after_send || c.peer_closed) {
+            ring_close(loop, c);
+        } else if (c.in.empty()) {
+            ring_set_state(c, ConnectionState::Idle);
+        }
+    }
+
+    // One request on a handler thread: serve_request() without the cases that
+    // need a connection thread, which are reported as HandOff. The request's
+    // method decides whether the body is sent.
+    void ring_respond(RingExchange& exchange) {
+        Request req;
+        Response& res = exchange.res;
+        res = Response(publicDirPath);
+        bool keep_alive = false;
+        RequestTrace trace;
+        try {
+            TraceSpan parse_span("parse_request", TraceEvent::Kind::Phase);
+            parse_request(exchange.request, req);
+            parse_span.end();
+            trace.describe(req.method, req.path);
+            req.remote_addr = exchange.remote_addr;
+            if (exchange.streamed || needs_connection_thread(req)) {
+                exchange.action = RingAction::HandOff;
+                return;
+            }
+            request_parsed(req, exchange.request);
+            if (config_.log_requests) {
+                std::cout << "Raw request:\n" << exchange.request << std::endl;
+                std::cout << "Parsed request - Method: " << req.method << ", Path: " << req.path << std::endl;
+            }
+
+            keep_alive = wants_keep_alive(req) && exchange.requests_served < config_.max_keep_alive_requests &&
+                         !stopping_;
+            res = dispatch(req);
+            if (config_.log_requests) std::cout << "Response body length: " << res.body.length() << std::endl;
+        }
+        catch (const HttpError& e) {
+            std::cerr << "HTTP Error: " << e.what() << std::endl;
+            res = Response(publicDirPath);
+            if (error_handler_) {
+                error_handler_(e, req, res);
+            } else {
+                default_error_handler(e, res);
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Exception: " << e.what() << std::endl;
+            res = Response(publicDirPath);
+            default_error_handler(HttpError(500, e.what()), res);
+            keep_alive = false;
+        }
+        if (!keep_alive || stopping_) res.header("Connection", "close");
+        responding(req, res);
+        exchange.method = req.method;
+        exchange.action = keep_alive && !stopping_ ? RingAction::KeepAlive : RingAction::Close;
+    }
+
+    // Upgrades, event streams and coroutine handlers hold on to the connection,
+    // as do streamed bodies.
+    bool needs_connection_thread(const Request& req) {
+        if (req.has_header("Upgrade") || req.method == "PRI") return true;
+        if (req.method == "GET") {
+            for (const auto& route : sse_routes_) {
+                if (std::regex_match(req.path, route)) return true;
+            }
+        }
+#ifdef XEBEC_HAS_COROUTINES
+        auto async_routes = async_routes_.find(req.method);
+        if (async_routes != async_routes_.end()) {
+            for (const auto& route : async_routes->second) {
+                if (std::regex_match(req.path, std::regex(route.first))) return true;
+            }
+        }
+#endif
+        return false;
+    }
+
+    void ring_send(RingLoop& loop, RingConnection& c) {
+        c.sending = true;
+        c.sent = 0;
+        if (c.file < 0) {
+            ring_send_bytes(loop, c);
+            return;
+        }
+        // The file chunk is read in behind the bytes already queued, and the send
+        // is linked to the read: one submission, one completion, no copy through
+        // user space beyond the read itself.
+        // The first chunk fits in one 64 KB pooled block together with the head.
+        size_t room = c.out.size() < ring_file_chunk ? ring_file_chunk - c.out.size() : ring_file_chunk;
+        size_t chunk = c.file_remaining < room ? static_cast<size_t>(c.file_remaining) : room;
+        char* space = c.out.prepare(chunk);
+        c.out.commit(chunk);
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = c.file;
+        sqe->addr = reinterpret_cast<uint64_t>(space);
+        sqe->len = static_cast<uint32_t>(chunk);
+        sqe->off = c.file_offset;
+        sqe->flags = IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = ring_tag(RingOp::Ignore, c.fd);
+        c.file_offset += chunk;
+        c.file_remaining -= chunk;
+        // A short or failed read cancels the send, which then closes the connection.
+        ring_send_bytes(loop, c);
+    }
+
+    void ring_send_bytes(RingLoop& loop, RingConnection& c) {
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = c.fd;
+        sqe->flags = c.fixed ? IOSQE_FIXED_FILE : 0;
+        sqe->addr = reinterpret_cast<uint64_t>(c.out.data() + c.sent);
+        sqe->len = static_cast<uint32_t>(c.out.size() - c.sent);
+        sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+        sqe->user_data = ring_tag(RingOp::Send, c.fd);
+    }
+
+    void ring_sent(RingLoop& loop, RingConnection& c, const io_uring_cqe& cqe) {
+        if (cqe.res <= 0) {
+            c.sending = false;
+            ring_close(loop, c);
+            return;
+        }
+        c.sent += static_cast<size_t>(cqe.res);
+        if (c.sent < c.out.size()) {
+            ring_send_bytes(loop, c);
+            return;
+        }
+        c.out.release();
+        c.last_active = std::chrono::steady_clock::now();
+        if (c.file >= 0) {
+            if (c.file_remaining > 0) {
+                ring_send(loop, c);
+                return;
+            }
+            ring_close_fd(loop, c.file);
+            c.file = -1;
+        }
+        c.sending = false;
+        if (c.close_after_send) {
+            ring_close(loop, c);
+        } else {
+            ring_process(loop, c);
+        }
+    }
+
+    void ring_set_state(RingConnection& c, ConnectionState state) {
+        if (c.state == state) return;
+        c.state = state;
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        auto& shared_state = connections_[c.fd];
+        if (shared_state != ConnectionState::Closing) shared_state = state;
+    }
+
+    // Keep-alive timeout, checked about once a second.
+    void ring_close_idle(RingLoop& loop, std::chrono::steady_clock::time_point now) {
+        auto timeout = std::chrono::milliseconds(config_.keep_alive_timeout_ms);
+        std::vector<RingConnection*> expired;
+        for (auto& entry : loop.connections) {
+            RingConnection& c = *entry.second;
+            if (!c.sending && !c.closing && !c.handing_off && !c.handling && now - c.last_active >= timeout) {
+                expired.push_back(&c);
+            }
+        }
+        for (RingConnection* c : expired) ring_close(loop, *c);
+    }
+
+    // Shuts the socket down, which ends the multishot recv; the connection is
+    // released when that completion arrives.
+    void ring_close(RingLoop& loop, RingConnection& c) {
+        if (c.closing) return;
+        c.closing = true;
+        if (c.file >= 0) {
+            ring_close_fd(loop, c.file);
+            c.file = -1;
+        }
+        if (!c.recv_armed) {
+            ring_release(loop, c);
+            return;
+        }
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_SHUTDOWN;
+        sqe->fd = c.fd;
+        sqe->flags = (c.fixed ? IOSQE_FIXED_FILE : 0) | IOSQE_CQE_SKIP_SUCCESS;
+        sqe->len = SHUT_RDWR;
+        sqe->user_data = ring_tag(RingOp::Ignore, c.fd);
+    }
+
+    void ring_release(RingLoop& loop, RingConnection& c) {
+        // ring_collect() releases it once the handler is done.
+        if (c.handling) return;
+        int fd = c.fd;
+        if (!hooks_.close.empty()) {
+            ConnectionInfo info{static_cast<uint64_t>(fd), c.remote_addr, false};
+            for (Plugin* plugin : hooks_.close) plugin->on_close(info);
+        }
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connections_.erase(fd);
+        }
+        connections_cv_.notify_all();
+        // The slot is cleared before the descriptor number can be reused.
+        if (c.fixed) ring_clear_slot(loop, fd, true);
+        ring_close_fd(loop, fd);
+        loop.connections.erase(fd);
+    }
+
+    void ring_start_hand_off(RingLoop& loop, RingConnection& c) {
+        c.handing_off = true;
+        if (!c.recv_armed) {
+            ring_hand_off(loop, c);
+            return;
+        }
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = ring_tag(RingOp::Recv, c.fd);
+        sqe->user_data = ring_tag(RingOp::Ignore, c.fd);
+    }
+
+    // The connection continues on the blocking path, starting with the bytes received so
+    // far, or with sending the streamed response of the handler thread.
+    void ring_hand_off(RingLoop& loop, RingConnection& c) {
+        int fd = c.fd;
+        if (c.fixed) ring_clear_slot(loop, fd, false);
+        IoBuffer buffer = std::move(c.in);
+        size_t requests_served = c.requests_served;
+        std::unique_ptr<RingExchange> exchange = std::move(c.exchange);
+        if (exchange && exchange->action == RingAction::HandOff) exchange.reset();
+        auto connection = std::make_unique<Connection>(fd, std::move(c.remote_addr));
+        loop.connections.erase(fd);
+        mark_busy(fd);
+        spawn_connection_thread([this, connection = std::move(connection), buffer = std::move(buffer),
+                                 requests_served, exchange = std::move(exchange)]() mutable {
+            if (exchange && !(send_response(*connection, exchange->method, exchange->res) &&
+                              exchange->action == RingAction::KeepAlive)) {
+                close_connection(*connection);
+                return;
+            }
+            serve_connection(std::move(connection), std::move(buffer), requests_served);
+        });
+    }
+
+    static void ring_clear_slot(RingLoop& loop, int slot, bool link) {
+        static const int no_file = -1;
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_FILES_UPDATE;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&no_file);
+        sqe->len = 1;
+        sqe->off = static_cast<uint64_t>(slot);
+        sqe->flags = (link ? IOSQE_IO_LINK : 0) | IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = ring_tag(RingOp::Ignore, -1);
+    }
+
+    static void ring_close_fd(RingLoop& loop, int fd) {
+        io_uring_sqe* sqe = loop.ring.sqe();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fd;
+        sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+        sqe->user_data = ring_tag(RingOp::Ignore, -1);
+    }
+#endif
+
+    static bool would_block() {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED;
+#endif
+    }
+
+    static void set_blocking(SOCKET socket, bool blocking) {
+        set_socket_blocking(socket, blocking);
+    }
+
+    static void set_cloexec(SOCKET socket) {
+#ifndef _WIN32
+        fcntl(socket, F_SETFD, fcntl(socket, F_GETFD) | FD_CLOEXEC);
+#else
+        (void)socket;
+#endif
+    }
+
+    // A listening socket handed over by upgrade() in the previous process.
+    static SOCKET inherited_listen_socket() {
+#ifndef _WIN32
+        const char* fd = std::getenv("XEBEC_LISTEN_FD");
+        if (fd) {
+            int socket = std::atoi(fd);
+            unsetenv("XEBEC_LISTEN_FD");
+            if (socket > 0) return socket;
+        }
+#endif
+        return INVALID_SOCKET;
+    }
+
+    // Tells the process that started us through upgrade() that we are accepting.
+    static void notify_ready() {
+#ifndef _WIN32
+        const char* fd = std::getenv("XEBEC_READY_FD");
+        if (fd) {
+            int ready_fd = std::atoi(fd);
+            unsetenv("XEBEC_READY_FD");
+            if (ready_fd > 0) {
+                if (write(ready_fd, "1", 1) < 0) {
+                    std::cerr << "Failed to signal readiness: " << errno << std::endl;
+                }
+                close(ready_fd);
+            }
+        }
+#endif
+    }
+
+    std::string generate_websocket_accept(const std::string& key) {
+        char accept[28];
+        websocket_accept_key(key.data(), key.size(), accept);
+        return std::string(accept, sizeof(accept));
+    }
+    
+
+    void handle_websocket(const Request& req, Connection& connection) {
+        std::string key = req.get_header("Sec-WebSocket-Key");
+        if (key.empty()) {
+            throw HttpError(400, "Invalid WebSocket request");
         }
 
         std::string accept_key = generate_websocket_accept(key);
@@ -377,38 +2244,46 @@ private:
            .header("Upgrade", "websocket")
            .header("Connection", "Upgrade") // Ensure 'Upgrade' is capitalized
            .header("Sec-WebSocket-Accept", accept_key);
-        send_response(client_socket, res);
+        send_response(connection, req.method, res);
 
+        // One frame is read into for the whole connection, so its payload is
+        // allocated again only for a frame larger than any before.
+        WebSocketFrame frame{};
         while (true) {
             try {
-                WebSocketFrame frame = read_websocket_frame(client_socket);
-                
+                read_websocket_frame(connection, frame);
+                for (Plugin* plugin : hooks_.ws_frame) plugin->on_ws_frame(req, frame);
+
                 switch (frame.opcode) {
                     case WSOpCode::CLOSE:
                         return;
                     case WSOpCode::PING:
                         frame.opcode = WSOpCode::PONG;
-                        send_websocket_frame(client_socket, frame);
+                        send_websocket_frame(connection, frame);
                         break;
                     default:
                         auto it = ws_handlers_.find(req.path);
                         if (it != ws_handlers_.end()) {
-                            it->second(frame, [client_socket](const WebSocketFrame& response_frame) {
-                                send_websocket_frame(client_socket, response_frame);
+                            it->second(frame, [&connection](const WebSocketFrame& response_frame) {
+                                send_websocket_frame(connection, response_frame);
                             });
                         }
                 }
-                
+                // A connection keeps no more than a pooled block's worth between frames.
+                if (frame.payload.capacity() > BufferPool::class_sizes[BufferPool::class_count - 1]) {
+                    std::vector<uint8_t>().swap(frame.payload);
+                }
             } catch (const std::exception& e) {
                 break;
             }
         }
     }
 
-    WebSocketFrame read_websocket_frame(SOCKET socket) {
-        WebSocketFrame frame{};
+    void read_websocket_frame(Connection& connection, WebSocketFrame& frame) {
         unsigned char header[2];
-        recv(socket, reinterpret_cast<char*>(header), 2, 0);
+        if (!connection.recv_all(reinterpret_cast<char*>(header), 2)) {
+            throw std::runtime_error("WebSocket connection closed");
+        }
         
         frame.fin = (header[0] & 0x80) != 0;
         frame.rsv1 = (header[0] & 0x40) != 0;
@@ -418,13 +2293,14 @@ private:
         frame.mask = (header[1] & 0x80) != 0;
         frame.payload_length = header[1] & 0x7F;
 
+        bool ok = true;
         if (frame.payload_length == 126) {
             uint16_t length;
-            recv(socket, reinterpret_cast<char*>(&length), 2, 0);
+            ok = connection.recv_all(reinterpret_cast<char*>(&length), 2);
             frame.payload_length = ntohs(length);
         } else if (frame.payload_length == 127) {
             uint64_t length;
-            recv(socket, reinterpret_cast<char*>(&length), 8, 0);
+            ok = connection.recv_all(reinterpret_cast<char*>(&length), 8);
             length = ((length & 0xFF00000000000000ull) >> 56) |
                     ((length & 0x00FF000000000000ull) >> 40) |
                     ((length & 0x0000FF0000000000ull) >> 24) |
@@ -435,33 +2311,58 @@ private:
                     ((length & 0x00000000000000FFull) << 56);
             frame.payload_length = length;
         }
+        if (ok && frame.payload_length > config_.max_request_size) {
+            throw std::runtime_error("WebSocket frame too large");
+        }
 
-        if (frame.mask) {
-            recv(socket, reinterpret_cast<char*>(frame.masking_key), 4, 0);
+        if (ok && frame.mask) {
+            ok = connection.recv_all(reinterpret_cast<char*>(frame.masking_key), 4);
         }
 
         frame.payload.resize(frame.payload_length);
-        if (frame.payload_length > 0) {
-            recv(socket, reinterpret_cast<char*>(frame.payload.data()), frame.payload_length, 0);
+        if (ok && frame.payload_length > 0) {
+            ok = connection.recv_all(reinterpret_cast<char*>(frame.payload.data()), frame.payload_length);
             if (frame.mask) {
                 for (size_t i = 0; i < frame.payload_length; ++i) {
                     frame.payload[i] ^= frame.masking_key[i % 4];
                 }
             }
         }
+        if (!ok) {
+            throw std::runtime_error("WebSocket connection closed");
+        }
+    }
 
-        return frame;
+    static std::string websocket_frame_header(const WebSocketFrame& frame) {
+        std::string header(1, static_cast<char>((frame.fin << 7) | static_cast<uint8_t>(frame.opcode)));
+        uint64_t length = frame.payload.size();
+        if (length < 126) {
+            header += static_cast<char>(length);
+        } else if (length <= 0xFFFF) {
+            header += static_cast<char>(126);
+            header += static_cast<char>((length >> 8) & 0xFF);
+            header += static_cast<char>(length & 0xFF);
+        } else {
+            header += static_cast<char>(127);
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                header += static_cast<char>((length >> shift) & 0xFF);
+            }
+        }
+        return header;
     }
 
     public:
+    static void send_websocket_frame(Connection& connection, const WebSocketFrame& frame) {
+        std::string header = websocket_frame_header(frame);
+        connection.send_all(header.data(), header.size(),
+                            reinterpret_cast<const char*>(frame.payload.data()), frame.payload.size());
+    }
+
     static void send_websocket_frame(SOCKET socket, const WebSocketFrame& frame) {
-        char header[2] = {
-            static_cast<char>((frame.fin << 7) | static_cast<uint8_t>(frame.opcode)),
-            static_cast<char>(frame.payload.size() & 0x7F)
-        };
-        send(socket, header, 2, 0);
+        std::string header = websocket_frame_header(frame);
+        send(socket, header.data(), static_cast<int>(header.size()), 0);
         if (!frame.payload.empty()) {
-            send(socket, reinterpret_cast<const char*>(frame.payload.data()), frame.payload.size(), 0);
+            send(socket, reinterpret_cast<const char*>(frame.payload.data()), static_cast<int>(frame.payload.size()), 0);
         }
     }
 };
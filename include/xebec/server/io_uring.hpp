@@ -0,0 +1,232 @@
+#pragma once
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+// Multishot recv is the newest feature used here (Linux 6.0 headers).
+#ifdef IORING_RECV_MULTISHOT
+#define XEBEC_HAS_IO_URING 1
+#endif
+#endif
+
+#ifdef XEBEC_HAS_IO_URING
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+#include <sys/eventfd.h>
+
+namespace xebec {
+
+// A minimal io_uring: the raw syscalls and ring bookkeeping the server needs,
+// so there is no dependency on liburing. Submission and completion happen on
+// one thread.
+class IoUring {
+public:
+    IoUring() = default;
+
+    ~IoUring() {
+        if (buffer_ring_) munmap(buffer_ring_, buffer_ring_bytes_);
+        if (sqes_) munmap(sqes_, sqes_bytes_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_bytes_);
+        if (sq_ptr_) munmap(sq_ptr_, sq_bytes_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Creates the ring. On failure `error` says why, e.g. when the kernel lacks
+    // io_uring or it is disabled by policy.
+    bool init(unsigned entries, std::string& error) {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL |
+                       IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+        params.cq_entries = entries * 4;
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0 && errno == EINVAL) {
+            // Kernels before 6.1 know neither single-issuer nor deferred task work.
+            params = io_uring_params{};
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = entries * 4;
+            fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        }
+        if (fd_ < 0) {
+            error = std::string("io_uring_setup: ") + std::strerror(errno);
+            return false;
+        }
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) ||
+            !(params.features & IORING_FEAT_NODROP)) {
+            error = "kernel io_uring is too old";
+            return false;
+        }
+
+        sq_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (cq_bytes_ > sq_bytes_) sq_bytes_ = cq_bytes_;
+        sq_ptr_ = map(sq_bytes_, IORING_OFF_SQ_RING);
+        cq_ptr_ = sq_ptr_;
+        sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_bytes_, IORING_OFF_SQES));
+        if (!sq_ptr_ || !sqes_) {
+            error = std::string("io_uring mmap: ") + std::strerror(errno);
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        // Slots are filled in order, so the index array is the identity.
+        unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        for (unsigned i = 0; i < sq_entries_; i++) array[i] = i;
+        sqe_tail_ = *sq_tail_;
+
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Whether this kernel can run the server's ring at all.
+    static bool supported() {
+        IoUring ring;
+        std::string error;
+        return ring.init(8, error) && ring.register_file_slots(8) && ring.register_buffer_ring(0, 8, 64);
+    }
+
+    // A zeroed submission entry. When the queue is full it is flushed first.
+    io_uring_sqe* sqe() {
+        if (sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            submit(0, 0);
+        }
+        io_uring_sqe* entry = &sqes_[sqe_tail_ & sq_mask_];
+        std::memset(entry, 0, sizeof(*entry));
+        sqe_tail_++;
+        return entry;
+    }
+
+    // Submits queued entries and waits for at least `wait` completions, or
+    // `timeout_ms` at most. Completions are always reaped into the queue, which
+    // deferred task work depends on.
+    int submit(unsigned wait, int timeout_ms) {
+        unsigned pending = sqe_tail_ - *sq_tail_;
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        __kernel_timespec timeout{};
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+        io_uring_getevents_arg arg{};
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = timeout_ms >= 0 && wait > 0 ? reinterpret_cast<uint64_t>(&timeout) : 0;
+        int result = static_cast<int>(syscall(__NR_io_uring_enter, fd_, pending, wait,
+                                              IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                                              &arg, sizeof(arg)));
+        return result < 0 ? -errno : result;
+    }
+
+    // Calls `handle(cqe)` for each completion that is ready. Each entry is
+    // released before its handler runs, so handlers can submit more work.
+    template <typename Handler>
+    void for_each_completion(Handler&& handle) {
+        unsigned head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = cqes_[head & cq_mask_];
+            __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+            handle(cqe);
+        }
+    }
+
+    // An empty table of `count` registered files. Sockets are placed in it with
+    // IORING_OP_FILES_UPDATE, so later operations skip the per-call fd lookup.
+    bool register_file_slots(unsigned count) {
+        io_uring_rsrc_register files{};
+        files.nr = count;
+        files.flags = IORING_RSRC_REGISTER_SPARSE;
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_FILES2, &files, sizeof(files)) < 0) {
+            return false;
+        }
+        file_slots_ = count;
+        return true;
+    }
+
+    unsigned file_slots() const { return file_slots_; }
+
+    // A provided buffer ring: `count` buffers of `size` bytes that the kernel picks
+    // from when data arrives, so idle connections own no receive buffer.
+    // `count` must be a power of two.
+    bool register_buffer_ring(uint16_t group, unsigned count, unsigned size) {
+        buffer_ring_bytes_ = count * sizeof(io_uring_buf);
+        void* ring = mmap(nullptr, buffer_ring_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED) return false;
+        buffer_ring_ = static_cast<io_uring_buf_ring*>(ring);
+
+        io_uring_buf_reg registration{};
+        registration.ring_addr = reinterpret_cast<uint64_t>(ring);
+        registration.ring_entries = count;
+        registration.bgid = group;
+        if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+            return false;
+        }
+
+        buffers_.reset(new char[static_cast<size_t>(count) * size]);
+        buffer_size_ = size;
+        buffer_mask_ = count - 1;
+        for (unsigned id = 0; id < count; id++) recycle_buffer(static_cast<uint16_t>(id));
+        return true;
+    }
+
+    const char* buffer(uint16_t id) const { return buffers_.get() + static_cast<size_t>(id) * buffer_size_; }
+
+    // Hands a consumed buffer back to the kernel.
+    void recycle_buffer(uint16_t id) {
+        io_uring_buf* entries = reinterpret_cast<io_uring_buf*>(buffer_ring_);
+        io_uring_buf& entry = entries[buffer_tail_ & buffer_mask_];
+        entry.addr = reinterpret_cast<uint64_t>(buffer(id));
+        entry.len = buffer_size_;
+        entry.bid = id;
+        __atomic_store_n(&buffer_ring_->tail, ++buffer_tail_, __ATOMIC_RELEASE);
+    }
+
+private:
+    int fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_bytes_ = 0;
+    size_t cq_bytes_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_bytes_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned file_slots_ = 0;
+    io_uring_buf_ring* buffer_ring_ = nullptr;
+    size_t buffer_ring_bytes_ = 0;
+    std::unique_ptr<char[]> buffers_;
+    unsigned buffer_size_ = 0;
+    unsigned buffer_mask_ = 0;
+    uint16_t buffer_tail_ = 0;
+
+    void* map(size_t length, off_t offset) {
+        void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+};
+
+} // namespace xebec
+
+#endif // XEBEC_HAS_IO_URING
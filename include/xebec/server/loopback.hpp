@@ -0,0 +1,150 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include "connection.hpp"
+
+namespace xebec {
+
+// The two byte streams between a LoopbackClient and the server end of its
+// connection.
+struct LoopbackStreams {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> input;      // written by the client, one entry per write()
+    size_t input_offset = 0;            // into input.front()
+    bool input_finished = false;
+    std::string output;                 // sent by the server, not yet read
+    bool closed = false;                // by the server
+};
+
+// The server end of a LoopbackClient's connection.
+class LoopbackTransport : public Transport {
+public:
+    explicit LoopbackTransport(std::shared_ptr<LoopbackStreams> streams) : streams_(std::move(streams)) {}
+
+    // Returns what is left of one write() at most, so fragments reach the
+    // server as they were written.
+    int recv(char* buffer, size_t length) override {
+        std::unique_lock<std::mutex> lock(streams_->mutex);
+        streams_->changed.wait(lock, [this] { return !streams_->input.empty() || streams_->input_finished; });
+        if (streams_->input.empty()) return 0;
+        const std::string& fragment = streams_->input.front();
+        size_t count = std::min(length, fragment.size() - streams_->input_offset);
+        std::memcpy(buffer, fragment.data() + streams_->input_offset, count);
+        streams_->input_offset += count;
+        if (streams_->input_offset == fragment.size()) {
+            streams_->input.pop_front();
+            streams_->input_offset = 0;
+        }
+        return static_cast<int>(count);
+    }
+
+    int send(const char* data, size_t length) override {
+        {
+            std::lock_guard<std::mutex> lock(streams_->mutex);
+            if (streams_->closed) return -1;
+            streams_->output.append(data, length);
+        }
+        streams_->changed.notify_all();
+        return static_cast<int>(length);
+    }
+
+    bool wait_readable(int timeout_ms) override {
+        std::unique_lock<std::mutex> lock(streams_->mutex);
+        auto ready = [this] { return !streams_->input.empty() || streams_->input_finished; };
+        if (timeout_ms < 0) {
+            streams_->changed.wait(lock, ready);
+            return true;
+        }
+        return streams_->changed.wait_for(lock, std::chrono::milliseconds(timeout_ms), ready);
+    }
+
+    void close() override {
+        {
+            std::lock_guard<std::mutex> lock(streams_->mutex);
+            streams_->closed = true;
+        }
+        streams_->changed.notify_all();
+    }
+
+private:
+    std::shared_ptr<LoopbackStreams> streams_;
+};
+
+// An in-process client: requests written here go through the server's real
+// parsing, routing and serialization, without a socket, and the response
+// bytes are collected here.
+//
+//     xebec::LoopbackClient client;
+//     client.write("GET /users/7 HTTP/1.1\r\nHost: localhost\r\n\r\n");
+//     client.finish();                    // no more requests
+//     server.serve(client.connect());     // returns once the server has closed the connection
+//     std::string responses = client.read();
+//
+// Each write() reaches the server as a recv() of its own: a request split
+// over several writes arrives fragmented, several requests in one write
+// arrive pipelined. The server may also serve the connection on another
+// thread while the client writes and reads.
+class LoopbackClient {
+public:
+    LoopbackClient() : streams_(std::make_shared<LoopbackStreams>()) {}
+
+    // The server end of the connection, for http_server::serve().
+    std::unique_ptr<Connection> connect(std::string remote_addr = "127.0.0.1") {
+        return std::make_unique<Connection>(std::make_unique<LoopbackTransport>(streams_), std::move(remote_addr));
+    }
+
+    void write(std::string_view bytes) {
+        if (bytes.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(streams_->mutex);
+            streams_->input.emplace_back(bytes);
+        }
+        streams_->changed.notify_all();
+    }
+
+    // Ends the input, as a client that shuts down its sending side. The server
+    // closes the connection once it has answered what was written.
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(streams_->mutex);
+            streams_->input_finished = true;
+        }
+        streams_->changed.notify_all();
+    }
+
+    // Takes the bytes the server has sent so far.
+    std::string read() {
+        std::lock_guard<std::mutex> lock(streams_->mutex);
+        std::string output;
+        output.swap(streams_->output);
+        return output;
+    }
+
+    // Waits until the unread bytes contain `needle`. False if the server closes
+    // the connection or `timeout` passes first.
+    bool wait_for(std::string_view needle, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+        std::unique_lock<std::mutex> lock(streams_->mutex);
+        return streams_->changed.wait_for(lock, timeout, [&] {
+            return streams_->output.find(needle) != std::string::npos || streams_->closed;
+        }) && streams_->output.find(needle) != std::string::npos;
+    }
+
+    // Whether the server has closed the connection.
+    bool closed() {
+        std::lock_guard<std::mutex> lock(streams_->mutex);
+        return streams_->closed;
+    }
+
+private:
+    std::shared_ptr<LoopbackStreams> streams_;
+};
+
+} // namespace xebec
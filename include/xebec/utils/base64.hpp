@@ -1,104 +1,312 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include "cpu_features.hpp"
 
 namespace xebec {
 
 static const std::string base64_chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-inline bool is_base64(unsigned char c) {
-    return (isalnum(c) || (c == '+') || (c == '/'));
+namespace detail {
+
+// Maps a character to its 6-bit value, or 0xFF when it is not in the alphabet.
+inline const uint8_t* base64_decode_table() {
+    static const struct Table {
+        uint8_t values[256];
+        Table() {
+            for (int i = 0; i < 256; i++) values[i] = 0xFF;
+            for (int i = 0; i < 64; i++) values[static_cast<uint8_t>(base64_chars[i])] = static_cast<uint8_t>(i);
+        }
+    } table;
+    return table.values;
 }
 
-inline std::vector<unsigned char> base64_decode(const std::string& input) {
-    size_t length = input.size();
-    if (length % 4 != 0) {
-        throw std::invalid_argument("Invalid base64 input length");
+inline size_t base64_encode_scalar(const unsigned char* input, size_t length, char* out) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char* start = out;
+    size_t i = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t triple = (static_cast<uint32_t>(input[i]) << 16) | (input[i + 1] << 8) | input[i + 2];
+        out[0] = alphabet[triple >> 18];
+        out[1] = alphabet[(triple >> 12) & 0x3F];
+        out[2] = alphabet[(triple >> 6) & 0x3F];
+        out[3] = alphabet[triple & 0x3F];
+        out += 4;
+    }
+    if (i < length) {
+        uint32_t triple = static_cast<uint32_t>(input[i]) << 16;
+        if (i + 1 < length) triple |= input[i + 1] << 8;
+        out[0] = alphabet[triple >> 18];
+        out[1] = alphabet[(triple >> 12) & 0x3F];
+        out[2] = i + 1 < length ? alphabet[(triple >> 6) & 0x3F] : '=';
+        out[3] = '=';
+        out += 4;
     }
+    return static_cast<size_t>(out - start);
+}
 
-    std::vector<unsigned char> ret;
-    int i = 0;
-    unsigned char char_array_4[4], char_array_3[3];
+// Decodes a padded base64 string whose length is a multiple of 4.
+inline bool base64_decode_scalar(const char* input, size_t length, unsigned char* out, size_t& out_length) {
+    out_length = 0;
+    if (length % 4 != 0) return false;
+    if (length == 0) return true;
+    const uint8_t* table = base64_decode_table();
+    size_t padding = input[length - 1] == '=' ? (input[length - 2] == '=' ? 2 : 1) : 0;
+    size_t full = padding ? length - 4 : length;
 
-    for (size_t pos = 0; pos < length; pos++) {
-        if (input[pos] == '=') break; // Padding reached
-        if (!is_base64(input[pos])) {
-            throw std::invalid_argument("Invalid character in base64 string");
-        }
+    unsigned char* start = out;
+    for (size_t i = 0; i < full; i += 4) {
+        uint32_t a = table[static_cast<uint8_t>(input[i])];
+        uint32_t b = table[static_cast<uint8_t>(input[i + 1])];
+        uint32_t c = table[static_cast<uint8_t>(input[i + 2])];
+        uint32_t d = table[static_cast<uint8_t>(input[i + 3])];
+        if ((a | b | c | d) & 0x80) return false;
+        uint32_t triple = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = static_cast<unsigned char>(triple >> 16);
+        out[1] = static_cast<unsigned char>(triple >> 8);
+        out[2] = static_cast<unsigned char>(triple);
+        out += 3;
+    }
+    if (padding) {
+        const char* last = input + full;
+        uint32_t a = table[static_cast<uint8_t>(last[0])];
+        uint32_t b = table[static_cast<uint8_t>(last[1])];
+        uint32_t c = padding == 1 ? table[static_cast<uint8_t>(last[2])] : 0;
+        if ((a | b | c) & 0x80) return false;
+        uint32_t triple = (a << 18) | (b << 12) | (c << 6);
+        *out++ = static_cast<unsigned char>(triple >> 16);
+        if (padding == 1) *out++ = static_cast<unsigned char>(triple >> 8);
+    }
+    out_length = static_cast<size_t>(out - start);
+    return true;
+}
 
-        char_array_4[i++] = input[pos];
-        if (i == 4) {
-            for (int j = 0; j < 4; j++) {
-                char_array_4[j] = base64_chars.find(char_array_4[j]);
-            }
+#ifdef XEBEC_X86
 
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0x0F) << 4) + ((char_array_4[2] & 0x3C) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x03) << 6) + char_array_4[3];
+// The SIMD kernels below follow Wojciech Muła and Daniel Lemire's base64 work:
+// bytes are spread into 6-bit lanes with a shuffle and two multiplies, then
+// mapped to ASCII (or back) with small pshufb lookup tables. Each kernel handles
+// whole blocks only and returns how much input it consumed; the scalar code
+// finishes the tail, including padding.
 
-            for (int j = 0; j < 3; j++) {
-                ret.push_back(char_array_3[j]);
-            }
-            i = 0;
-        }
-    }
+// 6-bit values to ASCII: every value gets an offset picked by its range.
+XEBEC_TARGET("ssse3") inline __m128i base64_ascii_ssse3(__m128i indices) {
+    __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, result), indices);
+}
 
-    if (i > 1) {
-        for (int j = i; j < 4; j++) {
-            char_array_4[j] = 0;
-        }
+XEBEC_TARGET("ssse3") inline __m128i base64_split_ssse3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t0, t1);
+}
 
-        for (int j = 0; j < 4; j++) {
-            char_array_4[j] = base64_chars.find(char_array_4[j]);
-        }
+// 12 input bytes per step; each load reads 16.
+XEBEC_TARGET("ssse3") inline size_t base64_encode_ssse3(const unsigned char* input, size_t length, char* out) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 12) {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_ascii_ssse3(base64_split_ssse3(in)));
+        out += 16;
+    }
+    return i;
+}
 
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0x0F) << 4) + ((char_array_4[2] & 0x3C) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x03) << 6) + char_array_4[3];
+XEBEC_TARGET("avx2") inline __m256i base64_ascii_avx2(__m256i indices) {
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, result), indices);
+}
 
-        for (int j = 0; j < i - 1; j++) {
-            ret.push_back(char_array_3[j]);
-        }
+// 24 input bytes per step, 12 in each 128-bit lane; each step reads 28.
+XEBEC_TARGET("avx2") inline size_t base64_encode_avx2(const unsigned char* input, size_t length, char* out) {
+    const __m256i shuffle = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    size_t i = 0;
+    for (; i + 28 <= length; i += 24) {
+        __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        in = _mm256_shuffle_epi8(in, shuffle);
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                                        _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                                        _mm256_set1_epi32(0x01000010));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), base64_ascii_avx2(_mm256_or_si256(t0, t1)));
+        out += 32;
     }
+    return i;
+}
 
-    return ret;
+// ASCII to 6-bit values. Returns false if any byte is outside the alphabet
+// ('=' included, so padding is always left to the scalar tail).
+XEBEC_TARGET("ssse3") inline bool base64_values_ssse3(__m128i& str) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+    __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    __m128i invalid = _mm_and_si128(lo, hi);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xFFFF) return false;
+    __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+    __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    str = _mm_add_epi8(str, roll);
+    return true;
 }
 
-inline std::string base64_encode(const unsigned char* input, size_t length) {
-    std::string ret;
-    int i = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-
-    while (length--) {
-        char_array_3[i++] = *(input++);
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for(i = 0; i < 4; i++)
-                ret += base64_chars[char_array_4[i]];
-            i = 0;
-        }
+// Packs four 6-bit values per 32-bit lane into three bytes.
+XEBEC_TARGET("ssse3") inline __m128i base64_pack_ssse3(__m128i values) {
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i packed = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(packed, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+// 16 characters per step. Each store writes 16 bytes of which 12 are output,
+// so at least 8 characters are always left for the scalar tail.
+XEBEC_TARGET("ssse3") inline size_t base64_decode_ssse3(const char* input, size_t length, unsigned char* out) {
+    size_t i = 0;
+    for (; i + 24 <= length; i += 16) {
+        __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        if (!base64_values_ssse3(str)) break;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_pack_ssse3(str));
+        out += 12;
     }
+    return i;
+}
+
+XEBEC_TARGET("avx2") inline size_t base64_decode_avx2(const char* input, size_t length, unsigned char* out) {
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i pack_shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                  2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    // 32 characters per step; the 32-byte store holds 24 bytes of output.
+    size_t i = 0;
+    for (; i + 48 <= length; i += 32) {
+        __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) break;
+        __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        str = _mm256_add_epi8(str, roll);
+
+        __m256i merged = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+        __m256i packed = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        packed = _mm256_shuffle_epi8(packed, pack_shuffle);
+        packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+        out += 24;
+    }
+    return i;
+}
+
+#endif // XEBEC_X86
 
-    if (i) {
-        // Fill remaining bytes with '\0'
-        for (int j = i; j < 3; j++)
-            char_array_3[j] = '\0';
+} // namespace detail
+
+inline constexpr size_t base64_encoded_length(size_t length) {
+    return (length + 2) / 3 * 4;
+}
+
+// Upper bound: the exact size is smaller by the number of '=' characters.
+inline constexpr size_t base64_decoded_max_length(size_t length) {
+    return length / 4 * 3;
+}
+
+// Encodes into `out`, which must have room for base64_encoded_length(length)
+// characters. Returns the number of characters written.
+inline size_t base64_encode(const unsigned char* input, size_t length, char* out) {
+    size_t consumed = 0;
+#ifdef XEBEC_X86
+    const CpuFeatures& cpu = cpu_features();
+    if (cpu.avx2) {
+        consumed = detail::base64_encode_avx2(input, length, out);
+    }
+    if (cpu.ssse3) {
+        consumed += detail::base64_encode_ssse3(input + consumed, length - consumed, out + consumed / 3 * 4);
+    }
+#endif
+    size_t written = consumed / 3 * 4;
+    return written + detail::base64_encode_scalar(input + consumed, length - consumed, out + written);
+}
 
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+// Decodes into `out`, which must have room for base64_decoded_max_length(length)
+// bytes. Returns false if the input is not padded base64.
+inline bool base64_decode(const char* input, size_t length, unsigned char* out, size_t& out_length) {
+    out_length = 0;
+    if (length % 4 != 0) return false;
+    size_t consumed = 0;
+#ifdef XEBEC_X86
+    const CpuFeatures& cpu = cpu_features();
+    if (cpu.avx2) {
+        consumed = detail::base64_decode_avx2(input, length, out);
+    }
+    if (cpu.ssse3) {
+        consumed += detail::base64_decode_ssse3(input + consumed, length - consumed, out + consumed / 4 * 3);
+    }
+#endif
+    size_t written = consumed / 4 * 3;
+    size_t tail_length = 0;
+    if (!detail::base64_decode_scalar(input + consumed, length - consumed, out + written, tail_length)) {
+        return false;
+    }
+    out_length = written + tail_length;
+    return true;
+}
 
-        for (int j = 0; j < i + 1; j++)
-            ret += base64_chars[char_array_4[j]];
+inline bool is_base64(unsigned char c) {
+    return detail::base64_decode_table()[c] != 0xFF;
+}
 
-        while((i++ < 3))
-            ret += '=';
+inline std::vector<unsigned char> base64_decode(const std::string& input) {
+    if (input.size() % 4 != 0) {
+        throw std::invalid_argument("Invalid base64 input length");
     }
+    std::vector<unsigned char> ret(base64_decoded_max_length(input.size()));
+    size_t length = 0;
+    if (!base64_decode(input.data(), input.size(), ret.data(), length)) {
+        throw std::invalid_argument("Invalid character in base64 string");
+    }
+    ret.resize(length);
+    return ret;
+}
+
+inline std::string base64_encode(const unsigned char* input, size_t length) {
+    std::string ret(base64_encoded_length(length), '\0');
+    base64_encode(input, length, &ret[0]);
     return ret;
 }
 
-} // namespace xebec
\ No newline at end of file
+} // namespace xebec
@@ -0,0 +1,74 @@
+#pragma once
+
+// Runtime CPU feature detection for the SIMD code paths. Kernels are compiled
+// with per-function target attributes, so the library itself still builds
+// without -mavx2 and the choice is made on the machine it runs on.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define XEBEC_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define XEBEC_TARGET(isa)
+#else
+#include <cpuid.h>
+#define XEBEC_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace xebec {
+
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool avx2 = false;
+    bool sha = false;  // SHA-NI
+};
+
+inline CpuFeatures detect_cpu_features() {
+    CpuFeatures features;
+#ifdef XEBEC_X86
+    unsigned int leaf1[4] = {0, 0, 0, 0};
+    unsigned int leaf7[4] = {0, 0, 0, 0};
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 0);
+    unsigned int max_leaf = static_cast<unsigned int>(regs[0]);
+    __cpuid(regs, 1);
+    for (int i = 0; i < 4; i++) leaf1[i] = static_cast<unsigned int>(regs[i]);
+    if (max_leaf >= 7) {
+        __cpuidex(regs, 7, 0);
+        for (int i = 0; i < 4; i++) leaf7[i] = static_cast<unsigned int>(regs[i]);
+    }
+#else
+    unsigned int max_leaf = __get_cpuid_max(0, nullptr);
+    __get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+    if (max_leaf >= 7) {
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+    }
+#endif
+    features.ssse3 = (leaf1[2] & (1u << 9)) != 0;
+    features.sse41 = (leaf1[2] & (1u << 19)) != 0;
+    features.sha = (leaf7[1] & (1u << 29)) != 0;
+
+    // AVX2 also needs the OS to save the upper halves of the YMM registers.
+    bool osxsave = (leaf1[2] & (1u << 27)) != 0;
+    if (osxsave && (leaf7[1] & (1u << 5))) {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+        features.avx2 = (xcr0 & 0x6) == 0x6;
+    }
+#endif
+    return features;
+}
+
+inline const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect_cpu_features();
+    return features;
+}
+
+} // namespace xebec
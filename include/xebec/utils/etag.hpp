@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace xebec {
+
+inline uint64_t fnv1a_64(const char* data, size_t length, uint64_t hash = 0xcbf29ce484222325ull) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+inline std::string to_hex(uint64_t value) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(16, '0');
+    for (int i = 15; i >= 0; i--) {
+        out[i] = digits[value & 0xF];
+        value >>= 4;
+    }
+    return out;
+}
+
+// Strong entity tag derived from the response body.
+inline std::string make_etag(const std::string& body) {
+    return "\"" + to_hex(fnv1a_64(body.data(), body.size())) + "\"";
+}
+
+// Checks an If-None-Match header value against an entity tag using the weak
+// comparison from RFC 9110 13.1.2 (a W/ prefix on either side is ignored).
+inline bool etag_matches(const std::string& if_none_match, const std::string& etag) {
+    auto strip_weak = [](const std::string& tag, size_t begin, size_t end) {
+        if (end - begin >= 2 && tag.compare(begin, 2, "W/") == 0) begin += 2;
+        return tag.substr(begin, end - begin);
+    };
+    std::string target = strip_weak(etag, 0, etag.size());
+
+    size_t pos = 0;
+    while (pos < if_none_match.size()) {
+        size_t end = if_none_match.find(',', pos);
+        if (end == std::string::npos) end = if_none_match.size();
+        size_t begin = if_none_match.find_first_not_of(" \t", pos);
+        size_t last = if_none_match.find_last_not_of(" \t", end - 1);
+        if (begin != std::string::npos && begin < end && last != std::string::npos && last >= begin) {
+            if (if_none_match.compare(begin, last - begin + 1, "*") == 0) return true;
+            if (strip_weak(if_none_match, begin, last + 1) == target) return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+} // namespace xebec
@@ -1,21 +1,178 @@
 #pragma once
-#include <iostream>
+#include <string>
 #include <vector>
-#include <sstream>
-#include <iomanip>
+#include <array>
+#include <utility>
 #include <cstdint>
+#include <cstddef>
 #include <cstring>
+#include "cpu_features.hpp"
+
+namespace xebec {
+
+using Sha1Digest = std::array<uint8_t, 20>;
+
+namespace detail {
+
+inline uint32_t sha1_rotl(uint32_t value, uint32_t bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+inline void sha1_compress_scalar(uint32_t state[5], const uint8_t* data, size_t blocks) {
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (static_cast<uint32_t>(data[i * 4]) << 24) | (data[i * 4 + 1] << 16) |
+                   (data[i * 4 + 2] << 8) | (data[i * 4 + 3]);
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = sha1_rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = sha1_rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = sha1_rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef XEBEC_X86
+
+// Four rounds with the SHA extensions. Group G uses message register G % 4 and
+// alternates between the two E registers, while the schedule for later groups
+// is computed in the same step.
+template <int G>
+XEBEC_TARGET("sha,sse4.1") inline void sha1_rounds_shani(__m128i& abcd, __m128i* e, __m128i* msg) {
+    __m128i& next = e[G % 2];
+    if constexpr (G == 0) {
+        next = _mm_add_epi32(next, msg[0]);
+    } else {
+        next = _mm_sha1nexte_epu32(next, msg[G % 4]);
+    }
+    e[(G + 1) % 2] = abcd;
+    if constexpr (G >= 3 && G <= 18) {
+        msg[(G + 1) % 4] = _mm_sha1msg2_epu32(msg[(G + 1) % 4], msg[G % 4]);
+    }
+    abcd = _mm_sha1rnds4_epu32(abcd, next, G / 5);
+    if constexpr (G >= 1 && G <= 16) {
+        msg[(G + 3) % 4] = _mm_sha1msg1_epu32(msg[(G + 3) % 4], msg[G % 4]);
+    }
+    if constexpr (G >= 2 && G <= 17) {
+        msg[(G + 2) % 4] = _mm_xor_si128(msg[(G + 2) % 4], msg[G % 4]);
+    }
+}
+
+template <int... G>
+XEBEC_TARGET("sha,sse4.1") inline void sha1_block_shani(__m128i& abcd, __m128i* e, __m128i* msg,
+                                                       std::integer_sequence<int, G...>) {
+    (sha1_rounds_shani<G>(abcd, e, msg), ...);
+}
+
+XEBEC_TARGET("sha,sse4.1") inline void sha1_compress_shani(uint32_t state[5], const uint8_t* data, size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i abcd_save = abcd;
+        __m128i e_save = e0;
+        __m128i msg[4];
+        for (int i = 0; i < 4; i++) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byte_swap);
+        }
+        __m128i e[2] = {e0, e0};
+        sha1_block_shani(abcd, e, msg, std::make_integer_sequence<int, 20>{});
+        e0 = _mm_sha1nexte_epu32(e[0], e_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+#endif // XEBEC_X86
+
+// Processes whole 64-byte blocks with SHA-NI when the CPU has it.
+inline void sha1_compress(uint32_t state[5], const uint8_t* data, size_t blocks) {
+#ifdef XEBEC_X86
+    static const bool shani = cpu_features().sha && cpu_features().sse41;
+    if (shani) {
+        sha1_compress_shani(state, data, blocks);
+        return;
+    }
+#endif
+    sha1_compress_scalar(state, data, blocks);
+}
+
+} // namespace detail
+
+} // namespace xebec
 
 class SHA1 {
 public:
-    SHA1() { 
+    SHA1() {
         reset();
-        //init buffer
-        memset(buffer, 0, 64);
     }
 
     void update(const std::string& data) {
-        update(reinterpret_cast<const uint8_t*>(data.c_str()), data.size());
+        update(data.data(), data.size());
+    }
+
+    void update(const void* input, size_t length) {
+        const uint8_t* data = static_cast<const uint8_t*>(input);
+        totalLength += length;
+        if (bufferSize > 0) {
+            size_t copySize = length < 64 - bufferSize ? length : 64 - bufferSize;
+            std::memcpy(buffer + bufferSize, data, copySize);
+            bufferSize += copySize;
+            data += copySize;
+            length -= copySize;
+            if (bufferSize < 64) return;
+            xebec::detail::sha1_compress(state, buffer, 1);
+            bufferSize = 0;
+        }
+        // Whole blocks are hashed straight from the input.
+        xebec::detail::sha1_compress(state, data, length / 64);
+        data += length / 64 * 64;
+        length %= 64;
+        std::memcpy(buffer, data, length);
+        bufferSize = length;
+    }
+
+    // Writes the 20-byte digest. The object must be reset() before reuse.
+    void final(uint8_t digest[20]) {
+        finalize(digest);
+    }
+
+    xebec::Sha1Digest digest() {
+        xebec::Sha1Digest result;
+        finalize(result.data());
+        return result;
     }
 
     std::vector<uint8_t> final_bytes() {
@@ -25,121 +182,72 @@ public:
     }
 
     static std::string bytes_to_hex(const std::vector<uint8_t>& bytes) {
-        std::ostringstream result;
-        for (uint8_t byte : bytes) {
-            result << std::hex << std::setw(2) << std::setfill('0') << (int)byte;
+        return bytes_to_hex(bytes.data(), bytes.size());
+    }
+
+    static std::string bytes_to_hex(const uint8_t* bytes, size_t length) {
+        static const char digits[] = "0123456789abcdef";
+        std::string result(length * 2, '0');
+        for (size_t i = 0; i < length; i++) {
+            result[i * 2] = digits[bytes[i] >> 4];
+            result[i * 2 + 1] = digits[bytes[i] & 0xF];
         }
-        return result.str();
+        return result;
     }
 
     std::string final() {
         uint8_t digest[20];
         finalize(digest);
-        std::ostringstream result;
-        for (int i = 0; i < 20; i++)
-            result << std::hex << std::setw(2) << std::setfill('0') << (int)digest[i];
-        return result.str();
+        return bytes_to_hex(digest, 20);
     }
 
-private:
-    uint32_t h0, h1, h2, h3, h4;
-    uint64_t totalLength;
-    uint8_t buffer[64];
-    size_t bufferSize;
-
     void reset() {
-        h0 = 0x67452301;
-        h1 = 0xEFCDAB89;
-        h2 = 0x98BADCFE;
-        h3 = 0x10325476;
-        h4 = 0xC3D2E1F0;
+        state[0] = 0x67452301;
+        state[1] = 0xEFCDAB89;
+        state[2] = 0x98BADCFE;
+        state[3] = 0x10325476;
+        state[4] = 0xC3D2E1F0;
         totalLength = 0;
         bufferSize = 0;
     }
 
-    void update(const uint8_t* data, size_t length) {
-        totalLength += length;
-        while (length > 0) {
-            size_t reducedBufferSize = 64 - bufferSize;
-            size_t copySize = (length < reducedBufferSize) ? length : reducedBufferSize;
-            std::memcpy(buffer + bufferSize, data, copySize);
-            bufferSize += copySize;
-            data += copySize;
-            length -= copySize;
-            if (bufferSize == 64) {
-                processChunk(buffer);
-                bufferSize = 0;
-            }
-        }
-    }
+private:
+    uint32_t state[5];
+    uint64_t totalLength;
+    uint8_t buffer[64];
+    size_t bufferSize;
 
     void finalize(uint8_t digest[20]) {
         buffer[bufferSize++] = 0x80;
         if (bufferSize > 56) {
-            while (bufferSize < 64)
-                buffer[bufferSize++] = 0;
-            processChunk(buffer);
+            std::memset(buffer + bufferSize, 0, 64 - bufferSize);
+            xebec::detail::sha1_compress(state, buffer, 1);
             bufferSize = 0;
         }
-        while (bufferSize < 56)
-            buffer[bufferSize++] = 0;
+        std::memset(buffer + bufferSize, 0, 56 - bufferSize);
 
         uint64_t bitLength = totalLength * 8;
-        for (int i = 7; i >= 0; i--)
-            buffer[bufferSize++] = (bitLength >> (i * 8)) & 0xFF;
-
-        processChunk(buffer);
+        for (int i = 0; i < 8; i++) {
+            buffer[56 + i] = static_cast<uint8_t>(bitLength >> ((7 - i) * 8));
+        }
+        xebec::detail::sha1_compress(state, buffer, 1);
 
-        const uint32_t hashValues[] = { h0, h1, h2, h3, h4 };
         for (int i = 0; i < 5; i++) {
-            for (int j = 3; j >= 0; j--) {
-                digest[i * 4 + (3 - j)] = (hashValues[i] >> (j * 8)) & 0xFF;
-            }
+            digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
         }
     }
+};
 
-    void processChunk(const uint8_t* chunk) {
-        uint32_t w[80];
-        for (int i = 0; i < 16; i++) {
-            w[i] = (chunk[i * 4] << 24) | (chunk[i * 4 + 1] << 16) |
-                   (chunk[i * 4 + 2] << 8) | (chunk[i * 4 + 3]);
-        }
-        for (int i = 16; i < 80; i++) {
-            w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
-        }
-
-        uint32_t a = h0, b = h1, c = h2, d = h3, e = h4;
-        for (int i = 0; i < 80; i++) {
-            uint32_t f, k;
-            if (i < 20) {
-                f = (b & c) | (~b & d);
-                k = 0x5A827999;
-            } else if (i < 40) {
-                f = b ^ c ^ d;
-                k = 0x6ED9EBA1;
-            } else if (i < 60) {
-                f = (b & c) | (b & d) | (c & d);
-                k = 0x8F1BBCDC;
-            } else {
-                f = b ^ c ^ d;
-                k = 0xCA62C1D6;
-            }
-            uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
-            e = d;
-            d = c;
-            c = rotateLeft(b, 30);
-            b = a;
-            a = temp;
-        }
+namespace xebec {
 
-        h0 += a;
-        h1 += b;
-        h2 += c;
-        h3 += d;
-        h4 += e;
-    }
+// One-shot digest of a buffer; nothing is allocated.
+inline Sha1Digest sha1_digest(const void* data, size_t length) {
+    class SHA1 sha1;
+    sha1.update(data, length);
+    return sha1.digest();
+}
 
-    static uint32_t rotateLeft(uint32_t value, uint32_t bits) {
-        return (value << bits) | (value >> (32 - bits));
-    }
-};
\ No newline at end of file
+} // namespace xebec
@@ -0,0 +1,101 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstring>
+#include "cpu_features.hpp"
+
+namespace xebec {
+
+namespace detail {
+
+inline int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+inline const char* find_any_scalar(const char* p, const char* end, char a, char b, char c, char d) {
+    for (; p < end; ++p) {
+        if (*p == a || *p == b || *p == c || *p == d) return p;
+    }
+    return end;
+}
+
+// First of the bytes a, b, c, d in [p, end). Plain runs in a URL are long
+// compared to escapes and separators, so they are skipped 16 bytes at a time.
+// SSE2 is part of x86-64, so there is no runtime dispatch here.
+inline const char* find_any(const char* p, const char* end, char a, char b, char c, char d) {
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    const __m128i vd = _mm_set1_epi8(d);
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(block, vc), _mm_cmpeq_epi8(block, vd)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index;
+            _BitScanForward(&index, static_cast<unsigned long>(mask));
+            return p + index;
+#else
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+#endif
+        }
+        p += 16;
+    }
+#endif
+    return find_any_scalar(p, end, a, b, c, d);
+}
+
+// Decodes the escape starting at `p` (which points at '%') into `out`.
+// Returns the number of input bytes used; a malformed escape stays literal.
+inline size_t decode_escape(const char* p, const char* end, char* out) {
+    if (end - p >= 3) {
+        int high = hex_value(p[1]);
+        int low = hex_value(p[2]);
+        if (high >= 0 && low >= 0) {
+            *out = static_cast<char>((high << 4) | low);
+            return 3;
+        }
+    }
+    *out = '%';
+    return 1;
+}
+
+} // namespace detail
+
+// Percent-decodes `length` bytes into `out`, which needs room for `length`
+// bytes (decoding never grows the input). With `plus_as_space`, '+' becomes a
+// space as in form-encoded query strings. Returns the decoded length.
+inline size_t percent_decode(const char* in, size_t length, char* out, bool plus_as_space) {
+    const char* p = in;
+    const char* end = in + length;
+    char* start = out;
+    const char plus = plus_as_space ? '+' : '%';
+    while (p < end) {
+        const char* special = detail::find_any(p, end, '%', plus, '%', '%');
+        std::memcpy(out, p, static_cast<size_t>(special - p));
+        out += special - p;
+        if (special == end) break;
+        if (*special == '+') {
+            *out++ = ' ';
+            p = special + 1;
+        } else {
+            p = special + detail::decode_escape(special, end, out++);
+        }
+    }
+    return static_cast<size_t>(out - start);
+}
+
+inline std::string percent_decode(std::string_view in, bool plus_as_space = false) {
+    std::string out(in.size(), '\0');
+    out.resize(percent_decode(in.data(), in.size(), &out[0], plus_as_space));
+    return out;
+}
+
+} // namespace xebec
@@ -3,19 +3,42 @@
 // Core components
 #include "core/config.hpp"
 #include "core/error.hpp"
+#include "core/json.hpp"
+#include "core/query.hpp"
+#include "core/embedded.hpp"
 #include "core/request.hpp"
 #include "core/response.hpp"
 #include "core/middleware.hpp"
+#include "core/task.hpp"
 
 // Features
 #include "features/plugin.hpp"
 #include "features/websocket.hpp"
 #include "features/template.hpp"
+#include "features/cache.hpp"
+#include "features/static_files.hpp"
+#include "features/embedded_files.hpp"
+#include "features/tls.hpp"
+#include "features/hpack.hpp"
+#include "features/http2.hpp"
+#include "features/multipart.hpp"
+#include "features/proxy.hpp"
+#include "features/rate_limit.hpp"
+#include "features/sse.hpp"
+#include "features/tracing.hpp"
 
 // Server
+#include "server/connection.hpp"
+#include "server/buffer_pool.hpp"
+#include "server/loopback.hpp"
+#include "server/event_loop.hpp"
+#include "server/io_uring.hpp"
 #include "server/http_server.hpp"
 
 // Utils
 #include "utils/base64.hpp"
 #include "utils/sha1.hpp"
-#include "utils/string_utils.hpp" 
\ No newline at end of file
+#include "utils/string_utils.hpp"
+#include "utils/url.hpp"
+#include "utils/etag.hpp"
+#include "utils/cpu_features.hpp" 
\ No newline at end of file
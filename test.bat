@@ -4,4 +4,85 @@ g++ -o tests.exe tests/test_sha1_base64.cpp -lws2_32 -std=c++17
 if %errorlevel% equ 0 (
     echo Running test...
     tests.exe
-)
\ No newline at end of file
+)
+g++ -o restart_tests.exe tests/test_graceful_restart.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    restart_tests.exe
+)
+g++ -o hpack_tests.exe tests/test_hpack.cpp -std=c++17
+if %errorlevel% equ 0 (
+    hpack_tests.exe
+)
+g++ -o http2_tests.exe tests/test_http2.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    http2_tests.exe
+)
+g++ -o static_files_tests.exe tests/test_static_files.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    static_files_tests.exe
+)
+g++ -o tls_tests.exe tests/test_tls.cpp -DXEBEC_ENABLE_TLS -lssl -lcrypto -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    tls_tests.exe
+)
+g++ -o async_tests.exe tests/test_async_handlers.cpp -lws2_32 -std=c++20
+if %errorlevel% equ 0 (
+    async_tests.exe
+)
+g++ -o io_uring_tests.exe tests/test_io_uring.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    io_uring_tests.exe
+)
+g++ -o query_tests.exe tests/test_query.cpp -std=c++17
+if %errorlevel% equ 0 (
+    query_tests.exe
+)
+g++ -o json_tests.exe tests/test_json.cpp -std=c++17
+if %errorlevel% equ 0 (
+    json_tests.exe
+)
+g++ -o multipart_tests.exe tests/test_multipart.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    multipart_tests.exe
+)
+g++ -o proxy_tests.exe tests/test_proxy.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    proxy_tests.exe
+)
+g++ -o rate_limit_tests.exe tests/test_rate_limit.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    rate_limit_tests.exe
+)
+g++ -o plugin_hooks_tests.exe tests/test_plugin_hooks.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    plugin_hooks_tests.exe
+)
+g++ -o sse_tests.exe tests/test_sse.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    sse_tests.exe
+)
+g++ -o tracing_tests.exe tests/test_tracing.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    tracing_tests.exe
+)
+g++ -o buffer_pool_tests.exe tests/test_buffer_pool.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    buffer_pool_tests.exe
+)
+g++ -o loopback_tests.exe tests/test_loopback.cpp -lws2_32 -std=c++17
+if %errorlevel% equ 0 (
+    loopback_tests.exe
+)
+if not exist generated mkdir generated
+g++ -o xebec_templates.exe tools/xebec_templates.cpp -std=c++17
+if %errorlevel% equ 0 (
+    xebec_templates.exe --dir tests/templates --include include/xebec/features/template.hpp -o generated/templates_generated.hpp page.html users/profile.html keywords.html fields.html
+    g++ -o template_tests.exe tests/test_template_compiler.cpp -I. -Igenerated -std=c++17
+    if not errorlevel 1 template_tests.exe
+)
+g++ -o xebec_embed.exe tools/xebec_embed.cpp -std=c++17
+if %errorlevel% equ 0 (
+    xebec_embed.exe --dir tests/public --include include/xebec/features/embedded_files.hpp -o generated/embedded_generated.hpp
+    g++ -o embedded_files_tests.exe tests/test_embedded_files.cpp -I. -Igenerated -lws2_32 -std=c++17
+    if not errorlevel 1 embedded_files_tests.exe
+)
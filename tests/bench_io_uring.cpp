@@ -0,0 +1,162 @@
+// io_uring vs blocking backend: requests per second over loopback with many
+// keep-alive connections, for a small handler response, a static file and
+// pipelined requests. The client is one poll() loop in this process.
+//
+//     g++ -O2 -std=c++17 tests/bench_io_uring.cpp -pthread
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include "../include/xebec/xebec.hpp"
+
+#ifdef XEBEC_HAS_IO_URING
+
+const int bench_port = 18935;
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(bench_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+int thread_count() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) return std::stoi(line.substr(8));
+    }
+    return -1;
+}
+
+struct ClientConnection {
+    SOCKET socket;
+    std::string pending;
+    int outstanding = 0;
+};
+
+// Keeps `depth` requests in flight on each connection for one second.
+double requests_per_second(const std::string& path, int connections, int depth, int& threads) {
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string batch;
+    for (int i = 0; i < depth; i++) batch += request;
+
+    std::vector<ClientConnection> clients(connections);
+    std::vector<pollfd> fds(connections);
+    for (int i = 0; i < connections; i++) {
+        clients[i].socket = connect_to_server();
+        fds[i].fd = clients[i].socket;
+        fds[i].events = POLLIN;
+        send(clients[i].socket, batch.data(), batch.size(), 0);
+        clients[i].outstanding = depth;
+    }
+
+    long long completed = 0;
+    char buffer[65536];
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(1);
+    bool sampled = false;
+    while (std::chrono::steady_clock::now() < end) {
+        if (poll(fds.data(), fds.size(), 100) <= 0) continue;
+        for (int i = 0; i < connections; i++) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            ClientConnection& c = clients[i];
+            int received = recv(c.socket, buffer, sizeof(buffer), 0);
+            if (received <= 0) continue;
+            c.pending.append(buffer, received);
+            int finished = 0;
+            size_t head_end;
+            while ((head_end = c.pending.find("\r\n\r\n")) != std::string::npos) {
+                size_t length_pos = c.pending.find("Content-Length: ");
+                size_t length = std::stoul(c.pending.substr(length_pos + 16));
+                if (c.pending.size() < head_end + 4 + length) break;
+                c.pending.erase(0, head_end + 4 + length);
+                finished++;
+            }
+            completed += finished;
+            c.outstanding -= finished;
+            if (c.outstanding == 0) {
+                send(c.socket, batch.data(), batch.size(), 0);
+                c.outstanding = depth;
+            }
+        }
+        if (!sampled && std::chrono::steady_clock::now() - start > std::chrono::milliseconds(500)) {
+            threads = thread_count();
+            sampled = true;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (auto& c : clients) SOCKET_CLOSE(c.socket);
+    return completed / seconds;
+}
+
+void bench_backend(xebec::IoBackend backend, const char* name) {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    xebec::ServerConfig config;
+    config.port = bench_port;
+    config.io_backend = backend;
+    config.max_keep_alive_requests = 1000000;
+    xebec::http_server server(config);
+    server.publicDir("xebec_bench_public");
+    server.get("/hello", [](xebec::Request&, xebec::Response& res) { res << "Hello, World!"; });
+    std::thread server_thread([&server]() { server.start(); });
+    for (int i = 0; i < 200; i++) {
+        SOCKET sock = connect_to_server();
+        if (sock != INVALID_SOCKET) {
+            SOCKET_CLOSE(sock);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    int threads[3] = {};
+    double hello = requests_per_second("/hello", 64, 1, threads[0]);
+    double file = requests_per_second("/asset.bin", 64, 1, threads[1]);
+    double pipelined = requests_per_second("/hello", 64, 16, threads[2]);
+
+    server.stop();
+    server_thread.join();
+    std::cout.rdbuf(saved_out);
+    std::cerr.rdbuf(saved_err);
+
+    std::printf("%-8s  handler %9.0f req/s (%3d threads)  16K file %9.0f req/s (%3d threads)"
+                "  pipelined x16 %9.0f req/s (%3d threads)\n",
+                name, hello, threads[0], file, threads[1], pipelined, threads[2]);
+}
+
+int main() {
+    std::system("mkdir -p xebec_bench_public");
+    { std::ofstream("xebec_bench_public/asset.bin", std::ios::binary) << std::string(16 * 1024, 'x'); }
+
+    std::printf("64 keep-alive connections over loopback, %u hardware threads\n",
+                std::thread::hardware_concurrency());
+    bench_backend(xebec::IoBackend::Threads, "threads");
+    if (xebec::IoUring::supported()) {
+        bench_backend(xebec::IoBackend::IoUring, "io_uring");
+    } else {
+        std::printf("io_uring is not available on this kernel\n");
+    }
+
+    std::remove("xebec_bench_public/asset.bin");
+    std::remove("xebec_bench_public");
+    return 0;
+}
+
+#else
+
+int main() {
+    std::printf("io_uring backend needs Linux\n");
+    return 0;
+}
+
+#endif
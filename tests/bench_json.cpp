@@ -0,0 +1,126 @@
+// JsonWriter vs building a body by string concatenation, and JsonDocument vs
+// pulling fields out of a body with find()/substr().
+//
+//     g++ -O2 -std=c++17 tests/bench_json.cpp
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include "../include/xebec/core/request.hpp"
+#include "../include/xebec/core/response.hpp"
+
+struct Item {
+    int id;
+    std::string name;
+    double price;
+    bool in_stock;
+};
+
+double per_second(const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    long long count = 0;
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300)) {
+        for (int i = 0; i < 100; i++) run();
+        count += 100;
+    }
+    return count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The pattern handlers used before: concatenate, unescaped, with std::to_string.
+std::string concatenate(const std::vector<Item>& items) {
+    std::string json = "{\"items\": [";
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) json += ", ";
+        json += "{\"id\": " + std::to_string(items[i].id) + ", \"name\": \"" + items[i].name +
+                "\", \"price\": " + std::to_string(items[i].price) +
+                ", \"in_stock\": " + (items[i].in_stock ? "true" : "false") + "}";
+    }
+    json += "]}";
+    return json;
+}
+
+void write(const std::vector<Item>& items, xebec::Response& res) {
+    xebec::JsonWriter json = res.json();
+    json.begin_object().key("items").begin_array();
+    for (const Item& item : items) {
+        json.begin_object()
+            .field("id", item.id)
+            .field("name", item.name)
+            .field("price", item.price)
+            .field("in_stock", item.in_stock)
+            .end_object();
+    }
+    json.end_array().end_object();
+}
+
+// Finds "key": and reads up to the next ',' or '}', as hand-rolled handlers do.
+std::string naive_field(const std::string& body, const std::string& key, size_t from = 0) {
+    size_t pos = body.find("\"" + key + "\":", from);
+    if (pos == std::string::npos) return "";
+    pos = body.find_first_not_of(' ', pos + key.size() + 3);
+    size_t end = body.find_first_of(",}", pos);
+    return body.substr(pos, end - pos);
+}
+
+int main() {
+    std::vector<Item> items;
+    for (int i = 0; i < 100; i++) {
+        items.push_back({i * 37, "Item number " + std::to_string(i) + " with a longer description", i * 1.25, i % 3 != 0});
+    }
+
+    volatile size_t sink = 0;
+    double concat = per_second([&] {
+        xebec::Response res;
+        res.json(concatenate(items));
+        sink = sink + res.body.size();
+    });
+    double writer = per_second([&] {
+        xebec::Response res;
+        write(items, res);
+        sink = sink + res.body.size();
+    });
+    xebec::Response sample;
+    write(items, sample);
+    std::printf("Serialize 100 objects (%zu bytes):\n", sample.body.size());
+    std::printf("  string concatenation  %9.0f/s\n", concat);
+    std::printf("  JsonWriter            %9.0f/s  (%.1fx)\n", writer, writer / concat);
+
+    xebec::Request req;
+    req.body = sample.body;
+    double naive = per_second([&] {
+        long long total = 0;
+        size_t from = 0;
+        for (int i = 0; i < 100; i++) {
+            from = req.body.find("\"id\":", from) + 1;
+            total += std::stoll(naive_field(req.body, "id", from - 1));
+            total += static_cast<long long>(naive_field(req.body, "name", from).size());
+        }
+        sink = sink + static_cast<size_t>(total);
+    });
+    double on_demand = per_second([&] {
+        long long total = 0;
+        xebec::JsonDocument doc = req.json();
+        for (xebec::JsonValue item : doc["items"].array()) {
+            total += item["id"].get_int();
+            total += static_cast<long long>(item["name"].get_string().size());
+        }
+        sink = sink + static_cast<size_t>(total);
+    });
+    double index = per_second([&] {
+        std::vector<uint32_t> entries;
+        xebec::detail::json_build_index(req.body, entries);
+        sink = sink + entries.size();
+    });
+    double index_scalar = per_second([&] {
+        std::vector<uint32_t> entries;
+        xebec::detail::json_build_index(req.body, entries, xebec::detail::json_classify_scalar);
+        sink = sink + entries.size();
+    });
+    double mb = req.body.size() / 1e6;
+    std::printf("Read id and name from each of 100 objects:\n");
+    std::printf("  find()/substr()       %9.0f/s\n", naive);
+    std::printf("  JsonDocument          %9.0f/s  (%.1fx)\n", on_demand, on_demand / naive);
+    std::printf("Structural index: SIMD %.0f MB/s, scalar %.0f MB/s\n", index * mb, index_scalar * mb);
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Fan-out of one event to 50k idle subscribers: SseHub vs the WebSocket
+// broadcast of examples/ws.cpp, which builds a frame per client and sends it
+// with a blocking write from the publishing thread. Each subscriber is one end
+// of a socket pair, so two descriptors are needed per subscriber; with a lower
+// descriptor limit the count is reduced.
+//
+//     g++ -O2 -std=c++17 tests/bench_sse.cpp -pthread
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <sys/resource.h>
+#include "../include/xebec/xebec.hpp"
+
+const size_t wanted_subscribers = 50000;
+const int event_count = 20;
+
+// Reads exactly `length` bytes from every client.
+void drain(const std::vector<SOCKET>& clients, size_t length) {
+    std::vector<char> buffer(length);
+    for (SOCKET client : clients) {
+        size_t received = 0;
+        while (received < length) {
+            int got = recv(client, buffer.data() + received, length - received, 0);
+            if (got <= 0) {
+                std::printf("client closed\n");
+                std::exit(1);
+            }
+            received += static_cast<size_t>(got);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t subscribers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : wanted_subscribers;
+    rlimit limit{};
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    size_t allowed = limit.rlim_cur > 64 ? (limit.rlim_cur - 64) / 2 : 0;
+    if (subscribers > allowed) {
+        std::printf("descriptor limit %zu: %zu subscribers instead of %zu\n", static_cast<size_t>(limit.rlim_cur),
+                    allowed, subscribers);
+        subscribers = allowed;
+    }
+
+    std::vector<SOCKET> servers(subscribers), clients(subscribers);
+    for (size_t i = 0; i < subscribers; i++) {
+        SOCKET pair[2];
+        if (!xebec::create_socket_pair(pair)) {
+            std::printf("socketpair failed after %zu\n", i);
+            return 1;
+        }
+        servers[i] = pair[0];
+        clients[i] = pair[1];
+    }
+    std::string message(96, 'm');
+
+    // examples/ws.cpp: one frame built and sent per client.
+    auto start = std::chrono::steady_clock::now();
+    for (int event = 0; event < event_count; event++) {
+        for (SOCKET server : servers) {
+            xebec::WebSocketFrame frame;
+            frame.fin = true;
+            frame.opcode = xebec::WSOpCode::TEXT;
+            frame.payload = std::vector<uint8_t>(message.begin(), message.end());
+            xebec::http_server::send_websocket_frame(server, frame);
+        }
+        drain(clients, message.size() + 2);
+    }
+    double websocket = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    xebec::SseOptions options;
+    options.heartbeat_ms = 0;
+    xebec::SseHub hub(options);
+    for (SOCKET server : servers) hub.subscribe(std::make_unique<xebec::Connection>(server), "feed");
+    while (hub.subscribers() != subscribers) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    size_t chunk_size = xebec::encode_sse_event(1, "", message).size();
+    double publish_us = 0;
+    start = std::chrono::steady_clock::now();
+    for (int event = 0; event < event_count; event++) {
+        auto published = std::chrono::steady_clock::now();
+        hub.publish("feed", message);
+        publish_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - published).count();
+        drain(clients, chunk_size);
+    }
+    double sse = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("Fan-out of a %zu byte message to %zu idle subscribers, %d events, delivered and read:\n",
+                message.size(), subscribers, event_count);
+    std::printf("  WebSocket broadcast loop  %8.2f ms/event  (publisher blocked throughout)\n",
+                websocket / event_count);
+    std::printf("  SseHub                    %8.2f ms/event  (%.2fx, publish() returns in %.1f us)\n",
+                sse / event_count, websocket / sse, publish_us / event_count);
+    hub.close_all();
+    for (SOCKET client : clients) SOCKET_CLOSE(client);
+    return 0;
+}
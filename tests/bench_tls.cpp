@@ -0,0 +1,179 @@
+// TLS benchmark: full vs resumed handshake rate and bulk throughput over a
+// self-signed certificate generated at startup.
+//
+//     g++ -O2 -std=c++17 -DXEBEC_ENABLE_TLS tests/bench_tls.cpp -lssl -lcrypto -pthread
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include "../include/xebec/xebec.hpp"
+
+#ifdef XEBEC_ENABLE_TLS
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+const int bench_port = 18929;
+const std::string bench_dir = "xebec_bench_tls";
+
+bool write_self_signed_cert(const std::string& cert_path, const std::string& key_path) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 86400);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    FILE* cert_file = std::fopen(cert_path.c_str(), "wb");
+    FILE* key_file = std::fopen(key_path.c_str(), "wb");
+    bool ok = cert_file && key_file && PEM_write_X509(cert_file, cert) &&
+              PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr);
+    if (cert_file) std::fclose(cert_file);
+    if (key_file) std::fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(bench_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// One TLS connection carrying one request. Returns the number of body bytes read, or -1.
+long long tls_request(SSL_CTX* ctx, const std::string& path, SSL_SESSION** session, bool* reused) {
+    SOCKET sock = connect_to_server();
+    if (sock == INVALID_SOCKET) return -1;
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, static_cast<int>(sock));
+    if (session && *session) SSL_set_session(ssl, *session);
+    long long total = -1;
+    if (SSL_connect(ssl) == 1) {
+        std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+        SSL_write(ssl, request.data(), static_cast<int>(request.size()));
+        static thread_local std::vector<char> buffer(256 * 1024);
+        total = 0;
+        int received;
+        while ((received = SSL_read(ssl, buffer.data(), static_cast<int>(buffer.size()))) > 0) {
+            total += received;
+        }
+        if (reused) *reused = SSL_session_reused(ssl) == 1;
+        // Like browsers, keep the newest ticket: TLS 1.3 tickets are meant for a single use.
+        if (session) {
+            if (*session) SSL_SESSION_free(*session);
+            *session = SSL_get1_session(ssl);
+        }
+    }
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    SOCKET_CLOSE(sock);
+    return total;
+}
+
+void bench_handshakes(SSL_CTX* ctx, bool resume) {
+    SSL_SESSION* session = nullptr;
+    if (resume) tls_request(ctx, "/hello", &session, nullptr);
+
+    int count = 0, reused_count = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::seconds(2);
+    while (std::chrono::steady_clock::now() < deadline) {
+        bool reused = false;
+        if (tls_request(ctx, "/hello", resume ? &session : nullptr, &reused) < 0) break;
+        count++;
+        if (reused) reused_count++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%s handshakes: %lld/s (%d of %d resumed)\n", resume ? "Resumed" : "Full",
+                static_cast<long long>(count / seconds), reused_count, count);
+    if (session) SSL_SESSION_free(session);
+}
+
+void bench_bulk(SSL_CTX* ctx, size_t file_size) {
+    auto start = std::chrono::steady_clock::now();
+    long long total = 0;
+    for (int i = 0; i < 5; i++) {
+        long long received = tls_request(ctx, "/bulk.bin", nullptr, nullptr);
+        if (received < 0) break;
+        total += received;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("Bulk throughput (%zu MB file): %lld MB/s\n", file_size / (1024 * 1024),
+                static_cast<long long>(total / seconds / (1024 * 1024)));
+}
+
+int main() {
+    std::string mkdir = "mkdir -p " + bench_dir;
+    if (std::system(mkdir.c_str()) != 0) return 1;
+    std::string cert_path = bench_dir + "/cert.pem";
+    std::string key_path = bench_dir + "/key.pem";
+    if (!write_self_signed_cert(cert_path, key_path)) {
+        std::printf("Failed to generate a self-signed certificate\n");
+        return 1;
+    }
+    const size_t file_size = 64 * 1024 * 1024;
+    {
+        std::ofstream bulk(bench_dir + "/bulk.bin", std::ios::binary);
+        std::string block(1024 * 1024, 'x');
+        for (size_t i = 0; i < file_size / block.size(); i++) bulk << block;
+    }
+
+    std::ifstream tls_stat("/proc/net/tls_stat");
+    std::printf("Kernel TLS available: %s\n", tls_stat ? "yes" : "no");
+
+    // The server logs every request; results are printed with printf instead.
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    xebec::ServerConfig config;
+    config.port = bench_port;
+    config.ssl_cert_path = cert_path;
+    config.ssl_key_path = key_path;
+    xebec::http_server server(config);
+    server.publicDir(bench_dir);
+    server.get("/hello", [](xebec::Request&, xebec::Response& res) {
+        res << "hello";
+    });
+    std::thread server_thread([&server]() { server.start(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    SSL_CTX* client_ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(client_ctx, SSL_VERIFY_NONE, nullptr);
+    SSL_CTX_set_session_cache_mode(client_ctx, SSL_SESS_CACHE_CLIENT);
+
+    bench_handshakes(client_ctx, false);
+    bench_handshakes(client_ctx, true);
+    bench_bulk(client_ctx, file_size);
+
+    SSL_CTX_free(client_ctx);
+    server.stop();
+    server_thread.join();
+    std::cout.rdbuf(saved_out);
+    std::cerr.rdbuf(saved_err);
+    std::string cleanup = "rm -rf " + bench_dir;
+    return std::system(cleanup.c_str());
+}
+
+#else
+
+int main() {
+    std::cout << "Built without XEBEC_ENABLE_TLS, nothing to benchmark" << std::endl;
+    return 0;
+}
+
+#endif
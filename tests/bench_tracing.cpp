@@ -0,0 +1,70 @@
+// Cost of request tracing: a request-shaped loop with the spans the server
+// opens (request, read_request, parse_request, middleware, handle_route,
+// handler, send_response) around a small JSON response, at sample rates 0,
+// 1% and 100%, against the same loop without spans.
+//
+//     g++ -O2 -std=c++17 tests/bench_tracing.cpp -pthread
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include "../include/xebec/features/tracing.hpp"
+
+const size_t request_count = 2000000;
+
+using Kind = xebec::TraceEvent::Kind;
+
+// Stands in for parsing, routing and serializing: a small JSON body.
+size_t work(size_t i, std::string& out) {
+    out.clear();
+    xebec::JsonWriter json(out);
+    json.begin_object().field("id", i).field("name", "user").field("active", i % 2 == 0).end_object();
+    return out.size();
+}
+
+template <bool Traced>
+double ns_per_request() {
+    std::string out;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < request_count; i++) {
+        if (Traced) {
+            xebec::RequestTrace trace;
+            { xebec::TraceSpan read("read_request", Kind::Phase); }
+            {
+                xebec::TraceSpan parse("parse_request", Kind::Phase);
+                trace.describe("GET", "/users/7");
+            }
+            {
+                xebec::TraceSpan middleware("middleware", Kind::Phase);
+                xebec::TraceSpan route("handle_route", Kind::Phase);
+                xebec::TraceSpan handler("handler", Kind::Phase);
+                total += work(i, out);
+            }
+            { xebec::TraceSpan send("send_response", Kind::Phase); }
+        } else {
+            total += work(i, out);
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (total == 0) std::printf("(no output)\n");
+    return ns / request_count;
+}
+
+int main() {
+    xebec::Tracer& tracer = xebec::Tracer::global();
+    ns_per_request<false>();
+    double plain = ns_per_request<false>();
+    tracer.set_sample_rate(0);
+    double disabled = ns_per_request<true>();
+    tracer.set_sample_rate(0.01);
+    double sampled = ns_per_request<true>();
+    tracer.set_sample_rate(1);
+    double all = ns_per_request<true>();
+
+    std::printf("Tracing overhead, 7 spans per request, %zu requests:\n", request_count);
+    std::printf("  no spans          %7.1f ns/request\n", plain);
+    std::printf("  sample rate 0     %7.1f ns/request  (%+.1f ns)\n", disabled, disabled - plain);
+    std::printf("  sample rate 1%%    %7.1f ns/request  (%+.1f ns)\n", sampled, sampled - plain);
+    std::printf("  sample rate 100%%  %7.1f ns/request  (%+.1f ns per traced request)\n", all, all - plain);
+    return 0;
+}
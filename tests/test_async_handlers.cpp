@@ -0,0 +1,263 @@
+// Coroutine handler tests; needs C++20:
+//
+//     g++ -std=c++20 tests/test_async_handlers.cpp -pthread
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <set>
+#include <atomic>
+#include "../include/xebec/xebec.hpp"
+
+#if defined(XEBEC_HAS_COROUTINES) && defined(__linux__)
+
+const int test_port = 18933;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Reads one Content-Length framed response from a keep-alive connection.
+std::string read_response(SOCKET sock) {
+    std::string response;
+    char buffer[4096];
+    while (true) {
+        size_t head_end = response.find("\r\n\r\n");
+        if (head_end != std::string::npos) {
+            size_t length_pos = response.find("Content-Length: ");
+            size_t length = length_pos == std::string::npos ? 0 : std::stoul(response.substr(length_pos + 16));
+            if (response.size() >= head_end + 4 + length) return response;
+        }
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return response;
+        response.append(buffer, received);
+    }
+}
+
+int thread_count() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 8, "Threads:") == 0) return std::stoi(line.substr(8));
+    }
+    return -1;
+}
+
+void wait_until_listening() {
+    for (int i = 0; i < 200; i++) {
+        SOCKET sock = connect_to_server();
+        if (sock != INVALID_SOCKET) {
+            SOCKET_CLOSE(sock);
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void register_routes(xebec::http_server& server) {
+    server.get_async("/sleep", [](xebec::Request&, xebec::Response& res) -> xebec::task<void> {
+        co_await xebec::sleep_for(std::chrono::milliseconds(500));
+        res << "slept";
+    });
+    server.get_async("/file", [](xebec::Request&, xebec::Response& res) -> xebec::task<void> {
+        res << co_await xebec::async_read_file("xebec_async_test.txt");
+    });
+    server.get_async("/error", [](xebec::Request&, xebec::Response&) -> xebec::task<void> {
+        co_await xebec::sleep_for(std::chrono::milliseconds(1));
+        throw xebec::HttpError(418, "teapot");
+    });
+    server.get_async("/socket", [](xebec::Request&, xebec::Response& res) -> xebec::task<void> {
+        SOCKET pair[2];
+        xebec::create_socket_pair(pair);
+        bool written = co_await xebec::async_write(pair[0], "ping", 4);
+        char buffer[16];
+        int received = co_await xebec::async_read(pair[1], buffer, sizeof(buffer));
+        SOCKET_CLOSE(pair[0]);
+        SOCKET_CLOSE(pair[1]);
+        res << (written && received == 4 ? std::string(buffer, 4) : std::string("failed"));
+    });
+}
+
+// Many concurrent slow requests park on the event loop instead of holding threads.
+void test_slow_requests_hold_no_threads() {
+    const int clients = 1000;
+    int ok = 0;
+    int peak_threads = 0;
+    double seconds = 0;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        xebec::http_server server(config);
+        register_routes(server);
+        std::thread server_thread([&server]() { server.start(); });
+        wait_until_listening();
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<SOCKET> sockets;
+        std::string request = "GET /sleep HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        for (int i = 0; i < clients; i++) {
+            SOCKET sock = connect_to_server();
+            if (sock == INVALID_SOCKET) break;
+            send(sock, request.data(), request.size(), 0);
+            sockets.push_back(sock);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        peak_threads = thread_count();
+        for (SOCKET sock : sockets) {
+            if (read_response(sock).find("slept") != std::string::npos) ok++;
+            SOCKET_CLOSE(sock);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        server.stop();
+        server_thread.join();
+    }
+
+    std::cout << "Slow requests completed: " << ok << "/" << clients << " in " << seconds
+              << "s, threads while suspended: " << peak_threads << std::endl;
+    bool passed = ok == clients && peak_threads < 50 && seconds < 5;
+    std::cout << (passed ? "Async Slow Requests Test Passed" : "Async Slow Requests Test Failed") << std::endl;
+}
+
+void test_awaitables_and_keep_alive() {
+    { std::ofstream("xebec_async_test.txt") << "file contents"; }
+    std::vector<std::string> responses;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        xebec::http_server server(config);
+        register_routes(server);
+        server.get("/sync", [](xebec::Request&, xebec::Response& res) { res << "sync"; });
+        std::thread server_thread([&server]() { server.start(); });
+        wait_until_listening();
+
+        // One keep-alive connection: the loop resumes serving it after each async request.
+        SOCKET sock = connect_to_server();
+        for (const char* path : {"/file", "/error", "/socket", "/sync", "/file"}) {
+            std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            send(sock, request.data(), request.size(), 0);
+            responses.push_back(read_response(sock));
+        }
+        SOCKET_CLOSE(sock);
+        server.stop();
+        server_thread.join();
+    }
+    std::remove("xebec_async_test.txt");
+
+    bool passed = responses.size() == 5 &&
+                  responses[0].find("file contents") != std::string::npos &&
+                  responses[1].find("418") != std::string::npos &&
+                  responses[2].find("ping") != std::string::npos &&
+                  responses[3].find("sync") != std::string::npos &&
+                  responses[4].find("file contents") != std::string::npos;
+    std::cout << (passed ? "Async Awaitables Test Passed" : "Async Awaitables Test Failed") << std::endl;
+}
+
+// Requests after an async one continue on a parked worker instead of a new thread.
+void test_workers_are_reused() {
+    // Numbered per thread, since a new thread may get the id of one that has ended.
+    static std::atomic<int> next_thread{0};
+    std::set<int> threads;
+    int ok = 0;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        xebec::http_server server(config);
+        server.get_async("/nap", [](xebec::Request&, xebec::Response& res) -> xebec::task<void> {
+            co_await xebec::sleep_for(std::chrono::milliseconds(20));
+            res << "nap";
+        });
+        server.get("/where", [&threads](xebec::Request&, xebec::Response& res) {
+            thread_local int thread_number = next_thread++;
+            threads.insert(thread_number);
+            res << "where";
+        });
+        std::thread server_thread([&server]() { server.start(); });
+        wait_until_listening();
+
+        SOCKET sock = connect_to_server();
+        for (int i = 0; i < 10; i++) {
+            for (const char* path : {"/nap", "/where"}) {
+                std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+                send(sock, request.data(), request.size(), 0);
+                if (read_response(sock).find(path + 1) != std::string::npos) ok++;
+            }
+        }
+        SOCKET_CLOSE(sock);
+        server.stop();
+        server_thread.join();
+    }
+    bool passed = ok == 20 && threads.size() == 1;
+    std::cout << (passed ? "Async Worker Reuse Test Passed" : "Async Worker Reuse Test Failed") << std::endl;
+}
+
+// Middleware code after next() runs before a coroutine handler has written the
+// response, so the cache must not store it.
+void test_cache_passes_async_routes() {
+    std::string output;
+    int calls = 0;
+    {
+        QuietOutput quiet;
+        xebec::http_server server;
+        xebec::ResponseCache cache;
+        cache.route("GET", "/nap", std::chrono::seconds(60));
+        server.use(cache.middleware());
+        server.get_async("/nap", [&calls](xebec::Request&, xebec::Response& res) -> xebec::task<void> {
+            co_await xebec::sleep_for(std::chrono::milliseconds(5));
+            res << "nap " + std::to_string(++calls);
+        });
+
+        xebec::LoopbackClient client;
+        std::thread serving([&server, &client]() { server.serve(client.connect()); });
+        for (const char* body : {"nap 1", "nap 2"}) {
+            client.write("GET /nap HTTP/1.1\r\nHost: localhost\r\n\r\n");
+            client.wait_for(body);
+        }
+        client.finish();
+        serving.join();
+        for (int i = 0; i < 200 && !client.closed(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        output = client.read();
+    }
+    bool passed = calls == 2 && output.find("Content-Length: 5\r\n") != std::string::npos &&
+                  output.find("nap 2") != std::string::npos && output.find("Content-Length: 0") == std::string::npos;
+    std::cout << (passed ? "Async Cache Test Passed" : "Async Cache Test Failed") << std::endl;
+}
+
+int main() {
+    test_slow_requests_hold_no_threads();
+    test_awaitables_and_keep_alive();
+    test_workers_are_reused();
+    test_cache_passes_async_routes();
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cout << "Coroutine handlers need C++20 on Linux for this test, skipped" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,202 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18945;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+void test_io_buffer() {
+    xebec::IoBuffer buffer;
+    std::string expected;
+    std::vector<size_t> capacities;
+    for (int i = 0; i < 200; i++) {
+        std::string piece = std::to_string(i) + std::string(997, static_cast<char>('a' + i % 26));
+        buffer += piece;
+        expected += piece;
+        if (capacities.empty() || capacities.back() != buffer.capacity()) capacities.push_back(buffer.capacity());
+    }
+    bool passed = buffer.view() == expected &&
+                  capacities == std::vector<size_t>({4096, 16384, 65536, 131072, 262144});
+
+    // Consumed bytes are skipped, then moved out of the way when room is needed.
+    buffer.consume(expected.size() - 100);
+    expected.erase(0, expected.size() - 100);
+    size_t capacity = buffer.capacity();
+    buffer.append(expected.data(), 50);
+    expected.append(expected.data(), 50);
+    passed = passed && buffer.view() == expected && buffer.capacity() == capacity &&
+             buffer.find("198") == expected.find("198");
+    buffer.consume(buffer.size());
+    passed = passed && buffer.empty() && buffer.room() == capacity;
+
+    char* space = buffer.prepare(10);
+    std::memcpy(space, "0123456789", 10);
+    buffer.commit(4);
+    passed = passed && buffer.view() == "0123";
+    buffer.release();
+    passed = passed && buffer.empty() && buffer.capacity() == 0;
+    std::cout << (passed ? "IoBuffer Test Passed" : "IoBuffer Test Failed") << std::endl;
+}
+
+void test_pool() {
+    xebec::BufferPool& pool = xebec::BufferPool::global();
+    size_t in_use = pool.stats().in_use;
+    size_t capacity;
+    char* first = pool.acquire(100, capacity);
+    bool passed = capacity == 4096 && pool.stats().in_use == in_use + 1;
+    pool.release(first, capacity);
+    char* again = pool.acquire(4096, capacity);
+    passed = passed && again == first && capacity == 4096;
+    char* middle = pool.acquire(4097, capacity);
+    passed = passed && capacity == 16384;
+    pool.release(middle, capacity);
+    pool.release(again, 4096);
+    passed = passed && pool.stats().in_use == in_use;
+
+    // Blocks given back by a thread that has ended are reused by others.
+    pool.flush_thread_cache();
+    std::vector<char*> blocks;
+    std::thread([&]() {
+        for (int i = 0; i < 20; i++) {
+            size_t ignored;
+            blocks.push_back(pool.acquire(65536, ignored));
+        }
+        for (char* block : blocks) pool.release(block, 65536);
+    }).join();
+    passed = passed && pool.stats().cached >= 20;
+    size_t allocated = pool.stats().allocated;
+    char* reused = pool.acquire(65536, capacity);
+    passed = passed && std::find(blocks.begin(), blocks.end(), reused) != blocks.end() &&
+             pool.stats().allocated == allocated;
+    pool.release(reused, capacity);
+
+    // Past the depot's limit blocks are freed.
+    pool.flush_thread_cache();
+    pool.set_max_cached_bytes(0);
+    passed = passed && pool.stats().cached == 0;
+    pool.set_max_cached_bytes(32 * 1024 * 1024);
+
+    char* large = pool.acquire(100000, capacity);
+    passed = passed && capacity == 100000 && pool.stats().in_use == in_use;
+    pool.release(large, capacity);
+    std::cout << (passed ? "Buffer Pool Test Passed" : "Buffer Pool Test Failed") << std::endl;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+bool read_until(SOCKET sock, std::string& pending, const std::string& needle) {
+    char buffer[4096];
+    while (pending.find(needle) == std::string::npos) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending.append(buffer, received);
+    }
+    return true;
+}
+
+bool send_text(SOCKET sock, const std::string& text) {
+    return send(sock, text.data(), text.size(), 0) == static_cast<int>(text.size());
+}
+
+// Waits for the pool's count of blocks in use to reach `count`.
+bool in_use_becomes(size_t count) {
+    for (int i = 0; i < 200 && xebec::BufferPool::global().stats().in_use != count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return xebec::BufferPool::global().stats().in_use == count;
+}
+
+bool run_pooled_server(xebec::IoBackend backend) {
+    QuietOutput quiet;
+    xebec::ServerConfig config;
+    config.port = test_port;
+    config.io_backend = backend;
+    xebec::http_server server(config);
+    server.get("/hello", [](xebec::Request&, xebec::Response& res) { res << "hello"; });
+    server.post("/echo", [](xebec::Request& req, xebec::Response& res) {
+        res << "size " + std::to_string(req.body.size()) + " last " + req.body.back();
+    });
+
+    std::thread server_thread([&server]() { server.start(); });
+    for (int i = 0; i < 200; i++) {
+        SOCKET probe = connect_to_server();
+        if (probe != INVALID_SOCKET) {
+            SOCKET_CLOSE(probe);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    size_t baseline = xebec::BufferPool::global().stats().in_use;
+
+    // Idle keep-alive connections hold no blocks.
+    std::vector<SOCKET> idle;
+    bool passed = true;
+    for (int i = 0; i < 16; i++) {
+        SOCKET sock = connect_to_server();
+        std::string pending;
+        passed = passed && send_text(sock, "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n") &&
+                 read_until(sock, pending, "hello");
+        idle.push_back(sock);
+    }
+    passed = passed && in_use_becomes(baseline);
+
+    // A connection with half a request does, until the request is complete.
+    SOCKET busy = connect_to_server();
+    std::string pending;
+    passed = passed && send_text(busy, "GET /hello HTTP/1.1\r\n") && in_use_becomes(baseline + 1) &&
+             send_text(busy, "Host: localhost\r\n\r\n") && read_until(busy, pending, "hello") &&
+             in_use_becomes(baseline);
+
+    // Pipelined requests, one with a body larger than the largest class.
+    std::string body(200000, 'x');
+    body.back() = 'z';
+    std::string requests = "POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                           std::to_string(body.size()) + "\r\n\r\n" + body +
+                           "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    pending.clear();
+    passed = passed && send_text(busy, requests) && read_until(busy, pending, "size 200000 last z") &&
+             read_until(busy, pending, "hello") && in_use_becomes(baseline);
+
+    SOCKET_CLOSE(busy);
+    for (SOCKET sock : idle) SOCKET_CLOSE(sock);
+    server.stop();
+    server_thread.join();
+    return passed;
+}
+
+int main() {
+    test_io_buffer();
+    test_pool();
+    bool passed = run_pooled_server(xebec::IoBackend::Threads);
+    std::cout << (passed ? "Pooled Server Test Passed" : "Pooled Server Test Failed") << std::endl;
+#ifdef XEBEC_HAS_IO_URING
+    if (xebec::IoUring::supported()) {
+        passed = run_pooled_server(xebec::IoBackend::IoUring);
+        std::cout << (passed ? "Pooled Server io_uring Test Passed" : "Pooled Server io_uring Test Failed")
+                  << std::endl;
+    }
+#endif
+    return 0;
+}
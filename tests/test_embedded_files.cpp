@@ -0,0 +1,190 @@
+// Built by test.bat after packing tests/public:
+//
+//     g++ -o xebec_embed tools/xebec_embed.cpp -std=c++17
+//     xebec_embed --dir tests/public --include include/xebec/features/embedded_files.hpp
+//                 -o generated/embedded_generated.hpp
+//     g++ -I. -Igenerated tests/test_embedded_files.cpp -std=c++17
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "../include/xebec/xebec.hpp"
+#include "embedded_generated.hpp"
+
+const int test_port = 18942;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+std::string read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+void test_embedded_lookup() {
+    const xebec::EmbeddedDirectory& files = public_files::files;
+    bool passed = files.file_count == 4;
+    for (const char* path : {"/index.html", "/css/site.css", "/img/pixel.png", "/empty.txt"}) {
+        const xebec::EmbeddedFile* file = files.find(path);
+        passed = passed && file && file->path == path &&
+                 file->identity.data == read_file(std::string("tests/public") + path);
+    }
+    for (const char* path : {"/", "", "/index.htm", "index.html", "/css", "/css/site.css.gz", "/missing"}) {
+        passed = passed && files.find(path) == nullptr;
+    }
+    const xebec::EmbeddedFile* css = files.find("/css/site.css");
+    passed = passed && css && css->content_type == "text/css" &&
+             css->gzip.data == read_file("tests/public/css/site.css.gz") && !css->br.present() &&
+             css->gzip.etag != css->identity.etag;
+
+    // The index for a larger set: every key in its own slot.
+    std::vector<std::string> keys;
+    for (int i = 0; i < 20000; i++) keys.push_back("/assets/" + std::to_string(i * 7919) + ".js");
+    std::vector<std::string_view> paths(keys.begin(), keys.end());
+    std::vector<uint32_t> seeds, slots;
+    xebec::detail::build_embedded_index(paths, seeds, slots);
+    std::vector<xebec::EmbeddedFile> entries(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) entries[i].path = keys[i];
+    xebec::EmbeddedDirectory large{entries.data(), entries.size(), seeds.data(), seeds.size(),
+                                   slots.data(), slots.size()};
+    for (size_t i = 0; i < keys.size(); i++) passed = passed && large.find(keys[i]) == &entries[i];
+    passed = passed && large.find("/assets/1.js") == nullptr;
+
+    passed = passed && xebec::accepts_encoding("gzip, deflate, br", "br") &&
+             xebec::accepts_encoding("GZip;q=0.5", "gzip") &&
+             !xebec::accepts_encoding("gzip;q=0, br", "gzip") &&
+             !xebec::accepts_encoding("gzip;q=0.000", "gzip") &&
+             xebec::accepts_encoding("*", "br") &&
+             !xebec::accepts_encoding("identity", "gzip") &&
+             !xebec::accepts_encoding("", "gzip");
+    std::cout << (passed ? "Embedded Lookup Test Passed" : "Embedded Lookup Test Failed") << std::endl;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+struct Reply {
+    std::string head;
+    std::string body;
+
+    std::string header(const std::string& name) const {
+        size_t pos = head.find("\r\n" + name + ": ");
+        if (pos == std::string::npos) return "";
+        pos += name.size() + 4;
+        return head.substr(pos, head.find("\r\n", pos) - pos);
+    }
+    std::string status() const { return head.substr(9, 3); }
+};
+
+// Sends a GET on the keep-alive connection and reads the Content-Length framed reply.
+Reply get(SOCKET sock, std::string& pending, const std::string& path, const std::string& headers = "") {
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n";
+    send(sock, request.data(), request.size(), 0);
+    Reply reply;
+    char buffer[4096];
+    size_t head_end;
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return reply;
+        pending.append(buffer, received);
+    }
+    reply.head = pending.substr(0, head_end + 2);
+    pending.erase(0, head_end + 4);
+    std::string length = reply.header("Content-Length");
+    size_t size = length.empty() ? 0 : std::stoul(length);
+    while (pending.size() < size) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return reply;
+        pending.append(buffer, received);
+    }
+    reply.body = pending.substr(0, size);
+    pending.erase(0, size);
+    return reply;
+}
+
+bool run_embedded_server(xebec::IoBackend backend) {
+    std::vector<Reply> replies;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.io_backend = backend;
+        xebec::http_server server(config);
+        server.publicDir(public_files::files);
+        server.get("/home", [](xebec::Request&, xebec::Response& res) { res.html("index.html"); });
+
+        std::thread server_thread([&server]() { server.start(); });
+        for (int i = 0; i < 200; i++) {
+            SOCKET probe = connect_to_server();
+            if (probe != INVALID_SOCKET) {
+                SOCKET_CLOSE(probe);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        SOCKET sock = connect_to_server();
+        std::string pending;
+        replies.push_back(get(sock, pending, "/index.html"));
+        replies.push_back(get(sock, pending, "/css/site.css", "Accept-Encoding: gzip, deflate\r\n"));
+        replies.push_back(get(sock, pending, "/css/site.css"));
+        replies.push_back(get(sock, pending, "/css/site.css", "If-None-Match: " + replies[2].header("ETag") + "\r\n"));
+        replies.push_back(get(sock, pending, "/css/site.css", "Range: bytes=3-12\r\nAccept-Encoding: gzip\r\n"));
+        replies.push_back(get(sock, pending, "/home"));
+        replies.push_back(get(sock, pending, "/empty.txt"));
+        replies.push_back(get(sock, pending, "/missing.html"));
+        SOCKET_CLOSE(sock);
+
+        server.stop();
+        server_thread.join();
+    }
+
+    std::string css = read_file("tests/public/css/site.css");
+    return replies.size() == 8 &&
+                  replies[0].status() == "200" && replies[0].body == read_file("tests/public/index.html") &&
+                  replies[0].header("Content-Type") == "text/html" &&
+                  replies[1].header("Content-Encoding") == "gzip" && replies[1].header("Vary") == "Accept-Encoding" &&
+                  replies[1].body == read_file("tests/public/css/site.css.gz") &&
+                  replies[2].header("Content-Encoding").empty() && replies[2].body == css &&
+                  replies[3].status() == "304" && replies[3].body.empty() &&
+                  replies[4].status() == "206" && replies[4].body == css.substr(3, 10) &&
+                  replies[4].header("Content-Range") == "bytes 3-12/" + std::to_string(css.size()) &&
+                  replies[5].body == replies[0].body &&
+                  replies[6].status() == "200" && replies[6].header("Content-Length") == "0" &&
+                  replies[7].status() == "404";
+}
+
+int main() {
+    test_embedded_lookup();
+    bool passed = run_embedded_server(xebec::IoBackend::Threads);
+    std::cout << (passed ? "Embedded Server Test Passed" : "Embedded Server Test Failed") << std::endl;
+#ifdef XEBEC_HAS_IO_URING
+    if (xebec::IoUring::supported()) {
+        passed = run_embedded_server(xebec::IoBackend::IoUring);
+        std::cout << (passed ? "Embedded Server io_uring Test Passed" : "Embedded Server io_uring Test Failed")
+                  << std::endl;
+    }
+#endif
+    return 0;
+}
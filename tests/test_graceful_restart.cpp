@@ -0,0 +1,231 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include "../include/xebec/xebec.hpp"
+
+#ifndef _WIN32
+
+const int test_port = 18928;
+
+// Silences the server's per-request logging while a test runs.
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Sends one request with "Connection: close" and returns the raw response, or "" on failure.
+std::string http_get(const std::string& path) {
+    SOCKET sock = connect_to_server();
+    if (sock == INVALID_SOCKET) return "";
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    send(sock, request.data(), request.size(), 0);
+    std::string response;
+    char buffer[1024];
+    int received;
+    while ((received = recv(sock, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, received);
+    }
+    SOCKET_CLOSE(sock);
+    return response;
+}
+
+void wait_until_listening() {
+    for (int i = 0; i < 200; i++) {
+        SOCKET sock = connect_to_server();
+        if (sock != INVALID_SOCKET) {
+            SOCKET_CLOSE(sock);
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// The replacement process started by upgrade().
+int run_replacement() {
+    QuietOutput quiet;
+    xebec::ServerConfig config;
+    config.port = test_port;
+    xebec::http_server server(config);
+    server.get("/", [](xebec::Request&, xebec::Response& res) {
+        res << "generation 2";
+    });
+    server.get("/quit", [&server](xebec::Request&, xebec::Response& res) {
+        std::thread([&server]() { server.stop(); }).detach();
+        res << "bye";
+    });
+    server.start();
+    return 0;
+}
+
+void test_stop_drains_in_flight() {
+    xebec::ServerConfig config;
+    config.port = test_port;
+    int completed = 0;
+    bool idle_closed = false;
+    {
+        QuietOutput quiet;
+        xebec::http_server server(config);
+        server.get("/slow", [](xebec::Request&, xebec::Response& res) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            res << "done";
+        });
+        server.get("/fast", [](xebec::Request&, xebec::Response& res) {
+            res << "fast";
+        });
+        std::thread server_thread([&server]() { server.start(); });
+        wait_until_listening();
+
+        // An idle keep-alive connection must be closed by stop().
+        SOCKET idle = connect_to_server();
+        std::string request = "GET /fast HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        send(idle, request.data(), request.size(), 0);
+        char buffer[1024];
+        recv(idle, buffer, sizeof(buffer), 0);
+
+        std::vector<std::string> responses(8);
+        std::vector<std::thread> clients;
+        for (size_t i = 0; i < responses.size(); i++) {
+            clients.emplace_back([&responses, i]() { responses[i] = http_get("/slow"); });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        server.stop();
+        for (auto& client : clients) client.join();
+        server_thread.join();
+
+        idle_closed = recv(idle, buffer, sizeof(buffer), 0) == 0;
+        SOCKET_CLOSE(idle);
+        for (const auto& response : responses) {
+            if (response.find("200 OK") != std::string::npos && response.find("done") != std::string::npos) {
+                completed++;
+            }
+        }
+    }
+
+    std::cout << "In-flight requests completed: " << completed << "/8" << std::endl;
+    std::cout << "Idle keep-alive closed: " << (idle_closed ? "yes" : "no") << std::endl;
+    if (completed == 8 && idle_closed) {
+        std::cout << "Graceful Stop Test Passed" << std::endl;
+    } else {
+        std::cout << "Graceful Stop Test Failed" << std::endl;
+    }
+}
+
+// stop() gives up on a handler that outlasts it, but the server is not torn down
+// under the handler's connection thread.
+void test_destructor_waits_for_connections() {
+    xebec::ServerConfig config;
+    config.port = test_port;
+    std::atomic<bool> handler_done{false};
+    bool waited = false;
+    {
+        QuietOutput quiet;
+        auto server = std::make_unique<xebec::http_server>(config);
+        server->get("/stuck", [&handler_done](xebec::Request&, xebec::Response& res) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+            handler_done = true;
+            res << "late";
+        });
+        std::thread server_thread([&server]() { server->start(); });
+        wait_until_listening();
+        std::thread client([]() { http_get("/stuck"); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        server->stop(std::chrono::milliseconds(0));
+        server_thread.join();
+        server.reset();
+        waited = handler_done;
+        client.join();
+    }
+
+    std::cout << (waited ? "Destructor Wait Test Passed" : "Destructor Wait Test Failed") << std::endl;
+}
+
+void test_upgrade_under_load(const char* self) {
+    xebec::ServerConfig config;
+    config.port = test_port;
+    std::atomic<bool> done{false};
+    std::atomic<int> total{0}, failed{0}, second_generation{0};
+    pid_t child = -1;
+    {
+        QuietOutput quiet;
+        xebec::http_server server(config);
+        server.get("/", [](xebec::Request&, xebec::Response& res) {
+            res << "generation 1";
+        });
+        std::thread server_thread([&server]() { server.start(); });
+        wait_until_listening();
+
+        std::vector<std::thread> clients;
+        for (int i = 0; i < 8; i++) {
+            clients.emplace_back([&]() {
+                while (!done) {
+                    std::string response = http_get("/");
+                    total++;
+                    if (response.find("200 OK") == std::string::npos) {
+                        failed++;
+                    } else if (response.find("generation 2") != std::string::npos) {
+                        second_generation++;
+                    }
+                }
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        child = server.upgrade({self, "--replacement"});
+        server_thread.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        done = true;
+        for (auto& client : clients) client.join();
+
+        http_get("/quit");
+        if (child > 0) waitpid(child, nullptr, 0);
+    }
+
+    std::cout << "Requests during upgrade: " << total << ", failed: " << failed
+              << ", served by replacement: " << second_generation << std::endl;
+    if (child > 0 && failed == 0 && second_generation > 0) {
+        std::cout << "Hot Upgrade Test Passed" << std::endl;
+    } else {
+        std::cout << "Hot Upgrade Test Failed" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--replacement") == 0) {
+        return run_replacement();
+    }
+    test_stop_drains_in_flight();
+    test_destructor_waits_for_connections();
+    test_upgrade_under_load(argv[0]);
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cout << "Graceful restart tests require a POSIX system, skipped" << std::endl;
+    return 0;
+}
+
+#endif
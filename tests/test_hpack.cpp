@@ -0,0 +1,123 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../include/xebec/features/hpack.hpp"
+
+using xebec::hpack::HeaderField;
+
+std::string from_hex(const std::string& hex) {
+    std::string bytes;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes += static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16));
+    }
+    return bytes;
+}
+
+std::string to_hex(const std::string& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (unsigned char c : bytes) {
+        hex += digits[c >> 4];
+        hex += digits[c & 0xF];
+    }
+    return hex;
+}
+
+bool same_headers(const std::vector<HeaderField>& a, const std::vector<HeaderField>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].name != b[i].name || a[i].value != b[i].value) return false;
+    }
+    return true;
+}
+
+// RFC 7541 C.4: requests with Huffman coding, sharing one dynamic table.
+void test_request_examples() {
+    const std::vector<std::pair<std::string, std::vector<HeaderField>>> examples = {
+        {"828684418cf1e3c2e5f23a6ba0ab90f4ff",
+         {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}}},
+        {"828684be5886a8eb10649cbf",
+         {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"},
+          {"cache-control", "no-cache"}}},
+        {"828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf",
+         {{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"},
+          {"custom-key", "custom-value"}}},
+    };
+
+    xebec::hpack::Decoder decoder;
+    xebec::hpack::Encoder encoder;
+    bool passed = true;
+    for (const auto& [hex, expected] : examples) {
+        std::string block = from_hex(hex);
+        std::vector<HeaderField> decoded;
+        if (!decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), decoded) ||
+            !same_headers(decoded, expected)) {
+            std::cout << "Decode mismatch for " << hex << std::endl;
+            passed = false;
+        }
+
+        std::string encoded;
+        encoder.encode(expected, encoded);
+        if (to_hex(encoded) != hex) {
+            std::cout << "Encoded: " << to_hex(encoded) << std::endl;
+            std::cout << "Expected: " << hex << std::endl;
+            passed = false;
+        }
+    }
+
+    std::cout << (passed ? "HPACK Request Test Passed" : "HPACK Request Test Failed") << std::endl;
+}
+
+// RFC 7541 C.6: responses with Huffman coding and a 256 byte dynamic table,
+// which forces evictions.
+void test_response_examples() {
+    const std::vector<std::pair<std::string, std::vector<HeaderField>>> examples = {
+        {"488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3",
+         {{":status", "302"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+          {"location", "https://www.example.com"}}},
+        {"4883640effc1c0bf",
+         {{":status", "307"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:21 GMT"},
+          {"location", "https://www.example.com"}}},
+        {"88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007",
+         {{":status", "200"}, {"cache-control", "private"}, {"date", "Mon, 21 Oct 2013 20:13:22 GMT"},
+          {"location", "https://www.example.com"}, {"content-encoding", "gzip"},
+          {"set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"}}},
+    };
+
+    xebec::hpack::Decoder decoder;
+    decoder.set_max_table_size(256);
+    bool passed = true;
+    std::string block = from_hex("3fe101");  // table size update to 256
+    std::vector<HeaderField> ignored;
+    passed = decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), ignored) && ignored.empty();
+    for (const auto& [hex, expected] : examples) {
+        block = from_hex(hex);
+        std::vector<HeaderField> decoded;
+        if (!decoder.decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), decoded) ||
+            !same_headers(decoded, expected)) {
+            std::cout << "Decode mismatch for " << hex << std::endl;
+            passed = false;
+        }
+    }
+
+    std::cout << (passed ? "HPACK Response Test Passed" : "HPACK Response Test Failed") << std::endl;
+}
+
+void test_huffman_round_trip() {
+    std::string input;
+    for (int i = 0; i < 256; i++) input += static_cast<char>(i);
+    std::string encoded, decoded;
+    const auto& huffman = xebec::hpack::Huffman::instance();
+    huffman.encode(input, encoded);
+    bool passed = encoded.size() == huffman.encoded_length(input) &&
+                  huffman.decode(reinterpret_cast<const uint8_t*>(encoded.data()), encoded.size(), decoded) &&
+                  decoded == input;
+    std::cout << (passed ? "Huffman Round Trip Test Passed" : "Huffman Round Trip Test Failed") << std::endl;
+}
+
+int main() {
+    test_request_examples();
+    test_response_examples();
+    test_huffman_round_trip();
+    return 0;
+}
@@ -0,0 +1,300 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18947;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+struct Frame {
+    uint8_t type = 0;
+    uint8_t flags = 0;
+    uint32_t stream = 0;
+    std::string payload;
+};
+
+struct StreamResult {
+    std::string status;
+    std::string body;
+    bool ended = false;
+};
+
+std::string u32(uint32_t value) {
+    std::string bytes;
+    for (int shift = 24; shift >= 0; shift -= 8) bytes += static_cast<char>((value >> shift) & 0xFF);
+    return bytes;
+}
+
+std::string frame(uint8_t type, uint8_t flags, uint32_t stream, const std::string& payload) {
+    std::string bytes = u32(static_cast<uint32_t>(payload.size())).substr(1);
+    bytes += static_cast<char>(type);
+    bytes += static_cast<char>(flags);
+    return bytes + u32(stream) + payload;
+}
+
+std::string setting(uint16_t id, uint32_t value) {
+    return std::string(1, static_cast<char>(id >> 8)) + static_cast<char>(id & 0xFF) + u32(value);
+}
+
+// A minimal HTTP/2 client over a TCP connection to the test server.
+class H2Client {
+public:
+    explicit H2Client(SOCKET sock) : sock_(sock) {}
+    ~H2Client() { SOCKET_CLOSE(sock_); }
+
+    bool send_bytes(const std::string& bytes) {
+        return send(sock_, bytes.data(), bytes.size(), 0) == static_cast<int>(bytes.size());
+    }
+
+    // The connection preface and our SETTINGS.
+    bool start(const std::string& settings = "") {
+        return send_bytes(std::string(xebec::h2_client_preface) + frame(0x4, 0, 0, settings));
+    }
+
+    bool request(uint32_t stream, const std::string& path) {
+        std::string block;
+        encoder_.encode({{":method", "GET"}, {":scheme", "http"}, {":path", path}, {":authority", "localhost"}},
+                        block);
+        return send_bytes(frame(0x1, 0x5, stream, block));
+    }
+
+    bool window_update(uint32_t stream, uint32_t increment) {
+        return send_bytes(frame(0x8, 0, stream, u32(increment)));
+    }
+
+    // Reads frames into `streams` for up to `timeout_ms`, until `done` holds.
+    // Streams are added to `finished` in the order their END_STREAM arrives.
+    template <typename Done>
+    bool read_until(Done done, int timeout_ms = 3000) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (!done()) {
+            Frame next;
+            int left = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count());
+            if (left <= 0 || !read_frame(next, left)) return false;
+            if (!handle(next)) return false;
+        }
+        return true;
+    }
+
+    // Consumes bytes that precede the frames, such as a 101 response.
+    bool read_text_until(const std::string& needle, std::string& text) {
+        while (true) {
+            size_t end = pending_.find(needle);
+            if (end != std::string::npos) {
+                text = pending_.substr(0, end + needle.size());
+                pending_.erase(0, end + needle.size());
+                return true;
+            }
+            if (!receive(3000)) return false;
+        }
+    }
+
+    std::map<uint32_t, StreamResult> streams;
+    std::vector<uint32_t> finished;
+
+private:
+    SOCKET sock_;
+    std::string pending_;
+    xebec::hpack::Encoder encoder_;
+    xebec::hpack::Decoder decoder_;
+
+    bool receive(int timeout_ms) {
+        pollfd pfd{};
+        pfd.fd = sock_;
+        pfd.events = POLLIN;
+        if (SOCKET_POLL(&pfd, 1, timeout_ms) <= 0) return false;
+        char buffer[16384];
+        int received = recv(sock_, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending_.append(buffer, received);
+        return true;
+    }
+
+    size_t pending_length() const {
+        const uint8_t* head = reinterpret_cast<const uint8_t*>(pending_.data());
+        return (static_cast<size_t>(head[0]) << 16) | (head[1] << 8) | head[2];
+    }
+
+    bool read_frame(Frame& out, int timeout_ms) {
+        while (pending_.size() < 9 || pending_.size() < 9 + pending_length()) {
+            if (!receive(timeout_ms)) return false;
+        }
+        const uint8_t* head = reinterpret_cast<const uint8_t*>(pending_.data());
+        size_t length = pending_length();
+        out.type = head[3];
+        out.flags = head[4];
+        out.stream = ((head[5] & 0x7F) << 24) | (head[6] << 16) | (head[7] << 8) | head[8];
+        out.payload = pending_.substr(9, length);
+        pending_.erase(0, 9 + length);
+        return true;
+    }
+
+    bool handle(const Frame& next) {
+        if (next.type == 0x7 || next.type == 0x3) return false;  // GOAWAY, RST_STREAM
+        if (next.type == 0x1) {
+            std::vector<xebec::hpack::HeaderField> fields;
+            if (!(next.flags & 0x4) ||
+                !decoder_.decode(reinterpret_cast<const uint8_t*>(next.payload.data()), next.payload.size(), fields)) {
+                return false;
+            }
+            for (const auto& field : fields) {
+                if (field.name == ":status") streams[next.stream].status = field.value;
+            }
+        } else if (next.type == 0x0) {
+            streams[next.stream].body += next.payload;
+        } else {
+            return true;
+        }
+        if (next.flags & 0x1) {
+            streams[next.stream].ended = true;
+            finished.push_back(next.stream);
+        }
+        return true;
+    }
+};
+
+const size_t max_handlers = 2;
+std::atomic<int> handlers_in_flight{0};
+std::atomic<int> most_handlers_in_flight{0};
+
+void register_routes(xebec::http_server& server) {
+    server.get("/hello", [](xebec::Request& req, xebec::Response& res) {
+        res << "hello " + req.version;
+    });
+    server.get("/slow", [](xebec::Request&, xebec::Response& res) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        res << "slow";
+    });
+    server.get("/big", [](xebec::Request&, xebec::Response& res) { res << std::string(70000, 'b'); });
+    server.get("/counted", [](xebec::Request&, xebec::Response& res) {
+        int now = ++handlers_in_flight;
+        int most = most_handlers_in_flight;
+        while (now > most && !most_handlers_in_flight.compare_exchange_weak(most, now)) {}
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        handlers_in_flight--;
+        res << "counted";
+    });
+}
+
+bool test_prior_knowledge() {
+    H2Client client(connect_to_server());
+    bool passed = client.start() && client.request(1, "/hello") &&
+                  client.read_until([&] { return client.streams[1].ended; });
+    passed = passed && client.streams[1].status == "200" && client.streams[1].body == "hello HTTP/2.0";
+    return passed;
+}
+
+bool test_upgrade() {
+    H2Client client(connect_to_server());
+    // HTTP2-Settings: MAX_CONCURRENT_STREAMS = 100, base64url encoded.
+    std::string switching;
+    bool passed = client.send_bytes("GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+                                    "Upgrade: h2c\r\nHTTP2-Settings: AAMAAABk\r\n\r\n") &&
+                  client.read_text_until("\r\n\r\n", switching) &&
+                  switching.find("101 Switching Protocols") != std::string::npos;
+    // The upgrading request is answered as stream 1; the connection then takes new streams.
+    passed = passed && client.start() && client.request(3, "/hello") &&
+             client.read_until([&] { return client.streams[1].ended && client.streams[3].ended; });
+    passed = passed && client.streams[1].status == "200" && client.streams[1].body == "hello HTTP/2.0" &&
+             client.streams[3].body == "hello HTTP/2.0";
+    return passed;
+}
+
+bool test_multiplexing() {
+    H2Client client(connect_to_server());
+    // A slow handler on stream 1 does not hold up the streams opened after it.
+    bool passed = client.start() && client.request(1, "/slow") && client.request(3, "/hello") &&
+                  client.request(5, "/hello") &&
+                  client.read_until([&] { return client.finished.size() == 3; });
+    passed = passed && client.finished.back() == 1 && client.streams[1].body == "slow" &&
+             client.streams[3].body == "hello HTTP/2.0" && client.streams[5].body == "hello HTTP/2.0";
+    return passed;
+}
+
+// Requests beyond http2_max_handlers wait for a handler of the session to finish.
+bool test_handler_limit() {
+    H2Client client(connect_to_server());
+    bool passed = client.start();
+    for (uint32_t stream = 1; stream <= 11; stream += 2) passed = passed && client.request(stream, "/counted");
+    passed = passed && client.read_until([&] { return client.finished.size() == 6; });
+    for (uint32_t stream = 1; stream <= 11; stream += 2) passed = passed && client.streams[stream].body == "counted";
+    return passed && most_handlers_in_flight == static_cast<int>(max_handlers);
+}
+
+bool test_flow_control() {
+    H2Client client(connect_to_server());
+    StreamResult& big = client.streams[1];
+    // INITIAL_WINDOW_SIZE = 100: the server sends 100 bytes, then waits.
+    bool passed = client.start(setting(0x4, 100)) && client.request(1, "/big") &&
+                  client.read_until([&] { return big.body.size() == 100; }) &&
+                  !client.read_until([&] { return big.body.size() > 100; }, 300);
+
+    // The stream window is opened, but the connection window (65535) stops it.
+    passed = passed && client.window_update(1, 69900) &&
+             client.read_until([&] { return big.body.size() == 65535; }) &&
+             !client.read_until([&] { return big.body.size() > 65535; }, 300);
+
+    passed = passed && client.window_update(0, 10000) && client.read_until([&] { return big.ended; }) &&
+             big.body == std::string(70000, 'b');
+    return passed;
+}
+
+int main() {
+    std::vector<std::pair<std::string, bool>> results;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.http2_max_handlers = max_handlers;
+        xebec::http_server server(config);
+        register_routes(server);
+        std::thread server_thread([&server]() { server.start(); });
+        for (int i = 0; i < 200; i++) {
+            SOCKET probe = connect_to_server();
+            if (probe != INVALID_SOCKET) {
+                SOCKET_CLOSE(probe);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        results.push_back({"Prior Knowledge", test_prior_knowledge()});
+        results.push_back({"Upgrade", test_upgrade()});
+        results.push_back({"Multiplexing", test_multiplexing()});
+        results.push_back({"Handler Limit", test_handler_limit()});
+        results.push_back({"Flow Control", test_flow_control()});
+
+        server.stop();
+        server_thread.join();
+    }
+    for (const auto& [name, passed] : results) {
+        std::cout << "HTTP/2 " << name << (passed ? " Test Passed" : " Test Failed") << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include "../include/xebec/xebec.hpp"
+
+#ifdef XEBEC_HAS_IO_URING
+
+const int test_port = 18934;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+void send_text(SOCKET sock, const std::string& text) {
+    send(sock, text.data(), text.size(), 0);
+}
+
+// Reads one Content-Length framed response and returns its body.
+std::string read_body(SOCKET sock, std::string& pending) {
+    char buffer[65536];
+    while (true) {
+        size_t head_end = pending.find("\r\n\r\n");
+        if (head_end != std::string::npos) {
+            size_t length_pos = pending.find("Content-Length: ");
+            size_t length = length_pos < head_end ? std::stoul(pending.substr(length_pos + 16)) : 0;
+            if (pending.size() >= head_end + 4 + length) {
+                std::string body = pending.substr(head_end + 4, length);
+                pending.erase(0, head_end + 4 + length);
+                return body;
+            }
+        }
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return "<closed>";
+        pending.append(buffer, received);
+    }
+}
+
+// Reads a response head, for a response without a body.
+std::string read_head(SOCKET sock, std::string& pending) {
+    char buffer[65536];
+    size_t head_end;
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return "<closed>";
+        pending.append(buffer, received);
+    }
+    std::string head = pending.substr(0, head_end + 4);
+    pending.erase(0, head_end + 4);
+    return head;
+}
+
+bool wait_until_listening() {
+    for (int i = 0; i < 200; i++) {
+        SOCKET sock = connect_to_server();
+        if (sock != INVALID_SOCKET) {
+            SOCKET_CLOSE(sock);
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+void test_io_uring_backend() {
+    std::string asset(300 * 1024 + 123, '\0');
+    for (size_t i = 0; i < asset.size(); i++) asset[i] = static_cast<char>('a' + (i * 7) % 26);
+    std::system("mkdir -p xebec_uring_public");
+    { std::ofstream("xebec_uring_public/asset.txt", std::ios::binary) << asset; }
+
+    std::vector<std::string> bodies;
+    std::string head_response;
+    std::string upgrade_response;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.io_backend = xebec::IoBackend::IoUring;
+        xebec::http_server server(config);
+        server.publicDir("xebec_uring_public");
+        server.get("/hello", [](xebec::Request&, xebec::Response& res) { res << "hello"; });
+        server.post("/echo", [](xebec::Request& req, xebec::Response& res) { res << req.body; });
+        server.ws("/ws", [](xebec::WebSocketFrame&, std::function<void(const xebec::WebSocketFrame&)>) {});
+        std::thread server_thread([&server]() { server.start(); });
+        wait_until_listening();
+
+        // Keep-alive, pipelining, a body split across writes and a static file on one connection.
+        SOCKET sock = connect_to_server();
+        std::string pending;
+        send_text(sock, "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        bodies.push_back(read_body(sock, pending));
+        send_text(sock, "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                        "GET /missing HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                        "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        for (int i = 0; i < 3; i++) bodies.push_back(read_body(sock, pending));
+        send_text(sock, "POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 10\r\n\r\nhello");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        send_text(sock, " ring");
+        bodies.push_back(read_body(sock, pending));
+        send_text(sock, "GET /asset.txt HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        bodies.push_back(read_body(sock, pending));
+        send_text(sock, "GET /asset.txt HTTP/1.1\r\nHost: localhost\r\nRange: bytes=100000-100009\r\n\r\n");
+        bodies.push_back(read_body(sock, pending));
+        send_text(sock, "HEAD /asset.txt HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        head_response = read_head(sock, pending);
+        send_text(sock, "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n");
+        bodies.push_back(read_body(sock, pending));
+        bodies.push_back(read_body(sock, pending));
+        SOCKET_CLOSE(sock);
+
+        // An upgrade is handed over to a connection thread.
+        sock = connect_to_server();
+        send_text(sock, "GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+        char buffer[1024];
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received > 0) upgrade_response.assign(buffer, received);
+        SOCKET_CLOSE(sock);
+
+        server.stop();
+        server_thread.join();
+    }
+    std::remove("xebec_uring_public/asset.txt");
+    std::remove("xebec_uring_public");
+
+    bool passed = bodies.size() == 9 &&
+                  bodies[0] == "hello" && bodies[1] == "hello" &&
+                  bodies[2].find("error") != std::string::npos && bodies[3] == "hello" &&
+                  bodies[4] == "hello ring" && bodies[5] == asset &&
+                  bodies[6] == asset.substr(100000, 10) && bodies[7] == "hello" &&
+                  bodies[8] == "<closed>" &&
+                  head_response.find("Content-Length: " + std::to_string(asset.size()) + "\r\n") != std::string::npos &&
+                  upgrade_response.find("101") != std::string::npos &&
+                  upgrade_response.find("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") != std::string::npos;
+    std::cout << (passed ? "io_uring Backend Test Passed" : "io_uring Backend Test Failed") << std::endl;
+}
+
+// Handlers run off the ring thread: a slow one holds up its own connection only.
+// A multi-range response is streamed from a connection thread, which keeps the
+// connection afterwards.
+void test_io_uring_handlers() {
+    std::string asset(300 * 1024, '\0');
+    for (size_t i = 0; i < asset.size(); i++) asset[i] = static_cast<char>('a' + (i * 11) % 26);
+    std::system("mkdir -p xebec_uring_public");
+    { std::ofstream("xebec_uring_public/asset.txt", std::ios::binary) << asset; }
+
+    std::string slow_body, fast_body, ranges_body, after_ranges;
+    std::chrono::steady_clock::duration fast_time{};
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.io_backend = xebec::IoBackend::IoUring;
+        xebec::http_server server(config);
+        server.publicDir("xebec_uring_public");
+        server.get("/hello", [](xebec::Request&, xebec::Response& res) { res << "hello"; });
+        server.get("/slow", [](xebec::Request&, xebec::Response& res) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            res << "slow";
+        });
+        std::thread server_thread([&server]() { server.start(); });
+        wait_until_listening();
+
+        SOCKET slow = connect_to_server();
+        SOCKET fast = connect_to_server();
+        std::string slow_pending, fast_pending;
+        send_text(slow, "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto start = std::chrono::steady_clock::now();
+        send_text(fast, "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        fast_body = read_body(fast, fast_pending);
+        fast_time = std::chrono::steady_clock::now() - start;
+        slow_body = read_body(slow, slow_pending);
+        SOCKET_CLOSE(slow);
+
+        send_text(fast, "GET /asset.txt HTTP/1.1\r\nHost: localhost\r\nRange: bytes=0-9,200000-200009\r\n\r\n");
+        ranges_body = read_body(fast, fast_pending);
+        send_text(fast, "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n");
+        after_ranges = read_body(fast, fast_pending);
+        SOCKET_CLOSE(fast);
+
+        server.stop();
+        server_thread.join();
+    }
+    std::remove("xebec_uring_public/asset.txt");
+    std::remove("xebec_uring_public");
+
+    size_t boundary_end = ranges_body.find("\r\n", 4);
+    std::string delimiter = boundary_end == std::string::npos ? "<none>" : ranges_body.substr(0, boundary_end);
+    size_t first = ranges_body.find("\r\n\r\n");
+    size_t second = ranges_body.find("\r\n\r\n", first + 4);
+    bool passed = slow_body == "slow" && fast_body == "hello" && fast_time < std::chrono::milliseconds(150) &&
+                  first != std::string::npos && second != std::string::npos &&
+                  ranges_body.compare(first + 4, 10, asset.substr(0, 10)) == 0 &&
+                  ranges_body.compare(second + 4, 10, asset.substr(200000, 10)) == 0 &&
+                  ranges_body.find("Content-Range: bytes 200000-200009/" + std::to_string(asset.size())) !=
+                      std::string::npos &&
+                  ranges_body.find(delimiter + "--\r\n") != std::string::npos && after_ranges == "hello";
+    std::cout << (passed ? "io_uring Handlers Test Passed" : "io_uring Handlers Test Failed") << std::endl;
+}
+
+int main() {
+    if (!xebec::IoUring::supported()) {
+        std::cout << "io_uring is not available on this kernel, test skipped" << std::endl;
+        return 0;
+    }
+    test_io_uring_backend();
+    test_io_uring_handlers();
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cout << "io_uring backend needs Linux, test skipped" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <limits>
+#include "../include/xebec/core/request.hpp"
+#include "../include/xebec/core/response.hpp"
+
+void test_json_writer() {
+    xebec::Response res;
+    res.json()
+        .begin_object()
+        .field("name", "a \"quoted\" \\ path\n\twith\x01 control")
+        .field("count", 42)
+        .field("negative", -9007199254740993LL)
+        .field("ratio", 0.1)
+        .field("nan", std::numeric_limits<double>::quiet_NaN())
+        .field("ok", true)
+        .key("empty").begin_array().end_array()
+        .key("items").begin_array().value(1).value("two").value(nullptr).begin_object().end_object().end_array()
+        .key("raw").raw("{\"x\":1}")
+        .end_object();
+
+    bool passed = res.body == "{\"name\":\"a \\\"quoted\\\" \\\\ path\\n\\twith\\u0001 control\","
+                              "\"count\":42,\"negative\":-9007199254740993,\"ratio\":0.1,\"nan\":null,"
+                              "\"ok\":true,\"empty\":[],\"items\":[1,\"two\",null,{}],\"raw\":{\"x\":1}}" &&
+                  res.headers.find("Content-Type: application/json") != std::string::npos;
+
+    // Escapes on both sides of the 16-byte SIMD blocks.
+    std::string plain(40, 'x');
+    for (size_t i = 0; i < 40 && passed; i++) {
+        std::string text = plain;
+        text[i] = '"';
+        std::string out;
+        xebec::JsonWriter::escape(text, out);
+        passed = out == plain.substr(0, i) + "\\\"" + plain.substr(i + 1);
+    }
+    std::cout << (passed ? "JSON Writer Test Passed" : "JSON Writer Test Failed") << std::endl;
+}
+
+void test_json_parser() {
+    xebec::Request req;
+    req.body = " {\"user\": {\"name\": \"Ada\", \"id\": 1815, \"admin\": false, \"score\": -2.5e3},\n"
+               "  \"tags\": [\"a\", \"b\\\"c\", \"\\u00e9\\ud83d\\ude00\"], \"note\": null,"
+               "  \"nested\": [[], {}, [1, [2]]], \"brace\": \"}{][,:\"} ";
+    xebec::JsonDocument doc = req.json();
+    xebec::JsonValue user = doc["user"];
+    xebec::JsonValue tags = doc["tags"];
+
+    bool passed = user["name"].get_string() == "Ada" && user["id"].get_int() == 1815 &&
+                  !user["admin"].get_bool() && user["score"].get_double() == -2500.0 &&
+                  user.size() == 4 && tags.size() == 3 && tags[1].get_string() == "b\"c" &&
+                  tags[2].get_string() == "\xC3\xA9\xF0\x9F\x98\x80" && doc["note"].is_null() &&
+                  doc["nested"].size() == 3 && doc["nested"][2][1][0].get_int() == 2 &&
+                  doc["brace"].get_string() == "}{][,:" && !doc.root().find("missing") &&
+                  doc["nested"].raw() == "[[], {}, [1, [2]]]" && tags[1].raw() == "\"b\\\"c\"" &&
+                  doc.root().type() == xebec::JsonType::Object;
+
+    std::string keys;
+    for (const xebec::JsonField& field : doc.root().object()) keys += std::string(field.key) + ",";
+    passed = passed && keys == "user,tags,note,nested,brace,";
+
+    // Missing fields and wrong types are JsonErrors, which are 400 HttpErrors.
+    auto rejects = [](const std::string& body, bool access) {
+        try {
+            xebec::JsonDocument bad(body);
+            if (access) bad["a"].get_int();
+        } catch (const xebec::HttpError& e) {
+            return e.status_code() == 400;
+        }
+        return false;
+    };
+    passed = passed && rejects("{\"a\": \"unterminated}", false) && rejects("{\"a\": [1, 2}", false) &&
+             rejects("{\"a\": 1}}", false) && rejects("", false) && rejects("{\"b\": 1}", true) &&
+             rejects("{\"a\": \"1\"}", true) && rejects("{\"a\": 1.5}", true);
+    std::cout << (passed ? "JSON Parser Test Passed" : "JSON Parser Test Failed") << std::endl;
+}
+
+// The SIMD classifiers must index exactly what the scalar one does, including
+// quotes, escapes and numbers that straddle 64-byte blocks.
+void test_json_index() {
+    std::mt19937 random(36);
+    const char alphabet[] = "{}[]:,\"\\ \n1a-";
+    bool passed = true;
+    for (int round = 0; round < 2000 && passed; round++) {
+        std::string input(1 + random() % 300, ' ');
+        for (char& c : input) c = alphabet[random() % (sizeof(alphabet) - 1)];
+        std::vector<uint32_t> scalar_index, simd_index;
+        bool scalar_threw = false, simd_threw = false;
+        try { xebec::detail::json_build_index(input, scalar_index, xebec::detail::json_classify_scalar); }
+        catch (const xebec::JsonError&) { scalar_threw = true; }
+        try { xebec::detail::json_build_index(input, simd_index); }
+        catch (const xebec::JsonError&) { simd_threw = true; }
+        passed = scalar_threw == simd_threw && scalar_index == simd_index;
+    }
+
+    // A quote escaped across a block boundary does not end the string.
+    std::string edge = "[\"" + std::string(61, 'x') + "\\\"\", 7]";
+    xebec::JsonDocument doc(edge);
+    passed = passed && doc.root()[0].get_string() == std::string(61, 'x') + "\"" && doc.root()[1].get_int() == 7;
+    std::cout << (passed ? "JSON Index Test Passed" : "JSON Index Test Failed") << std::endl;
+}
+
+int main() {
+    test_json_writer();
+    test_json_parser();
+    test_json_index();
+    return 0;
+}
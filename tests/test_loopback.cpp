@@ -0,0 +1,422 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include "../include/xebec/xebec.hpp"
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+void add_routes(xebec::http_server& server) {
+    server.use([](xebec::Request&, xebec::Response& res, xebec::MiddlewareContext::NextFunction next) {
+        res.header("X-Middleware", "yes");
+        next();
+    });
+    server.get("/users/:id", [](xebec::Request& req, xebec::Response& res) {
+        res << "user " + req.params["id"] + " from " + req.remote_addr;
+    });
+    server.post("/echo", [](xebec::Request& req, xebec::Response& res) {
+        res << "echo " + req.body;
+    });
+    server.ws("/chat", [](xebec::WebSocketFrame& frame, std::function<void(const xebec::WebSocketFrame&)> send) {
+        send(frame);
+    });
+}
+
+// The bodies of the responses in `output`, in order.
+std::vector<std::string> bodies(const std::string& output) {
+    std::vector<std::string> found;
+    size_t position = 0;
+    while (position < output.size()) {
+        size_t head_end = output.find("\r\n\r\n", position);
+        size_t length_at = output.find("Content-Length: ", position);
+        if (head_end == std::string::npos || length_at == std::string::npos || length_at > head_end) break;
+        size_t length = std::stoul(output.substr(length_at + 16));
+        found.push_back(output.substr(head_end + 4, length));
+        position = head_end + 4 + length;
+    }
+    return found;
+}
+
+bool test_pipelined() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    add_routes(server);
+    xebec::LoopbackClient client;
+    client.write("GET /users/7 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                 "POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 5\r\n\r\nhello"
+                 "GET /missing HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                 "GET /users/8 HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    client.finish();
+    server.serve(client.connect("10.0.0.1"));
+    std::string output = client.read();
+    std::vector<std::string> found = bodies(output);
+    return client.closed() && found.size() == 4 && found[0] == "user 7 from 10.0.0.1" && found[1] == "echo hello" &&
+           output.find("HTTP/1.1 404") != std::string::npos && found[3] == "user 8 from 10.0.0.1" &&
+           output.find("X-Middleware: yes\r\n") != std::string::npos;
+}
+
+// Every byte arrives in a recv() of its own.
+bool test_fragmented() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    add_routes(server);
+    xebec::LoopbackClient client;
+    std::string requests = "POST /echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: 11\r\n\r\nhello world"
+                           "GET /users/9 HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n"
+                           "GET /users/10 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    for (char byte : requests) client.write(std::string(1, byte));
+    server.serve(client.connect());
+    std::string output = client.read();
+    std::vector<std::string> found = bodies(output);
+    // Nothing is answered after "Connection: close", although the input was not finished.
+    return client.closed() && found.size() == 2 && found[0] == "echo hello world" &&
+           found[1] == "user 9 from 127.0.0.1" && output.find("Connection: close\r\n") != std::string::npos;
+}
+
+// Whether a body is streamed is decided on the same reading of the request
+// line as the routing, and lines that can be read more than one way are refused.
+bool test_request_line() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    add_routes(server);
+    server.stream_body("POST", "/upload", [](xebec::Request& req, xebec::Response& res) {
+        std::string body;
+        char chunk[3];
+        while (size_t got = req.body_reader(chunk, sizeof(chunk))) body.append(chunk, got);
+        res << "upload " + body;
+    });
+    const std::string next = "GET /users/2 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    const std::string body = "Content-Length: 4\r\n\r\nSMUG";
+
+    xebec::LoopbackClient client;
+    client.write("POST /upload HTTP/1.1\r\nHost: localhost\r\n" + body + next);
+    client.finish();
+    server.serve(client.connect());
+    std::vector<std::string> found = bodies(client.read());
+    bool passed = found.size() == 2 && found[0] == "upload SMUG" && found[1] == "user 2 from 127.0.0.1";
+
+    for (const char* line : {"POST  /upload HTTP/1.1", "POST\t/upload HTTP/1.1", "POST /upload  HTTP/1.1",
+                             "POST /upload HTTP/1.1 ", "POST /upload"}) {
+        xebec::LoopbackClient malformed;
+        malformed.write(line + std::string("\r\nHost: localhost\r\n") + body + next);
+        malformed.finish();
+        server.serve(malformed.connect());
+        std::string output = malformed.read();
+        passed = passed && output.compare(0, 12, "HTTP/1.1 400") == 0 &&
+                 output.find("Connection: close\r\n") != std::string::npos && bodies(output).size() == 1;
+    }
+    return passed;
+}
+
+// A body that could be framed more than one way is refused, so what follows it
+// is never taken for the next request.
+bool test_body_framing() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    add_routes(server);
+    const std::string next = "GET /users/3 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    auto serve = [&server, &next](const std::string& headers, const std::string& body) {
+        xebec::LoopbackClient client;
+        client.write("POST /echo HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n" + body + next);
+        client.finish();
+        server.serve(client.connect());
+        return client.read();
+    };
+    auto refused = [](const std::string& output, const std::string& status) {
+        return output.compare(0, 12, "HTTP/1.1 " + status) == 0 &&
+               output.find("Connection: close\r\n") != std::string::npos && bodies(output).size() == 1;
+    };
+
+    std::vector<std::string> found = bodies(serve("Content-Length: 5\r\ncontent-length: 5\r\n", "hello"));
+    bool passed = found.size() == 2 && found[0] == "echo hello" && found[1] == "user 3 from 127.0.0.1";
+    passed = passed && refused(serve("Transfer-Encoding: chunked\r\n", "5\r\nhello\r\n0\r\n\r\n"), "501");
+    passed = passed && refused(serve("Content-Length: 5\r\nTransfer-Encoding: chunked\r\n", "hello"), "501");
+    passed = passed && refused(serve("Content-Length: 5\r\nContent-Length: 0\r\n", "hello"), "400");
+    passed = passed && refused(serve("Content-Length: 5, 5\r\n", "hello"), "400");
+    passed = passed && refused(serve("Content-Length: 5x\r\n", "hello"), "400");
+    passed = passed && refused(serve("Content-Length : 5\r\n", "hello"), "400");
+    passed = passed && refused(serve("X-Note: a\r\n Content-Length: 5\r\n", "hello"), "400");
+    return passed;
+}
+
+// The answer to HEAD has the head GET would get, Content-Length included, and
+// no body, whichever way the body would have been sent.
+bool test_head() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    server.publicDir("tests/public");
+    add_routes(server);
+    server.use([](xebec::Request& req, xebec::Response& res, xebec::MiddlewareContext::NextFunction next) {
+        if (req.path == "/view") {
+            res.view("viewed");
+        } else if (req.path == "/stream") {
+            res.stream([](const xebec::BodyWriter& write) { return write("streamed", 8); }, 8);
+        } else if (req.path == "/text") {
+            res << "text";
+        } else {
+            next();
+        }
+    });
+    const std::string next = "GET /users/5 HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    bool passed = true;
+    for (const char* path : {"/index.html", "/view", "/stream", "/text"}) {
+        std::string request = std::string(" ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        xebec::LoopbackClient get;
+        get.write("GET" + request);
+        get.finish();
+        server.serve(get.connect());
+        std::string get_output = get.read();
+        std::string get_head = get_output.substr(0, get_output.find("\r\n\r\n") + 4);
+
+        xebec::LoopbackClient head;
+        head.write("HEAD" + request + next);
+        head.finish();
+        server.serve(head.connect());
+        std::string output = head.read();
+        passed = passed && get_head.find("Content-Length: ") != std::string::npos &&
+                 output == get_head + output.substr(get_head.size()) &&
+                 output.compare(get_head.size(), 15, "HTTP/1.1 200 OK") == 0 &&
+                 bodies(output.substr(get_head.size())) == std::vector<std::string>{"user 5 from 127.0.0.1"};
+    }
+    return passed;
+}
+
+// Serves `requests` over one loopback connection and returns what was written back.
+std::string serve_requests(xebec::http_server& server, const std::string& requests) {
+    xebec::LoopbackClient client;
+    client.write(requests);
+    client.finish();
+    server.serve(client.connect());
+    return client.read();
+}
+
+std::string get_request(const std::string& path, const std::string& headers = "") {
+    return "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n" + headers + "\r\n";
+}
+
+// Responses from a file pass the cache by, and a handler's own ETag is kept.
+// A 304 repeats the caching headers of the response it stands for.
+bool test_cache() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    server.publicDir("tests/public");
+    xebec::ResponseCache cache;
+    cache.route("GET", "/index.html", std::chrono::seconds(60)).route("GET", "/tagged", std::chrono::seconds(60));
+    server.use(cache.middleware());
+    int calls = 0;
+    server.get("/tagged", [&calls](xebec::Request&, xebec::Response& res) {
+        calls++;
+        res.header("etag", "\"v1\"").header("Cache-Control", "max-age=60").header("Vary", "Accept-Language");
+        res.header("Content-Location", "/tagged/en") << "tagged";
+    });
+    auto serve = [&server](const std::string& requests) {
+        xebec::LoopbackClient client;
+        client.write(requests);
+        client.finish();
+        server.serve(client.connect());
+        return client.read();
+    };
+    auto count = [](const std::string& text, const std::string& needle) {
+        size_t found = 0;
+        for (size_t at = text.find(needle); at != std::string::npos; at = text.find(needle, at + 1)) found++;
+        return found;
+    };
+
+    const std::string get_index = "GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::string output = serve(get_index + get_index);
+    std::vector<std::string> found = bodies(output);
+    bool passed = found.size() == 2 && found[0].size() == 120 && found[1] == found[0] &&
+                  count(output, "ETag: ") == 2;
+
+    output = serve("GET /tagged HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                   "GET /tagged HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: \"v1\"\r\n\r\n");
+    size_t not_modified = output.find("HTTP/1.1 304");
+    passed = passed && calls == 1 && count(output, "ETag: ") + count(output, "etag: ") == 2 &&
+             not_modified != std::string::npos &&
+             output.find("Cache-Control: max-age=60\r\n", not_modified) != std::string::npos &&
+             output.find("Vary: Accept-Language\r\n", not_modified) != std::string::npos &&
+             output.find("Content-Location: /tagged/en\r\n", not_modified) != std::string::npos;
+    return passed;
+}
+
+// Misses on one key that overlap run the handler once; the others wait for it.
+bool test_cache_coalescing() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    xebec::ResponseCache cache;
+    cache.route("GET", "/slow", std::chrono::seconds(60));
+    server.use(cache.middleware());
+    std::atomic<int> calls{0};
+    server.get("/slow", [&calls](xebec::Request&, xebec::Response& res) {
+        int call = ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        res << "slow " + std::to_string(call);
+    });
+
+    std::vector<std::string> outputs(4);
+    std::vector<std::thread> clients;
+    for (std::string& output : outputs) {
+        clients.emplace_back([&server, &output]() { output = serve_requests(server, get_request("/slow")); });
+    }
+    for (std::thread& client : clients) client.join();
+    bool passed = calls == 1;
+    for (const std::string& output : outputs) {
+        std::vector<std::string> found = bodies(output);
+        passed = passed && found.size() == 1 && found[0] == "slow 1";
+    }
+    return passed;
+}
+
+// An entry is served until its TTL passes, then the handler runs again.
+bool test_cache_expiry() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    xebec::ResponseCache cache;
+    cache.route("GET", "/clock", std::chrono::milliseconds(50));
+    server.use(cache.middleware());
+    int calls = 0;
+    server.get("/clock", [&calls](xebec::Request&, xebec::Response& res) { res << "tick " + std::to_string(++calls); });
+
+    std::vector<std::string> found = bodies(serve_requests(server, get_request("/clock") + get_request("/clock")));
+    bool passed = calls == 1 && found.size() == 2 && found[1] == "tick 1";
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    found = bodies(serve_requests(server, get_request("/clock")));
+    return passed && calls == 2 && found.size() == 1 && found[0] == "tick 2";
+}
+
+// With room for two entries, the least recently used one makes way for a third.
+bool test_cache_eviction() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    xebec::ResponseCache cache(2600, 1);
+    cache.route("GET", "/items/:id", std::chrono::seconds(60));
+    server.use(cache.middleware());
+    std::map<std::string, int> calls;
+    server.get("/items/:id", [&calls](xebec::Request& req, xebec::Response& res) {
+        calls[req.params["id"]]++;
+        res << std::string(1000, req.params["id"][0]);
+    });
+
+    serve_requests(server, get_request("/items/1") + get_request("/items/2") + get_request("/items/1") +
+                               get_request("/items/3"));
+    bool passed = calls["1"] == 1 && calls["2"] == 1 && calls["3"] == 1;
+    std::vector<std::string> found = bodies(serve_requests(server, get_request("/items/1") + get_request("/items/2")));
+    return passed && calls["1"] == 1 && calls["2"] == 2 && found.size() == 2 && found[1] == std::string(1000, '2');
+}
+
+// Only the listed query parameters and headers tell entries apart.
+bool test_cache_vary() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    xebec::ResponseCache cache;
+    cache.route("GET", "/search", std::chrono::seconds(60), {"q"}, {"Accept-Language"});
+    server.use(cache.middleware());
+    int calls = 0;
+    server.get("/search", [&calls](xebec::Request& req, xebec::Response& res) {
+        res << req.query.get("q") + " " + req.get_header("Accept-Language") + " " + std::to_string(++calls);
+    });
+
+    std::vector<std::string> found = bodies(serve_requests(
+        server, get_request("/search?q=a") + get_request("/search?q=a&page=2") + get_request("/search?q=b") +
+                    get_request("/search?q=a", "Accept-Language: fr\r\n") +
+                    get_request("/search?page=3&q=a", "Accept-Language: fr\r\n")));
+    return calls == 3 && found.size() == 5 && found[0] == "a  1" && found[1] == "a  1" && found[2] == "b  2" &&
+           found[3] == "a fr 3" && found[4] == "a fr 3";
+}
+
+// Overlapping ranges are merged, so no request costs more than the file, and
+// the parts of a multipart response are streamed from the file.
+bool test_ranges() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    server.publicDir("tests/public");
+    std::ifstream file("tests/public/index.html", std::ios::binary);
+    std::string index((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto get = [&server](const std::string& range) {
+        xebec::LoopbackClient client;
+        client.write("GET /index.html HTTP/1.1\r\nHost: localhost\r\nRange: bytes=" + range + "\r\n\r\n");
+        client.finish();
+        server.serve(client.connect());
+        return client.read();
+    };
+
+    std::string repeated;
+    for (int i = 0; i < 16; i++) repeated += i ? ",0-" : "0-";
+    std::string output = get(repeated);
+    std::vector<std::string> found = bodies(output);
+    bool passed = index.size() == 120 && output.compare(0, 12, "HTTP/1.1 206") == 0 &&
+                  output.find("Content-Range: bytes 0-119/120\r\n") != std::string::npos &&
+                  found.size() == 1 && found[0] == index;
+
+    output = get("50-59, 0-9, 5-14, 10-10");
+    found = bodies(output);
+    size_t boundary_at = output.find("boundary=") + 9;
+    std::string boundary = output.substr(boundary_at, output.find("\r\n", boundary_at) - boundary_at);
+    auto part = [&boundary](const std::string& range) {
+        return "\r\n--" + boundary + "\r\nContent-Type: text/html\r\nContent-Range: bytes " + range + "\r\n\r\n";
+    };
+    std::string expected = part("0-14/120") + index.substr(0, 15) + part("50-59/120") + index.substr(50, 10) +
+                           "\r\n--" + boundary + "--\r\n";
+    passed = passed && output.find("multipart/byteranges") != std::string::npos && found.size() == 1 &&
+             found[0] == expected;
+    return passed;
+}
+
+// The server runs on a thread of its own while the client waits for each answer.
+bool test_conversation() {
+    QuietOutput quiet;
+    xebec::http_server server;
+    add_routes(server);
+    xebec::LoopbackClient client;
+    std::thread serving([&server, &client]() { server.serve(client.connect()); });
+
+    client.write("GET /users/1 HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    bool passed = client.wait_for("user 1");
+    client.write("GET /chat HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                 "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+    passed = passed && client.wait_for("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    client.read();
+    // A masked text frame "hi", in two writes.
+    client.write(std::string("\x81\x82\x01\x02", 4));
+    client.write(std::string("\x03\x04") + static_cast<char>('h' ^ 1) + static_cast<char>('i' ^ 2));
+    passed = passed && client.wait_for("\x81\x02hi");
+    client.write(std::string("\x88\x80\x00\x00\x00\x00", 6));
+    serving.join();
+    return passed && client.closed();
+}
+
+int main() {
+    std::cout << (test_pipelined() ? "Loopback Pipelined Test Passed" : "Loopback Pipelined Test Failed") << std::endl;
+    std::cout << (test_fragmented() ? "Loopback Fragmented Test Passed" : "Loopback Fragmented Test Failed")
+              << std::endl;
+    std::cout << (test_request_line() ? "Loopback Request Line Test Passed" : "Loopback Request Line Test Failed")
+              << std::endl;
+    std::cout << (test_body_framing() ? "Loopback Body Framing Test Passed" : "Loopback Body Framing Test Failed")
+              << std::endl;
+    std::cout << (test_head() ? "Loopback HEAD Test Passed" : "Loopback HEAD Test Failed") << std::endl;
+    std::cout << (test_cache() ? "Loopback Cache Test Passed" : "Loopback Cache Test Failed") << std::endl;
+    std::cout << (test_cache_coalescing() ? "Loopback Cache Coalescing Test Passed"
+                                          : "Loopback Cache Coalescing Test Failed") << std::endl;
+    std::cout << (test_cache_expiry() ? "Loopback Cache Expiry Test Passed" : "Loopback Cache Expiry Test Failed")
+              << std::endl;
+    std::cout << (test_cache_eviction() ? "Loopback Cache Eviction Test Passed" : "Loopback Cache Eviction Test Failed")
+              << std::endl;
+    std::cout << (test_cache_vary() ? "Loopback Cache Vary Test Passed" : "Loopback Cache Vary Test Failed")
+              << std::endl;
+    std::cout << (test_ranges() ? "Loopback Ranges Test Passed" : "Loopback Ranges Test Failed") << std::endl;
+    std::cout << (test_conversation() ? "Loopback Conversation Test Passed" : "Loopback Conversation Test Failed")
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18936;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+// Collects parser events as "part(name,filename,type)", data and "end".
+struct Recorder {
+    std::string events;
+    void attach(xebec::MultipartParser& parser) {
+        parser.on_part = [this](const xebec::MultipartPart& part) {
+            events += "part(" + part.name + "," + part.filename + "," + part.content_type + ")";
+        };
+        parser.on_data = [this](const char* data, size_t length) { events.append(data, length); };
+        parser.on_part_end = [this]() { events += "|end|"; };
+    }
+};
+
+void test_multipart_parser() {
+    // File data with near-misses of the delimiter, split at every position.
+    const std::string file_data = "line\r\n--Xbound\r\n--XbounD\r\n-\r\n--Xboun";
+    const std::string body = "preamble\r\n--Xboundary\r\n"
+                             "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+                             "Hello\r\n--Xboundary\r\n"
+                             "Content-Disposition: form-data; name=\"doc\"; filename=\"a \\\"b\\\".txt\"\r\n"
+                             "Content-Type: text/plain\r\n\r\n" + file_data + "\r\n--Xboundary\r\n"
+                             "content-disposition: form-data; name=empty\r\n\r\n"
+                             "\r\n--Xboundary--\r\nepilogue";
+    const std::string expected = "part(title,,)Hello|end|part(doc,a \"b\".txt,text/plain)" + file_data +
+                                 "|end|part(empty,,)|end|";
+
+    bool passed = true;
+    for (size_t split = 0; split <= body.size() && passed; split++) {
+        xebec::MultipartParser parser("Xboundary");
+        Recorder recorder;
+        recorder.attach(parser);
+        parser.feed(body.data(), split);
+        parser.feed(body.data() + split, body.size() - split);
+        parser.finish();
+        passed = recorder.events == expected;
+    }
+
+    xebec::MultipartParser bytewise("Xboundary");
+    Recorder recorder;
+    recorder.attach(bytewise);
+    for (char c : body) bytewise.feed(&c, 1);
+    passed = passed && bytewise.done() && recorder.events == expected;
+
+    xebec::MultipartParser truncated("Xboundary");
+    truncated.feed(body.data(), body.size() / 2);
+    try {
+        truncated.finish();
+        passed = false;
+    } catch (const xebec::HttpError& e) {
+        passed = passed && e.status_code() == 400;
+    }
+
+    // Whitespace after a boundary is buffered only up to max_header_size.
+    xebec::MultipartParser padded("Xboundary");
+    padded.feed("--Xboundary", 11);
+    try {
+        const std::string spaces(1024, ' ');
+        for (int i = 0; i < 32; i++) padded.feed(spaces.data(), spaces.size());
+        passed = false;
+    } catch (const xebec::HttpError& e) {
+        passed = passed && e.status_code() == 400;
+    }
+
+    passed = passed &&
+             xebec::MultipartParser::boundary_of("multipart/form-data; boundary=\"a b\"; x=1") == "a b" &&
+             xebec::MultipartParser::boundary_of("Multipart/Form-Data;boundary=abc") == "abc" &&
+             xebec::MultipartParser::boundary_of("application/json").empty();
+    std::cout << (passed ? "Multipart Parser Test Passed" : "Multipart Parser Test Failed") << std::endl;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+void send_text(SOCKET sock, const std::string& text) {
+    send(sock, text.data(), text.size(), 0);
+}
+
+// Reads until `marker` arrives and returns everything up to and including it.
+std::string read_until(SOCKET sock, std::string& pending, const std::string& marker) {
+    char buffer[4096];
+    size_t found;
+    while ((found = pending.find(marker)) == std::string::npos) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return "<closed>";
+        pending.append(buffer, received);
+    }
+    std::string text = pending.substr(0, found + marker.size());
+    pending.erase(0, found + marker.size());
+    return text;
+}
+
+// Reads one Content-Length framed response and returns "<status> <body>".
+std::string read_body(SOCKET sock, std::string& pending) {
+    std::string head = read_until(sock, pending, "\r\n\r\n");
+    size_t length_pos = head.find("Content-Length: ");
+    size_t length = length_pos == std::string::npos ? 0 : std::stoul(head.substr(length_pos + 16));
+    char buffer[4096];
+    while (pending.size() < length) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return "<closed>";
+        pending.append(buffer, received);
+    }
+    size_t status = head.find(' ') + 1;
+    std::string body = head.substr(status, head.find("\r\n") - status) + " " + pending.substr(0, length);
+    pending.erase(0, length);
+    return body;
+}
+
+long peak_memory_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::stol(line.substr(6));
+    }
+    return -1;
+}
+
+// Sends a multipart upload of a `size`-byte file in 64 KB writes, waiting for
+// "100 Continue" first.
+bool send_upload(SOCKET sock, std::string& pending, const std::string& path, uint64_t size) {
+    std::string head_part = "--B0und\r\nContent-Disposition: form-data; name=\"owner\"\r\n\r\nada\r\n"
+                            "--B0und\r\nContent-Disposition: form-data; name=\"data\"; filename=\"big.bin\"\r\n"
+                            "Content-Type: application/octet-stream\r\n\r\n";
+    std::string tail_part = "\r\n--B0und--\r\n";
+    send_text(sock, "POST " + path + " HTTP/1.1\r\nHost: localhost\r\nExpect: 100-continue\r\n"
+                    "Content-Type: multipart/form-data; boundary=B0und\r\n"
+                    "Content-Length: " + std::to_string(head_part.size() + size + tail_part.size()) + "\r\n\r\n");
+    if (read_until(sock, pending, "\r\n\r\n").find("100 Continue") == std::string::npos) return false;
+    send_text(sock, head_part);
+    std::string chunk(64 * 1024, '\0');
+    for (size_t i = 0; i < chunk.size(); i++) chunk[i] = static_cast<char>(i * 31 % 251);
+    for (uint64_t sent = 0; sent < size; sent += chunk.size()) {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(chunk.size(), size - sent));
+        if (send(sock, chunk.data(), length, 0) != static_cast<int>(length)) return false;
+    }
+    send_text(sock, tail_part);
+    return true;
+}
+
+void test_upload_route() {
+    const uint64_t upload_size = 64 * 1024 * 1024 + 17;
+    std::system("mkdir -p xebec_upload_tmp");
+    std::vector<std::string> responses;
+    long before = 0, after = 0;
+    bool temp_dir_empty = false;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        xebec::http_server server(config);
+
+        xebec::UploadOptions to_disk;
+        to_disk.temp_dir = "xebec_upload_tmp";
+        server.upload("/upload", [](xebec::Request&, xebec::MultipartForm& form, xebec::Response& res) {
+            xebec::UploadedFile* file = form.file("data");
+            bool saved = file && file->save_as("xebec_upload_tmp/saved.bin");
+            xebec::FileInfo info;
+            res.json().begin_object()
+                .field("owner", form.get("owner"))
+                .field("size", file ? file->size : 0)
+                .field("on_disk", saved && xebec::stat_file("xebec_upload_tmp/saved.bin", info) ? info.size : 0)
+                .end_object();
+        }, to_disk);
+
+        // A handler-supplied sink that only checksums the bytes.
+        struct ChecksumSink : xebec::UploadSink {
+            uint64_t* sum;
+            explicit ChecksumSink(uint64_t* target) : sum(target) {}
+            void write(const char* data, size_t length) override {
+                for (size_t i = 0; i < length; i++) *sum += static_cast<unsigned char>(data[i]);
+            }
+        };
+        auto sum = std::make_shared<uint64_t>(0);
+        xebec::UploadOptions to_sink;
+        to_sink.max_size = 1024 * 1024;
+        to_sink.open_sink = [sum](const xebec::Request&, const xebec::MultipartPart&) {
+            return std::unique_ptr<xebec::UploadSink>(new ChecksumSink(sum.get()));
+        };
+        server.upload("/checksum", [sum](xebec::Request&, xebec::MultipartForm& form, xebec::Response& res) {
+            res << std::to_string(*sum) + " " + form.files[0].filename + " " + std::to_string(form.files[0].path.empty());
+        }, to_sink);
+
+        std::thread server_thread([&server]() { server.start(); });
+        for (int i = 0; i < 200; i++) {
+            SOCKET probe = connect_to_server();
+            if (probe != INVALID_SOCKET) {
+                SOCKET_CLOSE(probe);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        SOCKET sock = connect_to_server();
+        std::string pending;
+        before = peak_memory_kb();
+        if (send_upload(sock, pending, "/upload", upload_size)) responses.push_back(read_body(sock, pending));
+        after = peak_memory_kb();
+
+        // Same connection: a small upload to the sink, then one over its max_size.
+        uint64_t expected_sum = 0;
+        for (size_t i = 0; i < 1000; i++) expected_sum += static_cast<unsigned char>(i * 31 % 251);
+        if (send_upload(sock, pending, "/checksum", 1000)) responses.push_back(read_body(sock, pending));
+        responses.push_back(std::to_string(expected_sum));
+        send_text(sock, "POST /checksum HTTP/1.1\r\nHost: localhost\r\n"
+                        "Content-Type: multipart/form-data; boundary=B0und\r\nContent-Length: 2000000\r\n\r\n");
+        responses.push_back(read_body(sock, pending));
+        SOCKET_CLOSE(sock);
+
+        server.stop();
+        server_thread.join();
+        std::remove("xebec_upload_tmp/saved.bin");
+        temp_dir_empty = std::remove("xebec_upload_tmp") == 0;
+    }
+
+    bool passed = responses.size() == 4 &&
+                  responses[0] == "200 OK {\"owner\":\"ada\",\"size\":" + std::to_string(upload_size) +
+                                  ",\"on_disk\":" + std::to_string(upload_size) + "}" &&
+                  responses[1] == "200 OK " + responses[2] + " big.bin 1" &&
+                  responses[3].compare(0, 4, "413 ") == 0 &&
+                  temp_dir_empty && after - before < 16 * 1024;
+    std::cout << "Uploaded " << upload_size / (1024 * 1024) << " MB, peak memory grew by "
+              << (after - before) / 1024 << " MB" << std::endl;
+    std::cout << (passed ? "Upload Route Test Passed" : "Upload Route Test Failed") << std::endl;
+}
+
+int main() {
+    test_multipart_parser();
+    test_upload_route();
+    return 0;
+}
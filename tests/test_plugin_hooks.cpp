@@ -0,0 +1,184 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18941;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+// Records every hook it sees as one line of text.
+class RecordingPlugin : public xebec::Plugin {
+public:
+    void init(xebec::http_server*) override {}
+    std::string name() const override { return "recorder"; }
+    std::string version() const override { return "1.0"; }
+
+    void on_connection(const xebec::ConnectionInfo& info) override {
+        record("open " + std::string(info.remote_addr));
+    }
+    void on_request_parsed(xebec::Request& req, std::string_view raw) override {
+        bool raw_ok = raw.substr(0, req.method.size() + req.path.size() + 2) == req.method + " " + req.path + " ";
+        record("parsed " + req.method + " " + req.path + (raw_ok ? " raw" : " no raw"));
+    }
+    void on_response(const xebec::Request& req, xebec::Response& res) override {
+        res.header("X-Seen-By", name());
+        record("response " + req.path);
+    }
+    void on_ws_frame(const xebec::Request& req, const xebec::WebSocketFrame& frame) override {
+        record("frame " + req.path + " " + std::to_string(static_cast<int>(frame.opcode)) + " " +
+               std::string(frame.payload.begin(), frame.payload.end()));
+    }
+    void on_close(const xebec::ConnectionInfo& info) override {
+        record("close " + std::string(info.remote_addr));
+    }
+
+    std::string events() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return events_;
+    }
+
+private:
+    void record(const std::string& event) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_ += event + "|";
+    }
+
+    std::mutex mutex_;
+    std::string events_;
+};
+
+// Handed over as a plain Plugin, so every hook is called and the defaults do nothing.
+class VersionPlugin : public xebec::Plugin {
+public:
+    void init(xebec::http_server*) override {}
+    std::string name() const override { return "version"; }
+    std::string version() const override { return "2.0"; }
+    void on_response(const xebec::Request&, xebec::Response& res) override {
+        res.header("X-Version", version());
+    }
+};
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+std::string read_until(SOCKET sock, std::string& pending, const std::string& marker) {
+    char buffer[4096];
+    size_t found;
+    while ((found = pending.find(marker)) == std::string::npos) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return "<closed>";
+        pending.append(buffer, received);
+    }
+    std::string text = pending.substr(0, found + marker.size());
+    pending.erase(0, found + marker.size());
+    return text;
+}
+
+// A masked client text frame.
+std::string client_frame(const std::string& payload, uint8_t opcode = 0x1) {
+    std::string frame;
+    frame += static_cast<char>(0x80 | opcode);
+    frame += static_cast<char>(0x80 | payload.size());
+    const char mask[4] = {0x11, 0x22, 0x33, 0x44};
+    frame.append(mask, 4);
+    for (size_t i = 0; i < payload.size(); i++) frame += static_cast<char>(payload[i] ^ mask[i % 4]);
+    return frame;
+}
+
+bool run_hooks_test(xebec::IoBackend backend) {
+    std::string events;
+    std::string head;
+    std::string echo;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.io_backend = backend;
+        xebec::http_server server(config);
+        auto recorder = std::make_unique<RecordingPlugin>();
+        RecordingPlugin* recording = recorder.get();
+        server.register_plugin(std::move(recorder));
+        server.register_plugin(std::unique_ptr<xebec::Plugin>(new VersionPlugin()));
+        server.get("/hello", [](xebec::Request&, xebec::Response& res) { res << "hello"; });
+        server.ws("/chat", [](xebec::WebSocketFrame& frame, std::function<void(const xebec::WebSocketFrame&)> send) {
+            send(frame);
+        });
+
+        std::thread server_thread([&server]() { server.start(); });
+        for (int i = 0; i < 200; i++) {
+            SOCKET probe = connect_to_server();
+            if (probe != INVALID_SOCKET) {
+                SOCKET_CLOSE(probe);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        // The probe connections are not part of the test.
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::string baseline = recording->events();
+
+        SOCKET sock = connect_to_server();
+        std::string pending;
+        std::string request = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        send(sock, request.data(), request.size(), 0);
+        head = read_until(sock, pending, "hello");
+        request = "GET /chat HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                  "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+        send(sock, request.data(), request.size(), 0);
+        read_until(sock, pending, "\r\n\r\n");
+        std::string frame = client_frame("hi");
+        send(sock, frame.data(), frame.size(), 0);
+        echo = read_until(sock, pending, "hi");
+        frame = client_frame("", 0x8);
+        send(sock, frame.data(), frame.size(), 0);
+        char buffer[256];
+        while (recv(sock, buffer, sizeof(buffer), 0) > 0) {}
+        SOCKET_CLOSE(sock);
+
+        for (int i = 0; i < 100 && recording->events().find("close", baseline.size()) == std::string::npos; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        events = recording->events().substr(baseline.size());
+        server.stop();
+        server_thread.join();
+    }
+
+    return events == "open 127.0.0.1|parsed GET /hello raw|response /hello|parsed GET /chat raw|"
+                     "frame /chat 1 hi|frame /chat 8 |close 127.0.0.1|" &&
+           head.find("X-Seen-By: recorder\r\n") != std::string::npos &&
+           head.find("X-Version: 2.0\r\n") != std::string::npos &&
+           echo == "\x81\x02hi";
+}
+
+int main() {
+    bool passed = run_hooks_test(xebec::IoBackend::Threads);
+    std::cout << (passed ? "Plugin Hooks Test Passed" : "Plugin Hooks Test Failed") << std::endl;
+#ifdef XEBEC_HAS_IO_URING
+    if (xebec::IoUring::supported()) {
+        passed = run_hooks_test(xebec::IoBackend::IoUring);
+        std::cout << (passed ? "Plugin Hooks io_uring Test Passed" : "Plugin Hooks io_uring Test Failed") << std::endl;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,467 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <atomic>
+#include <memory>
+#include "../include/xebec/xebec.hpp"
+
+const int proxy_port = 18937;
+const int upstream_ports[2] = {18938, 18939};
+const uint64_t big_size = 32 * 1024 * 1024 + 5;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+char pattern_byte(uint64_t i) {
+    return static_cast<char>(i * 131 % 251);
+}
+
+SOCKET connect_to(int port) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+void wait_until_listening(int port) {
+    for (int i = 0; i < 200; i++) {
+        SOCKET sock = connect_to(port);
+        if (sock != INVALID_SOCKET) {
+            SOCKET_CLOSE(sock);
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// A stand-in upstream service: a second xebec server in this process.
+struct Upstream {
+    std::string name;
+    int port;
+    std::atomic<bool> healthy{true};
+    std::unique_ptr<xebec::http_server> server;
+    std::thread thread;
+
+    Upstream(std::string upstream_name, int upstream_port) : name(std::move(upstream_name)), port(upstream_port) {}
+
+    void start() {
+        xebec::ServerConfig config;
+        config.port = port;
+        server = std::make_unique<xebec::http_server>(config);
+        server->get("/health", [this](xebec::Request&, xebec::Response& res) {
+            if (!healthy) res.status_code(503);
+            res << "ok";
+        });
+        server->get("/api/who", [this](xebec::Request& req, xebec::Response& res) {
+            res << name + "?" + req.query.raw();
+        });
+        // A chunked body produced piece by piece.
+        server->get("/api/big", [](xebec::Request&, xebec::Response& res) {
+            res.stream([](const xebec::BodyWriter& write) {
+                std::string piece;
+                for (uint64_t offset = 0; offset < big_size; offset += piece.size()) {
+                    piece.resize(static_cast<size_t>(std::min<uint64_t>(60000, big_size - offset)));
+                    for (size_t i = 0; i < piece.size(); i++) piece[i] = pattern_byte(offset + i);
+                    if (!write(piece.data(), piece.size())) return false;
+                }
+                return true;
+            });
+        });
+        // Reads the request body as it arrives and reports its size and checksum.
+        server->stream_body("POST", "/api/echo", [](xebec::Request& req, xebec::Response& res) {
+            char chunk[65536];
+            uint64_t total = 0, sum = 0;
+            size_t received;
+            while ((received = req.body_reader(chunk, sizeof(chunk))) > 0) {
+                for (size_t i = 0; i < received; i++) sum += static_cast<unsigned char>(chunk[i]);
+                total += received;
+            }
+            res << std::to_string(total) + " " + std::to_string(sum);
+        });
+        thread = std::thread([this]() { server->start(); });
+        wait_until_listening(port);
+    }
+
+    void stop() {
+        server->stop();
+        thread.join();
+        server.reset();
+    }
+};
+
+struct ProxyServer {
+    std::unique_ptr<xebec::http_server> server;
+    xebec::ProxyPlugin* proxy = nullptr;
+    std::thread thread;
+
+    explicit ProxyServer(xebec::ProxyOptions options, const std::string& prefix = "/api") {
+        xebec::ServerConfig config;
+        config.port = proxy_port;
+        server = std::make_unique<xebec::http_server>(config);
+        auto plugin = std::make_unique<xebec::ProxyPlugin>(options);
+        plugin->route(prefix, {"127.0.0.1:" + std::to_string(upstream_ports[0]),
+                               "http://127.0.0.1:" + std::to_string(upstream_ports[1])});
+        proxy = plugin.get();
+        server->register_plugin(std::move(plugin));
+        thread = std::thread([this]() { server->start(); });
+        wait_until_listening(proxy_port);
+    }
+
+    ~ProxyServer() {
+        server->stop();
+        thread.join();
+    }
+};
+
+struct ClientResponse {
+    int status = 0;
+    std::string body;       // Kept up to 1 KB
+    uint64_t length = 0;
+    bool pattern_ok = true; // Every byte matched pattern_byte()
+};
+
+// Reads one response, decoding Content-Length or chunked framing.
+ClientResponse read_response(SOCKET sock, std::string& pending) {
+    ClientResponse response;
+    char buffer[65536];
+    auto fill = [&](size_t needed) {
+        while (pending.size() < needed) {
+            int received = recv(sock, buffer, sizeof(buffer), 0);
+            if (received <= 0) return false;
+            pending.append(buffer, received);
+        }
+        return true;
+    };
+    auto take = [&](size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (pending[i] != pattern_byte(response.length + i)) response.pattern_ok = false;
+        }
+        if (response.body.size() < 1024) response.body.append(pending, 0, std::min<size_t>(count, 1024));
+        response.length += count;
+        pending.erase(0, count);
+    };
+    size_t head_end;
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos) {
+        if (!fill(pending.size() + 1)) return response;
+    }
+    std::string head = pending.substr(0, head_end);
+    pending.erase(0, head_end + 4);
+    response.status = std::atoi(head.c_str() + 9);
+    size_t length_pos = head.find("Content-Length: ");
+    if (length_pos != std::string::npos) {
+        uint64_t remaining = std::stoull(head.substr(length_pos + 16));
+        while (remaining > 0) {
+            if (!fill(1)) return response;
+            size_t count = static_cast<size_t>(std::min<uint64_t>(remaining, pending.size()));
+            take(count);
+            remaining -= count;
+        }
+    } else if (head.find("Transfer-Encoding: chunked") != std::string::npos) {
+        while (true) {
+            size_t line_end;
+            while ((line_end = pending.find("\r\n")) == std::string::npos) {
+                if (!fill(pending.size() + 1)) return response;
+            }
+            uint64_t size = std::stoull(pending.substr(0, line_end), nullptr, 16);
+            pending.erase(0, line_end + 2);
+            if (size == 0) {
+                fill(2);
+                pending.erase(0, 2);
+                break;
+            }
+            while (size > 0) {
+                if (!fill(1)) return response;
+                size_t count = static_cast<size_t>(std::min<uint64_t>(size, pending.size()));
+                take(count);
+                size -= count;
+            }
+            fill(2);
+            pending.erase(0, 2);
+        }
+    }
+    return response;
+}
+
+ClientResponse get(SOCKET sock, std::string& pending, const std::string& path) {
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(sock, request.data(), request.size(), 0);
+    return read_response(sock, pending);
+}
+
+long peak_memory_kb() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return std::stol(line.substr(6));
+    }
+    return -1;
+}
+
+// Who answered each of `count` requests: "A", "B" or the status on failure.
+std::string spread(SOCKET sock, std::string& pending, int count) {
+    int a = 0, b = 0, failed = 0;
+    for (int i = 0; i < count; i++) {
+        ClientResponse response = get(sock, pending, "/api/who");
+        if (response.status == 200 && response.body[0] == 'A') a++;
+        else if (response.status == 200 && response.body[0] == 'B') b++;
+        else failed++;
+    }
+    return "A" + std::to_string(a) + " B" + std::to_string(b) + " failed" + std::to_string(failed);
+}
+
+void test_proxy_forwarding() {
+    bool passed = false;
+    long memory_growth = 0;
+    {
+        QuietOutput quiet;
+        Upstream a("A", upstream_ports[0]), b("B", upstream_ports[1]);
+        a.start();
+        b.start();
+        xebec::ProxyOptions options;
+        options.health_interval_ms = 100;
+        ProxyServer proxy(options);
+
+        SOCKET sock = connect_to(proxy_port);
+        std::string pending;
+        ClientResponse who = get(sock, pending, "/api/who?x=1&y=%20");
+        std::string balanced = spread(sock, pending, 40);
+        std::vector<xebec::ProxyUpstream*> upstreams = proxy.proxy->upstreams("/api");
+        bool pooled = upstreams.size() == 2 && upstreams[0]->idle_connections() >= 1 &&
+                      upstreams[1]->idle_connections() >= 1;
+
+        long before = peak_memory_kb();
+        ClientResponse big = get(sock, pending, "/api/big");
+
+        // A request body streamed through the proxy.
+        std::string head = "POST /api/echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                           std::to_string(big_size) + "\r\n\r\n";
+        send(sock, head.data(), head.size(), 0);
+        std::string chunk(65536, '\0');
+        uint64_t expected_sum = 0;
+        for (uint64_t offset = 0; offset < big_size; offset += chunk.size()) {
+            chunk.resize(static_cast<size_t>(std::min<uint64_t>(65536, big_size - offset)));
+            for (size_t i = 0; i < chunk.size(); i++) {
+                chunk[i] = pattern_byte(offset + i);
+                expected_sum += static_cast<unsigned char>(chunk[i]);
+            }
+            send(sock, chunk.data(), chunk.size(), 0);
+        }
+        ClientResponse echo = read_response(sock, pending);
+        memory_growth = peak_memory_kb() - before;
+
+        // An upstream failing its health check stops getting traffic, and gets it back.
+        b.healthy = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        std::string without_b = spread(sock, pending, 20);
+        b.healthy = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        std::string with_b = spread(sock, pending, 40);
+        SOCKET_CLOSE(sock);
+
+        passed = who.status == 200 && (who.body == "A?x=1&y=%20" || who.body == "B?x=1&y=%20") &&
+                 balanced.find(" failed0") != std::string::npos && balanced.find("A0 ") == std::string::npos &&
+                 balanced.find("B0 ") == std::string::npos && pooled &&
+                 big.status == 200 && big.length == big_size && big.pattern_ok &&
+                 echo.status == 200 && echo.body == std::to_string(big_size) + " " + std::to_string(expected_sum) &&
+                 memory_growth < 16 * 1024 &&
+                 without_b == "A20 B0 failed0" && with_b.find("B0 ") == std::string::npos;
+        a.stop();
+        b.stop();
+    }
+    std::cout << "Relayed " << big_size / (1024 * 1024) << " MB each way, peak memory grew by "
+              << memory_growth / 1024 << " MB" << std::endl;
+    std::cout << (passed ? "Proxy Forwarding Test Passed" : "Proxy Forwarding Test Failed") << std::endl;
+}
+
+void test_circuit_breaker() {
+    bool passed = false;
+    {
+        QuietOutput quiet;
+        Upstream a("A", upstream_ports[0]), b("B", upstream_ports[1]);
+        a.start();
+        b.start();
+        xebec::ProxyOptions options;
+        options.health_path = "";  // Only the breaker reacts to B going away
+        options.failure_threshold = 2;
+        options.open_circuit_ms = 300;
+        ProxyServer proxy(options);
+        xebec::ProxyUpstream* upstream_b = proxy.proxy->upstreams("/api")[1];
+
+        SOCKET sock = connect_to(proxy_port);
+        std::string pending;
+        std::string before = spread(sock, pending, 20);
+
+        // Requests B cannot take are retried on A, and B's circuit opens.
+        b.stop();
+        std::string down = spread(sock, pending, 20);
+        bool opened = upstream_b->circuit_open();
+
+        // After the cool-down one trial request reaches B again and closes the circuit.
+        b.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        std::string recovered = spread(sock, pending, 40);
+        SOCKET_CLOSE(sock);
+
+        passed = before.find("B0 ") == std::string::npos && down == "A20 B0 failed0" && opened &&
+                 !upstream_b->circuit_open() && recovered.find("B0 ") == std::string::npos &&
+                 recovered.find(" failed0") != std::string::npos;
+        a.stop();
+        b.stop();
+    }
+    std::cout << (passed ? "Circuit Breaker Test Passed" : "Circuit Breaker Test Failed") << std::endl;
+}
+
+// Reads from `sock` until `pending` holds `size` bytes past the end of a head.
+bool read_request_bytes(SOCKET sock, std::string& pending, size_t size) {
+    char buffer[65536];
+    size_t head_end;
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos || pending.size() < head_end + 4 + size) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending.append(buffer, received);
+    }
+    pending.erase(0, head_end + 4 + size);
+    return true;
+}
+
+// An upstream that answers one request on a kept-alive connection, then drops
+// that connection once the next request, a streamed upload, has been read.
+// The upload cannot be sent again, to this upstream or another: the client
+// gets 502 at once instead of a 504 after another upstream waited for the body,
+// and the dropped connection does not count against the upstream.
+void test_stale_connection_upload() {
+    bool passed = false;
+    {
+        QuietOutput quiet;
+        const size_t upload_size = 100000;
+        SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(upstream_ports[0]);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(listener, 4);
+        std::atomic<bool> upload_read{false};
+        std::thread dropping([&]() {
+            SOCKET sock = accept(listener, nullptr, nullptr);
+            std::string pending;
+            if (read_request_bytes(sock, pending, 0)) {
+                const std::string response = "HTTP/1.1 200 OK\r\nContent-Length: 1\r\n\r\nA";
+                send(sock, response.data(), response.size(), 0);
+                upload_read = read_request_bytes(sock, pending, upload_size);
+            }
+            linger reset{1, 0};
+            setsockopt(sock, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&reset), sizeof(reset));
+            SOCKET_CLOSE(sock);
+        });
+        Upstream b("B", upstream_ports[1]);
+        b.start();
+        xebec::ProxyOptions options;
+        options.balance = xebec::ProxyOptions::Balance::LeastConnections;  // A, B, then A again
+        options.health_path = "";
+        options.failure_threshold = 1;
+        options.read_timeout_ms = 2000;
+        ProxyServer proxy(options);
+        xebec::ProxyUpstream* upstream_a = proxy.proxy->upstreams("/api")[0];
+
+        SOCKET sock = connect_to(proxy_port);
+        std::string pending;
+        ClientResponse first = get(sock, pending, "/api/who");
+        ClientResponse second = get(sock, pending, "/api/who");
+        std::string upload = "POST /api/echo HTTP/1.1\r\nHost: localhost\r\nContent-Length: " +
+                             std::to_string(upload_size) + "\r\n\r\n" + std::string(upload_size, 'u');
+        auto start = std::chrono::steady_clock::now();
+        send(sock, upload.data(), upload.size(), 0);
+        ClientResponse failed = read_response(sock, pending);
+        auto waited = std::chrono::steady_clock::now() - start;
+        SOCKET_CLOSE(sock);
+        dropping.join();
+        SOCKET_CLOSE(listener);
+
+        passed = first.body == "A" && second.body.compare(0, 2, "B?") == 0 && upload_read &&
+                 failed.status == 502 && waited < std::chrono::milliseconds(1500) && !upstream_a->circuit_open();
+        b.stop();
+    }
+    std::cout << (passed ? "Stale Connection Upload Test Passed" : "Stale Connection Upload Test Failed")
+              << std::endl;
+}
+
+// A route prefix with regex characters matches only itself, and a chunked
+// response with a malformed chunk size line is cut off: the client sees the
+// connection close, and the upstream connection is not pooled.
+void test_malformed_chunk() {
+    bool passed = false;
+    {
+        QuietOutput quiet;
+        SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&one), sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(upstream_ports[0]);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        listen(listener, 4);
+        std::atomic<int> requests{0};
+        std::thread malformed([&]() {
+            SOCKET sock = accept(listener, nullptr, nullptr);
+            std::string pending;
+            if (read_request_bytes(sock, pending, 0)) {
+                requests++;
+                const std::string response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                             "5\r\nhello\r\nzz\r\nmore\r\n0\r\n\r\n";
+                send(sock, response.data(), response.size(), 0);
+                // Another request here would mean the connection was pooled and reused.
+                if (read_request_bytes(sock, pending, 0)) requests++;
+            }
+            SOCKET_CLOSE(sock);
+        });
+        {
+            xebec::ProxyOptions options;
+            options.health_path = "";
+            ProxyServer proxy(options, "/v1.0");
+            xebec::ProxyUpstream* upstream_a = proxy.proxy->upstreams("/v1.0")[0];
+
+            SOCKET sock = connect_to(proxy_port);
+            std::string pending;
+            ClientResponse unrouted = get(sock, pending, "/v1x0/who");
+            get(sock, pending, "/v1.0/who");
+            pollfd pfd{};
+            pfd.fd = sock;
+            pfd.events = POLLIN;
+            char byte;
+            bool closed = SOCKET_POLL(&pfd, 1, 2000) == 1 && recv(sock, &byte, 1, 0) <= 0;
+            SOCKET_CLOSE(sock);
+            passed = unrouted.status == 404 && closed && upstream_a->idle_connections() == 0;
+        }
+        malformed.join();
+        SOCKET_CLOSE(listener);
+        passed = passed && requests == 1;
+    }
+    std::cout << (passed ? "Malformed Chunk Test Passed" : "Malformed Chunk Test Failed") << std::endl;
+}
+
+int main() {
+    test_proxy_forwarding();
+    test_circuit_breaker();
+    test_stale_connection_upload();
+    test_malformed_chunk();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include "../include/xebec/core/request.hpp"
+
+void test_query_params() {
+    xebec::Request req;
+    xebec::parse_request_target("/search?q=hello+world%21&tag=a&tag=b%2Cc&debug&page=42&bad=4x&on=YES&e=%zz&=&&", req);
+
+    std::vector<std::string_view> tags = req.query.get_all("tag");
+    bool passed = req.path == "/search" &&
+                  req.query.get("q") == "hello world!" &&
+                  req.query["tag"] == "a" &&
+                  tags.size() == 2 && tags[0] == "a" && tags[1] == "b,c" &&
+                  req.query.has("debug") && req.query.get("debug").empty() &&
+                  req.query.get_bool("debug") && req.query.get_bool("on") && !req.query.get_bool("page") &&
+                  req.query.get_int("page") == 42 && req.query.get_int("bad", -1) == -1 &&
+                  req.query.get_int("missing", 7) == 7 &&
+                  req.query.get("e") == "%zz" &&
+                  !req.query.has("missing") && req.query.size() == 8;
+
+    // Copies keep their own decoded buffer.
+    xebec::Request copy = req;
+    req.query.assign("q=other");
+    passed = passed && copy.query.get("q") == "hello world!" && req.query.get("q") == "other" &&
+             req.query.get_all("tag").empty();
+
+    std::string keys;
+    for (auto [key, value] : copy.query) keys += std::string(key) + ",";
+    passed = passed && keys == "q,tag,tag,debug,page,bad,on,e,";
+
+    xebec::parse_request_target("/files/a%20b+c%2Fd", req);
+    passed = passed && req.path == "/files/a%20b+c%2Fd" && req.decoded_path() == "/files/a b+c/d" &&
+             req.query.empty();
+
+    std::cout << (passed ? "Query Params Test Passed" : "Query Params Test Failed") << std::endl;
+}
+
+// Long runs, escapes at the 16-byte block edges and a truncated escape at the end.
+void test_percent_decode() {
+    bool passed = true;
+    std::string plain(100, 'x');
+    for (size_t position = 0; position < 40 && passed; position++) {
+        std::string encoded = plain.substr(0, position) + "%41+" + plain.substr(0, 37 - position) + "%4";
+        std::string expected = plain.substr(0, position) + "A " + plain.substr(0, 37 - position) + "%4";
+        passed = xebec::percent_decode(encoded, true) == expected &&
+                 xebec::percent_decode(encoded, false) == plain.substr(0, position) + "A+" +
+                                                          plain.substr(0, 37 - position) + "%4";
+    }
+    std::cout << (passed ? "Percent Decode Test Passed" : "Percent Decode Test Failed") << std::endl;
+}
+
+void bench_query() {
+    const std::string target = "/api/items?category=books%20and%20music&sort=price&order=desc"
+                               "&page=3&per_page=50&filter=author%3Ddoe&lang=en&debug";
+    auto measure = [](const std::function<void()>& run) {
+        auto start = std::chrono::steady_clock::now();
+        long long count = 0;
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200)) {
+            for (int i = 0; i < 1000; i++) run();
+            count += 1000;
+        }
+        return count / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    xebec::Request req;
+    volatile long long sink = 0;
+    double untouched = measure([&] { xebec::parse_request_target(target, req); });
+    double accessed = measure([&] {
+        xebec::parse_request_target(target, req);
+        sink = sink + req.query.get_int("page") + static_cast<long long>(req.query.get_all("lang").size());
+    });
+    std::string long_value(4096, 'v');
+    for (size_t i = 0; i < long_value.size(); i += 97) long_value.replace(i, 3, "%2F");
+    std::string out(long_value.size(), '\0');
+    double simd = measure([&] { sink = sink + xebec::percent_decode(long_value.data(), long_value.size(), &out[0], true); });
+    double scalar = measure([&] {
+        const char* p = long_value.data();
+        const char* end = p + long_value.size();
+        char* o = &out[0];
+        while (p < end) {
+            const char* special = xebec::detail::find_any_scalar(p, end, '%', '+', '%', '%');
+            std::memcpy(o, p, special - p);
+            o += special - p;
+            if (special == end) break;
+            p = *special == '+' ? (*o++ = ' ', special + 1) : special + xebec::detail::decode_escape(special, end, o++);
+        }
+        sink = sink + (o - &out[0]);
+    });
+
+    std::printf("Request target, query untouched: %10.0f/s\n", untouched);
+    std::printf("Request target, two lookups:     %10.0f/s\n", accessed);
+    std::printf("Percent-decode 4 KB, SIMD scan:  %10.0f MB/s\n", simd * 4096 / 1e6);
+    std::printf("Percent-decode 4 KB, scalar:     %10.0f MB/s\n", scalar * 4096 / 1e6);
+}
+
+int main() {
+    test_query_params();
+    test_percent_decode();
+    bench_query();
+    return 0;
+}
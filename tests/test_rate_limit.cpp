@@ -0,0 +1,162 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18940;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+void test_token_bucket() {
+    using std::chrono::milliseconds;
+    xebec::RateLimitOptions options;
+    options.rate = 2;
+    options.burst = 3;
+    options.max_clients = 4;
+    xebec::RateLimiter limiter(options);
+    std::chrono::nanoseconds retry_after{0};
+
+    // A full bucket allows a burst of three, then one request per 500 ms.
+    bool passed = limiter.capacity() == 4;
+    for (int i = 0; i < 3; i++) passed = passed && limiter.allow_at("a", milliseconds(1000), retry_after);
+    passed = passed && !limiter.allow_at("a", milliseconds(1000), retry_after) && retry_after == milliseconds(500);
+    passed = passed && !limiter.allow_at("a", milliseconds(1400), retry_after) && retry_after == milliseconds(100);
+    passed = passed && limiter.allow_at("a", milliseconds(1500), retry_after);
+    passed = passed && !limiter.allow_at("a", milliseconds(1500), retry_after);
+    passed = passed && limiter.allow_at("b", milliseconds(1500), retry_after);
+
+    // Refill is capped at the burst size.
+    for (int i = 0; i < 3; i++) passed = passed && limiter.allow_at("a", milliseconds(60000), retry_after);
+    passed = passed && !limiter.allow_at("a", milliseconds(60000), retry_after);
+
+    // One set of four buckets: a stream of new clients evicts idle ones, while
+    // the busy client keeps its (empty) bucket.
+    for (int i = 0; i < 20; i++) {
+        passed = passed && limiter.allow_at("client" + std::to_string(i), milliseconds(60000 + i), retry_after);
+    }
+    passed = passed && !limiter.allow_at("a", milliseconds(60100), retry_after);
+    std::cout << (passed ? "Token Bucket Test Passed" : "Token Bucket Test Failed") << std::endl;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Sends one request and returns "<status>[ Retry-After: <n>] <body>".
+std::string request(const std::string& path, const std::string& headers = "") {
+    SOCKET sock = connect_to_server();
+    if (sock == INVALID_SOCKET) return "<no connection>";
+    std::string text = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n" + headers + "\r\n";
+    send(sock, text.data(), text.size(), 0);
+    std::string response;
+    char buffer[4096];
+    int received;
+    while ((received = recv(sock, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, received);
+    SOCKET_CLOSE(sock);
+
+    size_t head_end = response.find("\r\n\r\n");
+    if (head_end == std::string::npos) return "<closed>";
+    std::string result = response.substr(9, 3);
+    size_t retry = response.find("Retry-After: ");
+    if (retry != std::string::npos && retry < head_end) {
+        result += " Retry-After: " + response.substr(retry + 13, response.find("\r\n", retry) - retry - 13);
+    }
+    return result + " " + response.substr(head_end + 4);
+}
+
+void test_rate_limit_middleware() {
+    std::vector<std::string> responses;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        xebec::http_server server(config);
+
+        xebec::RateLimitOptions by_address;
+        by_address.rate = 0.5;
+        by_address.burst = 2;
+        xebec::RateLimiter login_limiter(by_address);
+        login_limiter.route("GET", "/login").route("GET", "/users/:id");
+        server.use(login_limiter.middleware());
+
+        xebec::RateLimitOptions by_key;
+        by_key.rate = 1;
+        by_key.burst = 1;
+        by_key.key_header = "X-Api-Key";
+        xebec::RateLimiter key_limiter(by_key);
+        key_limiter.route("GET", "/api");
+        server.use(key_limiter.middleware());
+
+        server.get("/login", [](xebec::Request& req, xebec::Response& res) { res << "from " + req.remote_addr; });
+        server.get("/users/:id", [](xebec::Request& req, xebec::Response& res) { res << req.params["id"]; });
+        server.get("/api", [](xebec::Request& req, xebec::Response& res) { res << req.get_header("X-Api-Key"); });
+        server.get("/free", [](xebec::Request&, xebec::Response& res) { res << "free"; });
+
+        std::thread server_thread([&server]() { server.start(); });
+        for (int i = 0; i < 200; i++) {
+            SOCKET probe = connect_to_server();
+            if (probe != INVALID_SOCKET) {
+                SOCKET_CLOSE(probe);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        for (int i = 0; i < 3; i++) responses.push_back(request("/login"));
+        responses.push_back(request("/users/7"));
+        responses.push_back(request("/free"));
+        responses.push_back(request("/api", "X-Api-Key: one\r\n"));
+        responses.push_back(request("/api", "X-Api-Key: one\r\n"));
+        responses.push_back(request("/api", "X-Api-Key: two\r\n"));
+        // Without the header the address is the key.
+        responses.push_back(request("/api"));
+        responses.push_back(request("/api"));
+        responses.push_back(request("/api", "X-Api-Key: 127.0.0.1\r\n"));
+
+        server.stop();
+        server_thread.join();
+    }
+
+    const std::vector<std::string> expected = {
+        "200 from 127.0.0.1",
+        "200 from 127.0.0.1",
+        "429 Retry-After: 2 {\"error\":\"Too Many Requests\"}",
+        "200 7",
+        "200 free",
+        "200 one",
+        "429 Retry-After: 1 {\"error\":\"Too Many Requests\"}",
+        "200 two",
+        "200 ",
+        "429 Retry-After: 1 {\"error\":\"Too Many Requests\"}",
+        "200 127.0.0.1",
+    };
+    bool passed = responses == expected;
+    if (!passed) {
+        for (const std::string& response : responses) std::cout << "  " << response << std::endl;
+    }
+    std::cout << (passed ? "Rate Limit Middleware Test Passed" : "Rate Limit Middleware Test Failed") << std::endl;
+}
+
+int main() {
+    test_token_bucket();
+    test_rate_limit_middleware();
+    return 0;
+}
@@ -1,8 +1,14 @@
 #include <iostream>
+#include <cstdio>
 #include <string>
 #include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <cstring>
 #include "../include/xebec/utils/sha1.hpp"
 #include "../include/xebec/utils/base64.hpp"
+#include "../include/xebec/features/websocket.hpp"
 
 void test_base64() {
     std::string input = "hello World";
@@ -27,6 +33,121 @@ void test_base64() {
     }
 }
 
+// A block kernel followed by the scalar tail, as base64_encode/base64_decode do.
+struct Base64Kernel {
+    const char* name;
+    std::function<size_t(const unsigned char*, size_t, char*)> encode;
+    std::function<size_t(const char*, size_t, unsigned char*)> decode;
+};
+
+std::vector<Base64Kernel> available_base64_kernels() {
+    std::vector<Base64Kernel> kernels;
+    kernels.push_back({"scalar",
+                       [](const unsigned char*, size_t, char*) { return size_t(0); },
+                       [](const char*, size_t, unsigned char*) { return size_t(0); }});
+#ifdef XEBEC_X86
+    if (xebec::cpu_features().ssse3) {
+        kernels.push_back({"ssse3", xebec::detail::base64_encode_ssse3, xebec::detail::base64_decode_ssse3});
+    }
+    if (xebec::cpu_features().avx2) {
+        kernels.push_back({"avx2", xebec::detail::base64_encode_avx2, xebec::detail::base64_decode_avx2});
+    }
+#endif
+    return kernels;
+}
+
+std::string encode_with(const Base64Kernel& kernel, const std::vector<unsigned char>& input) {
+    std::string out(xebec::base64_encoded_length(input.size()), '\0');
+    size_t consumed = kernel.encode(input.data(), input.size(), &out[0]);
+    xebec::detail::base64_encode_scalar(input.data() + consumed, input.size() - consumed, &out[consumed / 3 * 4]);
+    return out;
+}
+
+bool decode_with(const Base64Kernel& kernel, const std::string& input, std::vector<unsigned char>& out) {
+    out.assign(xebec::base64_decoded_max_length(input.size()), 0);
+    if (input.size() % 4 != 0) return false;
+    size_t consumed = kernel.decode(input.data(), input.size(), out.data());
+    size_t tail = 0;
+    if (!xebec::detail::base64_decode_scalar(input.data() + consumed, input.size() - consumed,
+                                             out.data() + consumed / 4 * 3, tail)) {
+        return false;
+    }
+    out.resize(consumed / 4 * 3 + tail);
+    return true;
+}
+
+// Every kernel must match the scalar code on all lengths and reject the same inputs.
+void test_base64_kernels() {
+    std::mt19937 rng(42);
+    bool passed = true;
+    auto kernels = available_base64_kernels();
+    for (size_t length = 0; length < 300 && passed; length++) {
+        std::vector<unsigned char> input(length);
+        for (auto& byte : input) byte = static_cast<unsigned char>(rng());
+        std::string expected = encode_with(kernels[0], input);
+        for (const auto& kernel : kernels) {
+            std::vector<unsigned char> decoded;
+            if (encode_with(kernel, input) != expected || !decode_with(kernel, expected, decoded) || decoded != input) {
+                std::cout << kernel.name << " mismatch at length " << length << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    std::string long_valid = xebec::base64_encode(std::vector<unsigned char>(150, 'x').data(), 150);
+    std::vector<std::string> invalid = {"abc", "ab=c", "a===", "====", "@AAA", "AA\x80" "A"};
+    for (size_t position : {0, 17, 100, 190}) {
+        std::string corrupted = long_valid;
+        corrupted[position] = '*';
+        invalid.push_back(corrupted);
+    }
+    for (const auto& kernel : kernels) {
+        for (const auto& input : invalid) {
+            std::vector<unsigned char> decoded;
+            if (decode_with(kernel, input, decoded)) {
+                std::cout << kernel.name << " accepted invalid input " << input << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    std::cout << (passed ? "Base64 Kernels Test Passed" : "Base64 Kernels Test Failed") << std::endl;
+}
+
+void bench_base64() {
+    const size_t size = 1024 * 1024;
+    std::vector<unsigned char> input(size);
+    std::mt19937 rng(7);
+    for (auto& byte : input) byte = static_cast<unsigned char>(rng());
+    std::string encoded = xebec::base64_encode(input.data(), input.size());
+    std::string out(encoded.size(), '\0');
+    std::vector<unsigned char> decoded(size);
+
+    for (const auto& kernel : available_base64_kernels()) {
+        auto measure = [&](const std::function<void()>& run) {
+            auto start = std::chrono::steady_clock::now();
+            int iterations = 0;
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(200)) {
+                run();
+                iterations++;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return iterations * (size / (1024.0 * 1024.0)) / seconds;
+        };
+        double encode_rate = measure([&] {
+            size_t consumed = kernel.encode(input.data(), size, &out[0]);
+            xebec::detail::base64_encode_scalar(input.data() + consumed, size - consumed, &out[consumed / 3 * 4]);
+        });
+        double decode_rate = measure([&] {
+            size_t consumed = kernel.decode(encoded.data(), encoded.size(), decoded.data());
+            size_t tail;
+            xebec::detail::base64_decode_scalar(encoded.data() + consumed, encoded.size() - consumed,
+                                                decoded.data() + consumed / 4 * 3, tail);
+        });
+        std::printf("Base64 %-6s encode: %7.0f MB/s  decode: %7.0f MB/s\n", kernel.name, encode_rate, decode_rate);
+    }
+}
+
 void test_sha1() {
     std::string input = "hello World. This is a sample string to test SHA1 hashing";
 
@@ -49,6 +170,38 @@ void test_sha1() {
     }
 }
 
+// The dispatched compression (SHA-NI where available) must match the scalar one,
+// including inputs split across update() calls.
+void test_sha1_kernels() {
+    std::mt19937 rng(3);
+    bool passed = SHA1::bytes_to_hex(xebec::sha1_digest("abc", 3).data(), 20) ==
+                  "a9993e364706816aba3e25717850c26c9cd0d89d";
+    for (size_t length = 0; length < 300 && passed; length++) {
+        std::vector<uint8_t> input(length);
+        for (auto& byte : input) byte = static_cast<uint8_t>(rng());
+
+        uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+        std::vector<uint8_t> padded = input;
+        padded.push_back(0x80);
+        while (padded.size() % 64 != 56) padded.push_back(0);
+        for (int i = 7; i >= 0; i--) padded.push_back(static_cast<uint8_t>((uint64_t(length) * 8) >> (i * 8)));
+        xebec::detail::sha1_compress_scalar(state, padded.data(), padded.size() / 64);
+        uint8_t expected[20];
+        for (int i = 0; i < 20; i++) expected[i] = static_cast<uint8_t>(state[i / 4] >> (24 - 8 * (i % 4)));
+
+        SHA1 split;
+        split.update(input.data(), length / 3);
+        split.update(input.data() + length / 3, length - length / 3);
+        xebec::Sha1Digest one_shot = xebec::sha1_digest(input.data(), input.size());
+        if (std::memcmp(one_shot.data(), expected, 20) != 0 || std::memcmp(split.digest().data(), expected, 20) != 0) {
+            std::cout << "SHA1 mismatch at length " << length << std::endl;
+            passed = false;
+        }
+    }
+    std::cout << (xebec::cpu_features().sha ? "SHA1 (SHA-NI) " : "SHA1 (scalar) ")
+              << (passed ? "Kernels Test Passed" : "Kernels Test Failed") << std::endl;
+}
+
 void test_websocket_accept() {
     std::string key = "dGhlIHNhbXBsZSBub25jZQ=="; // "the sample nonce" in base64
     std::string expected_accept = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
@@ -61,6 +214,12 @@ void test_websocket_accept() {
     std::vector<uint8_t> hash_bytes = sha1.final_bytes();
     std::string accept_key = xebec::base64_encode(hash_bytes.data(), hash_bytes.size());
 
+    char fixed_accept[28];
+    xebec::websocket_accept_key(key.data(), key.size(), fixed_accept);
+    if (std::string(fixed_accept, 28) != accept_key) {
+        accept_key = "mismatch between the allocating and fixed-size paths";
+    }
+
     std::cout << "WebSocket Accept Key: " << accept_key << std::endl;
     std::cout << "Expected Accept Key: " << expected_accept << std::endl;
 
@@ -74,7 +233,10 @@ void test_websocket_accept() {
 
 int main() {
     test_base64();
+    test_base64_kernels();
     test_sha1();
+    test_sha1_kernels();
     test_websocket_accept();
+    bench_base64();
     return 0;
 }
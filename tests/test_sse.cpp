@@ -0,0 +1,248 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18943;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+// Reads from `sock` into `pending` until it contains `needle`, the peer closes,
+// or a second passes without data.
+bool read_until(SOCKET sock, std::string& pending, const std::string& needle) {
+    char buffer[4096];
+    while (pending.find(needle) == std::string::npos) {
+        pollfd client_poll{};
+        client_poll.fd = sock;
+        client_poll.events = POLLIN;
+        if (SOCKET_POLL(&client_poll, 1, 1000) <= 0) return false;
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        pending.append(buffer, received);
+    }
+    return true;
+}
+
+// Whether the peer closes within a second.
+bool closed_by_peer(SOCKET sock) {
+    char buffer[4096];
+    for (;;) {
+        pollfd client_poll{};
+        client_poll.fd = sock;
+        client_poll.events = POLLIN;
+        if (SOCKET_POLL(&client_poll, 1, 1000) <= 0) return false;
+        if (recv(sock, buffer, sizeof(buffer), 0) <= 0) return true;
+    }
+}
+
+bool wait_for_subscribers(xebec::SseHub& hub, size_t count) {
+    for (int i = 0; i < 200 && hub.subscribers() != count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return hub.subscribers() == count;
+}
+
+void test_sse_encoding() {
+    std::string chunk = xebec::encode_sse_event(7, "update", "a\nb");
+    std::string payload = "id: 7\nevent: update\ndata: a\ndata: b\n\n";
+    bool passed = chunk == "25\r\n" + payload + "\r\n" && payload.size() == 0x25 &&
+                  xebec::encode_sse_event(1, "", "") == "e\r\nid: 1\ndata: \n\n\r\n";
+    // Every line break a client splits on ends a data line, and none gets into the event name.
+    std::string lines = xebec::encode_sse_event(2, "up\r\ndata: x", "a\rb\r\nc\n\nd");
+    passed = passed && lines.substr(lines.find("\r\n") + 2) ==
+                       "id: 2\nevent: updata: x\ndata: a\ndata: b\ndata: c\ndata: \ndata: d\n\n\r\n";
+    std::cout << (passed ? "SSE Encoding Test Passed" : "SSE Encoding Test Failed") << std::endl;
+}
+
+void test_sse_hub() {
+    xebec::SseOptions options;
+    options.history = 4;
+    options.heartbeat_ms = 0;
+    xebec::SseHub hub(options);
+    bool passed = true;
+
+    // Replay from the ring: ids 1-6 published, 3-6 kept.
+    for (int i = 1; i <= 6; i++) hub.publish("c", "event " + std::to_string(i));
+    SOCKET pairs[3][2];
+    std::string pending[3];
+    const char* last_ids[3] = {"1", "5", ""};
+    for (int i = 0; i < 3; i++) {
+        passed = passed && xebec::create_socket_pair(pairs[i]);
+        hub.subscribe(std::make_unique<xebec::Connection>(pairs[i][0]), "c", last_ids[i]);
+    }
+    passed = passed && wait_for_subscribers(hub, 3);
+    hub.publish("c", "event 7", "last");
+    hub.publish("other", "elsewhere");
+    for (int i = 0; i < 3; i++) passed = passed && read_until(pairs[i][1], pending[i], "event: last\ndata: event 7");
+    passed = passed && pending[0].find("id: 2\n") == std::string::npos &&
+             pending[0].find("id: 3\ndata: event 3\n") != std::string::npos &&
+             pending[0].find("id: 6\ndata: event 6\n") != std::string::npos &&
+             pending[1].find("id: 5\n") == std::string::npos && pending[1].find("id: 6\n") != std::string::npos &&
+             pending[2].find("id: 6\n") == std::string::npos && pending[2].find("elsewhere") == std::string::npos;
+
+    // A client that goes away is dropped.
+    SOCKET_CLOSE(pairs[2][1]);
+    passed = passed && wait_for_subscribers(hub, 2);
+
+    // A client that reads too slowly is dropped when it falls out of the ring, instead of being buffered for.
+    std::string large(256 * 1024, 'x');
+    for (int i = 0; i < 16; i++) hub.publish("c", large);
+    SOCKET_CLOSE(pairs[0][1]);
+    passed = passed && wait_for_subscribers(hub, 1) && closed_by_peer(pairs[1][1]);
+    passed = passed && hub.subscribers() == 0;
+    SOCKET_CLOSE(pairs[1][1]);
+    std::cout << (passed ? "SSE Hub Test Passed" : "SSE Hub Test Failed") << std::endl;
+}
+
+bool wait_for_channels(xebec::SseHub& hub, size_t count) {
+    for (int i = 0; i < 200 && hub.channels() != count; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return hub.channels() == count;
+}
+
+// Channels nothing was published to are forgotten with their last subscriber,
+// and new channels past max_channels are refused.
+void test_sse_channels() {
+    xebec::SseOptions options;
+    options.history = 4;
+    options.heartbeat_ms = 0;
+    options.max_channels = 2;
+    xebec::SseHub hub(options);
+    bool passed = true;
+
+    for (int i = 0; i < 100; i++) {
+        SOCKET pair[2];
+        passed = passed && xebec::create_socket_pair(pair);
+        hub.subscribe(std::make_unique<xebec::Connection>(pair[0]), "made-up " + std::to_string(i));
+        passed = passed && wait_for_subscribers(hub, 1);
+        SOCKET_CLOSE(pair[1]);
+        passed = passed && wait_for_subscribers(hub, 0);
+    }
+    passed = passed && wait_for_channels(hub, 0);
+
+    SOCKET pairs[3][2];
+    const char* names[3] = {"a", "b", "c"};
+    for (int i = 0; i < 3; i++) {
+        passed = passed && xebec::create_socket_pair(pairs[i]);
+        hub.subscribe(std::make_unique<xebec::Connection>(pairs[i][0]), names[i]);
+    }
+    passed = passed && wait_for_subscribers(hub, 2) && hub.channels() == 2 && closed_by_peer(pairs[2][1]);
+    passed = passed && hub.publish("d", "refused") == 0 && hub.publish("b", "kept") == 1;
+
+    // "b" has history now, so it outlives its subscriber; "a" does not.
+    SOCKET_CLOSE(pairs[0][1]);
+    SOCKET_CLOSE(pairs[1][1]);
+    passed = passed && wait_for_subscribers(hub, 0) && wait_for_channels(hub, 1);
+    SOCKET_CLOSE(pairs[2][1]);
+    std::cout << (passed ? "SSE Channels Test Passed" : "SSE Channels Test Failed") << std::endl;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+SOCKET subscribe(const std::string& path, const std::string& headers = "") {
+    SOCKET sock = connect_to_server();
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\nAccept: text/event-stream\r\n" +
+                          headers + "\r\n";
+    send(sock, request.data(), request.size(), 0);
+    return sock;
+}
+
+bool run_sse_server(xebec::IoBackend backend) {
+    QuietOutput quiet;
+    xebec::ServerConfig config;
+    config.port = test_port;
+    config.io_backend = backend;
+    xebec::http_server server(config);
+    server.use([](xebec::Request& req, xebec::Response& res, xebec::MiddlewareContext::NextFunction next) {
+        if (req.path == "/rooms/secret") {
+            res.status_code(403);
+            res << "Forbidden";
+            return;
+        }
+        next();
+    });
+    server.sse("/rooms/:room", [](xebec::Request& req) { return "room-" + req.params["room"]; });
+    server.sse("/ticker");
+
+    std::thread server_thread([&server]() { server.start(); });
+    for (int i = 0; i < 200; i++) {
+        SOCKET probe = connect_to_server();
+        if (probe != INVALID_SOCKET) {
+            SOCKET_CLOSE(probe);
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::string first_pending, second_pending, ticker_pending, secret_pending;
+    SOCKET first = subscribe("/rooms/a");
+    SOCKET ticker = subscribe("/ticker");
+    bool passed = read_until(first, first_pending, "\r\n\r\n") && read_until(ticker, ticker_pending, "\r\n\r\n") &&
+                  first_pending.compare(0, 12, "HTTP/1.1 200") == 0 &&
+                  first_pending.find("Content-Type: text/event-stream\r\n") != std::string::npos &&
+                  first_pending.find("Transfer-Encoding: chunked\r\n") != std::string::npos &&
+                  first_pending.find("Content-Length") == std::string::npos &&
+                  wait_for_subscribers(server.events(), 2);
+
+    server.events().publish("room-a", "hello");
+    server.events().publish("/ticker", "42", "tick");
+    passed = passed && read_until(first, first_pending, "id: 1\ndata: hello\n\n\r\n") &&
+             read_until(ticker, ticker_pending, "id: 1\nevent: tick\ndata: 42\n\n\r\n") &&
+             ticker_pending.find("hello") == std::string::npos;
+
+    // A reconnecting client gets what it missed.
+    server.events().publish("room-a", "while away");
+    SOCKET second = subscribe("/rooms/a", "Last-Event-ID: 1\r\n");
+    passed = passed && read_until(second, second_pending, "id: 2\ndata: while away\n") &&
+             second_pending.find("hello") == std::string::npos;
+
+    SOCKET secret = subscribe("/rooms/secret");
+    passed = passed && read_until(secret, secret_pending, "Forbidden") &&
+             secret_pending.compare(0, 12, "HTTP/1.1 403") == 0;
+    SOCKET_CLOSE(secret);
+
+    server.stop();
+    server_thread.join();
+    passed = passed && closed_by_peer(first) && closed_by_peer(second) && closed_by_peer(ticker) &&
+             server.events().subscribers() == 0;
+    SOCKET_CLOSE(first);
+    SOCKET_CLOSE(second);
+    SOCKET_CLOSE(ticker);
+    return passed;
+}
+
+int main() {
+    test_sse_encoding();
+    test_sse_hub();
+    test_sse_channels();
+    bool passed = run_sse_server(xebec::IoBackend::Threads);
+    std::cout << (passed ? "SSE Server Test Passed" : "SSE Server Test Failed") << std::endl;
+#ifdef XEBEC_HAS_IO_URING
+    if (xebec::IoUring::supported()) {
+        passed = run_sse_server(xebec::IoBackend::IoUring);
+        std::cout << (passed ? "SSE Server io_uring Test Passed" : "SSE Server io_uring Test Failed") << std::endl;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18949;
+const int request_count = 50;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Reads one Content-Length framed response and returns its body.
+std::string read_body(SOCKET sock, std::string& pending) {
+    char buffer[65536];
+    while (true) {
+        size_t head_end = pending.find("\r\n\r\n");
+        if (head_end != std::string::npos) {
+            size_t length_pos = pending.find("Content-Length: ");
+            size_t length = length_pos < head_end ? std::stoul(pending.substr(length_pos + 16)) : 0;
+            if (pending.size() >= head_end + 4 + length) {
+                std::string body = pending.substr(head_end + 4, length);
+                pending.erase(0, head_end + 4 + length);
+                return body;
+            }
+        }
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return "<closed>";
+        pending.append(buffer, received);
+    }
+}
+
+// A 16 KB static file requested over and over on one keep-alive connection. A
+// head and body sent as two writes without TCP_NODELAY wait on the client's
+// delayed ACK, about 40 ms per request.
+bool static_file_latency(xebec::IoBackend backend, double& ms_per_request) {
+    std::string asset(16 * 1024, 's');
+    bool passed = true;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.io_backend = backend;
+        xebec::http_server server(config);
+        server.publicDir("xebec_static_public");
+        std::thread server_thread([&server]() { server.start(); });
+        SOCKET sock = INVALID_SOCKET;
+        for (int i = 0; i < 200 && sock == INVALID_SOCKET; i++) {
+            sock = connect_to_server();
+            if (sock == INVALID_SOCKET) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        std::string request = "GET /asset.txt HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        std::string pending;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < request_count && passed; i++) {
+            send(sock, request.data(), request.size(), 0);
+            passed = read_body(sock, pending) == asset;
+        }
+        ms_per_request = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() /
+                         request_count;
+        SOCKET_CLOSE(sock);
+        server.stop();
+        server_thread.join();
+    }
+    return passed && ms_per_request < 5;
+}
+
+int main() {
+    std::system("mkdir -p xebec_static_public");
+    { std::ofstream("xebec_static_public/asset.txt", std::ios::binary) << std::string(16 * 1024, 's'); }
+
+    double ms = 0;
+    bool passed = static_file_latency(xebec::IoBackend::Threads, ms);
+    std::cout << "Static file: " << ms << " ms/request" << std::endl;
+    std::cout << (passed ? "Static File Latency Test Passed" : "Static File Latency Test Failed") << std::endl;
+#ifdef XEBEC_HAS_IO_URING
+    if (xebec::IoUring::supported()) {
+        passed = static_file_latency(xebec::IoBackend::IoUring, ms);
+        std::cout << "Static file over io_uring: " << ms << " ms/request" << std::endl;
+        std::cout << (passed ? "Static File io_uring Latency Test Passed" : "Static File io_uring Latency Test Failed")
+                  << std::endl;
+    }
+#endif
+
+    std::remove("xebec_static_public/asset.txt");
+    std::remove("xebec_static_public");
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Built by test.bat after generating generated/templates_generated.hpp:
+//
+//     g++ -o xebec_templates tools/xebec_templates.cpp -std=c++17
+//     xebec_templates --dir tests/templates --include include/xebec/features/template.hpp
+//                     -o generated/templates_generated.hpp page.html users/profile.html keywords.html fields.html
+//     g++ -I. -Igenerated tests/test_template_compiler.cpp -std=c++17
+#include <iostream>
+#include <string>
+#include <map>
+#include "templates_generated.hpp"
+
+static_assert(templates::detail_page_html::chunk0.substr(0, 15) == "<!DOCTYPE html>",
+              "literal text is available at compile time");
+
+void test_compiled_render() {
+    std::map<std::string, std::string> vars = {{"title", "Welcome \"home\""}, {"content", "Hello"}};
+    xebec::SimpleTemplateEngine simple;
+    simple.set_template_dir("tests/templates");
+    std::string expected = simple.render("page.html", vars);
+
+    templates::PageHtml page;
+    page.title = "Welcome \"home\"";
+    page.content = "Hello";
+    size_t predicted = templates::render_size(page);
+    std::string typed = templates::render(page);
+    std::string appended = "prefix:";
+    templates::render(page, appended);
+
+    // Unset struct fields are empty; unset map entries stay as placeholders, as in SimpleTemplateEngine.
+    page.spaced = "{{ spaced }}";
+    page.missing = "{{missing}}";
+    bool passed = templates::render_page_html(vars) == expected &&
+                  expected.find("{{ spaced }} and {{missing}}") != std::string::npos &&
+                  typed.find("<p> and </p>") != std::string::npos &&
+                  typed.size() == predicted &&
+                  templates::render(page) == expected &&
+                  appended == "prefix:" + typed &&
+                  templates::render(templates::UsersProfileHtml{"Ada", "admin"}) == "<div>Ada (admin)</div>";
+    std::cout << (passed ? "Compiled Template Test Passed" : "Compiled Template Test Failed") << std::endl;
+}
+
+// Placeholders named after keywords are set through fields with a "_" appended.
+void test_keyword_placeholders() {
+    templates::KeywordsHtml link;
+    link.class_ = "nav";
+    link.default_ = "/home";
+    link.class__ = "Home";
+    std::map<std::string, std::string> vars = {{"class", "nav"}, {"default", "/home"}, {"class_", "Home"}};
+    xebec::SimpleTemplateEngine simple;
+    simple.set_template_dir("tests/templates");
+    bool passed = templates::render(link) == "<a class=\"nav\" href=\"/home\">Home</a>" &&
+                  templates::render_keywords_html(vars) == templates::render(link) &&
+                  simple.render("keywords.html", vars) == templates::render(link);
+    std::cout << (passed ? "Keyword Placeholder Test Passed" : "Keyword Placeholder Test Failed") << std::endl;
+}
+
+// Placeholders that are not identifiers get fields made from their keys, and
+// render as SimpleTemplateEngine does, set or not.
+void test_field_names() {
+    templates::FieldsHtml fields;
+    fields.user_name = "Ada";
+    fields.user_name_ = "ada";
+    fields.spaced = "s";
+    fields.x = "x";
+    fields.say_hi = "hi";
+    fields.field_2nd = "2";
+    std::map<std::string, std::string> vars = {{"user.name", "Ada"}, {"user-name", "ada"}, {" spaced ", "s"},
+                                               {"x", "x"}, {"say \"hi\"", "hi"}, {"2nd", "2"}};
+    std::map<std::string, std::string> some = {{"user.name", "Ada"}, {"x", "x"}};
+    xebec::SimpleTemplateEngine simple;
+    simple.set_template_dir("tests/templates");
+    bool passed = templates::render(fields) == "<p>Ada / ada / s / {x} / hi / 2</p>\n" &&
+                  templates::render_fields_html(vars) == simple.render("fields.html", vars) &&
+                  templates::render_fields_html(vars) == templates::render(fields) &&
+                  templates::render_fields_html(some) == simple.render("fields.html", some);
+    std::cout << (passed ? "Field Name Test Passed" : "Field Name Test Failed") << std::endl;
+}
+
+void test_compiled_engine() {
+    xebec::CompiledTemplateEngine engine;
+    engine.set_template_dir("tests/templates");
+    templates::register_templates(engine);
+
+    std::map<std::string, std::string> vars = {{"name", "Grace"}, {"role", "owner"}, {"message", "dynamic"}};
+    bool passed = engine.render("users/profile.html", vars) == "<div>Grace (owner)</div>" &&
+                  // Not compiled: read from the template directory.
+                  engine.render("plain.html", vars) == "<p>dynamic</p>\n";
+    try {
+        engine.render("absent.html", vars);
+        passed = false;
+    } catch (const xebec::HttpError& e) {
+        passed = passed && e.status_code() == 500;
+    }
+    std::cout << (passed ? "Compiled Template Engine Test Passed" : "Compiled Template Engine Test Failed") << std::endl;
+}
+
+int main() {
+    test_compiled_render();
+    test_keyword_placeholders();
+    test_field_names();
+    test_compiled_engine();
+    return 0;
+}
@@ -0,0 +1,184 @@
+// TLS tests over a self-signed certificate generated at startup:
+//
+//     g++ -std=c++17 -DXEBEC_ENABLE_TLS tests/test_tls.cpp -lssl -lcrypto -pthread
+#include <iostream>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <chrono>
+#include "../include/xebec/xebec.hpp"
+
+#ifdef XEBEC_ENABLE_TLS
+
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+const int test_port = 18948;
+const std::string cert_path = "xebec_test_tls_cert.pem";
+const std::string key_path = "xebec_test_tls_key.pem";
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+bool write_self_signed_cert() {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 86400);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1,
+                               0);
+    X509_set_issuer_name(cert, name);
+    X509_sign(cert, key, EVP_sha256());
+
+    FILE* cert_file = std::fopen(cert_path.c_str(), "wb");
+    FILE* key_file = std::fopen(key_path.c_str(), "wb");
+    bool ok = cert_file && key_file && PEM_write_X509(cert_file, cert) &&
+              PEM_write_PrivateKey(key_file, key, nullptr, nullptr, 0, nullptr, nullptr);
+    if (cert_file) std::fclose(cert_file);
+    if (key_file) std::fclose(key_file);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Sends `requests` over a new TLS connection offering `alpn`, and reads until the
+// server closes it. `protocol` receives the protocol the server selected.
+bool tls_exchange(SSL_CTX* ctx, const std::string& alpn, const std::string& requests, std::string& responses,
+                  std::string& protocol) {
+    SOCKET sock = connect_to_server();
+    if (sock == INVALID_SOCKET) return false;
+    SSL* ssl = SSL_new(ctx);
+    SSL_set_fd(ssl, static_cast<int>(sock));
+    SSL_set_alpn_protos(ssl, reinterpret_cast<const unsigned char*>(alpn.data()),
+                        static_cast<unsigned int>(alpn.size()));
+    bool ok = SSL_connect(ssl) == 1;
+    if (ok) {
+        const unsigned char* selected = nullptr;
+        unsigned int selected_length = 0;
+        SSL_get0_alpn_selected(ssl, &selected, &selected_length);
+        protocol.assign(reinterpret_cast<const char*>(selected), selected_length);
+        ok = requests.empty() || SSL_write(ssl, requests.data(), static_cast<int>(requests.size())) > 0;
+        char buffer[4096];
+        int received;
+        while (ok && !requests.empty() && (received = SSL_read(ssl, buffer, sizeof(buffer))) > 0) {
+            responses.append(buffer, received);
+        }
+        SSL_shutdown(ssl);
+    }
+    SSL_free(ssl);
+    SOCKET_CLOSE(sock);
+    return ok;
+}
+
+// Keep-alive requests over TLS, and HTTP/2 offered through ALPN.
+bool test_requests(SSL_CTX* ctx) {
+    std::string requests = "GET /hello HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                           "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    std::string responses, protocol;
+    bool passed = tls_exchange(ctx, std::string("\x08http/1.1", 9), requests, responses, protocol) &&
+                  protocol == "http/1.1" && responses.find("hello secure") != std::string::npos &&
+                  responses.find("hello secure", responses.find("hello secure") + 1) != std::string::npos;
+
+    std::string ignored;
+    passed = passed && tls_exchange(ctx, std::string("\x02h2\x08http/1.1", 12), "", ignored, protocol) &&
+             protocol == "h2";
+    return passed;
+}
+
+// A client that connects and never sends a ClientHello is dropped once the
+// handshake timeout passes, and other clients are still served meanwhile.
+bool test_handshake_timeout(SSL_CTX* ctx) {
+    SOCKET stalled = connect_to_server();
+    auto start = std::chrono::steady_clock::now();
+
+    std::string responses, protocol;
+    bool passed = tls_exchange(ctx, std::string("\x08http/1.1", 9),
+                               "GET /hello HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n", responses,
+                               protocol) &&
+                  responses.find("hello secure") != std::string::npos;
+
+    pollfd pfd{};
+    pfd.fd = stalled;
+    pfd.events = POLLIN;
+    char byte;
+    passed = passed && SOCKET_POLL(&pfd, 1, 3000) == 1 && recv(stalled, &byte, 1, 0) <= 0;
+    auto waited = std::chrono::steady_clock::now() - start;
+    passed = passed && waited >= std::chrono::milliseconds(250) && waited < std::chrono::milliseconds(2000);
+    SOCKET_CLOSE(stalled);
+    return passed;
+}
+
+int main() {
+    if (!write_self_signed_cert()) {
+        std::cout << "TLS Test Failed: no certificate" << std::endl;
+        return 1;
+    }
+    bool requests_passed, timeout_passed;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.ssl_cert_path = cert_path;
+        config.ssl_key_path = key_path;
+        config.tls_handshake_timeout_ms = 300;
+        xebec::http_server server(config);
+        server.get("/hello", [](xebec::Request&, xebec::Response& res) { res << "hello secure"; });
+        std::thread server_thread([&server]() { server.start(); });
+        for (int i = 0; i < 200; i++) {
+            SOCKET probe = connect_to_server();
+            if (probe != INVALID_SOCKET) {
+                SOCKET_CLOSE(probe);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        SSL_CTX* client_ctx = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_verify(client_ctx, SSL_VERIFY_NONE, nullptr);
+        requests_passed = test_requests(client_ctx);
+        timeout_passed = test_handshake_timeout(client_ctx);
+        SSL_CTX_free(client_ctx);
+
+        server.stop();
+        server_thread.join();
+    }
+    std::remove(cert_path.c_str());
+    std::remove(key_path.c_str());
+
+    std::cout << (requests_passed ? "TLS Requests Test Passed" : "TLS Requests Test Failed") << std::endl;
+    std::cout << (timeout_passed ? "TLS Handshake Timeout Test Passed" : "TLS Handshake Timeout Test Failed")
+              << std::endl;
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cout << "Built without XEBEC_ENABLE_TLS, TLS tests skipped" << std::endl;
+    return 0;
+}
+
+#endif
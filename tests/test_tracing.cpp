@@ -0,0 +1,211 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include "../include/xebec/xebec.hpp"
+
+const int test_port = 18944;
+
+struct QuietOutput {
+    std::streambuf* saved_out = std::cout.rdbuf(nullptr);
+    std::streambuf* saved_err = std::cerr.rdbuf(nullptr);
+    ~QuietOutput() {
+        std::cout.rdbuf(saved_out);
+        std::cerr.rdbuf(saved_err);
+    }
+};
+
+struct Span {
+    std::string name;
+    std::string category;
+    double start;
+    double end;
+    long long request;
+};
+
+std::vector<Span> spans(const std::string& trace) {
+    std::vector<Span> found;
+    xebec::JsonDocument doc(trace);
+    for (xebec::JsonValue event : doc["traceEvents"].array()) {
+        double start = event["ts"].get_double();
+        found.push_back({std::string(event["name"].get_string()), std::string(event["cat"].get_string()), start,
+                         start + event["dur"].get_double(), event["args"]["request"].get_int()});
+    }
+    return found;
+}
+
+void test_trace_buffer() {
+    xebec::TraceBuffer buffer(4, 1);
+    std::vector<xebec::TraceEvent> events;
+    for (uint64_t i = 0; i < 10; i++) {
+        xebec::TraceEvent event{};
+        event.trace = i;
+        buffer.record(event);
+        if (i == 2) buffer.collect(events);
+    }
+    bool passed = events.size() == 3 && events[0].trace == 0 && events[2].trace == 2;
+    // Once the ring is full, the oldest entry is the one the next record() overwrites.
+    events.clear();
+    buffer.collect(events);
+    passed = passed && events.size() == 3 && events[0].trace == 7 && events[2].trace == 9;
+    std::cout << (passed ? "Trace Buffer Test Passed" : "Trace Buffer Test Failed") << std::endl;
+}
+
+void test_sampling() {
+    xebec::Tracer& tracer = xebec::Tracer::global();
+    tracer.set_sample_rate(0);
+    bool passed = true;
+    for (int i = 0; i < 1000; i++) passed = passed && tracer.sample() == 0;
+    tracer.set_sample_rate(0.01);
+    int sampled = 0;
+    for (int i = 0; i < 100000; i++) sampled += tracer.sample() != 0;
+    passed = passed && sampled > 700 && sampled < 1300;
+
+    // Spans outside a sampled request are not recorded; inside one they nest.
+    tracer.set_sample_rate(1);
+    tracer.clear();
+    { xebec::TraceSpan ignored("outside"); }
+    {
+        xebec::RequestTrace trace;
+        trace.describe("GET", "/a/path/long/enough/to/be/cut/at/the/end/of/the/name/field/of/an/event");
+        xebec::TraceSpan outer("outer");
+        { xebec::TraceSpan inner("inner"); }
+    }
+    tracer.set_sample_rate(0);
+    std::vector<Span> found = spans(tracer.chrome_trace());
+    std::map<std::string, Span> by_name;
+    for (const Span& span : found) by_name[span.name] = span;
+    passed = passed && found.size() == 3 && by_name.count("inner") && by_name.count("outer") &&
+             by_name.count("GET /a/path/long/enough/to/be/cut/at/the/end/of/the/na") &&
+             by_name["inner"].start >= by_name["outer"].start && by_name["inner"].end <= by_name["outer"].end &&
+             by_name["inner"].category == "user" && by_name["inner"].request == by_name["outer"].request;
+    std::cout << (passed ? "Trace Sampling Test Passed" : "Trace Sampling Test Failed") << std::endl;
+}
+
+SOCKET connect_to_server() {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(test_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        SOCKET_CLOSE(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+bool get(SOCKET sock, const std::string& path, const std::string& expected) {
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(sock, request.data(), request.size(), 0);
+    std::string response;
+    char buffer[4096];
+    while (response.find(expected) == std::string::npos) {
+        int received = recv(sock, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        response.append(buffer, received);
+    }
+    return true;
+}
+
+bool run_traced_server(xebec::IoBackend backend) {
+    std::vector<Span> found;
+    bool replied = false;
+    {
+        QuietOutput quiet;
+        xebec::ServerConfig config;
+        config.port = test_port;
+        config.io_backend = backend;
+        config.trace_sample_rate = 1;
+        xebec::http_server server(config);
+        server.use([](xebec::Request&, xebec::Response&, xebec::MiddlewareContext::NextFunction next) { next(); });
+        server.get("/users/:id", [](xebec::Request& req, xebec::Response& res) {
+            xebec::TraceSpan span("load user");
+            res << "user " << req.params["id"];
+        });
+
+        std::thread server_thread([&server]() { server.start(); });
+        for (int i = 0; i < 200; i++) {
+            SOCKET probe = connect_to_server();
+            if (probe != INVALID_SOCKET) {
+                SOCKET_CLOSE(probe);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        xebec::Tracer::global().clear();
+        SOCKET sock = connect_to_server();
+        replied = get(sock, "/users/7", "user 7") && get(sock, "/users/8", "user 8");
+        SOCKET_CLOSE(sock);
+        server.stop();
+        server_thread.join();
+        xebec::Tracer::global().set_sample_rate(0);
+        found = spans(xebec::Tracer::global().chrome_trace());
+    }
+
+    // Every span of a request lies within the request's own span.
+    std::map<long long, Span> requests;
+    for (const Span& span : found) {
+        if (span.category == "request") requests[span.request] = span;
+    }
+    std::map<std::string, int> seen;
+    bool nested = requests.size() == 2;
+    for (const Span& span : found) {
+        seen[span.name]++;
+        auto request = requests.find(span.request);
+        nested = nested && request != requests.end() && span.start >= request->second.start &&
+                 span.end <= request->second.end;
+    }
+    bool threads = backend == xebec::IoBackend::Threads;
+    return replied && nested && seen["GET /users/7"] == 1 && seen["GET /users/8"] == 1 &&
+           seen["parse_request"] == 2 && seen["middleware"] == 2 && seen["handle_route"] == 2 &&
+           seen["handler"] == 2 && seen["load user"] == 2 &&
+           seen["read_request"] == (threads ? 2 : 0) && seen["send_response"] == (threads ? 2 : 0);
+}
+
+void test_dump_on_signal() {
+#ifndef _WIN32
+    const std::string path = "trace_signal_test.json";
+    std::remove(path.c_str());
+    xebec::Tracer& tracer = xebec::Tracer::global();
+    tracer.set_sample_rate(1);
+    { xebec::RequestTrace trace; }
+    tracer.set_sample_rate(0);
+    // Set up once: a second call fails instead of starting another writing thread.
+    bool passed = tracer.dump_on_signal(SIGUSR2, path) && !tracer.dump_on_signal(SIGUSR1, path + ".2") &&
+                  raise(SIGUSR2) == 0;
+    std::string content;
+    for (int i = 0; i < 200 && content.find("]") == std::string::npos; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::ifstream file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        content = buffer.str();
+    }
+    passed = passed && content.compare(0, 15, "{\"traceEvents\":") == 0 &&
+             content.find("\"name\":\"request\"") != std::string::npos;
+    std::remove(path.c_str());
+    std::cout << (passed ? "Trace Signal Dump Test Passed" : "Trace Signal Dump Test Failed") << std::endl;
+#endif
+}
+
+int main() {
+    test_trace_buffer();
+    test_sampling();
+    bool passed = run_traced_server(xebec::IoBackend::Threads);
+    std::cout << (passed ? "Traced Server Test Passed" : "Traced Server Test Failed") << std::endl;
+#ifdef XEBEC_HAS_IO_URING
+    if (xebec::IoUring::supported()) {
+        passed = run_traced_server(xebec::IoBackend::IoUring);
+        std::cout << (passed ? "Traced Server io_uring Test Passed" : "Traced Server io_uring Test Failed")
+                  << std::endl;
+    }
+#endif
+    test_dump_on_signal();
+    return 0;
+}
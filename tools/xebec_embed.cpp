@@ -0,0 +1,197 @@
+// Packs a directory into a C++ header, as a build step, for
+// server.publicDir(<namespace>::files):
+//
+//     g++ -O2 -std=c++17 -o xebec_embed tools/xebec_embed.cpp
+//     xebec_embed --dir public --namespace public_files -o generated/public_files.hpp
+//
+// Every file becomes a constexpr array, so it lives in the binary's read-only
+// data, together with its MIME type and a strong ETag of its content. A
+// precompressed sibling (site.css.gz, site.css.br) is packed as an encoding of
+// the file when it is smaller. Paths are indexed with a perfect hash computed
+// here, so the server needs no file I/O and no setup at startup.
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "../include/xebec/features/embedded_files.hpp"
+#include "../include/xebec/features/static_files.hpp"
+#include "../include/xebec/utils/etag.hpp"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct PackedFile {
+    std::string path;       // "/css/site.css"
+    std::string content;
+    std::string gzip;       // empty when not packed
+    std::string br;
+};
+
+bool read_file(const fs::path& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+bool has_suffix(const std::string& text, const std::string& suffix) {
+    return text.size() > suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string quote(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string etag_literal(const std::string& content) {
+    return quote("\"" + xebec::to_hex(xebec::fnv1a_64(content.data(), content.size())) + "\"");
+}
+
+// A char array initializer; a trailing NUL keeps empty files valid.
+void write_array(std::ostream& out, const std::string& name, const std::string& content) {
+    out << "inline constexpr char " << name << "[] = {";
+    for (size_t i = 0; i <= content.size(); i++) {
+        if (i % 16 == 0) out << "\n    ";
+        unsigned char c = i < content.size() ? static_cast<unsigned char>(content[i]) : 0;
+        if (c >= 0x20 && c < 0x7F && c != '\'' && c != '\\') {
+            out << '\'' << static_cast<char>(c) << "',";
+        } else {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "'\\x%02x',", c);
+            out << escaped;
+        }
+    }
+    out << "\n};\n";
+}
+
+std::string variant(const std::string& array, const std::string& content) {
+    return "{{" + array + ", " + std::to_string(content.size()) + "}, " + etag_literal(content) + "}";
+}
+
+int usage() {
+    std::cerr << "usage: xebec_embed --dir <directory> [--namespace <name>] [--include <embedded_files.hpp>]\n"
+                 "                   -o <output.hpp>\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string dir;
+    std::string name_space = "public_files";
+    std::string include = "xebec/features/embedded_files.hpp";
+    std::string output;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--dir" && has_value) dir = argv[++i];
+        else if (arg == "--namespace" && has_value) name_space = argv[++i];
+        else if (arg == "--include" && has_value) include = argv[++i];
+        else if (arg == "-o" && has_value) output = argv[++i];
+        else return usage();
+    }
+    if (dir.empty() || output.empty()) return usage();
+
+    std::error_code error;
+    std::vector<fs::path> found;
+    for (fs::recursive_directory_iterator it(dir, error), end; !error && it != end; it.increment(error)) {
+        if (it->is_regular_file()) found.push_back(it->path());
+    }
+    if (error) {
+        std::cerr << "cannot read " << dir << ": " << error.message() << "\n";
+        return 1;
+    }
+
+    std::vector<PackedFile> files;
+    for (const fs::path& path : found) {
+        std::string relative = "/" + fs::relative(path, dir).generic_string();
+        // site.css.gz next to site.css is an encoding of it, not a file of its own.
+        if ((has_suffix(relative, ".gz") || has_suffix(relative, ".br")) &&
+            fs::is_regular_file(path.parent_path() / path.stem())) {
+            continue;
+        }
+        PackedFile file;
+        file.path = relative;
+        if (!read_file(path, file.content)) {
+            std::cerr << "cannot read " << path << "\n";
+            return 1;
+        }
+        std::string compressed;
+        if (read_file(path.string() + ".gz", compressed) && compressed.size() < file.content.size()) {
+            file.gzip = compressed;
+        }
+        if (read_file(path.string() + ".br", compressed) && compressed.size() < file.content.size()) {
+            file.br = compressed;
+        }
+        files.push_back(std::move(file));
+    }
+    if (files.empty()) {
+        std::cerr << "no files in " << dir << "\n";
+        return 1;
+    }
+    std::sort(files.begin(), files.end(), [](const PackedFile& a, const PackedFile& b) { return a.path < b.path; });
+
+    std::vector<std::string_view> paths;
+    for (const PackedFile& file : files) paths.push_back(file.path);
+    std::vector<uint32_t> seeds;
+    std::vector<uint32_t> slots;
+    xebec::detail::build_embedded_index(paths, seeds, slots);
+
+    std::ostringstream out;
+    out << "// Generated by tools/xebec_embed.cpp. Do not edit.\n";
+    out << "#pragma once\n";
+    out << "#include <cstdint>\n";
+    out << "#include \"" << include << "\"\n\n";
+    out << "namespace " << name_space << " {\n";
+    out << "namespace detail {\n\n";
+    for (size_t i = 0; i < files.size(); i++) {
+        out << "// " << files[i].path << "\n";
+        write_array(out, "file" + std::to_string(i), files[i].content);
+        if (!files[i].gzip.empty()) write_array(out, "file" + std::to_string(i) + "_gzip", files[i].gzip);
+        if (!files[i].br.empty()) write_array(out, "file" + std::to_string(i) + "_br", files[i].br);
+        out << "\n";
+    }
+
+    out << "inline constexpr xebec::EmbeddedFile files[] = {\n";
+    for (size_t i = 0; i < files.size(); i++) {
+        const PackedFile& file = files[i];
+        std::string array = "file" + std::to_string(i);
+        out << "    {" << quote(file.path) << ", " << quote(xebec::mime_type(file.path)) << ",\n"
+            << "     " << variant(array, file.content) << ",\n"
+            << "     " << (file.gzip.empty() ? "{}" : variant(array + "_gzip", file.gzip)) << ", "
+            << (file.br.empty() ? "{}" : variant(array + "_br", file.br)) << "},\n";
+    }
+    out << "};\n\n";
+
+    for (const auto& [name, values] : {std::make_pair("seeds", &seeds), std::make_pair("slots", &slots)}) {
+        out << "inline constexpr uint32_t " << name << "[] = {";
+        for (size_t i = 0; i < values->size(); i++) out << (i % 12 == 0 ? "\n    " : " ") << (*values)[i] << ",";
+        out << "\n};\n\n";
+    }
+    out << "} // namespace detail\n\n";
+    out << "inline constexpr xebec::EmbeddedDirectory files{detail::files, " << files.size() << ", detail::seeds, "
+        << seeds.size() << ", detail::slots, " << slots.size() << "};\n\n";
+    out << "} // namespace " << name_space << "\n";
+
+    // Rewritten only when it changes, so dependents are not rebuilt needlessly.
+    std::string previous;
+    if (read_file(output, previous) && previous == out.str()) return 0;
+    std::ofstream file(output, std::ios::binary);
+    file << out.str();
+    if (!file) {
+        std::cerr << "cannot write " << output << "\n";
+        return 1;
+    }
+    return 0;
+}
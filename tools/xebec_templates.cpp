@@ -0,0 +1,282 @@
+// Compiles {{key}} templates into a C++ header, as a build step:
+//
+//     g++ -O2 -std=c++17 -o xebec_templates tools/xebec_templates.cpp
+//     xebec_templates --dir templates --namespace pages -o generated/pages.hpp index.html users/profile.html
+//
+// Each template becomes a struct with one std::string_view per placeholder and
+// render(), render_size() and a map-based entry point for CompiledTemplateEngine.
+// The text between placeholders is kept in constexpr string_views, and
+// render_size() adds their precomputed length to the lengths of the values, so
+// the output is allocated once. Output matches SimpleTemplateEngine: values are
+// inserted as they are, and placeholders missing from a map are left in place.
+// A placeholder that is a C++ keyword gets a field with a "_" appended:
+// {{class}} is set through `class_`, and still looked up as "class" in a map.
+// Other placeholders that are not identifiers get one made from their key:
+// {{user.name}} is set through `user_name` and {{ spaced }} through `spaced`.
+#include <algorithm>
+#include <cstdio>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Piece {
+    bool placeholder;
+    std::string text;   // literal text or placeholder key
+    std::string field;  // the placeholder's struct member
+};
+
+struct CompiledTemplate {
+    std::string name;        // as passed to server.render()
+    std::string identifier;  // index_html
+    std::string type;        // IndexHtml
+    std::vector<Piece> pieces;
+    std::vector<std::string> keys;
+    std::vector<std::string> fields;  // keys[i] is set through fields[i]
+};
+
+bool is_keyword(const std::string& word) {
+    static const char* const keywords[] = {
+        "alignas", "alignof", "and", "and_eq", "asm", "auto", "bitand", "bitor", "bool", "break", "case",
+        "catch", "char", "char8_t", "char16_t", "char32_t", "class", "compl", "concept", "const", "consteval",
+        "constexpr", "constinit", "const_cast", "continue", "co_await", "co_return", "co_yield", "decltype",
+        "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export", "extern",
+        "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new",
+        "noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public",
+        "register", "reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static",
+        "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+        "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile",
+        "wchar_t", "while", "xor", "xor_eq"};
+    return std::find(std::begin(keywords), std::end(keywords), word) != std::end(keywords);
+}
+
+// The struct member for a new placeholder `key`: the key with each run of
+// other characters turned into "_" and trimmed, with "_" appended while it is a
+// keyword or the member of another key already has that name.
+std::string make_field(const CompiledTemplate& compiled, const std::string& key) {
+    std::string field;
+    bool separated = false;
+    for (char c : key) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            if (separated && !field.empty()) field += '_';
+            field += c;
+            separated = false;
+        } else {
+            separated = true;
+        }
+    }
+    if (field.empty() || std::isdigit(static_cast<unsigned char>(field[0]))) field = "field_" + field;
+    while (is_keyword(field) ||
+           std::find(compiled.fields.begin(), compiled.fields.end(), field) != compiled.fields.end()) {
+        field += '_';
+    }
+    return field;
+}
+
+// "users/profile.html" -> "users_profile_html" and "UsersProfileHtml".
+void make_names(CompiledTemplate& compiled) {
+    bool word_start = true;
+    for (char c : compiled.name) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            compiled.identifier += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            compiled.type += word_start ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : c;
+            word_start = false;
+        } else {
+            if (!compiled.identifier.empty() && compiled.identifier.back() != '_') compiled.identifier += '_';
+            word_start = true;
+        }
+    }
+    if (compiled.identifier.empty() || std::isdigit(static_cast<unsigned char>(compiled.identifier[0]))) {
+        compiled.identifier = "t_" + compiled.identifier;
+        compiled.type = "T" + compiled.type;
+    }
+}
+
+void parse(const std::string& content, CompiledTemplate& compiled) {
+    size_t pos = 0;
+    std::string literal;
+    while (pos < content.size()) {
+        size_t open = content.find("{{", pos);
+        size_t close = open == std::string::npos ? std::string::npos : content.find("}}", open + 2);
+        if (close == std::string::npos) break;
+        // The innermost "{{" is the one SimpleTemplateEngine finds: "{{{x}}}" is "{" + x + "}".
+        open = content.rfind("{{", close - 2);
+        std::string key = content.substr(open + 2, close - open - 2);
+        literal.append(content, pos, open - pos);
+        if (!literal.empty()) compiled.pieces.push_back({false, literal, std::string()});
+        literal.clear();
+        auto known = std::find(compiled.keys.begin(), compiled.keys.end(), key);
+        if (known == compiled.keys.end()) {
+            compiled.fields.push_back(make_field(compiled, key));
+            compiled.keys.push_back(key);
+            known = compiled.keys.end() - 1;
+        }
+        compiled.pieces.push_back({true, key, compiled.fields[static_cast<size_t>(known - compiled.keys.begin())]});
+        pos = close + 2;
+    }
+    literal.append(content, pos, std::string::npos);
+    if (!literal.empty()) compiled.pieces.push_back({false, literal, std::string()});
+}
+
+// A string literal, split after each newline of the text.
+std::string quote(const std::string& text) {
+    std::string out = "\"";
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += static_cast<char>(c);
+        } else if (c == '\n') {
+            out += "\\n";
+            if (i + 1 < text.size()) out += "\"\n        \"";
+        } else if (c < 0x20 || c >= 0x7F) {
+            char escaped[5];
+            std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+            out += escaped;
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out + "\"";
+}
+
+void write_template(std::ostream& out, const CompiledTemplate& compiled) {
+    const std::string chunks = "detail_" + compiled.identifier;
+    out << "// " << compiled.name << "\n";
+    out << "struct " << compiled.type << " {\n";
+    for (const std::string& field : compiled.fields) out << "    std::string_view " << field << ";\n";
+    out << "};\n\n";
+
+    out << "namespace " << chunks << " {\n";
+    size_t literal_size = 0;
+    size_t chunk = 0;
+    for (const Piece& piece : compiled.pieces) {
+        if (piece.placeholder) continue;
+        out << "inline constexpr std::string_view chunk" << chunk++ << "{\n        " << quote(piece.text) << ", "
+            << piece.text.size() << "};\n";
+        literal_size += piece.text.size();
+    }
+    for (size_t i = 0; i < compiled.keys.size(); i++) {
+        out << "inline constexpr std::string_view placeholder_" << compiled.fields[i] << " = "
+            << quote("{{" + compiled.keys[i] + "}}") << ";\n";
+    }
+    out << "inline constexpr size_t literal_size = " << literal_size << ";\n";
+    out << "} // namespace " << chunks << "\n\n";
+
+    out << "// The exact length of the output.\n";
+    out << "inline size_t render_size(const " << compiled.type << "& vars) {\n";
+    out << "    return " << chunks << "::literal_size";
+    for (const Piece& piece : compiled.pieces) {
+        if (piece.placeholder) out << " + vars." << piece.field << ".size()";
+    }
+    out << ";\n}\n\n";
+
+    out << "inline void render(const " << compiled.type << "& vars, std::string& out) {\n";
+    out << "    out.reserve(out.size() + render_size(vars));\n";
+    chunk = 0;
+    for (const Piece& piece : compiled.pieces) {
+        if (piece.placeholder) out << "    out.append(vars." << piece.field << ");\n";
+        else out << "    out.append(" << chunks << "::chunk" << chunk++ << ");\n";
+    }
+    if (compiled.pieces.empty()) out << "    (void)vars;\n";
+    out << "}\n\n";
+
+    out << "inline std::string render(const " << compiled.type << "& vars) {\n";
+    out << "    std::string out;\n";
+    out << "    render(vars, out);\n";
+    out << "    return out;\n";
+    out << "}\n\n";
+
+    out << "inline std::string render_" << compiled.identifier
+        << "(const std::map<std::string, std::string>& vars) {\n";
+    out << "    " << compiled.type << " typed;\n";
+    for (size_t i = 0; i < compiled.keys.size(); i++) {
+        const std::string& field = compiled.fields[i];
+        out << "    " << (i == 0 ? "auto found" : "found") << " = vars.find(" << quote(compiled.keys[i]) << ");\n";
+        out << "    typed." << field << " = found != vars.end() ? std::string_view(found->second) : " << chunks
+            << "::placeholder_" << field << ";\n";
+    }
+    if (compiled.keys.empty()) out << "    (void)vars;\n";
+    out << "    return render(typed);\n";
+    out << "}\n\n";
+}
+
+int usage() {
+    std::cerr << "usage: xebec_templates [--dir <template dir>] [--namespace <name>] [--include <template.hpp>]\n"
+                 "                       -o <output.hpp> <template>...\n";
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string dir = ".";
+    std::string name_space = "templates";
+    std::string include = "xebec/features/template.hpp";
+    std::string output;
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--dir" && has_value) dir = argv[++i];
+        else if (arg == "--namespace" && has_value) name_space = argv[++i];
+        else if (arg == "--include" && has_value) include = argv[++i];
+        else if (arg == "-o" && has_value) output = argv[++i];
+        else if (!arg.empty() && arg[0] == '-') return usage();
+        else names.push_back(arg);
+    }
+    if (output.empty() || names.empty()) return usage();
+
+    std::vector<CompiledTemplate> compiled(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        std::ifstream file(dir + "/" + names[i], std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "cannot read " << dir << "/" << names[i] << "\n";
+            return 1;
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        compiled[i].name = names[i];
+        make_names(compiled[i]);
+        parse(content.str(), compiled[i]);
+        for (size_t j = 0; j < i; j++) {
+            if (compiled[j].identifier == compiled[i].identifier) {
+                std::cerr << names[j] << " and " << names[i] << " map to the same name\n";
+                return 1;
+            }
+        }
+    }
+
+    std::ostringstream out;
+    out << "// Generated by tools/xebec_templates.cpp. Do not edit.\n";
+    out << "#pragma once\n";
+    out << "#include <cstddef>\n#include <map>\n#include <string>\n#include <string_view>\n";
+    out << "#include \"" << include << "\"\n\n";
+    out << "namespace " << name_space << " {\n\n";
+    for (const CompiledTemplate& each : compiled) write_template(out, each);
+    out << "inline void register_templates(xebec::CompiledTemplateEngine& engine) {\n";
+    for (const CompiledTemplate& each : compiled) {
+        out << "    engine.add(\"" << each.name << "\", render_" << each.identifier << ");\n";
+    }
+    out << "}\n\n";
+    out << "} // namespace " << name_space << "\n";
+
+    // Rewritten only when it changes, so dependents are not rebuilt needlessly.
+    std::ifstream existing(output, std::ios::binary);
+    if (existing.is_open()) {
+        std::stringstream previous;
+        previous << existing.rdbuf();
+        if (previous.str() == out.str()) return 0;
+    }
+    std::ofstream file(output, std::ios::binary);
+    file << out.str();
+    if (!file) {
+        std::cerr << "cannot write " << output << "\n";
+        return 1;
+    }
+    return 0;
+}